@@ -0,0 +1,60 @@
+#include "FramePacketQueue.h"
+
+#include <algorithm>
+
+namespace AppCore
+{
+FramePacketQueue::FramePacketQueue(uint32_t packetCount)
+    : m_packetCount{std::max(packetCount, 1u)}
+{
+}
+
+uint32_t FramePacketQueue::beginWrite()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_packetRead.wait(lock, [this]() { return m_isClosed || m_writtenCount - m_readCount < m_packetCount; });
+
+  return (uint32_t)(m_writtenCount % m_packetCount);
+}
+
+void FramePacketQueue::endWrite()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_writtenCount++;
+  }
+  m_packetWritten.notify_one();
+}
+
+std::optional<uint32_t> FramePacketQueue::beginRead()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_packetWritten.wait(lock, [this]() { return m_isClosed || m_readCount < m_writtenCount; });
+
+  if (m_isClosed)
+  {
+    return std::nullopt;
+  }
+
+  return (uint32_t)(m_readCount % m_packetCount);
+}
+
+void FramePacketQueue::endRead()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_readCount++;
+  }
+  m_packetRead.notify_one();
+}
+
+void FramePacketQueue::close()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isClosed = true;
+  }
+  m_packetWritten.notify_all();
+  m_packetRead.notify_all();
+}
+} // namespace AppCore
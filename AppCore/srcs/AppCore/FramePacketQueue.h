@@ -0,0 +1,43 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+namespace AppCore
+{
+/** @brief Hands frame packet slots from the simulation thread to the render thread in order.
+           The simulation can be at most packetCount frames ahead, a slot stays owned by the render thread until endRead. */
+class FramePacketQueue
+{
+public:
+  explicit FramePacketQueue(uint32_t packetCount);
+
+  uint32_t getPacketCount() const
+  {
+    return m_packetCount;
+  }
+
+  /** @brief Blocks until a slot is free and returns its index. */
+  uint32_t beginWrite();
+  void endWrite();
+
+  /** @brief Blocks until a packet is published, nullopt once the queue is closed. */
+  std::optional<uint32_t> beginRead();
+  void endRead();
+
+  void close();
+
+private:
+  const uint32_t m_packetCount;
+
+  std::mutex m_mutex;
+  std::condition_variable m_packetWritten;
+  std::condition_variable m_packetRead;
+
+  uint64_t m_writtenCount = 0;
+  uint64_t m_readCount = 0;
+  bool m_isClosed = false;
+};
+} // namespace AppCore
@@ -0,0 +1,286 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+namespace AppCore
+{
+namespace
+{
+struct ThreadRegistration
+{
+  const JobSystem* m_jobSystem = nullptr;
+  uint32_t m_threadIndex = JobSystem::c_externalThreadIndex;
+};
+
+thread_local ThreadRegistration t_registration;
+} // namespace
+
+JobSystem::JobSystem(uint32_t threadCount)
+{
+  if (threadCount == 0)
+  {
+    threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  for (uint32_t i = 0; i < threadCount; i++)
+  {
+    auto threadData = std::make_unique<ThreadData>();
+    threadData->m_random.seed(i + 1);
+    m_threadData.push_back(std::move(threadData));
+  }
+
+  m_previousJobSystem = t_registration.m_jobSystem;
+  m_previousThreadIndex = t_registration.m_threadIndex;
+  t_registration = {this, 0};
+
+  for (uint32_t i = 1; i < threadCount; i++)
+  {
+    m_threads.emplace_back(&JobSystem::workerMain, this, i);
+  }
+}
+
+JobSystem::~JobSystem()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+    m_isExiting = true;
+  }
+  m_wakeCondition.notify_all();
+
+  for (auto& thread : m_threads)
+  {
+    thread.join();
+  }
+
+  t_registration = {m_previousJobSystem, m_previousThreadIndex};
+}
+
+uint32_t JobSystem::getThreadIndex() const
+{
+  return t_registration.m_jobSystem == this ? t_registration.m_threadIndex : c_externalThreadIndex;
+}
+
+JobSystem::Job* JobSystem::allocateJob()
+{
+  auto threadIndex = getThreadIndex();
+  auto& freeJobs = threadIndex != c_externalThreadIndex ? m_threadData[threadIndex]->m_freeJobs : m_externalFreeJobs;
+  auto& jobs = threadIndex != c_externalThreadIndex ? m_threadData[threadIndex]->m_jobs : m_externalJobs;
+
+  if (freeJobs.empty() && threadIndex != c_externalThreadIndex)
+  {
+    // Only the owner pops, taking the whole stack cannot suffer from ABA.
+    for (auto job = m_threadData[threadIndex]->m_returnedJobs.exchange(nullptr, std::memory_order_acquire); job; job = job->m_nextReturnedJob)
+    {
+      freeJobs.push_back(job);
+    }
+  }
+
+  if (!freeJobs.empty())
+  {
+    auto job = freeJobs.back();
+    freeJobs.pop_back();
+    return job;
+  }
+
+  jobs.push_back(std::make_unique<Job>());
+  jobs.back()->m_ownerIndex = threadIndex;
+  return jobs.back().get();
+}
+
+void JobSystem::freeJob(Job* job)
+{
+  if (job->m_ownerIndex == c_externalThreadIndex)
+  {
+    std::lock_guard<std::mutex> lock(m_externalMutex);
+    m_externalFreeJobs.push_back(job);
+  }
+  else if (job->m_ownerIndex == getThreadIndex())
+  {
+    m_threadData[job->m_ownerIndex]->m_freeJobs.push_back(job);
+  }
+  else
+  {
+    auto& returnedJobs = m_threadData[job->m_ownerIndex]->m_returnedJobs;
+    job->m_nextReturnedJob = returnedJobs.load(std::memory_order_relaxed);
+    while (!returnedJobs.compare_exchange_weak(job->m_nextReturnedJob, job, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+  }
+}
+
+void JobSystem::run(std::function<void()> function, JobCounter* counter, const JobCounter* dependency)
+{
+  if (counter)
+  {
+    counter->m_count.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  if (dependency)
+  {
+    function = [this, dependency, function = std::move(function)]() {
+      wait(*dependency);
+      function();
+    };
+  }
+
+  auto threadIndex = getThreadIndex();
+
+  Job* job = nullptr;
+  if (threadIndex != c_externalThreadIndex)
+  {
+    job = allocateJob();
+    job->m_function = std::move(function);
+    job->m_counter = counter;
+
+    m_queuedJobCount.fetch_add(1);
+    if (!m_threadData[threadIndex]->m_queue.push(job))
+    {
+      // The queue is full, running the job right away keeps the memory bounded.
+      m_queuedJobCount.fetch_sub(1);
+      execute(job);
+      return;
+    }
+  }
+  else
+  {
+    std::lock_guard<std::mutex> lock(m_externalMutex);
+    job = allocateJob();
+    job->m_function = std::move(function);
+    job->m_counter = counter;
+
+    m_queuedJobCount.fetch_add(1);
+    m_externalQueuedJobCount.fetch_add(1);
+    m_externalQueue.push_back(job);
+  }
+
+  if (m_sleepingThreadCount.load() > 0)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_wakeCondition.notify_one();
+  }
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t batchSize, std::function<void(uint32_t begin, uint32_t end)> function, JobCounter* counter)
+{
+  batchSize = std::max(batchSize, 1u);
+
+  auto sharedFunction = std::make_shared<std::function<void(uint32_t, uint32_t)>>(std::move(function));
+  for (uint32_t begin = 0; begin < count; begin += batchSize)
+  {
+    auto end = std::min(begin + batchSize, count);
+    run([sharedFunction, begin, end]() { (*sharedFunction)(begin, end); }, counter);
+  }
+}
+
+void JobSystem::execute(Job* job)
+{
+  job->m_function();
+  job->m_function = nullptr;
+
+  if (job->m_counter)
+  {
+    job->m_counter->m_count.fetch_sub(1, std::memory_order_release);
+  }
+
+  freeJob(job);
+}
+
+JobSystem::Job* JobSystem::tryTakeJob()
+{
+  auto threadIndex = getThreadIndex();
+
+  if (threadIndex != c_externalThreadIndex)
+  {
+    if (auto job = m_threadData[threadIndex]->m_queue.pop())
+    {
+      return *job;
+    }
+  }
+
+  // Steal from the other threads, starting at a random one so the thieves spread.
+  auto threadCount = getThreadCount();
+  auto firstVictim = threadIndex != c_externalThreadIndex ? m_threadData[threadIndex]->m_random() : (uint32_t)std::hash<std::thread::id>{}(std::this_thread::get_id());
+  for (uint32_t i = 0; i < threadCount; i++)
+  {
+    auto victimIndex = (firstVictim + i) % threadCount;
+    if (victimIndex == threadIndex)
+    {
+      continue;
+    }
+
+    if (auto job = m_threadData[victimIndex]->m_queue.steal())
+    {
+      return *job;
+    }
+  }
+
+  if (m_externalQueuedJobCount.load(std::memory_order_relaxed) > 0)
+  {
+    std::lock_guard<std::mutex> lock(m_externalMutex);
+    if (!m_externalQueue.empty())
+    {
+      auto job = m_externalQueue.front();
+      m_externalQueue.pop_front();
+      m_externalQueuedJobCount.fetch_sub(1, std::memory_order_relaxed);
+      return job;
+    }
+  }
+
+  return nullptr;
+}
+
+bool JobSystem::tryRunJob()
+{
+  auto job = tryTakeJob();
+  if (!job)
+  {
+    return false;
+  }
+
+  m_queuedJobCount.fetch_sub(1);
+  execute(job);
+
+  return true;
+}
+
+void JobSystem::wait(const JobCounter& counter)
+{
+  while (!counter.isDone())
+  {
+    if (!tryRunJob())
+    {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void JobSystem::workerMain(uint32_t threadIndex)
+{
+  t_registration = {this, threadIndex};
+
+  uint32_t idleSpinCount = 0;
+  while (!m_isExiting.load(std::memory_order_relaxed))
+  {
+    if (tryRunJob())
+    {
+      idleSpinCount = 0;
+      continue;
+    }
+
+    if (++idleSpinCount < c_spinCountBeforeSleep)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    // The sleeping count is published before the queued count is read, and run() does the opposite, so a wake up cannot be missed.
+    std::unique_lock<std::mutex> lock(m_sleepMutex);
+    m_sleepingThreadCount.fetch_add(1);
+    m_wakeCondition.wait(lock, [this]() { return m_isExiting.load() || m_queuedJobCount.load() > 0; });
+    m_sleepingThreadCount.fetch_sub(1);
+    idleSpinCount = 0;
+  }
+}
+} // namespace AppCore
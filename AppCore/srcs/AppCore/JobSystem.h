@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Utility/WorkStealingDeque.h"
+
+namespace AppCore
+{
+/** @brief Counts the jobs still running in a group. A job can wait on a counter to depend on the group. */
+class JobCounter
+{
+public:
+  bool isDone() const
+  {
+    return m_count.load(std::memory_order_acquire) == 0;
+  }
+
+private:
+  friend class JobSystem;
+
+  std::atomic<uint32_t> m_count{0};
+};
+
+/** @brief Work stealing job system. Each thread owns a Chase-Lev deque, idle threads steal from the others.
+           The thread that creates the job system is thread 0 and runs jobs when it waits on a counter.
+           Standalone, only runJobSystemBenchmark drives it. The renderer runs its parallel work on VulkanRecordingWorkers. */
+class JobSystem
+{
+public:
+  static constexpr uint32_t c_externalThreadIndex = ~0u;
+
+  /** @brief threadCount includes the calling thread, 0 means one thread per hardware thread. */
+  explicit JobSystem(uint32_t threadCount = 0);
+  ~JobSystem();
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  uint32_t getThreadCount() const
+  {
+    return (uint32_t)m_threadData.size();
+  }
+
+  /** @brief Index of the calling thread, c_externalThreadIndex if it is not one of the job system threads. */
+  uint32_t getThreadIndex() const;
+
+  /** @brief counter is incremented now and decremented once the job ran. The job first waits on dependency if there is one. */
+  void run(std::function<void()> function, JobCounter* counter = nullptr, const JobCounter* dependency = nullptr);
+
+  /** @brief Splits [0, count) in jobs of batchSize elements. */
+  void parallelFor(uint32_t count, uint32_t batchSize, std::function<void(uint32_t begin, uint32_t end)> function, JobCounter* counter);
+
+  /** @brief Runs other jobs until the counter reaches zero. */
+  void wait(const JobCounter& counter);
+
+private:
+  static constexpr uint32_t c_queueCapacity = 4096;
+  static constexpr uint32_t c_spinCountBeforeSleep = 64;
+
+  struct Job
+  {
+    std::function<void()> m_function;
+    JobCounter* m_counter = nullptr;
+    uint32_t m_ownerIndex = c_externalThreadIndex; // Thread that allocated the job, it goes back to its free list.
+    Job* m_nextReturnedJob = nullptr;
+  };
+
+  // A job always returns to the thread that allocated it, so a thread's pool only grows with its own peak of jobs in flight.
+  // Jobs run by other threads are pushed on m_returnedJobs, the owner takes the whole stack at once when its free list is empty.
+  struct ThreadData
+  {
+    WorkStealingDeque<Job*, c_queueCapacity> m_queue;
+    std::vector<Job*> m_freeJobs;
+    std::atomic<Job*> m_returnedJobs{nullptr};
+    std::vector<std::unique_ptr<Job>> m_jobs;
+    std::minstd_rand m_random;
+  };
+
+  Job* allocateJob();
+  void freeJob(Job* job);
+  void execute(Job* job);
+  bool tryRunJob();
+  Job* tryTakeJob();
+  void workerMain(uint32_t threadIndex);
+
+  std::vector<std::unique_ptr<ThreadData>> m_threadData;
+  std::vector<std::thread> m_threads;
+
+  // Jobs pushed by threads that are not part of the job system.
+  std::mutex m_externalMutex;
+  std::deque<Job*> m_externalQueue;
+  std::vector<Job*> m_externalFreeJobs;
+  std::vector<std::unique_ptr<Job>> m_externalJobs;
+  std::atomic<uint32_t> m_externalQueuedJobCount{0};
+
+  std::atomic<uint32_t> m_queuedJobCount{0};
+  std::atomic<uint32_t> m_sleepingThreadCount{0};
+  std::mutex m_sleepMutex;
+  std::condition_variable m_wakeCondition;
+  std::atomic<bool> m_isExiting{false};
+
+  // Registration of the creating thread before this job system, restored on destruction so job systems can nest.
+  const JobSystem* m_previousJobSystem = nullptr;
+  uint32_t m_previousThreadIndex = c_externalThreadIndex;
+};
+} // namespace AppCore
@@ -0,0 +1,117 @@
+#include "JobSystemBenchmark.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AppCore/JobSystem.h"
+
+namespace AppCore
+{
+namespace
+{
+template <typename... Args_t>
+void print(const char* format, Args_t... args)
+{
+  const auto size = std::snprintf(nullptr, 0, format, args...);
+  std::string output(size + 1, '\0');
+  std::snprintf(output.data(), output.size(), format, args...);
+  std::cout << output.c_str();
+}
+
+void benchmarkThroughput(uint32_t threadCount, uint32_t jobCount)
+{
+  JobSystem jobSystem(threadCount);
+  std::atomic<uint32_t> executedJobCount{0};
+
+  // Empty jobs spawned from the main thread, everything else has to be stolen.
+  auto start = std::chrono::high_resolution_clock::now();
+  JobCounter counter;
+  for (uint32_t i = 0; i < jobCount; i++)
+  {
+    jobSystem.run([&executedJobCount]() { executedJobCount.fetch_add(1, std::memory_order_relaxed); }, &counter);
+  }
+  jobSystem.wait(counter);
+  auto flatTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+  // Jobs that spawn jobs, the work fans out from every thread.
+  constexpr uint32_t fanOut = 64;
+  start = std::chrono::high_resolution_clock::now();
+  JobCounter nestedCounter;
+  for (uint32_t i = 0; i < jobCount / fanOut; i++)
+  {
+    jobSystem.run(
+        [&]() {
+          for (uint32_t j = 0; j < fanOut; j++)
+          {
+            jobSystem.run([&executedJobCount]() { executedJobCount.fetch_add(1, std::memory_order_relaxed); }, &nestedCounter);
+          }
+        },
+        &nestedCounter);
+  }
+  jobSystem.wait(nestedCounter);
+  auto nestedTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+  print("  %2u threads: %7.2f Mjobs/s flat, %7.2f Mjobs/s nested\n", threadCount, jobCount / flatTime / 1e6, (jobCount / fanOut) * (fanOut + 1) / nestedTime / 1e6);
+}
+
+void benchmarkStealLatency(uint32_t sampleCount)
+{
+  JobSystem jobSystem(2);
+
+  std::vector<double> spinningLatencies;
+  std::vector<double> sleepingLatencies;
+
+  for (uint32_t i = 0; i < sampleCount; i++)
+  {
+    // Every other sample lets the worker go to sleep first, to also measure the wake up.
+    auto isSleepingSample = (i % 2) == 1;
+    if (isSleepingSample)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::atomic<int64_t> executionTime{0};
+    auto pushTime = std::chrono::high_resolution_clock::now();
+    jobSystem.run([&executionTime]() { executionTime.store(std::chrono::high_resolution_clock::now().time_since_epoch().count(), std::memory_order_release); });
+
+    // Spin without helping so the job has to be stolen by the worker.
+    while (executionTime.load(std::memory_order_acquire) == 0)
+    {
+    }
+
+    auto latency = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::duration(executionTime.load() - pushTime.time_since_epoch().count())).count();
+    (isSleepingSample ? sleepingLatencies : spinningLatencies).push_back(latency);
+  }
+
+  for (auto* latencies : {&spinningLatencies, &sleepingLatencies})
+  {
+    std::sort(begin(*latencies), end(*latencies));
+  }
+
+  print("  steal latency, worker spinning: median %8.2f us, p99 %8.2f us\n", spinningLatencies[spinningLatencies.size() / 2], spinningLatencies[spinningLatencies.size() * 99 / 100]);
+  print("  steal latency, worker sleeping: median %8.2f us, p99 %8.2f us\n", sleepingLatencies[sleepingLatencies.size() / 2], sleepingLatencies[sleepingLatencies.size() * 99 / 100]);
+}
+} // namespace
+
+void runJobSystemBenchmark(uint32_t jobCount, uint32_t stealSampleCount)
+{
+  std::cout << "Job system benchmark, " << jobCount << " jobs" << std::endl;
+
+  auto hardwareThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+  for (uint32_t threadCount = 1; threadCount <= hardwareThreadCount; threadCount *= 2)
+  {
+    benchmarkThroughput(threadCount, jobCount);
+  }
+
+  if (hardwareThreadCount > 1)
+  {
+    benchmarkStealLatency(std::max(stealSampleCount, 2u));
+  }
+}
+} // namespace AppCore
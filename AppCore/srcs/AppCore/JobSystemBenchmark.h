@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+
+namespace AppCore
+{
+/** @brief Prints the job throughput for 1 to N threads and the latency for an idle thread to steal a job. */
+void runJobSystemBenchmark(uint32_t jobCount, uint32_t stealSampleCount);
+} // namespace AppCore
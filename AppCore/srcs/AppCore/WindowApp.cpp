@@ -132,11 +132,50 @@ void WindowApp::showInfoMessageBox(const wchar_t* msg)
   MessageBox(nullptr, msg, m_applicationName.c_str(), MB_ICONINFORMATION);
 }
 
+void WindowApp::enableRenderThread(uint32_t framePacketCount)
+{
+  m_framePackets = std::make_unique<FramePacketQueue>(framePacketCount);
+}
+
+void WindowApp::renderThreadMain()
+{
+  try
+  {
+    while (auto packetIndex = m_framePackets->beginRead())
+    {
+      render(*packetIndex);
+      m_framePackets->endRead();
+    }
+  }
+  catch (...)
+  {
+    // Rethrown on the main thread, closing the queue unblocks it.
+    m_renderThreadException = std::current_exception();
+    m_hasRenderThreadFailed = true;
+    m_framePackets->close();
+  }
+}
+
+void WindowApp::stopRenderThread()
+{
+  if (m_renderThread.joinable())
+  {
+    m_framePackets->close();
+    m_renderThread.join();
+  }
+}
+
 int WindowApp::run()
 {
   MSG systemMsg{};
+  auto returnCode = EXIT_SUCCESS;
   try
   {
+    if (m_framePackets)
+    {
+      m_renderThread = std::thread(&WindowApp::renderThreadMain, this);
+    }
+
     while (true)
     {
       while (::PeekMessage(&systemMsg, nullptr, 0, 0, PM_REMOVE))
@@ -162,16 +201,37 @@ int WindowApp::run()
 
         update();
       });
-      render();
+
+      if (m_framePackets)
+      {
+        // Blocks only when the render thread is framePacketCount frames behind.
+        auto packetIndex = m_framePackets->beginWrite();
+        if (m_hasRenderThreadFailed)
+        {
+          std::rethrow_exception(m_renderThreadException);
+        }
+
+        writeFramePacket(packetIndex);
+        m_framePackets->endWrite();
+      }
+      else
+      {
+        writeFramePacket(0);
+        render(0);
+      }
     }
+
+    returnCode = (int)systemMsg.wParam;
   }
   catch (const std::runtime_error& e)
   {
     std::cerr << e.what() << std::endl;
-    return EXIT_FAILURE;
+    returnCode = EXIT_FAILURE;
   }
 
-  return (int)systemMsg.wParam;
+  stopRenderThread();
+
+  return returnCode;
 }
 
 LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
@@ -9,8 +9,13 @@
 // Windows Header Files:
 #include <windows.h>
 
+#include <atomic>
+#include <exception>
+#include <memory>
 #include <string>
+#include <thread>
 
+#include "AppCore/FramePacketQueue.h"
 #include "Utility/Timer.h"
 
 namespace AppCore
@@ -28,14 +33,25 @@ public:
 
   int run();
 
+  /** @brief Simulation step, runs on the thread calling run(). */
   virtual void update() {}
-  virtual void render() {}
+
+  /** @brief Copies what the renderer needs from the simulation into the packet slot. Runs on the thread calling run(). */
+  virtual void writeFramePacket(uint32_t packetIndex) {}
+
+  /** @brief Renders the packet. Runs on the render thread in threaded mode, right after writeFramePacket otherwise. */
+  virtual void render(uint32_t packetIndex) {}
 
 protected:
   HINSTANCE getHInstance() const { return m_windowInstance; }
 
   HWND getWindowHandle() const { return m_window; }
 
+  const StepTimer& getTimer() const { return m_timer; }
+
+  /** @brief Must be called before run(). The simulation produces frame N+1 while the render thread renders frame N. */
+  void enableRenderThread(uint32_t framePacketCount);
+
   std::string getApplicationName() const
   {
     int size_needed = WideCharToMultiByte(CP_UTF8, 0, m_applicationName.data(), (int)m_applicationName.size(), nullptr, 0, nullptr, nullptr);
@@ -50,6 +66,9 @@ private:
   friend LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
   int64_t handleMessages(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
+  void renderThreadMain();
+  void stopRenderThread();
+
   HINSTANCE m_windowInstance = {};
   HWND m_window = {};
   WNDCLASSEX m_windowClassEx = {};
@@ -62,5 +81,11 @@ private:
   uint32_t m_windowPosY = 64;
 
   StepTimer m_timer;
+
+  // Threaded mode only.
+  std::unique_ptr<FramePacketQueue> m_framePackets;
+  std::thread m_renderThread;
+  std::exception_ptr m_renderThreadException;
+  std::atomic<bool> m_hasRenderThreadFailed{false};
 };
 } // namespace AppCore
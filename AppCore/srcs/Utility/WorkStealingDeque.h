@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+
+// Chase-Lev work stealing deque with a fixed capacity, with the memory orderings of
+// "Correct and Efficient Work-Stealing for Weak Memory Models" (Le, Pop, Cohen, Zappa Nardelli 2013).
+// push and pop are only called by the owner thread, steal can be called by any thread.
+template <typename T, uint32_t Capacity>
+class WorkStealingDeque
+{
+  static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+  static_assert(std::is_trivially_copyable_v<T>, "Items are copied in and out of atomics.");
+
+public:
+  // Returns false if the deque is full, the caller keeps the item.
+  bool push(T item)
+  {
+    auto bottom = m_bottom.load(std::memory_order_relaxed);
+    auto top = m_top.load(std::memory_order_acquire);
+    if (bottom - top >= (int64_t)Capacity)
+    {
+      return false;
+    }
+
+    m_items[bottom & c_mask].store(item, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_bottom.store(bottom + 1, std::memory_order_relaxed);
+
+    return true;
+  }
+
+  // Takes the most recently pushed item.
+  std::optional<T> pop()
+  {
+    auto bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto top = m_top.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+      m_bottom.store(bottom + 1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+
+    auto item = m_items[bottom & c_mask].load(std::memory_order_relaxed);
+    if (top == bottom)
+    {
+      // Last item, race against the thieves for it.
+      auto isWon = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+      m_bottom.store(bottom + 1, std::memory_order_relaxed);
+      if (!isWon)
+      {
+        return std::nullopt;
+      }
+    }
+
+    return item;
+  }
+
+  // Takes the oldest item.
+  std::optional<T> steal()
+  {
+    auto top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto bottom = m_bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom)
+    {
+      return std::nullopt;
+    }
+
+    auto item = m_items[top & c_mask].load(std::memory_order_relaxed);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+      return std::nullopt;
+    }
+
+    return item;
+  }
+
+  // Approximate when other threads are pushing or stealing.
+  uint32_t size() const
+  {
+    auto bottom = m_bottom.load(std::memory_order_relaxed);
+    auto top = m_top.load(std::memory_order_relaxed);
+    return bottom > top ? (uint32_t)(bottom - top) : 0;
+  }
+
+private:
+  static constexpr int64_t c_mask = Capacity - 1;
+
+  alignas(64) std::atomic<int64_t> m_top{0};
+  alignas(64) std::atomic<int64_t> m_bottom{0};
+  alignas(64) std::array<std::atomic<T>, Capacity> m_items;
+};
@@ -1,7 +1,14 @@
 #include "TriangleApp.h"
 
-TriangleApp::TriangleApp(HINSTANCE windowInstance)
+#include <stdexcept>
+#include <utility>
+
+#include "AppCore/JobSystemBenchmark.h"
+#include "VkHal/VkRendererBenchmarks.h"
+
+TriangleApp::TriangleApp(HINSTANCE windowInstance, std::vector<std::string> benchmarkNames)
     : WindowApp(windowInstance, true, L"Triangle Win APP")
+    , m_benchmarkNames(std::move(benchmarkNames))
 {
 }
 
@@ -13,17 +20,49 @@ void TriangleApp::initialize(uint32_t windowWidth, uint32_t windowHeight)
 
   constexpr bool isHeadless = false;
   constexpr bool enableValidation = true;
+  constexpr bool isRenderThreaded = true;
+  constexpr uint32_t framePacketCount = 2;
   m_gfxSystem = std::make_unique<VkHal::VkRenderer>(isHeadless, enableValidation, getApplicationName());
   m_gfxSystem->initialize(getHInstance(), getWindowHandle());
   m_gfxSystem->prepare(windowWidth, windowHeight);
+
+  m_framePackets.resize(isRenderThreaded ? framePacketCount : 1);
+  if (isRenderThreaded)
+  {
+    enableRenderThread(framePacketCount);
+  }
+
+  // Benchmarks run on the prepared renderer instead of the frame loop, the app quits once they are done.
+  if (!m_benchmarkNames.empty())
+  {
+    VkHal::VkRendererBenchmarks rendererBenchmarks(*m_gfxSystem);
+    for (const auto& benchmarkName : m_benchmarkNames)
+    {
+      if (benchmarkName == "job-system")
+      {
+        AppCore::runJobSystemBenchmark(1 << 20, 1000);
+      }
+      else if (!rendererBenchmarks.run(benchmarkName))
+      {
+        throw std::runtime_error("Unknown benchmark " + benchmarkName + ".");
+      }
+    }
+    PostQuitMessage(EXIT_SUCCESS);
+  }
 }
 
 void TriangleApp::update()
 {
-  m_gfxSystem->update();
+  m_simulationTimeInSeconds = getTimer().GetTotalSeconds();
+}
+
+void TriangleApp::writeFramePacket(uint32_t packetIndex)
+{
+  m_framePackets[packetIndex].m_simulationTimeInSeconds = m_simulationTimeInSeconds;
+  VkHal::VkRenderer::writeDebugGuiInput(m_framePackets[packetIndex]);
 }
 
-void TriangleApp::render()
+void TriangleApp::render(uint32_t packetIndex)
 {
-  m_gfxSystem->render();
+  m_gfxSystem->render(m_framePackets[packetIndex]);
 }
\ No newline at end of file
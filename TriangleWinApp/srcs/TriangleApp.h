@@ -1,6 +1,8 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "AppCore/WindowApp.h"
 
@@ -9,13 +11,20 @@
 class TriangleApp final : public AppCore::WindowApp
 {
 public:
-  TriangleApp(HINSTANCE windowInstance);
+  /** @brief Runs the named benchmarks once the renderer is prepared and quits, see VkRendererBenchmarks::run. "job-system" runs the job system one. */
+  TriangleApp(HINSTANCE windowInstance, std::vector<std::string> benchmarkNames);
   ~TriangleApp() override;
 
 private:
   void initialize(uint32_t windowWidth, uint32_t windowHeight) final;
   void update() final;
-  void render() final;
+  void writeFramePacket(uint32_t packetIndex) final;
+  void render(uint32_t packetIndex) final;
+
+  std::vector<std::string> m_benchmarkNames;
+
+  double m_simulationTimeInSeconds = 0.0;
+  std::vector<VkHal::VkFramePacket> m_framePackets;
 
   std::unique_ptr<VkHal::VkRenderer> m_gfxSystem; // vkRenderer is not the gfxSytstem but when I implement it the gfx system should own the specific impl of the renderer
 };
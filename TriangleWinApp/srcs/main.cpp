@@ -12,6 +12,9 @@
 #include <io.h>
 
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "TriangleApp.h"
 
@@ -140,13 +143,28 @@ Console console{true, true, true};
 
 std::unique_ptr<AppCore::WindowApp> app;
 
+/** @brief Names given with --benchmark <name>, the option can be repeated. */
+std::vector<std::string> parseBenchmarkNames(int argc, char** argv)
+{
+  std::vector<std::string> benchmarkNames;
+  for (int i = 1; i < argc; i++)
+  {
+    if (std::string(argv[i]) != "--benchmark" || i + 1 == argc)
+    {
+      throw std::runtime_error("Usage: TriangleWinApp [--benchmark <name>]...");
+    }
+    benchmarkNames.push_back(argv[++i]);
+  }
+  return benchmarkNames;
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nShowCmd)
 {
   auto returnCode = EXIT_SUCCESS;
   try
   {
 
-    app = std::make_unique<TriangleApp>(hInstance);
+    app = std::make_unique<TriangleApp>(hInstance, parseBenchmarkNames(__argc, __argv));
 
     uint32_t width = 1280;
     uint32_t height = 720;
@@ -17,7 +17,6 @@
 #include "VkHal/VkRenderer.h"
 #include "VkHal/Vulkan/VulkanUtils.h"
 
-extern LRESULT ImGui_ImplWin32_WndProcHandler(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 namespace VkHal
 {
 void CheckVkresult(VkResult result)
@@ -26,15 +25,72 @@ void CheckVkresult(VkResult result)
 }
 
 WNDPROC originalProc{};
+HWND guiWindow{};
+
+// Only touched by the thread pumping the window messages, the render thread gets the events through the frame packets.
+std::vector<DevGuiInputEvent> pendingInput;
 
 LRESULT WINAPI WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
-  if (ImGui_ImplWin32_WndProcHandler(hWnd, msg, wParam, lParam))
-    return true;
+  switch (msg)
+  {
+  case WM_LBUTTONDOWN:
+  case WM_LBUTTONDBLCLK:
+  case WM_RBUTTONDOWN:
+  case WM_RBUTTONDBLCLK:
+  case WM_MBUTTONDOWN:
+  case WM_MBUTTONDBLCLK:
+    // The capture belongs to the thread owning the window, a drag leaving the window keeps its mouse up.
+    if (::GetCapture() == nullptr)
+    {
+      ::SetCapture(hWnd);
+    }
+    pendingInput.push_back({msg, wParam, lParam});
+    break;
+  case WM_LBUTTONUP:
+  case WM_RBUTTONUP:
+  case WM_MBUTTONUP:
+    if ((wParam & (MK_LBUTTON | MK_RBUTTON | MK_MBUTTON)) == 0 && ::GetCapture() == hWnd)
+    {
+      ::ReleaseCapture();
+    }
+    pendingInput.push_back({msg, wParam, lParam});
+    break;
+  case WM_MOUSEWHEEL:
+  case WM_MOUSEHWHEEL:
+  case WM_KEYDOWN:
+  case WM_SYSKEYDOWN:
+  case WM_KEYUP:
+  case WM_SYSKEYUP:
+  case WM_CHAR:
+    pendingInput.push_back({msg, wParam, lParam});
+    break;
+  default:
+    break;
+  }
 
   return CallWindowProc(originalProc, hWnd, msg, wParam, lParam);
 }
 
+void DevGuiRenderer::takeInput(DevGuiInput& input)
+{
+  input.m_events.swap(pendingInput);
+  pendingInput.clear();
+
+  // What ImGui_ImplWin32_NewFrame reads, sampled here where GetActiveWindow and GetKeyState see the window's input.
+  input.m_mouseX = -FLT_MAX;
+  input.m_mouseY = -FLT_MAX;
+  POINT cursorPosition{};
+  if (guiWindow && ::GetActiveWindow() == guiWindow && ::GetCursorPos(&cursorPosition) && ::ScreenToClient(guiWindow, &cursorPosition))
+  {
+    input.m_mouseX = (float)cursorPosition.x;
+    input.m_mouseY = (float)cursorPosition.y;
+  }
+  input.m_keyCtrl = (::GetKeyState(VK_CONTROL) & 0x8000) != 0;
+  input.m_keyShift = (::GetKeyState(VK_SHIFT) & 0x8000) != 0;
+  input.m_keyAlt = (::GetKeyState(VK_MENU) & 0x8000) != 0;
+}
+
 DevGuiRenderer::DevGuiRenderer(vk::Instance* instance, VulkanDevice* device, uint32_t graphicsQueueFamily, vk::Queue& graphicsQueue)
     : m_instance{instance}
     , m_device{device}
@@ -52,6 +108,7 @@ DevGuiRenderer::~DevGuiRenderer()
 
 void DevGuiRenderer::prepare(HWND windowHandle, VulkanSwapchain* swapchain)
 {
+  guiWindow = windowHandle;
   originalProc = (WNDPROC)SetWindowLongPtr(windowHandle, GWLP_WNDPROC, (int64_t)WndProc);
 
   ImGui::CreateContext();
@@ -70,7 +127,7 @@ void DevGuiRenderer::prepare(HWND windowHandle, VulkanSwapchain* swapchain)
   init_info.Device = m_device->getDevice();
   init_info.QueueFamily = m_graphicsQueueFamily;
   init_info.Queue = m_graphicsQueue;
-  init_info.PipelineCache = nullptr;
+  init_info.PipelineCache = m_device->getPipelineCache().getCache();
   init_info.DescriptorPool = m_descriptorPool.get();
   init_info.Allocator = nullptr;
   init_info.CheckVkResultFn = &CheckVkresult;
@@ -83,12 +140,25 @@ void DevGuiRenderer::prepare(HWND windowHandle, VulkanSwapchain* swapchain)
   UploadFonts();
 }
 
-void DevGuiRenderer::startFrame()
+void DevGuiRenderer::startFrame(const VulkanFrameStats& frameStats, const DevGuiInput& input)
 {
+  for (const auto& event : input.m_events)
+  {
+    applyInput(event);
+  }
+
   ImGui_ImplWin32_NewFrame();
+
+  // The backend queried the cursor and the modifiers on this thread, where they always read as outside and released.
+  ImGuiIO& io = ImGui::GetIO();
+  io.MousePos = ImVec2(input.m_mouseX, input.m_mouseY);
+  io.KeyCtrl = input.m_keyCtrl;
+  io.KeyShift = input.m_keyShift;
+  io.KeyAlt = input.m_keyAlt;
+
   ImGui::NewFrame();
 
-  statsGui();
+  statsGui(frameStats);
 }
 
 void DevGuiRenderer::recordCommandBuffers(const VulkanCurrentFrameResources& currentFrameResources)
@@ -160,6 +230,13 @@ void DevGuiRenderer::createRenderPass(vk::Format surfaceFormat)
   m_renderPass = m_device->getDevice().createRenderPassUnique(renderPassCreateInfo);
 }
 
+void DevGuiRenderer::recreateFramebuffers(VulkanSwapchain* swapchain)
+{
+  // In flight frames may still use the old framebuffers.
+  m_device->getTimeline().retire(std::move(m_framebuffers));
+  createFramebuffer(swapchain);
+}
+
 void DevGuiRenderer::createFramebuffer(VulkanSwapchain* swapchain)
 {
   auto extent = swapchain->getSwapchainExtent();
@@ -197,12 +274,70 @@ void DevGuiRenderer::UploadFonts()
   ImGui_ImplVulkan_InvalidateFontUploadObjects();
 }
 
-void DevGuiRenderer::statsGui()
+void DevGuiRenderer::applyInput(const DevGuiInputEvent& event)
+{
+  // Same handling as ImGui_ImplWin32_WndProcHandler, without the mouse capture the window thread already took.
+  ImGuiIO& io = ImGui::GetIO();
+  switch (event.m_message)
+  {
+  case WM_LBUTTONDOWN:
+  case WM_LBUTTONDBLCLK:
+    io.MouseDown[0] = true;
+    break;
+  case WM_RBUTTONDOWN:
+  case WM_RBUTTONDBLCLK:
+    io.MouseDown[1] = true;
+    break;
+  case WM_MBUTTONDOWN:
+  case WM_MBUTTONDBLCLK:
+    io.MouseDown[2] = true;
+    break;
+  case WM_LBUTTONUP:
+    io.MouseDown[0] = false;
+    break;
+  case WM_RBUTTONUP:
+    io.MouseDown[1] = false;
+    break;
+  case WM_MBUTTONUP:
+    io.MouseDown[2] = false;
+    break;
+  case WM_MOUSEWHEEL:
+    io.MouseWheel += (float)GET_WHEEL_DELTA_WPARAM(event.m_wParam) / (float)WHEEL_DELTA;
+    break;
+  case WM_MOUSEHWHEEL:
+    io.MouseWheelH += (float)GET_WHEEL_DELTA_WPARAM(event.m_wParam) / (float)WHEEL_DELTA;
+    break;
+  case WM_KEYDOWN:
+  case WM_SYSKEYDOWN:
+    if (event.m_wParam < 256)
+    {
+      io.KeysDown[event.m_wParam] = 1;
+    }
+    break;
+  case WM_KEYUP:
+  case WM_SYSKEYUP:
+    if (event.m_wParam < 256)
+    {
+      io.KeysDown[event.m_wParam] = 0;
+    }
+    break;
+  case WM_CHAR:
+    if (event.m_wParam > 0 && event.m_wParam < 0x10000)
+    {
+      io.AddInputCharacter((unsigned short)event.m_wParam);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+void DevGuiRenderer::statsGui(const VulkanFrameStats& frameStats)
 {
   ImGuiIO& io = ImGui::GetIO();
 
-  ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x - 120.0f, 20.0f));
-  ImGui::SetNextWindowSize(ImVec2(100.0f, 100.0));
+  ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x - 200.0f, 20.0f));
+  ImGui::SetNextWindowSize(ImVec2(180.0f, 140.0));
   ImGui::Begin("Stats", nullptr, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoScrollbar);
 
   static bool show_fps = true;
@@ -234,6 +369,13 @@ void DevGuiRenderer::statsGui()
     //ImGui::PlotHistogram("", histogram.data(), static_cast<int>(histogram.size()), 0, nullptr, 0.0f, FLT_MAX, ImVec2(85.0f, 30.0f));
   }
 
+  ImGui::Separator();
+  ImGui::Text("Draws   %u", frameStats.m_drawCount);
+  ImGui::Text("Tris    %u", frameStats.m_triangleCount);
+  ImGui::Text("Record  %.3f ms", frameStats.m_recordingTimeMs);
+  ImGui::Text("Workers %u", frameStats.m_recordingWorkerCount);
+  ImGui::Text("Texture mip %u, %.1f MB", frameStats.m_textureResidentMip, frameStats.m_textureResidentMB);
+
   ImGui::End();
 }
 
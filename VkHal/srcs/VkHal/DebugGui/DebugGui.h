@@ -9,7 +9,9 @@
 // Windows Header Files:
 #include <windows.h>
 
+#include <cfloat>
 #include <cstdint>
+#include <vector>
 
 #include <vulkan/vulkan.hpp>
 
@@ -18,10 +20,36 @@
 namespace VkHal
 {
 struct VulkanCurrentFrameResources;
+struct VulkanFrameStats;
+
+/** @brief Window message for the GUI, recorded by the window procedure and replayed on the thread that builds the GUI frame. */
+struct DevGuiInputEvent
+{
+  UINT m_message = 0;
+  WPARAM m_wParam = 0;
+  LPARAM m_lParam = 0;
+};
+
+/**
+ * @brief GUI input of one frame: the window messages since the previous one and the state sampled on the window thread.
+ * The cursor position and the key state are per thread in Win32, the thread building the GUI frame cannot query them.
+ */
+struct DevGuiInput
+{
+  std::vector<DevGuiInputEvent> m_events;
+  float m_mouseX = -FLT_MAX; // Client space, -FLT_MAX while the window is not the active one.
+  float m_mouseY = -FLT_MAX;
+  bool m_keyCtrl = false;
+  bool m_keyShift = false;
+  bool m_keyAlt = false;
+};
 
 class DevGuiRenderer
 {
 public:
+  /** @brief Moves the input received since the previous call into input and samples the cursor and modifiers. Called on the thread pumping the window messages. */
+  static void takeInput(DevGuiInput& input);
+
   DevGuiRenderer(vk::Instance* instance, VulkanDevice* device, uint32_t graphicsQueueFamily, vk::Queue& graphicsQueue);
   ~DevGuiRenderer();
 
@@ -29,14 +57,17 @@ public:
   DevGuiRenderer& operator=(DevGuiRenderer&&) = default;
 
   void prepare(HWND windowHandle, VulkanSwapchain* swapchain);
-  void startFrame();
+  void recreateFramebuffers(VulkanSwapchain* swapchain);
+  /** @brief Replays the input before starting the frame, ImGui's context is only touched by the thread calling this. */
+  void startFrame(const VulkanFrameStats& frameStats, const DevGuiInput& input);
   void recordCommandBuffers(const VulkanCurrentFrameResources& currentFrameResources);
 
 private:
   void createRenderPass(vk::Format surfaceFormat);
   void createFramebuffer(VulkanSwapchain* swapchain);
   void UploadFonts();
-  void statsGui();
+  void applyInput(const DevGuiInputEvent& event);
+  void statsGui(const VulkanFrameStats& frameStats);
 
   vk::Instance* m_instance;
   VulkanDevice* m_device;
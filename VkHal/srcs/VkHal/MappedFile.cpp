@@ -0,0 +1,90 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+#include <utility>
+
+#include <SDKDDKVer.h>
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+namespace VkHal
+{
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+  m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (m_file == INVALID_HANDLE_VALUE)
+  {
+    m_file = nullptr;
+    throw std::runtime_error("Failed to open " + path.u8string());
+  }
+
+  LARGE_INTEGER fileSize{};
+  if (!GetFileSizeEx(m_file, &fileSize))
+  {
+    close();
+    throw std::runtime_error("Failed to get the size of " + path.u8string());
+  }
+  m_size = (size_t)fileSize.QuadPart;
+
+  // An empty file cannot be mapped, it stays a valid object with no data.
+  if (m_size == 0)
+  {
+    return;
+  }
+
+  m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  m_view = m_mapping ? MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+  if (!m_view)
+  {
+    close();
+    throw std::runtime_error("Failed to map " + path.u8string());
+  }
+}
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : m_file{std::exchange(other.m_file, nullptr)}
+    , m_mapping{std::exchange(other.m_mapping, nullptr)}
+    , m_view{std::exchange(other.m_view, nullptr)}
+    , m_size{std::exchange(other.m_size, 0)}
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+  if (this != &other)
+  {
+    close();
+    m_file = std::exchange(other.m_file, nullptr);
+    m_mapping = std::exchange(other.m_mapping, nullptr);
+    m_view = std::exchange(other.m_view, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+  }
+  return *this;
+}
+
+void MappedFile::close()
+{
+  if (m_view)
+  {
+    UnmapViewOfFile(m_view);
+    m_view = nullptr;
+  }
+  if (m_mapping)
+  {
+    CloseHandle(m_mapping);
+    m_mapping = nullptr;
+  }
+  if (m_file)
+  {
+    CloseHandle(m_file);
+    m_file = nullptr;
+  }
+  m_size = 0;
+}
+} // namespace VkHal
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace VkHal
+{
+/** @brief Read only memory mapping of a whole file. The pages are loaded by the OS on first access. */
+class MappedFile
+{
+public:
+  explicit MappedFile(const std::filesystem::path& path);
+  ~MappedFile();
+
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const uint8_t* getData() const
+  {
+    return static_cast<const uint8_t*>(m_view);
+  }
+
+  size_t getSize() const
+  {
+    return m_size;
+  }
+
+private:
+  void close();
+
+  // Win32 handles, kept as void* so windows.h stays out of the header.
+  void* m_file = nullptr;
+  void* m_mapping = nullptr;
+  const void* m_view = nullptr;
+  size_t m_size = 0;
+};
+} // namespace VkHal
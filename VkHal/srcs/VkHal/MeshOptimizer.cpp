@@ -0,0 +1,383 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "VkHal/VkMesh.h"
+
+namespace VkHal
+{
+namespace
+{
+// https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+constexpr uint32_t c_forsythCacheSize = 32;
+constexpr float c_forsythCacheDecayPower = 1.5f;
+constexpr float c_forsythLastTriangleScore = 0.75f;
+constexpr float c_forsythValenceBoostScale = 2.0f;
+constexpr float c_forsythValenceBoostPower = 0.5f;
+
+constexpr uint32_t c_invalidIndex = std::numeric_limits<uint32_t>::max();
+
+float forsythVertexScore(int32_t cachePosition, uint32_t remainingValence)
+{
+  if (remainingValence == 0)
+  {
+    // No triangle left to draw with this vertex.
+    return -1.0f;
+  }
+
+  float score = 0.0f;
+  if (cachePosition >= 0)
+  {
+    if (cachePosition < 3)
+    {
+      // Used by the last triangle, fixed score so it is not favored too much over the rest of the cache.
+      score = c_forsythLastTriangleScore;
+    }
+    else
+    {
+      const float scaler = 1.0f / (c_forsythCacheSize - 3);
+      score = std::pow(1.0f - (cachePosition - 3) * scaler, c_forsythCacheDecayPower);
+    }
+  }
+
+  // Vertices with few triangles left are finished first so they leave the cache for good.
+  score += c_forsythValenceBoostScale * std::pow((float)remainingValence, -c_forsythValenceBoostPower);
+  return score;
+}
+
+/** @brief FIFO cache simulation, returns the number of cache misses of the triangle. */
+class FifoCache
+{
+public:
+  FifoCache(size_t vertexCount, uint32_t cacheSize)
+      : m_timestamps(vertexCount, 0)
+      , m_cacheSize{cacheSize}
+  {
+  }
+
+  uint32_t addTriangle(const uint32_t* triangle)
+  {
+    uint32_t missCount = 0;
+    for (uint32_t i = 0; i < 3; i++)
+    {
+      auto vertex = triangle[i];
+      // A vertex is in the cache when it was pushed less than cacheSize pushes ago.
+      if (m_time - m_timestamps[vertex] >= m_cacheSize || m_timestamps[vertex] == 0)
+      {
+        m_timestamps[vertex] = ++m_time;
+        missCount++;
+      }
+    }
+    return missCount;
+  }
+
+  void reset()
+  {
+    // Ageing the clock flushes the whole cache without touching the timestamps.
+    m_time += m_cacheSize + 1;
+  }
+
+private:
+  std::vector<uint32_t> m_timestamps;
+  uint32_t m_cacheSize;
+  uint32_t m_time = 0;
+};
+} // namespace
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+  VertexCacheStats stats{};
+  stats.m_triangleCount = (uint32_t)(indexCount / 3);
+
+  FifoCache cache(vertexCount, cacheSize);
+  for (size_t i = 0; i + 2 < indexCount; i += 3)
+  {
+    stats.m_transformedVertexCount += cache.addTriangle(indices + i);
+  }
+
+  std::vector<bool> isReferenced(vertexCount, false);
+  for (size_t i = 0; i < indexCount; i++)
+  {
+    if (!isReferenced[indices[i]])
+    {
+      isReferenced[indices[i]] = true;
+      stats.m_referencedVertexCount++;
+    }
+  }
+
+  return stats;
+}
+
+void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+  const size_t triangleCount = indexCount / 3;
+  if (triangleCount == 0)
+  {
+    return;
+  }
+
+  // Triangles of every vertex, packed with a prefix sum over the valences.
+  std::vector<uint32_t> remainingValence(vertexCount, 0);
+  for (size_t i = 0; i < triangleCount * 3; i++)
+  {
+    remainingValence[indices[i]]++;
+  }
+
+  std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+  for (size_t vertex = 0; vertex < vertexCount; vertex++)
+  {
+    adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + remainingValence[vertex];
+  }
+
+  std::vector<uint32_t> adjacency(triangleCount * 3);
+  {
+    auto fillOffsets = adjacencyOffsets;
+    for (size_t triangle = 0; triangle < triangleCount; triangle++)
+    {
+      for (size_t i = 0; i < 3; i++)
+      {
+        adjacency[fillOffsets[indices[triangle * 3 + i]]++] = (uint32_t)triangle;
+      }
+    }
+  }
+
+  std::vector<int32_t> cachePositions(vertexCount, -1);
+  std::vector<float> vertexScores(vertexCount);
+  for (size_t vertex = 0; vertex < vertexCount; vertex++)
+  {
+    vertexScores[vertex] = forsythVertexScore(-1, remainingValence[vertex]);
+  }
+
+  std::vector<float> triangleScores(triangleCount);
+  std::vector<bool> isTriangleEmitted(triangleCount, false);
+  for (size_t triangle = 0; triangle < triangleCount; triangle++)
+  {
+    triangleScores[triangle] = vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+  }
+
+  std::vector<uint32_t> output;
+  output.reserve(triangleCount * 3);
+
+  // LRU cache model, three extra slots for the vertices pushed by the triangle being added.
+  std::vector<uint32_t> cache;
+  std::vector<uint32_t> nextCache;
+  cache.reserve(c_forsythCacheSize + 3);
+  nextCache.reserve(c_forsythCacheSize + 3);
+
+  size_t searchCursor = 0;
+  auto bestTriangle = c_invalidIndex;
+  while (output.size() < triangleCount * 3)
+  {
+    if (bestTriangle == c_invalidIndex)
+    {
+      // Nothing left around the cache, restart from the next triangle not drawn yet.
+      while (isTriangleEmitted[searchCursor])
+      {
+        searchCursor++;
+      }
+      bestTriangle = (uint32_t)searchCursor;
+    }
+
+    const uint32_t* triangleIndices = indices + bestTriangle * 3;
+    output.insert(output.end(), triangleIndices, triangleIndices + 3);
+    isTriangleEmitted[bestTriangle] = true;
+
+    nextCache.assign(triangleIndices, triangleIndices + 3);
+    for (auto vertex : cache)
+    {
+      if (vertex != triangleIndices[0] && vertex != triangleIndices[1] && vertex != triangleIndices[2])
+      {
+        nextCache.push_back(vertex);
+      }
+    }
+
+    for (size_t i = 0; i < 3; i++)
+    {
+      auto vertex = triangleIndices[i];
+      remainingValence[vertex]--;
+
+      // Drops the triangle from the adjacency of the vertex.
+      auto begin = adjacency.begin() + adjacencyOffsets[vertex];
+      auto end = begin + remainingValence[vertex] + 1;
+      std::iter_swap(std::find(begin, end, bestTriangle), end - 1);
+    }
+
+    // Only the triangles touching the cache change score.
+    for (size_t position = 0; position < nextCache.size(); position++)
+    {
+      auto vertex = nextCache[position];
+      cachePositions[vertex] = position < c_forsythCacheSize ? (int32_t)position : -1;
+
+      auto newScore = forsythVertexScore(cachePositions[vertex], remainingValence[vertex]);
+      auto scoreDelta = newScore - vertexScores[vertex];
+      vertexScores[vertex] = newScore;
+
+      for (uint32_t i = 0; i < remainingValence[vertex]; i++)
+      {
+        triangleScores[adjacency[adjacencyOffsets[vertex] + i]] += scoreDelta;
+      }
+    }
+
+    // The best one is picked among them once all their scores are up to date.
+    auto bestScore = -1.0f;
+    bestTriangle = c_invalidIndex;
+    for (size_t position = 0; position < std::min<size_t>(nextCache.size(), c_forsythCacheSize); position++)
+    {
+      auto vertex = nextCache[position];
+      for (uint32_t i = 0; i < remainingValence[vertex]; i++)
+      {
+        auto triangle = adjacency[adjacencyOffsets[vertex] + i];
+        if (triangleScores[triangle] > bestScore)
+        {
+          bestScore = triangleScores[triangle];
+          bestTriangle = triangle;
+        }
+      }
+    }
+
+    if (nextCache.size() > c_forsythCacheSize)
+    {
+      nextCache.resize(c_forsythCacheSize);
+    }
+    std::swap(cache, nextCache);
+  }
+
+  std::copy(output.begin(), output.end(), indices);
+}
+
+void optimizeOverdraw(uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, float threshold)
+{
+  // https://gfx.cs.princeton.edu/pubs/Sander_2007_%3ETR/tipsy.pdf
+  const size_t triangleCount = indexCount / 3;
+  if (triangleCount == 0)
+  {
+    return;
+  }
+
+  const auto meshAcmr = analyzeVertexCache(indices, indexCount, vertexCount).getAcmr();
+
+  // Cluster boundaries, keeping the cache efficiency of the input within the threshold.
+  std::vector<uint32_t> clusterStarts;
+  {
+    FifoCache cache(vertexCount, c_vertexCacheSize);
+    uint32_t clusterMissCount = 0;
+    uint32_t clusterTriangleCount = 0;
+    for (size_t triangle = 0; triangle < triangleCount; triangle++)
+    {
+      auto missCount = cache.addTriangle(indices + triangle * 3);
+
+      // Three misses means the cache restarts here, cutting costs nothing.
+      auto isHardBoundary = missCount == 3;
+      auto isSoftBoundary = clusterTriangleCount > 0 && (float)clusterMissCount / clusterTriangleCount <= meshAcmr * threshold && missCount > 0;
+      if (triangle == 0 || isHardBoundary || isSoftBoundary)
+      {
+        clusterStarts.push_back((uint32_t)triangle);
+        if (!isHardBoundary)
+        {
+          // A soft cut starts the next cluster with a cold cache, the simulation has to see it too.
+          cache.reset();
+          missCount = cache.addTriangle(indices + triangle * 3);
+        }
+        clusterMissCount = 0;
+        clusterTriangleCount = 0;
+      }
+
+      clusterMissCount += missCount;
+      clusterTriangleCount++;
+    }
+  }
+  clusterStarts.push_back((uint32_t)triangleCount);
+
+  const size_t clusterCount = clusterStarts.size() - 1;
+  if (clusterCount < 2)
+  {
+    return;
+  }
+
+  // Area weighted centroid and normal of each cluster and of the mesh.
+  std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3{0.0f});
+  std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3{0.0f});
+  std::vector<float> clusterAreas(clusterCount, 0.0f);
+  glm::vec3 meshCentroid{0.0f};
+  float meshArea = 0.0f;
+  for (size_t cluster = 0; cluster < clusterCount; cluster++)
+  {
+    for (auto triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; triangle++)
+    {
+      const auto& p0 = vertices[indices[triangle * 3]].pos;
+      const auto& p1 = vertices[indices[triangle * 3 + 1]].pos;
+      const auto& p2 = vertices[indices[triangle * 3 + 2]].pos;
+
+      auto normal = glm::cross(p1 - p0, p2 - p0); // Length is twice the area.
+      auto area = glm::length(normal);
+      auto centroid = (p0 + p1 + p2) / 3.0f;
+
+      clusterCentroids[cluster] += centroid * area;
+      clusterNormals[cluster] += normal;
+      clusterAreas[cluster] += area;
+    }
+
+    meshCentroid += clusterCentroids[cluster];
+    meshArea += clusterAreas[cluster];
+  }
+  meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3{0.0f};
+
+  // Clusters facing away from the center are more likely to occlude the others, they draw first.
+  std::vector<float> sortKeys(clusterCount);
+  for (size_t cluster = 0; cluster < clusterCount; cluster++)
+  {
+    auto centroid = clusterAreas[cluster] > 0.0f ? clusterCentroids[cluster] / clusterAreas[cluster] : meshCentroid;
+    auto normalLength = glm::length(clusterNormals[cluster]);
+    auto normal = normalLength > 0.0f ? clusterNormals[cluster] / normalLength : glm::vec3{0.0f};
+    sortKeys[cluster] = glm::dot(centroid - meshCentroid, normal);
+  }
+
+  std::vector<uint32_t> clusterOrder(clusterCount);
+  for (size_t cluster = 0; cluster < clusterCount; cluster++)
+  {
+    clusterOrder[cluster] = (uint32_t)cluster;
+  }
+  std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](uint32_t lhs, uint32_t rhs) { return sortKeys[lhs] > sortKeys[rhs]; });
+
+  std::vector<uint32_t> output;
+  output.reserve(triangleCount * 3);
+  for (auto cluster : clusterOrder)
+  {
+    output.insert(output.end(), indices + clusterStarts[cluster] * 3, indices + clusterStarts[cluster + 1] * 3);
+  }
+  std::copy(output.begin(), output.end(), indices);
+}
+
+void optimizeVertexFetch(Vertex* vertices, uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+  std::vector<uint32_t> remap(vertexCount, c_invalidIndex);
+  uint32_t nextVertex = 0;
+  for (size_t i = 0; i < indexCount; i++)
+  {
+    auto& newIndex = remap[indices[i]];
+    if (newIndex == c_invalidIndex)
+    {
+      newIndex = nextVertex++;
+    }
+    indices[i] = newIndex;
+  }
+
+  for (auto& newIndex : remap)
+  {
+    if (newIndex == c_invalidIndex)
+    {
+      newIndex = nextVertex++;
+    }
+  }
+
+  std::vector<Vertex> reordered(vertexCount);
+  for (size_t vertex = 0; vertex < vertexCount; vertex++)
+  {
+    reordered[remap[vertex]] = vertices[vertex];
+  }
+  std::copy(reordered.begin(), reordered.end(), vertices);
+}
+} // namespace VkHal
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace VkHal
+{
+struct Vertex;
+
+constexpr uint32_t c_vertexCacheSize = 16; // FIFO size used for the statistics, close to the post transform cache of current GPUs.
+
+/** @brief Result of the post transform cache simulation. ACMR is transformed vertices per triangle, ATVR transformed per referenced vertex, 1.0 at best. */
+struct VertexCacheStats
+{
+  uint32_t m_transformedVertexCount = 0;
+  uint32_t m_triangleCount = 0;
+  uint32_t m_referencedVertexCount = 0;
+
+  float getAcmr() const
+  {
+    return m_triangleCount ? (float)m_transformedVertexCount / m_triangleCount : 0.0f;
+  }
+
+  float getAtvr() const
+  {
+    return m_referencedVertexCount ? (float)m_transformedVertexCount / m_referencedVertexCount : 0.0f;
+  }
+
+  VertexCacheStats& operator+=(const VertexCacheStats& other)
+  {
+    m_transformedVertexCount += other.m_transformedVertexCount;
+    m_triangleCount += other.m_triangleCount;
+    m_referencedVertexCount += other.m_referencedVertexCount;
+    return *this;
+  }
+};
+
+struct MeshOptimizationStats
+{
+  VertexCacheStats m_before;
+  VertexCacheStats m_after;
+};
+
+/** @brief Simulates a FIFO post transform cache over a triangle list. */
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = c_vertexCacheSize);
+
+/** @brief Reorders the triangles for the post transform cache, Tom Forsyth's linear speed vertex cache optimisation. */
+void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+/**
+ * @brief Reorders clusters of an already cache optimized triangle list so outer facing ones draw first.
+ * Clusters are cut where the cache restarts anyway, or where the ACMR of the cluster stays under threshold times the one of the mesh.
+ */
+void optimizeOverdraw(uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, float threshold = 1.05f);
+
+/** @brief Moves the vertices to their first use order and remaps the indices. Unreferenced vertices end up last so the vertex count does not change. */
+void optimizeVertexFetch(Vertex* vertices, uint32_t* indices, size_t indexCount, size_t vertexCount);
+} // namespace VkHal
@@ -0,0 +1,312 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <tuple>
+#include <vector>
+
+#include "VkHal/VkMesh.h"
+
+namespace VkHal
+{
+namespace
+{
+// https://www.cs.cmu.edu/~./garland/Papers/quadrics.pdf
+constexpr float c_flipCosineThreshold = 1e-2f; // A collapse turning a triangle normal by about 90 degrees or more is rejected.
+
+/** @brief Sum of squared distances to planes, as the symmetric matrix A, the vector b and the scalar c of p.A.p + 2 b.p + c, and the total weight of the planes. */
+struct Quadric
+{
+  double m_a00 = 0.0, m_a11 = 0.0, m_a22 = 0.0;
+  double m_a01 = 0.0, m_a02 = 0.0, m_a12 = 0.0;
+  double m_b0 = 0.0, m_b1 = 0.0, m_b2 = 0.0;
+  double m_c = 0.0;
+  double m_weight = 0.0;
+
+  Quadric& operator+=(const Quadric& other)
+  {
+    m_a00 += other.m_a00;
+    m_a11 += other.m_a11;
+    m_a22 += other.m_a22;
+    m_a01 += other.m_a01;
+    m_a02 += other.m_a02;
+    m_a12 += other.m_a12;
+    m_b0 += other.m_b0;
+    m_b1 += other.m_b1;
+    m_b2 += other.m_b2;
+    m_c += other.m_c;
+    m_weight += other.m_weight;
+    return *this;
+  }
+};
+
+Quadric makePlaneQuadric(const glm::dvec3& normal, double distance, double weight)
+{
+  Quadric quadric{};
+  quadric.m_a00 = weight * normal.x * normal.x;
+  quadric.m_a11 = weight * normal.y * normal.y;
+  quadric.m_a22 = weight * normal.z * normal.z;
+  quadric.m_a01 = weight * normal.x * normal.y;
+  quadric.m_a02 = weight * normal.x * normal.z;
+  quadric.m_a12 = weight * normal.y * normal.z;
+  quadric.m_b0 = weight * normal.x * distance;
+  quadric.m_b1 = weight * normal.y * distance;
+  quadric.m_b2 = weight * normal.z * distance;
+  quadric.m_c = weight * distance * distance;
+  quadric.m_weight = weight;
+  return quadric;
+}
+
+/** @brief Weighted mean of the squared distances from the point to the planes. */
+double evaluateQuadric(const Quadric& quadric, const glm::vec3& point)
+{
+  if (quadric.m_weight <= 0.0)
+  {
+    return 0.0;
+  }
+
+  glm::dvec3 p{point};
+  auto error = quadric.m_a00 * p.x * p.x + quadric.m_a11 * p.y * p.y + quadric.m_a22 * p.z * p.z;
+  error += 2.0 * (quadric.m_a01 * p.x * p.y + quadric.m_a02 * p.x * p.z + quadric.m_a12 * p.y * p.z);
+  error += 2.0 * (quadric.m_b0 * p.x + quadric.m_b1 * p.y + quadric.m_b2 * p.z);
+  error += quadric.m_c;
+  return std::abs(error) / quadric.m_weight;
+}
+
+/** @brief Vertices that must not move: on an edge used by a single triangle, or sharing their position with another vertex. */
+std::vector<bool> findLockedVertices(const uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount)
+{
+  std::vector<bool> isLocked(vertexCount, false);
+
+  // Same position with different attributes, moving one side would open the seam.
+  std::vector<uint32_t> sortedVertices(vertexCount);
+  for (uint32_t i = 0; i < vertexCount; i++)
+  {
+    sortedVertices[i] = i;
+  }
+  auto positionKey = [vertices](uint32_t vertex) { return std::make_tuple(vertices[vertex].pos.x, vertices[vertex].pos.y, vertices[vertex].pos.z, vertex); };
+  std::sort(sortedVertices.begin(), sortedVertices.end(), [&](uint32_t left, uint32_t right) { return positionKey(left) < positionKey(right); });
+  for (size_t i = 1; i < vertexCount; i++)
+  {
+    if (vertices[sortedVertices[i]].pos == vertices[sortedVertices[i - 1]].pos)
+    {
+      isLocked[sortedVertices[i]] = true;
+      isLocked[sortedVertices[i - 1]] = true;
+    }
+  }
+
+  // An edge without its opposite half edge is on a border, a hole or the cut of a split mesh.
+  std::vector<uint64_t> halfEdges;
+  halfEdges.reserve(indexCount);
+  for (size_t i = 0; i + 2 < indexCount; i += 3)
+  {
+    for (size_t j = 0; j < 3; j++)
+    {
+      halfEdges.push_back((uint64_t)indices[i + j] << 32 | indices[i + (j + 1) % 3]);
+    }
+  }
+  std::sort(halfEdges.begin(), halfEdges.end());
+  for (auto halfEdge : halfEdges)
+  {
+    auto from = (uint32_t)(halfEdge >> 32);
+    auto to = (uint32_t)halfEdge;
+    if (!std::binary_search(halfEdges.begin(), halfEdges.end(), (uint64_t)to << 32 | from))
+    {
+      isLocked[from] = true;
+      isLocked[to] = true;
+    }
+  }
+
+  return isLocked;
+}
+
+struct Collapse
+{
+  double m_error = 0.0;
+  uint32_t m_from = 0;
+  uint32_t m_to = 0;
+
+  bool operator<(const Collapse& other) const
+  {
+    return std::tie(m_error, m_from, m_to) < std::tie(other.m_error, other.m_from, other.m_to);
+  }
+};
+} // namespace
+
+size_t simplifyMesh(uint32_t* destination, const uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, size_t targetIndexCount, float targetError, float* resultError)
+{
+  indexCount -= indexCount % 3;
+  std::vector<uint32_t> currentIndices(indices, indices + indexCount);
+  auto isLocked = findLockedVertices(indices, indexCount, vertices, vertexCount);
+
+  // The quadrics keep the planes of the original triangles, the error stays measured against the source mesh.
+  std::vector<Quadric> quadrics(vertexCount);
+  for (size_t i = 0; i < indexCount; i += 3)
+  {
+    const auto& p0 = vertices[indices[i]].pos;
+    const auto& p1 = vertices[indices[i + 1]].pos;
+    const auto& p2 = vertices[indices[i + 2]].pos;
+    auto normal = glm::cross(glm::dvec3(p1 - p0), glm::dvec3(p2 - p0));
+    auto doubleArea = glm::length(normal);
+    if (doubleArea == 0.0)
+    {
+      continue;
+    }
+
+    normal /= doubleArea;
+    auto quadric = makePlaneQuadric(normal, -glm::dot(normal, glm::dvec3(p0)), doubleArea * 0.5);
+    for (size_t j = 0; j < 3; j++)
+    {
+      quadrics[indices[i + j]] += quadric;
+    }
+  }
+
+  std::vector<uint32_t> collapseTargets(vertexCount);
+  std::vector<bool> isTouched(vertexCount);
+  std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+  std::vector<uint32_t> vertexTriangles;
+  std::vector<Collapse> collapses;
+  auto maxTargetError = (double)targetError * targetError;
+  double maxError = 0.0;
+
+  auto hasTriangleFlip = [&](uint32_t from, uint32_t to) {
+    const auto& toPosition = vertices[to].pos;
+    for (auto t = triangleOffsets[from]; t < triangleOffsets[from + 1]; t++)
+    {
+      const auto* triangle = currentIndices.data() + vertexTriangles[t] * 3;
+      if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+      {
+        // Collapsed with the edge.
+        continue;
+      }
+
+      std::array<glm::vec3, 3> positions{vertices[triangle[0]].pos, vertices[triangle[1]].pos, vertices[triangle[2]].pos};
+      auto oldNormal = glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+      for (size_t j = 0; j < 3; j++)
+      {
+        if (triangle[j] == from)
+        {
+          positions[j] = toPosition;
+        }
+      }
+      auto newNormal = glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+      if (glm::dot(oldNormal, newNormal) <= c_flipCosineThreshold * glm::length(oldNormal) * glm::length(newNormal))
+      {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  // Each pass collapses the cheapest edges whose neighbourhoods do not overlap, then rebuilds the triangle list.
+  while (currentIndices.size() > targetIndexCount)
+  {
+    const auto triangleCount = currentIndices.size() / 3;
+
+    std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+    for (auto vertex : currentIndices)
+    {
+      triangleOffsets[vertex + 1]++;
+    }
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+      triangleOffsets[i + 1] += triangleOffsets[i];
+    }
+    vertexTriangles.resize(currentIndices.size());
+    {
+      auto writeOffsets = triangleOffsets;
+      for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+      {
+        for (size_t j = 0; j < 3; j++)
+        {
+          vertexTriangles[writeOffsets[currentIndices[triangle * 3 + j]]++] = triangle;
+        }
+      }
+    }
+
+    // Every interior edge shows up in both directions over its two triangles.
+    collapses.clear();
+    for (size_t i = 0; i < currentIndices.size(); i += 3)
+    {
+      for (size_t j = 0; j < 3; j++)
+      {
+        auto from = currentIndices[i + j];
+        auto to = currentIndices[i + (j + 1) % 3];
+        if (!isLocked[from] && from != to)
+        {
+          collapses.push_back({evaluateQuadric(quadrics[from], vertices[to].pos), from, to});
+        }
+      }
+    }
+    std::sort(collapses.begin(), collapses.end());
+
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+      collapseTargets[i] = (uint32_t)i;
+    }
+    std::fill(isTouched.begin(), isTouched.end(), false);
+
+    // A collapse removes the two triangles of its edge.
+    auto removableTriangleCount = (currentIndices.size() - targetIndexCount + 2) / 3;
+    size_t removedTriangleCount = 0;
+    size_t collapseCount = 0;
+    for (const auto& collapse : collapses)
+    {
+      if (collapse.m_error > maxTargetError || removedTriangleCount >= removableTriangleCount)
+      {
+        break;
+      }
+
+      if (isTouched[collapse.m_from] || isTouched[collapse.m_to] || hasTriangleFlip(collapse.m_from, collapse.m_to))
+      {
+        continue;
+      }
+
+      collapseTargets[collapse.m_from] = collapse.m_to;
+      quadrics[collapse.m_to] += quadrics[collapse.m_from];
+      maxError = std::max(maxError, collapse.m_error);
+      collapseCount++;
+
+      // The whole neighbourhood is frozen for the pass, the flip test of the next collapses then sees final positions.
+      for (auto t = triangleOffsets[collapse.m_from]; t < triangleOffsets[collapse.m_from + 1]; t++)
+      {
+        const auto* triangle = currentIndices.data() + vertexTriangles[t] * 3;
+        removedTriangleCount += triangle[0] == collapse.m_to || triangle[1] == collapse.m_to || triangle[2] == collapse.m_to ? 1 : 0;
+        for (size_t j = 0; j < 3; j++)
+        {
+          isTouched[triangle[j]] = true;
+        }
+      }
+    }
+
+    if (collapseCount == 0)
+    {
+      break;
+    }
+
+    size_t writeIndex = 0;
+    for (size_t i = 0; i < currentIndices.size(); i += 3)
+    {
+      auto v0 = collapseTargets[currentIndices[i]];
+      auto v1 = collapseTargets[currentIndices[i + 1]];
+      auto v2 = collapseTargets[currentIndices[i + 2]];
+      if (v0 != v1 && v1 != v2 && v2 != v0)
+      {
+        currentIndices[writeIndex++] = v0;
+        currentIndices[writeIndex++] = v1;
+        currentIndices[writeIndex++] = v2;
+      }
+    }
+    currentIndices.resize(writeIndex);
+  }
+
+  if (resultError)
+  {
+    *resultError = (float)std::sqrt(maxError);
+  }
+
+  std::copy(currentIndices.begin(), currentIndices.end(), destination);
+  return currentIndices.size();
+}
+} // namespace VkHal
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace VkHal
+{
+struct Vertex;
+
+/**
+ * @brief Simplifies a triangle list with quadric error metric edge collapses (Garland and Heckbert) until it has at most targetIndexCount indices or the next collapse would exceed targetError.
+ * Vertices only collapse onto a neighbour so the result indexes the same vertices. Vertices on an open border or on an attribute seam are locked, parts of a split mesh stay watertight.
+ * Writes the indices to destination, which may alias indices, and returns their count. resultError gets the largest error of the applied collapses, a distance in model space.
+ * The collapses are ordered by error then by vertex index, the same input always gives the same result.
+ */
+size_t simplifyMesh(uint32_t* destination, const uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, size_t targetIndexCount, float targetError, float* resultError = nullptr);
+} // namespace VkHal
@@ -0,0 +1,200 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "VkHal/VkMesh.h"
+
+namespace VkHal
+{
+namespace
+{
+// https://github.com/zeux/meshoptimizer, meshopt_computeMeshletBounds
+void computeMeshletBounds(Meshlet& meshlet, const MeshletData& meshletData, const Vertex* vertices)
+{
+  const auto* meshletVertices = meshletData.m_vertices.data() + meshlet.m_firstVertex;
+  const auto* meshletTriangles = meshletData.m_triangles.data() + meshlet.m_firstTriangle * 3;
+
+  // Sphere around the bounding box, close enough to the minimal one for small clusters.
+  auto boundsMin = vertices[meshletVertices[0]].pos;
+  auto boundsMax = boundsMin;
+  for (uint32_t i = 1; i < meshlet.m_vertexCount; i++)
+  {
+    boundsMin = glm::min(boundsMin, vertices[meshletVertices[i]].pos);
+    boundsMax = glm::max(boundsMax, vertices[meshletVertices[i]].pos);
+  }
+  meshlet.m_center = (boundsMin + boundsMax) * 0.5f;
+  meshlet.m_radius = 0.0f;
+  for (uint32_t i = 0; i < meshlet.m_vertexCount; i++)
+  {
+    meshlet.m_radius = std::max(meshlet.m_radius, glm::length(vertices[meshletVertices[i]].pos - meshlet.m_center));
+  }
+
+  std::array<glm::vec3, 3> positions;
+  std::vector<glm::vec3> normals;
+  normals.reserve(meshlet.m_triangleCount);
+  glm::vec3 normalSum{0.0f};
+  for (uint32_t triangle = 0; triangle < meshlet.m_triangleCount; triangle++)
+  {
+    for (uint32_t i = 0; i < 3; i++)
+    {
+      positions[i] = vertices[meshletVertices[meshletTriangles[triangle * 3 + i]]].pos;
+    }
+
+    auto normal = glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+    auto length = glm::length(normal);
+    if (length > 0.0f)
+    {
+      normals.push_back(normal / length);
+      normalSum += normals.back();
+    }
+  }
+
+  meshlet.m_coneAxis = glm::vec3{0.0f};
+  meshlet.m_coneApex = meshlet.m_center;
+  meshlet.m_coneCutoff = 1.0f;
+
+  auto normalSumLength = glm::length(normalSum);
+  if (normals.empty() || normalSumLength == 0.0f)
+  {
+    return;
+  }
+
+  auto axis = normalSum / normalSumLength;
+  auto minDot = 1.0f;
+  for (const auto& normal : normals)
+  {
+    minDot = std::min(minDot, glm::dot(normal, axis));
+  }
+
+  if (minDot <= 0.1f)
+  {
+    // Normals spread over a hemisphere or more, the cone would almost never reject anything.
+    meshlet.m_coneAxis = axis;
+    return;
+  }
+
+  // The apex is pushed back along the axis until every triangle plane is in front of it.
+  auto maxT = 0.0f;
+  uint32_t normalIndex = 0;
+  for (uint32_t triangle = 0; triangle < meshlet.m_triangleCount; triangle++)
+  {
+    const auto& p0 = vertices[meshletVertices[meshletTriangles[triangle * 3]]].pos;
+    const auto& p1 = vertices[meshletVertices[meshletTriangles[triangle * 3 + 1]]].pos;
+    const auto& p2 = vertices[meshletVertices[meshletTriangles[triangle * 3 + 2]]].pos;
+    if (glm::length(glm::cross(p1 - p0, p2 - p0)) == 0.0f)
+    {
+      continue;
+    }
+
+    const auto& normal = normals[normalIndex++];
+    auto t = glm::dot(meshlet.m_center - p0, normal) / glm::dot(axis, normal);
+    maxT = std::max(maxT, t);
+  }
+
+  meshlet.m_coneAxis = axis;
+  meshlet.m_coneApex = meshlet.m_center - axis * maxT;
+  meshlet.m_coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+} // namespace
+
+void buildMeshlets(const uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, MeshletData& meshletData)
+{
+  // Meshlet vertex index of every mesh vertex, valid when its stamp is the current meshlet.
+  std::vector<uint8_t> localIndices(vertexCount);
+  std::vector<uint32_t> meshletStamps(vertexCount, std::numeric_limits<uint32_t>::max());
+
+  const auto firstMeshlet = meshletData.m_meshlets.size();
+  auto startMeshlet = [&]() {
+    Meshlet meshlet{};
+    meshlet.m_firstVertex = (uint32_t)meshletData.m_vertices.size();
+    meshlet.m_firstTriangle = (uint32_t)(meshletData.m_triangles.size() / 3);
+    meshletData.m_meshlets.push_back(meshlet);
+  };
+
+  for (size_t i = 0; i + 2 < indexCount; i += 3)
+  {
+    auto meshletIndex = (uint32_t)meshletData.m_meshlets.size() - 1;
+    uint32_t newVertexCount = 0;
+    for (size_t j = 0; j < 3; j++)
+    {
+      auto vertex = indices[i + j];
+      auto isRepeated = (j > 0 && indices[i] == vertex) || (j > 1 && indices[i + 1] == vertex);
+      auto isInMeshlet = meshletData.m_meshlets.size() > firstMeshlet && meshletStamps[vertex] == meshletIndex;
+      newVertexCount += isInMeshlet || isRepeated ? 0 : 1;
+    }
+
+    if (meshletData.m_meshlets.size() == firstMeshlet || meshletData.m_meshlets.back().m_vertexCount + newVertexCount > c_meshletMaxVertexCount || meshletData.m_meshlets.back().m_triangleCount == c_meshletMaxTriangleCount)
+    {
+      startMeshlet();
+      meshletIndex = (uint32_t)meshletData.m_meshlets.size() - 1;
+    }
+
+    auto& meshlet = meshletData.m_meshlets.back();
+    for (size_t j = 0; j < 3; j++)
+    {
+      auto vertex = indices[i + j];
+      if (meshletStamps[vertex] != meshletIndex)
+      {
+        meshletStamps[vertex] = meshletIndex;
+        localIndices[vertex] = (uint8_t)meshlet.m_vertexCount++;
+        meshletData.m_vertices.push_back(vertex);
+      }
+      meshletData.m_triangles.push_back(localIndices[vertex]);
+    }
+    meshlet.m_triangleCount++;
+  }
+
+  for (auto meshletIndex = firstMeshlet; meshletIndex < meshletData.m_meshlets.size(); meshletIndex++)
+  {
+    computeMeshletBounds(meshletData.m_meshlets[meshletIndex], meshletData, vertices);
+  }
+}
+
+Frustum Frustum::fromViewProjection(const glm::mat4& viewProjection)
+{
+  // http://www.cs.otago.ac.nz/postgrads/alexis/planeExtraction.pdf, with the near plane of a [0, 1] depth range.
+  auto row = [&viewProjection](int i) { return glm::vec4{viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]}; };
+
+  Frustum frustum{};
+  frustum.m_planes[0] = row(3) + row(0);
+  frustum.m_planes[1] = row(3) - row(0);
+  frustum.m_planes[2] = row(3) + row(1);
+  frustum.m_planes[3] = row(3) - row(1);
+  frustum.m_planes[4] = row(2);
+  frustum.m_planes[5] = row(3) - row(2);
+
+  for (auto& plane : frustum.m_planes)
+  {
+    plane /= glm::length(glm::vec3(plane));
+  }
+  return frustum;
+}
+
+MeshletVisibility cullMeshlet(const Meshlet& meshlet, const glm::mat4& worldTransform, float worldScale, const Frustum& frustum, const glm::vec3& modelCameraPosition)
+{
+  auto worldCenter = glm::vec3(worldTransform * glm::vec4(meshlet.m_center, 1.0f));
+  auto worldRadius = meshlet.m_radius * worldScale;
+  for (const auto& plane : frustum.m_planes)
+  {
+    if (glm::dot(glm::vec3(plane), worldCenter) + plane.w < -worldRadius)
+    {
+      return MeshletVisibility::eOutsideFrustum;
+    }
+  }
+
+  // Which side of a plane a point is on does not change under affine transforms, the cone is tested in model space.
+  if (meshlet.m_coneCutoff < 1.0f)
+  {
+    auto toApex = meshlet.m_coneApex - modelCameraPosition;
+    auto distance = glm::length(toApex);
+    if (distance > 0.0f && glm::dot(toApex / distance, meshlet.m_coneAxis) >= meshlet.m_coneCutoff)
+    {
+      return MeshletVisibility::eBackfacing;
+    }
+  }
+
+  return MeshletVisibility::eVisible;
+}
+} // namespace VkHal
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+namespace VkHal
+{
+struct Vertex;
+
+constexpr uint32_t c_meshletMaxVertexCount = 64;
+constexpr uint32_t c_meshletMaxTriangleCount = 124; // Limits recommended for mesh shaders on NVIDIA hardware.
+
+/**
+ * @brief Cluster of at most c_meshletMaxVertexCount vertices and c_meshletMaxTriangleCount triangles of one mesh, with its culling bounds in model space.
+ * The cone rejects the meshlet when dot(normalize(m_coneApex - cameraPosition), m_coneAxis) >= m_coneCutoff, every triangle then faces away.
+ */
+struct Meshlet
+{
+  glm::vec3 m_center = {};
+  float m_radius = 0.0f;
+  glm::vec3 m_coneApex = {};
+  float m_coneCutoff = 1.0f; // 1 disables the cone test.
+  glm::vec3 m_coneAxis = {};
+  uint32_t m_firstVertex = 0;   // In the meshlet vertex stream, which holds mesh vertex indices.
+  uint32_t m_firstTriangle = 0; // In the meshlet triangle stream, which holds three meshlet vertex indices per triangle.
+  uint32_t m_vertexCount = 0;
+  uint32_t m_triangleCount = 0;
+  uint32_t m_padding = 0;
+};
+
+/** @brief Meshlets of one mesh and the streams they index. */
+struct MeshletData
+{
+  std::vector<Meshlet> m_meshlets;
+  std::vector<uint32_t> m_vertices;
+  std::vector<uint8_t> m_triangles;
+};
+
+/** @brief Groups the triangles in meshlets in their current order, so a cache optimized mesh gives compact meshlets. Appends to meshletData. */
+void buildMeshlets(const uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, MeshletData& meshletData);
+
+/** @brief View frustum planes, pointing inward, in the space of the matrix they are extracted from. */
+struct Frustum
+{
+  std::array<glm::vec4, 6> m_planes;
+
+  /** @brief Planes of a projection with a [0, 1] depth range, in the space viewProjection transforms from. */
+  static Frustum fromViewProjection(const glm::mat4& viewProjection);
+};
+
+enum class MeshletVisibility
+{
+  eVisible,
+  eOutsideFrustum,
+  eBackfacing,
+};
+
+/**
+ * @brief CPU reference of the per meshlet culling a GPU pass would do before the vertex stage.
+ * The frustum is in world space, the camera position in the model space of the meshlet. The transform must not mirror, or front faces would flip.
+ */
+MeshletVisibility cullMeshlet(const Meshlet& meshlet, const glm::mat4& worldTransform, float worldScale, const Frustum& frustum, const glm::vec3& modelCameraPosition);
+} // namespace VkHal
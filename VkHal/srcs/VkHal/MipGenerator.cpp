@@ -0,0 +1,255 @@
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include <emmintrin.h>
+
+#include "VkHal/Vulkan/VulkanRecordingWorkers.h"
+
+namespace VkHal
+{
+namespace
+{
+constexpr float c_pi = 3.14159265358979f;
+constexpr float c_lobeRadius = 3.0f; // In mip texels, for both windowed sincs.
+constexpr float c_kaiserAlpha = 4.0f;
+constexpr uint32_t c_linearToSrgbTableSize = 16384; // Under half a step of error in the darkest sRGB values.
+
+/** @brief Source texels and weights of every mip texel along one axis. Every mip texel has the same tap count, the unused taps weight 0. */
+struct AxisFilter
+{
+  uint32_t m_tapCount = 0;
+  std::vector<uint32_t> m_sources;
+  std::vector<float> m_weights;
+};
+
+struct ColorTables
+{
+  float m_srgbToLinear[256];
+  float m_unormToFloat[256];
+  uint8_t m_linearToSrgb[c_linearToSrgbTableSize];
+};
+
+const ColorTables& getColorTables()
+{
+  static const ColorTables tables = [] {
+    ColorTables colorTables{};
+    for (uint32_t i = 0; i < 256; i++)
+    {
+      auto value = i / 255.0f;
+      colorTables.m_srgbToLinear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+      colorTables.m_unormToFloat[i] = value;
+    }
+
+    for (uint32_t i = 0; i < c_linearToSrgbTableSize; i++)
+    {
+      auto value = (float)i / (c_linearToSrgbTableSize - 1);
+      auto srgb = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+      colorTables.m_linearToSrgb[i] = (uint8_t)std::min(srgb * 255.0f + 0.5f, 255.0f);
+    }
+    return colorTables;
+  }();
+
+  return tables;
+}
+
+float sinc(float x)
+{
+  if (std::abs(x) < 1e-6f)
+  {
+    return 1.0f;
+  }
+
+  x *= c_pi;
+  return std::sin(x) / x;
+}
+
+/** @brief Modified Bessel function of the first kind, order 0, from its power series. */
+float besselI0(float x)
+{
+  float sum = 1.0f;
+  float term = 1.0f;
+  for (uint32_t k = 1; k < 32 && term > sum * 1e-8f; k++)
+  {
+    term *= (x * 0.5f / k) * (x * 0.5f / k);
+    sum += term;
+  }
+  return sum;
+}
+
+float getFilterRadius(MipFilter filter)
+{
+  return filter == MipFilter::eBox ? 0.5f : c_lobeRadius;
+}
+
+/** @brief Weight at x mip texels from the center. */
+float evaluateFilter(MipFilter filter, float x)
+{
+  x = std::abs(x);
+  switch (filter)
+  {
+  case MipFilter::eBox:
+    return x <= 0.5f ? 1.0f : 0.0f;
+  case MipFilter::eLanczos:
+    return x < c_lobeRadius ? sinc(x) * sinc(x / c_lobeRadius) : 0.0f;
+  case MipFilter::eKaiser:
+  {
+    if (x >= c_lobeRadius)
+    {
+      return 0.0f;
+    }
+    auto ratio = x / c_lobeRadius;
+    return sinc(x) * besselI0(c_kaiserAlpha * std::sqrt(1.0f - ratio * ratio)) / besselI0(c_kaiserAlpha);
+  }
+  default:
+    return 0.0f;
+  }
+}
+
+AxisFilter buildAxisFilter(MipFilter filter, uint32_t sourceSize, uint32_t mipSize)
+{
+  // Scaling the filter by the actual ratio keeps odd sizes centered, where folding the last texel would shift the image.
+  const auto scale = (float)sourceSize / mipSize;
+  const auto radius = getFilterRadius(filter) * scale;
+
+  AxisFilter axisFilter;
+  axisFilter.m_tapCount = (uint32_t)std::ceil(radius * 2.0f) + 1;
+  axisFilter.m_sources.resize((size_t)mipSize * axisFilter.m_tapCount);
+  axisFilter.m_weights.resize((size_t)mipSize * axisFilter.m_tapCount);
+
+  for (uint32_t mipTexel = 0; mipTexel < mipSize; mipTexel++)
+  {
+    const auto center = (mipTexel + 0.5f) * scale;
+    const auto first = (int32_t)std::ceil(center - radius - 0.5f);
+    auto* sources = axisFilter.m_sources.data() + (size_t)mipTexel * axisFilter.m_tapCount;
+    auto* weights = axisFilter.m_weights.data() + (size_t)mipTexel * axisFilter.m_tapCount;
+
+    float weightSum = 0.0f;
+    for (uint32_t tap = 0; tap < axisFilter.m_tapCount; tap++)
+    {
+      const auto source = first + (int32_t)tap;
+      sources[tap] = (uint32_t)std::clamp(source, 0, (int32_t)sourceSize - 1);
+      weights[tap] = evaluateFilter(filter, (source + 0.5f - center) / scale);
+      weightSum += weights[tap];
+    }
+
+    for (uint32_t tap = 0; tap < axisFilter.m_tapCount; tap++)
+    {
+      weights[tap] /= weightSum;
+    }
+  }
+
+  return axisFilter;
+}
+
+} // namespace
+
+const char* getMipFilterName(MipFilter filter)
+{
+  switch (filter)
+  {
+  case MipFilter::eBox:
+    return "Box";
+  case MipFilter::eLanczos:
+    return "Lanczos";
+  case MipFilter::eKaiser:
+    return "Kaiser";
+  default:
+    return "Unknown";
+  }
+}
+
+void generateMip(MipFilter filter, bool isSrgb, const uint8_t* texels, uint32_t width, uint32_t height, uint8_t* mipTexels, VulkanRecordingWorkers* workers, uint32_t workerCount)
+{
+  const auto mipWidth = std::max(width / 2, 1u);
+  const auto mipHeight = std::max(height / 2, 1u);
+  const auto horizontalFilter = buildAxisFilter(filter, width, mipWidth);
+  const auto verticalFilter = buildAxisFilter(filter, height, mipHeight);
+
+  const auto& colorTables = getColorTables();
+  const auto* colorToLinear = isSrgb ? colorTables.m_srgbToLinear : colorTables.m_unormToFloat;
+  const auto* alphaToLinear = colorTables.m_unormToFloat;
+
+  // One RGBA texel per SSE register. The horizontal pass keeps every source row at the mip width in floats, so the vertical pass never requantizes.
+  // Left uninitialized, every texel is written by the pass and the page faults are taken on the workers.
+  std::unique_ptr<__m128[]> filteredRows(new __m128[(size_t)mipWidth * height]);
+  VulkanRecordingWorkers::forEach(workers, workerCount, height, [&](uint32_t y) {
+    std::vector<__m128> sourceRow(width);
+    const auto* sourceTexels = texels + (size_t)y * width * 4;
+    for (uint32_t x = 0; x < width; x++)
+    {
+      const auto* texel = sourceTexels + (size_t)x * 4;
+      sourceRow[x] = _mm_setr_ps(colorToLinear[texel[0]], colorToLinear[texel[1]], colorToLinear[texel[2]], alphaToLinear[texel[3]]);
+    }
+
+    auto* filteredRow = filteredRows.get() + (size_t)y * mipWidth;
+    for (uint32_t x = 0; x < mipWidth; x++)
+    {
+      const auto* sources = horizontalFilter.m_sources.data() + (size_t)x * horizontalFilter.m_tapCount;
+      const auto* weights = horizontalFilter.m_weights.data() + (size_t)x * horizontalFilter.m_tapCount;
+      auto sum = _mm_setzero_ps();
+      for (uint32_t tap = 0; tap < horizontalFilter.m_tapCount; tap++)
+      {
+        sum = _mm_add_ps(sum, _mm_mul_ps(sourceRow[sources[tap]], _mm_set1_ps(weights[tap])));
+      }
+      filteredRow[x] = sum;
+    }
+  });
+
+  VulkanRecordingWorkers::forEach(workers, workerCount, mipHeight, [&](uint32_t y) {
+    std::vector<__m128> sums(mipWidth, _mm_setzero_ps());
+    const auto* sources = verticalFilter.m_sources.data() + (size_t)y * verticalFilter.m_tapCount;
+    const auto* weights = verticalFilter.m_weights.data() + (size_t)y * verticalFilter.m_tapCount;
+    for (uint32_t tap = 0; tap < verticalFilter.m_tapCount; tap++)
+    {
+      if (weights[tap] == 0.0f)
+      {
+        continue;
+      }
+
+      const auto weight = _mm_set1_ps(weights[tap]);
+      const auto* filteredRow = filteredRows.get() + (size_t)sources[tap] * mipWidth;
+      for (uint32_t x = 0; x < mipWidth; x++)
+      {
+        sums[x] = _mm_add_ps(sums[x], _mm_mul_ps(filteredRow[x], weight));
+      }
+    }
+
+    // The negative lobes overshoot around edges, clamped before encoding.
+    const auto zero = _mm_setzero_ps();
+    const auto one = _mm_set1_ps(1.0f);
+    const auto half = _mm_set1_ps(0.5f);
+    const auto unormScale = _mm_set1_ps(255.0f);
+    const auto srgbTableScale = _mm_set1_ps((float)(c_linearToSrgbTableSize - 1));
+
+    auto* mipRow = mipTexels + (size_t)y * mipWidth * 4;
+    for (uint32_t x = 0; x < mipWidth; x++)
+    {
+      const auto value = _mm_min_ps(_mm_max_ps(sums[x], zero), one);
+
+      alignas(16) int32_t unorm[4];
+      _mm_store_si128(reinterpret_cast<__m128i*>(unorm), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, unormScale), half)));
+
+      auto* mipTexel = mipRow + (size_t)x * 4;
+      if (isSrgb)
+      {
+        alignas(16) int32_t tableIndices[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(tableIndices), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, srgbTableScale), half)));
+        mipTexel[0] = colorTables.m_linearToSrgb[tableIndices[0]];
+        mipTexel[1] = colorTables.m_linearToSrgb[tableIndices[1]];
+        mipTexel[2] = colorTables.m_linearToSrgb[tableIndices[2]];
+      }
+      else
+      {
+        mipTexel[0] = (uint8_t)unorm[0];
+        mipTexel[1] = (uint8_t)unorm[1];
+        mipTexel[2] = (uint8_t)unorm[2];
+      }
+      mipTexel[3] = (uint8_t)unorm[3];
+    }
+  });
+}
+} // namespace VkHal
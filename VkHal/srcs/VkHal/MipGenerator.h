@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+namespace VkHal
+{
+class VulkanRecordingWorkers;
+
+enum class MipFilter : uint8_t
+{
+  eBox,     // Average of the texels under the mip texel, what a linear blit does on a power of two size.
+  eLanczos, // Sinc windowed by a sinc, 3 lobes. Sharp, rings a little on hard edges.
+  eKaiser,  // Sinc windowed by a Kaiser window, 3 lobes. Close to Lanczos with less ringing.
+};
+
+const char* getMipFilterName(MipFilter filter);
+
+/**
+ * @brief Filters RGBA8 texels down to the next mip, of max(size / 2, 1) texels per side. Odd sizes are resampled with the filter scaled to them, the edges are clamped.
+ * sRGB colors are filtered in linear space, alpha is always linear. The rows are spread over the workers when given.
+ */
+void generateMip(MipFilter filter, bool isSrgb, const uint8_t* texels, uint32_t width, uint32_t height, uint8_t* mipTexels, VulkanRecordingWorkers* workers = nullptr, uint32_t workerCount = 1);
+} // namespace VkHal
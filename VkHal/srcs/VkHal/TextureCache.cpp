@@ -0,0 +1,210 @@
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "stb_image.h"
+
+#include "VkHal/MipGenerator.h"
+#include "VkHal/Vulkan/VulkanHash.h"
+#include "VkHal/Vulkan/VulkanRecordingWorkers.h"
+
+using namespace std::literals::string_literals;
+
+namespace VkHal
+{
+static_assert(std::is_trivially_copyable_v<TextureCacheHeader>, "Texture cache content is written and read as raw bytes.");
+
+namespace
+{
+constexpr uint64_t c_mipAlignment = 16;
+constexpr MipFilter c_mipFilter = MipFilter::eKaiser;
+
+uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+int64_t getWriteTime(const std::filesystem::path& path)
+{
+  return (int64_t)std::filesystem::last_write_time(path).time_since_epoch().count();
+}
+
+uint64_t hashFile(const std::filesystem::path& path)
+{
+  MappedFile file(path);
+  return hashBytes(file.getData(), file.getSize());
+}
+} // namespace
+
+TextureCache::TextureCache(const std::filesystem::path& cachePath)
+    : m_file{cachePath}
+{
+  if (m_file.getSize() < sizeof(TextureCacheHeader))
+  {
+    throw std::runtime_error("Texture cache is truncated.");
+  }
+
+  const auto& header = getHeader();
+  if (header.m_magic != c_textureCacheMagic || header.m_version != c_textureCacheVersion)
+  {
+    throw std::runtime_error("Texture cache version is not supported.");
+  }
+
+  if (header.m_format > TextureFormat::eBC7 || header.m_mipCount == 0 || header.m_mipCount > c_textureCacheMaxMipCount)
+  {
+    throw std::runtime_error("Texture cache format is invalid.");
+  }
+
+  auto fileSize = (uint64_t)m_file.getSize();
+  if (header.m_dataOffset > fileSize || header.m_dataSize > fileSize - header.m_dataOffset)
+  {
+    throw std::runtime_error("Texture cache is truncated.");
+  }
+
+  auto mipWidth = header.m_width;
+  auto mipHeight = header.m_height;
+  for (uint32_t mipLevel = 0; mipLevel < header.m_mipCount; mipLevel++)
+  {
+    const auto& mip = header.m_mips[mipLevel];
+    if (mip.m_width != mipWidth || mip.m_height != mipHeight || mip.m_size != getTextureMipSize(header.m_format, mipWidth, mipHeight))
+    {
+      throw std::runtime_error("Texture cache mip size does not match its format.");
+    }
+
+    if (mip.m_offset > header.m_dataSize || mip.m_size > header.m_dataSize - mip.m_offset)
+    {
+      throw std::runtime_error("Texture cache mip is out of the texel data.");
+    }
+
+    mipWidth = std::max(mipWidth / 2, 1u);
+    mipHeight = std::max(mipHeight / 2, 1u);
+  }
+}
+
+TextureCache TextureCache::loadOrCook(const std::filesystem::path& sourcePath, const std::filesystem::path& cachePath, TextureFormat format, VulkanRecordingWorkers* workers)
+{
+  if (std::filesystem::exists(cachePath))
+  {
+    try
+    {
+      TextureCache textureCache(cachePath);
+      if (textureCache.getHeader().m_format == format && textureCache.isSourceUpToDate(sourcePath))
+      {
+        return textureCache;
+      }
+    }
+    catch (const std::runtime_error&)
+    {
+      // Corrupted or from an older version, cooked again below.
+    }
+  }
+
+  cook(sourcePath, cachePath, format, workers);
+  return TextureCache(cachePath);
+}
+
+void TextureCache::cook(const std::filesystem::path& sourcePath, const std::filesystem::path& cachePath, TextureFormat format, VulkanRecordingWorkers* workers)
+{
+  int32_t width{};
+  int32_t height{};
+  int32_t channels{};
+  auto pixels = stbi_load(sourcePath.u8string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+  if (!pixels)
+  {
+    throw std::runtime_error("Failed to load texture image "s + sourcePath.u8string() + ".");
+  }
+  std::vector<uint8_t> texels(pixels, pixels + (size_t)width * height * 4);
+  stbi_image_free(pixels);
+
+  TextureCacheHeader header{};
+  header.m_sourceHash = hashFile(sourcePath);
+  header.m_sourceSize = std::filesystem::file_size(sourcePath);
+  header.m_sourceWriteTime = getWriteTime(sourcePath);
+  header.m_format = format;
+  header.m_width = (uint32_t)width;
+  header.m_height = (uint32_t)height;
+  header.m_mipCount = std::min((uint32_t)std::floor(std::log2(std::max(width, height))) + 1, c_textureCacheMaxMipCount);
+  header.m_dataOffset = alignUp(sizeof(TextureCacheHeader), c_mipAlignment);
+
+  uint64_t dataSize = 0;
+  auto mipWidth = header.m_width;
+  auto mipHeight = header.m_height;
+  for (uint32_t mipLevel = 0; mipLevel < header.m_mipCount; mipLevel++)
+  {
+    auto& mip = header.m_mips[mipLevel];
+    mip.m_offset = alignUp(dataSize, c_mipAlignment);
+    mip.m_size = getTextureMipSize(format, mipWidth, mipHeight);
+    mip.m_width = mipWidth;
+    mip.m_height = mipHeight;
+    dataSize = mip.m_offset + mip.m_size;
+
+    mipWidth = std::max(mipWidth / 2, 1u);
+    mipHeight = std::max(mipHeight / 2, 1u);
+  }
+  header.m_dataSize = dataSize;
+
+  // The whole chain is filtered here and encoded mip by mip, loading a texture never blits its mips.
+  // The color formats hold sRGB images, BC5 holds normals and other linear data.
+  const bool isSrgb = format != TextureFormat::eBC5;
+  auto start = std::chrono::high_resolution_clock::now();
+  auto workerCount = workers ? workers->getWorkerCount() : 1;
+  std::vector<uint8_t> data(dataSize);
+  std::vector<uint8_t> mipTexels;
+  for (uint32_t mipLevel = 0; mipLevel < header.m_mipCount; mipLevel++)
+  {
+    const auto& mip = header.m_mips[mipLevel];
+    if (mipLevel > 0)
+    {
+      const auto& previousMip = header.m_mips[mipLevel - 1];
+      mipTexels.resize((size_t)mip.m_width * mip.m_height * 4);
+      generateMip(c_mipFilter, isSrgb, texels.data(), previousMip.m_width, previousMip.m_height, mipTexels.data(), workers, workerCount);
+      texels.swap(mipTexels);
+    }
+    compressTexture(format, texels.data(), mip.m_width, mip.m_height, data.data() + mip.m_offset, workers, workerCount);
+  }
+  auto timeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+
+  const auto size = std::snprintf(nullptr, 0, "Texture cooking %s: %s %ux%u, %u %s mips, %.1f MB in %.1f ms\n", sourcePath.filename().u8string().c_str(), getTextureFormatName(format), header.m_width, header.m_height, header.m_mipCount, getMipFilterName(c_mipFilter), dataSize / (1024.0f * 1024.0f), timeMs);
+  std::string output(size + 1, '\0');
+  std::snprintf(output.data(), output.size(), "Texture cooking %s: %s %ux%u, %u %s mips, %.1f MB in %.1f ms\n", sourcePath.filename().u8string().c_str(), getTextureFormatName(format), header.m_width, header.m_height, header.m_mipCount, getMipFilterName(c_mipFilter), dataSize / (1024.0f * 1024.0f), timeMs);
+  std::cout << output.c_str();
+
+  std::filesystem::create_directories(cachePath.parent_path());
+  auto tempPath = cachePath;
+  tempPath += ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.seekp(header.m_dataOffset);
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+    if (!file)
+    {
+      throw std::runtime_error("Failed to write the texture cache.");
+    }
+  }
+
+  std::filesystem::rename(tempPath, cachePath);
+}
+
+bool TextureCache::isSourceUpToDate(const std::filesystem::path& sourcePath) const
+{
+  const auto& header = getHeader();
+  if (header.m_sourceSize == std::filesystem::file_size(sourcePath) && header.m_sourceWriteTime == getWriteTime(sourcePath))
+  {
+    return true;
+  }
+
+  // A checkout or a copy changes the write time without changing the content.
+  return header.m_sourceHash == hashFile(sourcePath);
+}
+} // namespace VkHal
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+#include "VkHal/MappedFile.h"
+#include "VkHal/TextureCompressor.h"
+
+namespace VkHal
+{
+class VulkanRecordingWorkers;
+
+constexpr uint32_t c_textureCacheMagic = 0x43544B56; // "VKTC"
+constexpr uint32_t c_textureCacheVersion = 2;
+constexpr uint32_t c_textureCacheMaxMipCount = 16; // Up to 32k texels per side.
+
+struct TextureCacheMip
+{
+  uint64_t m_offset = 0; // From the start of the texel data.
+  uint64_t m_size = 0;
+  uint32_t m_width = 0;
+  uint32_t m_height = 0;
+};
+
+/** @brief Start of a texture cache file. The texel data follows with the mips from the largest, each 16 bytes aligned. */
+struct TextureCacheHeader
+{
+  uint32_t m_magic = c_textureCacheMagic;
+  uint32_t m_version = c_textureCacheVersion;
+
+  uint64_t m_sourceHash = 0;
+  uint64_t m_sourceSize = 0;
+  int64_t m_sourceWriteTime = 0;
+
+  TextureFormat m_format = TextureFormat::eRGBA8;
+  uint8_t m_padding[3] = {};
+  uint32_t m_width = 0;
+  uint32_t m_height = 0;
+  uint32_t m_mipCount = 0;
+
+  uint64_t m_dataOffset = 0;
+  uint64_t m_dataSize = 0;
+  TextureCacheMip m_mips[c_textureCacheMaxMipCount] = {};
+};
+
+/** @brief Memory mapped texture cache. The mips are stored in the layout of their format, copied to the image as is. */
+class TextureCache
+{
+public:
+  /** @brief Throws if the file is not a texture cache of the current version. */
+  explicit TextureCache(const std::filesystem::path& cachePath);
+
+  /** @brief Maps the cache of the source, cooking it first if it is missing, stale or of another format. */
+  static TextureCache loadOrCook(const std::filesystem::path& sourcePath, const std::filesystem::path& cachePath, TextureFormat format, VulkanRecordingWorkers* workers = nullptr);
+
+  /** @brief Decodes the source, filters its mip chain and writes the mips encoded to the format to cachePath. The blocks are encoded on the workers when given. */
+  static void cook(const std::filesystem::path& sourcePath, const std::filesystem::path& cachePath, TextureFormat format, VulkanRecordingWorkers* workers = nullptr);
+
+  bool isSourceUpToDate(const std::filesystem::path& sourcePath) const;
+
+  const TextureCacheHeader& getHeader() const
+  {
+    return *reinterpret_cast<const TextureCacheHeader*>(m_file.getData());
+  }
+
+  uint32_t getMipCount() const
+  {
+    return getHeader().m_mipCount;
+  }
+
+  const TextureCacheMip& getMip(uint32_t mipLevel) const
+  {
+    return getHeader().m_mips[mipLevel];
+  }
+
+  const void* getData() const
+  {
+    return m_file.getData() + getHeader().m_dataOffset;
+  }
+
+  uint64_t getDataSize() const
+  {
+    return getHeader().m_dataSize;
+  }
+
+private:
+  MappedFile m_file;
+};
+} // namespace VkHal
@@ -0,0 +1,872 @@
+#include "TextureCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <emmintrin.h>
+
+#include "VkHal/Vulkan/VulkanRecordingWorkers.h"
+
+namespace VkHal
+{
+namespace
+{
+// https://learn.microsoft.com/windows/win32/direct3d11/texture-block-compression-in-direct3d-11
+// https://learn.microsoft.com/windows/win32/direct3d11/bc7-format-mode-reference
+constexpr uint32_t c_blockTexelCount = 16;
+constexpr uint32_t c_maxStepCount = 16;
+constexpr uint32_t c_refinementCount = 2; // Least squares refits of the endpoints to the steps the previous endpoints gave.
+
+constexpr float c_bc1Weights[4] = {0.0f, 1.0f / 3.0f, 2.0f / 3.0f, 1.0f};
+constexpr uint8_t c_bc1StepIndices[4] = {0, 2, 3, 1}; // From the first endpoint to the second.
+constexpr uint8_t c_bc4StepIndices[8] = {0, 2, 3, 4, 5, 6, 7, 1};
+constexpr uint32_t c_bc7Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+constexpr uint32_t c_bc7Mode6 = 6;
+
+/** @brief Texels of one block with one array per channel, so the SSE code handles four texels at a time. */
+struct alignas(16) BlockTexels
+{
+  float m_channels[4][c_blockTexelCount];
+};
+
+/** @brief Decoded palette of a block, ordered from the first endpoint to the second, and the positions of its steps on the endpoint line. */
+struct BlockPalette
+{
+  float m_colors[c_maxStepCount][4];
+  float m_weights[c_maxStepCount];
+  uint32_t m_stepCount = 0;
+};
+
+void loadBlock(const uint8_t* texels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, BlockTexels& block)
+{
+  for (uint32_t y = 0; y < 4; y++)
+  {
+    auto sourceY = std::min(blockY * 4 + y, height - 1);
+    for (uint32_t x = 0; x < 4; x++)
+    {
+      auto sourceX = std::min(blockX * 4 + x, width - 1);
+      const auto* texel = texels + ((size_t)sourceY * width + sourceX) * 4;
+      for (uint32_t c = 0; c < 4; c++)
+      {
+        block.m_channels[c][y * 4 + x] = texel[c];
+      }
+    }
+  }
+}
+
+/** @brief Endpoints through the extreme projections of the texels on their principal axis, found by power iteration on the covariance. */
+void findPrincipalEndpoints(const BlockTexels& block, uint32_t channelCount, float* endpoint0, float* endpoint1)
+{
+  float mean[4] = {};
+  for (uint32_t c = 0; c < channelCount; c++)
+  {
+    for (uint32_t i = 0; i < c_blockTexelCount; i++)
+    {
+      mean[c] += block.m_channels[c][i];
+    }
+    mean[c] /= c_blockTexelCount;
+  }
+
+  float covariance[4][4] = {};
+  for (uint32_t i = 0; i < c_blockTexelCount; i++)
+  {
+    for (uint32_t c0 = 0; c0 < channelCount; c0++)
+    {
+      for (uint32_t c1 = c0; c1 < channelCount; c1++)
+      {
+        covariance[c0][c1] += (block.m_channels[c0][i] - mean[c0]) * (block.m_channels[c1][i] - mean[c1]);
+      }
+    }
+  }
+
+  // Starting from the channel of largest variance avoids an axis orthogonal to the principal one.
+  uint32_t largestChannel = 0;
+  for (uint32_t c0 = 0; c0 < channelCount; c0++)
+  {
+    for (uint32_t c1 = 0; c1 < c0; c1++)
+    {
+      covariance[c0][c1] = covariance[c1][c0];
+    }
+    if (covariance[c0][c0] > covariance[largestChannel][largestChannel])
+    {
+      largestChannel = c0;
+    }
+  }
+
+  if (covariance[largestChannel][largestChannel] <= 0.0f)
+  {
+    std::copy(mean, mean + channelCount, endpoint0);
+    std::copy(mean, mean + channelCount, endpoint1);
+    return;
+  }
+
+  float axis[4] = {};
+  std::copy(covariance[largestChannel], covariance[largestChannel] + channelCount, axis);
+  for (uint32_t iteration = 0; iteration < 8; iteration++)
+  {
+    float nextAxis[4] = {};
+    float lengthSquared = 0.0f;
+    for (uint32_t c0 = 0; c0 < channelCount; c0++)
+    {
+      for (uint32_t c1 = 0; c1 < channelCount; c1++)
+      {
+        nextAxis[c0] += covariance[c0][c1] * axis[c1];
+      }
+      lengthSquared += nextAxis[c0] * nextAxis[c0];
+    }
+
+    if (lengthSquared <= 0.0f)
+    {
+      break;
+    }
+
+    auto inverseLength = 1.0f / std::sqrt(lengthSquared);
+    for (uint32_t c = 0; c < channelCount; c++)
+    {
+      axis[c] = nextAxis[c] * inverseLength;
+    }
+  }
+
+  auto minProjection = std::numeric_limits<float>::max();
+  auto maxProjection = std::numeric_limits<float>::lowest();
+  for (uint32_t i = 0; i < c_blockTexelCount; i++)
+  {
+    float projection = 0.0f;
+    for (uint32_t c = 0; c < channelCount; c++)
+    {
+      projection += (block.m_channels[c][i] - mean[c]) * axis[c];
+    }
+    minProjection = std::min(minProjection, projection);
+    maxProjection = std::max(maxProjection, projection);
+  }
+
+  for (uint32_t c = 0; c < channelCount; c++)
+  {
+    endpoint0[c] = std::clamp(mean[c] + axis[c] * minProjection, 0.0f, 255.0f);
+    endpoint1[c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.0f, 255.0f);
+  }
+}
+
+/**
+ * @brief Gives each texel the step nearest to its projection on the line between the first and last palette colors, and returns the squared error against the palette.
+ * The palette colors lie on that line up to the endpoint rounding, so the nearest step along it is the nearest color.
+ */
+float selectSteps(const BlockTexels& block, uint32_t channelCount, const BlockPalette& palette, uint8_t* steps)
+{
+  const auto* first = palette.m_colors[0];
+  const auto* last = palette.m_colors[palette.m_stepCount - 1];
+
+  float direction[4] = {};
+  float lengthSquared = 0.0f;
+  for (uint32_t c = 0; c < channelCount; c++)
+  {
+    direction[c] = last[c] - first[c];
+    lengthSquared += direction[c] * direction[c];
+  }
+
+  if (lengthSquared == 0.0f)
+  {
+    std::fill(steps, steps + c_blockTexelCount, (uint8_t)0);
+  }
+  else
+  {
+    __m128 scaledDirection[4];
+    __m128 origin[4];
+    for (uint32_t c = 0; c < channelCount; c++)
+    {
+      scaledDirection[c] = _mm_set1_ps(direction[c] / lengthSquared);
+      origin[c] = _mm_set1_ps(first[c]);
+    }
+
+    __m128 thresholds[c_maxStepCount - 1];
+    for (uint32_t k = 0; k + 1 < palette.m_stepCount; k++)
+    {
+      thresholds[k] = _mm_set1_ps((palette.m_weights[k] + palette.m_weights[k + 1]) * 0.5f);
+    }
+
+    for (uint32_t i = 0; i < c_blockTexelCount; i += 4)
+    {
+      auto projection = _mm_setzero_ps();
+      for (uint32_t c = 0; c < channelCount; c++)
+      {
+        auto offset = _mm_sub_ps(_mm_load_ps(block.m_channels[c] + i), origin[c]);
+        projection = _mm_add_ps(projection, _mm_mul_ps(offset, scaledDirection[c]));
+      }
+
+      // The comparison masks are -1 where the projection is past a midpoint, subtracting them counts the steps.
+      auto step = _mm_setzero_si128();
+      for (uint32_t k = 0; k + 1 < palette.m_stepCount; k++)
+      {
+        step = _mm_sub_epi32(step, _mm_castps_si128(_mm_cmpgt_ps(projection, thresholds[k])));
+      }
+
+      alignas(16) int32_t laneSteps[4];
+      _mm_store_si128(reinterpret_cast<__m128i*>(laneSteps), step);
+      for (uint32_t lane = 0; lane < 4; lane++)
+      {
+        steps[i + lane] = (uint8_t)laneSteps[lane];
+      }
+    }
+  }
+
+  auto error = _mm_setzero_ps();
+  for (uint32_t i = 0; i < c_blockTexelCount; i += 4)
+  {
+    for (uint32_t c = 0; c < channelCount; c++)
+    {
+      auto decoded = _mm_setr_ps(palette.m_colors[steps[i]][c], palette.m_colors[steps[i + 1]][c], palette.m_colors[steps[i + 2]][c], palette.m_colors[steps[i + 3]][c]);
+      auto difference = _mm_sub_ps(_mm_load_ps(block.m_channels[c] + i), decoded);
+      error = _mm_add_ps(error, _mm_mul_ps(difference, difference));
+    }
+  }
+
+  alignas(16) float laneErrors[4];
+  _mm_store_ps(laneErrors, error);
+  return laneErrors[0] + laneErrors[1] + laneErrors[2] + laneErrors[3];
+}
+
+/** @brief Least squares endpoints for the steps of the texels. False when every texel is on the same step, the endpoints are then left as they are. */
+bool fitEndpoints(const BlockTexels& block, uint32_t channelCount, const uint8_t* steps, const float* weights, float* endpoint0, float* endpoint1)
+{
+  float alphaSquared = 0.0f;
+  float alphaBeta = 0.0f;
+  float betaSquared = 0.0f;
+  float alphaTexel[4] = {};
+  float betaTexel[4] = {};
+  for (uint32_t i = 0; i < c_blockTexelCount; i++)
+  {
+    auto beta = weights[steps[i]];
+    auto alpha = 1.0f - beta;
+    alphaSquared += alpha * alpha;
+    alphaBeta += alpha * beta;
+    betaSquared += beta * beta;
+    for (uint32_t c = 0; c < channelCount; c++)
+    {
+      alphaTexel[c] += alpha * block.m_channels[c][i];
+      betaTexel[c] += beta * block.m_channels[c][i];
+    }
+  }
+
+  auto determinant = alphaSquared * betaSquared - alphaBeta * alphaBeta;
+  if (std::abs(determinant) < 1e-6f)
+  {
+    return false;
+  }
+
+  for (uint32_t c = 0; c < channelCount; c++)
+  {
+    endpoint0[c] = std::clamp((betaSquared * alphaTexel[c] - alphaBeta * betaTexel[c]) / determinant, 0.0f, 255.0f);
+    endpoint1[c] = std::clamp((alphaSquared * betaTexel[c] - alphaBeta * alphaTexel[c]) / determinant, 0.0f, 255.0f);
+  }
+  return true;
+}
+
+uint16_t quantize565(const float* color)
+{
+  auto r = (uint32_t)std::lround(color[0] * 31.0f / 255.0f);
+  auto g = (uint32_t)std::lround(color[1] * 63.0f / 255.0f);
+  auto b = (uint32_t)std::lround(color[2] * 31.0f / 255.0f);
+  return (uint16_t)(r << 11 | g << 5 | b);
+}
+
+void expand565(uint16_t packed, uint32_t* color)
+{
+  auto r = (uint32_t)(packed >> 11) & 31;
+  auto g = (uint32_t)(packed >> 5) & 63;
+  auto b = (uint32_t)packed & 31;
+  color[0] = r << 3 | r >> 2;
+  color[1] = g << 2 | g >> 4;
+  color[2] = b << 3 | b >> 2;
+}
+
+/** @brief Four color palette of a BC1 block, the one BC3 always uses. */
+void buildColorPalette(uint16_t packed0, uint16_t packed1, uint32_t (*colors)[3])
+{
+  expand565(packed0, colors[0]);
+  expand565(packed1, colors[3]);
+  for (uint32_t c = 0; c < 3; c++)
+  {
+    colors[1][c] = (2 * colors[0][c] + colors[3][c] + 1) / 3;
+    colors[2][c] = (colors[0][c] + 2 * colors[3][c] + 1) / 3;
+  }
+}
+
+void encodeColorBlock(const BlockTexels& block, uint8_t* output)
+{
+  float endpoint0[4] = {};
+  float endpoint1[4] = {};
+  findPrincipalEndpoints(block, 3, endpoint0, endpoint1);
+
+  BlockPalette palette{};
+  palette.m_stepCount = 4;
+  std::copy(std::begin(c_bc1Weights), std::end(c_bc1Weights), palette.m_weights);
+
+  auto bestError = std::numeric_limits<float>::max();
+  uint16_t bestPacked[2] = {};
+  uint8_t bestSteps[c_blockTexelCount] = {};
+  for (uint32_t iteration = 0; iteration <= c_refinementCount; iteration++)
+  {
+    uint16_t packed[2] = {quantize565(endpoint0), quantize565(endpoint1)};
+    uint32_t colors[4][3];
+    buildColorPalette(packed[0], packed[1], colors);
+    for (uint32_t k = 0; k < 4; k++)
+    {
+      std::copy(colors[k], colors[k] + 3, palette.m_colors[k]);
+    }
+
+    uint8_t steps[c_blockTexelCount];
+    auto error = selectSteps(block, 3, palette, steps);
+    if (error < bestError)
+    {
+      bestError = error;
+      std::copy(packed, packed + 2, bestPacked);
+      std::copy(steps, steps + c_blockTexelCount, bestSteps);
+    }
+
+    if (iteration == c_refinementCount || !fitEndpoints(block, 3, steps, c_bc1Weights, endpoint0, endpoint1))
+    {
+      break;
+    }
+  }
+
+  // The first endpoint must be the larger one for the four color mode, swapping them reverses the steps.
+  if (bestPacked[0] < bestPacked[1])
+  {
+    std::swap(bestPacked[0], bestPacked[1]);
+    std::for_each(std::begin(bestSteps), std::end(bestSteps), [](uint8_t& step) { step = (uint8_t)(3 - step); });
+  }
+  else if (bestPacked[0] == bestPacked[1])
+  {
+    std::fill(std::begin(bestSteps), std::end(bestSteps), (uint8_t)0);
+  }
+
+  uint32_t indices = 0;
+  for (uint32_t i = 0; i < c_blockTexelCount; i++)
+  {
+    indices |= (uint32_t)c_bc1StepIndices[bestSteps[i]] << (i * 2);
+  }
+  std::memcpy(output, &bestPacked[0], 2);
+  std::memcpy(output + 2, &bestPacked[1], 2);
+  std::memcpy(output + 4, &indices, 4);
+}
+
+/** @brief Eight value palette of a BC4 block, the first endpoint is the larger. */
+void buildChannelPalette(uint32_t value0, uint32_t value1, uint32_t* values)
+{
+  for (uint32_t k = 0; k < 8; k++)
+  {
+    values[k] = ((7 - k) * value0 + k * value1 + 3) / 7;
+  }
+}
+
+void encodeChannelBlock(const BlockTexels& block, uint32_t channel, uint8_t* output)
+{
+  BlockTexels channelBlock;
+  std::copy(block.m_channels[channel], block.m_channels[channel] + c_blockTexelCount, channelBlock.m_channels[0]);
+
+  float endpoint0 = *std::max_element(channelBlock.m_channels[0], channelBlock.m_channels[0] + c_blockTexelCount);
+  float endpoint1 = *std::min_element(channelBlock.m_channels[0], channelBlock.m_channels[0] + c_blockTexelCount);
+
+  BlockPalette palette{};
+  palette.m_stepCount = 8;
+  for (uint32_t k = 0; k < 8; k++)
+  {
+    palette.m_weights[k] = k / 7.0f;
+  }
+
+  auto bestError = std::numeric_limits<float>::max();
+  uint32_t bestValues[2] = {};
+  uint8_t bestSteps[c_blockTexelCount] = {};
+  for (uint32_t iteration = 0; iteration <= c_refinementCount; iteration++)
+  {
+    auto value0 = (uint32_t)std::lround(endpoint0);
+    auto value1 = (uint32_t)std::lround(endpoint1);
+    if (value0 < value1)
+    {
+      break;
+    }
+
+    uint32_t values[8];
+    buildChannelPalette(value0, value1, values);
+    for (uint32_t k = 0; k < 8; k++)
+    {
+      palette.m_colors[k][0] = (float)values[k];
+    }
+
+    uint8_t steps[c_blockTexelCount];
+    auto error = selectSteps(channelBlock, 1, palette, steps);
+    if (error < bestError)
+    {
+      bestError = error;
+      bestValues[0] = value0;
+      bestValues[1] = value1;
+      std::copy(steps, steps + c_blockTexelCount, bestSteps);
+    }
+
+    if (iteration == c_refinementCount || !fitEndpoints(channelBlock, 1, steps, palette.m_weights, &endpoint0, &endpoint1))
+    {
+      break;
+    }
+  }
+
+  // Equal endpoints select the six value mode, where index 0 still is the first endpoint.
+  uint64_t indices = 0;
+  for (uint32_t i = 0; i < c_blockTexelCount; i++)
+  {
+    auto index = bestValues[0] == bestValues[1] ? 0u : c_bc4StepIndices[bestSteps[i]];
+    indices |= (uint64_t)index << (i * 3);
+  }
+  output[0] = (uint8_t)bestValues[0];
+  output[1] = (uint8_t)bestValues[1];
+  std::memcpy(output + 2, &indices, 6);
+}
+
+/** @brief 7 bit channels plus a p-bit shared by the channels of the endpoint, choosing the p-bit closest to the endpoint. */
+void quantizeBc7Endpoint(const float* endpoint, uint32_t* quantized, uint32_t& pBit)
+{
+  auto bestError = std::numeric_limits<float>::max();
+  for (uint32_t candidatePBit = 0; candidatePBit < 2; candidatePBit++)
+  {
+    uint32_t candidate[4];
+    float error = 0.0f;
+    for (uint32_t c = 0; c < 4; c++)
+    {
+      candidate[c] = (uint32_t)std::clamp(std::lround((endpoint[c] - candidatePBit) * 0.5f), 0l, 127l);
+      auto difference = endpoint[c] - (float)(candidate[c] << 1 | candidatePBit);
+      error += difference * difference;
+    }
+
+    if (error < bestError)
+    {
+      bestError = error;
+      pBit = candidatePBit;
+      std::copy(candidate, candidate + 4, quantized);
+    }
+  }
+}
+
+class BlockBitWriter
+{
+public:
+  void write(uint32_t value, uint32_t bitCount)
+  {
+    for (uint32_t bit = 0; bit < bitCount; bit++, m_position++)
+    {
+      m_bits[m_position / 64] |= (uint64_t)((value >> bit) & 1) << (m_position % 64);
+    }
+  }
+
+  const uint64_t* getBits() const
+  {
+    return m_bits;
+  }
+
+private:
+  uint64_t m_bits[2] = {};
+  uint32_t m_position = 0;
+};
+
+class BlockBitReader
+{
+public:
+  explicit BlockBitReader(const uint8_t* block)
+  {
+    std::memcpy(m_bits, block, 16);
+  }
+
+  uint32_t read(uint32_t bitCount)
+  {
+    uint32_t value = 0;
+    for (uint32_t bit = 0; bit < bitCount; bit++, m_position++)
+    {
+      value |= (uint32_t)((m_bits[m_position / 64] >> (m_position % 64)) & 1) << bit;
+    }
+    return value;
+  }
+
+private:
+  uint64_t m_bits[2] = {};
+  uint32_t m_position = 0;
+};
+
+void encodeBc7Block(const BlockTexels& block, uint8_t* output)
+{
+  float endpoint0[4] = {};
+  float endpoint1[4] = {};
+  findPrincipalEndpoints(block, 4, endpoint0, endpoint1);
+
+  BlockPalette palette{};
+  palette.m_stepCount = 16;
+  for (uint32_t k = 0; k < 16; k++)
+  {
+    palette.m_weights[k] = c_bc7Weights[k] / 64.0f;
+  }
+
+  auto bestError = std::numeric_limits<float>::max();
+  uint32_t bestQuantized[2][4] = {};
+  uint32_t bestPBits[2] = {};
+  uint8_t bestSteps[c_blockTexelCount] = {};
+  for (uint32_t iteration = 0; iteration <= c_refinementCount; iteration++)
+  {
+    uint32_t quantized[2][4];
+    uint32_t pBits[2];
+    quantizeBc7Endpoint(endpoint0, quantized[0], pBits[0]);
+    quantizeBc7Endpoint(endpoint1, quantized[1], pBits[1]);
+
+    for (uint32_t k = 0; k < 16; k++)
+    {
+      for (uint32_t c = 0; c < 4; c++)
+      {
+        auto value0 = quantized[0][c] << 1 | pBits[0];
+        auto value1 = quantized[1][c] << 1 | pBits[1];
+        palette.m_colors[k][c] = (float)(((64 - c_bc7Weights[k]) * value0 + c_bc7Weights[k] * value1 + 32) >> 6);
+      }
+    }
+
+    uint8_t steps[c_blockTexelCount];
+    auto error = selectSteps(block, 4, palette, steps);
+    if (error < bestError)
+    {
+      bestError = error;
+      std::memcpy(bestQuantized, quantized, sizeof(quantized));
+      std::copy(pBits, pBits + 2, bestPBits);
+      std::copy(steps, steps + c_blockTexelCount, bestSteps);
+    }
+
+    if (iteration == c_refinementCount || !fitEndpoints(block, 4, steps, palette.m_weights, endpoint0, endpoint1))
+    {
+      break;
+    }
+  }
+
+  // The index of the first texel is stored without its top bit, it must be under 8.
+  if (bestSteps[0] >= 8)
+  {
+    std::swap(bestQuantized[0], bestQuantized[1]);
+    std::swap(bestPBits[0], bestPBits[1]);
+    std::for_each(std::begin(bestSteps), std::end(bestSteps), [](uint8_t& step) { step = (uint8_t)(15 - step); });
+  }
+
+  BlockBitWriter writer;
+  writer.write(1 << c_bc7Mode6, c_bc7Mode6 + 1);
+  for (uint32_t c = 0; c < 4; c++)
+  {
+    writer.write(bestQuantized[0][c], 7);
+    writer.write(bestQuantized[1][c], 7);
+  }
+  writer.write(bestPBits[0], 1);
+  writer.write(bestPBits[1], 1);
+  for (uint32_t i = 0; i < c_blockTexelCount; i++)
+  {
+    writer.write(bestSteps[i], i == 0 ? 3 : 4);
+  }
+  std::memcpy(output, writer.getBits(), 16);
+}
+
+void encodeBlock(TextureFormat format, const BlockTexels& block, uint8_t* output)
+{
+  switch (format)
+  {
+  case TextureFormat::eBC1:
+    encodeColorBlock(block, output);
+    break;
+  case TextureFormat::eBC3:
+    encodeChannelBlock(block, 3, output);
+    encodeColorBlock(block, output + 8);
+    break;
+  case TextureFormat::eBC5:
+    encodeChannelBlock(block, 0, output);
+    encodeChannelBlock(block, 1, output + 8);
+    break;
+  case TextureFormat::eBC7:
+    encodeBc7Block(block, output);
+    break;
+  default:
+    throw std::runtime_error("Texture format is not block compressed.");
+  }
+}
+
+void decodeColorBlock(const uint8_t* input, bool isFourColor, uint8_t (*texels)[4])
+{
+  uint16_t packed[2];
+  uint32_t indices;
+  std::memcpy(&packed[0], input, 2);
+  std::memcpy(&packed[1], input + 2, 2);
+  std::memcpy(&indices, input + 4, 4);
+
+  // Palette in index order.
+  uint32_t colors[4][3];
+  expand565(packed[0], colors[0]);
+  expand565(packed[1], colors[1]);
+  for (uint32_t c = 0; c < 3; c++)
+  {
+    if (isFourColor || packed[0] > packed[1])
+    {
+      colors[2][c] = (2 * colors[0][c] + colors[1][c] + 1) / 3;
+      colors[3][c] = (colors[0][c] + 2 * colors[1][c] + 1) / 3;
+    }
+    else
+    {
+      colors[2][c] = (colors[0][c] + colors[1][c]) / 2;
+      colors[3][c] = 0;
+    }
+  }
+
+  for (uint32_t i = 0; i < c_blockTexelCount; i++)
+  {
+    auto index = (indices >> (i * 2)) & 3;
+    for (uint32_t c = 0; c < 3; c++)
+    {
+      texels[i][c] = (uint8_t)colors[index][c];
+    }
+  }
+}
+
+void decodeChannelBlock(const uint8_t* input, uint32_t channel, uint8_t (*texels)[4])
+{
+  uint32_t value0 = input[0];
+  uint32_t value1 = input[1];
+  uint64_t indices = 0;
+  std::memcpy(&indices, input + 2, 6);
+
+  uint32_t values[8] = {value0, value1};
+  if (value0 > value1)
+  {
+    for (uint32_t k = 1; k < 7; k++)
+    {
+      values[k + 1] = ((7 - k) * value0 + k * value1 + 3) / 7;
+    }
+  }
+  else
+  {
+    for (uint32_t k = 1; k < 5; k++)
+    {
+      values[k + 1] = ((5 - k) * value0 + k * value1 + 2) / 5;
+    }
+    values[6] = 0;
+    values[7] = 255;
+  }
+
+  for (uint32_t i = 0; i < c_blockTexelCount; i++)
+  {
+    texels[i][channel] = (uint8_t)values[(indices >> (i * 3)) & 7];
+  }
+}
+
+void decodeBc7Block(const uint8_t* input, uint8_t (*texels)[4])
+{
+  BlockBitReader reader(input);
+  if (reader.read(c_bc7Mode6 + 1) != 1u << c_bc7Mode6)
+  {
+    throw std::runtime_error("Only BC7 mode 6 blocks can be decoded.");
+  }
+
+  uint32_t endpoints[2][4];
+  for (uint32_t c = 0; c < 4; c++)
+  {
+    endpoints[0][c] = reader.read(7);
+    endpoints[1][c] = reader.read(7);
+  }
+  auto pBit0 = reader.read(1);
+  auto pBit1 = reader.read(1);
+  for (uint32_t c = 0; c < 4; c++)
+  {
+    endpoints[0][c] = endpoints[0][c] << 1 | pBit0;
+    endpoints[1][c] = endpoints[1][c] << 1 | pBit1;
+  }
+
+  for (uint32_t i = 0; i < c_blockTexelCount; i++)
+  {
+    auto weight = c_bc7Weights[reader.read(i == 0 ? 3 : 4)];
+    for (uint32_t c = 0; c < 4; c++)
+    {
+      texels[i][c] = (uint8_t)(((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >> 6);
+    }
+  }
+}
+
+void decodeBlock(TextureFormat format, const uint8_t* input, uint8_t (*texels)[4])
+{
+  for (uint32_t i = 0; i < c_blockTexelCount; i++)
+  {
+    texels[i][0] = 0;
+    texels[i][1] = 0;
+    texels[i][2] = 0;
+    texels[i][3] = 255;
+  }
+
+  switch (format)
+  {
+  case TextureFormat::eBC1:
+    decodeColorBlock(input, false, texels);
+    break;
+  case TextureFormat::eBC3:
+    decodeChannelBlock(input, 3, texels);
+    decodeColorBlock(input + 8, true, texels);
+    break;
+  case TextureFormat::eBC5:
+    decodeChannelBlock(input, 0, texels);
+    decodeChannelBlock(input + 8, 1, texels);
+    break;
+  case TextureFormat::eBC7:
+    decodeBc7Block(input, texels);
+    break;
+  default:
+    throw std::runtime_error("Texture format is not block compressed.");
+  }
+}
+
+uint32_t getStoredChannelCount(TextureFormat format)
+{
+  switch (format)
+  {
+  case TextureFormat::eBC1:
+    return 3;
+  case TextureFormat::eBC5:
+    return 2;
+  default:
+    return 4;
+  }
+}
+
+} // namespace
+
+const char* getTextureFormatName(TextureFormat format)
+{
+  switch (format)
+  {
+  case TextureFormat::eRGBA8:
+    return "RGBA8";
+  case TextureFormat::eBC1:
+    return "BC1";
+  case TextureFormat::eBC3:
+    return "BC3";
+  case TextureFormat::eBC5:
+    return "BC5";
+  case TextureFormat::eBC7:
+    return "BC7";
+  }
+  return "Unknown";
+}
+
+vk::Format getVkFormat(TextureFormat format)
+{
+  switch (format)
+  {
+  case TextureFormat::eRGBA8:
+    return vk::Format::eR8G8B8A8Unorm;
+  case TextureFormat::eBC1:
+    return vk::Format::eBc1RgbUnormBlock;
+  case TextureFormat::eBC3:
+    return vk::Format::eBc3UnormBlock;
+  case TextureFormat::eBC5:
+    return vk::Format::eBc5UnormBlock;
+  case TextureFormat::eBC7:
+    return vk::Format::eBc7UnormBlock;
+  }
+  throw std::runtime_error("Texture format is unknown.");
+}
+
+uint32_t getTextureBlockDimension(TextureFormat format)
+{
+  return format == TextureFormat::eRGBA8 ? 1 : 4;
+}
+
+uint32_t getTextureBlockSize(TextureFormat format)
+{
+  switch (format)
+  {
+  case TextureFormat::eRGBA8:
+    return 4;
+  case TextureFormat::eBC1:
+    return 8;
+  default:
+    return 16;
+  }
+}
+
+uint64_t getTextureMipSize(TextureFormat format, uint32_t width, uint32_t height)
+{
+  const auto blockDimension = getTextureBlockDimension(format);
+  return (uint64_t)((width + blockDimension - 1) / blockDimension) * ((height + blockDimension - 1) / blockDimension) * getTextureBlockSize(format);
+}
+
+void compressTexture(TextureFormat format, const uint8_t* texels, uint32_t width, uint32_t height, uint8_t* blocks, VulkanRecordingWorkers* workers, uint32_t workerCount)
+{
+  if (format == TextureFormat::eRGBA8)
+  {
+    std::memcpy(blocks, texels, (size_t)width * height * 4);
+    return;
+  }
+
+  const auto blockCountX = (width + 3) / 4;
+  const auto blockCountY = (height + 3) / 4;
+  const auto blockSize = getTextureBlockSize(format);
+  VulkanRecordingWorkers::forEach(workers, workerCount, blockCountY, [&](uint32_t blockY) {
+    BlockTexels block;
+    auto* output = blocks + (size_t)blockY * blockCountX * blockSize;
+    for (uint32_t blockX = 0; blockX < blockCountX; blockX++, output += blockSize)
+    {
+      loadBlock(texels, width, height, blockX, blockY, block);
+      encodeBlock(format, block, output);
+    }
+  });
+}
+
+void decompressTexture(TextureFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* texels)
+{
+  if (format == TextureFormat::eRGBA8)
+  {
+    std::memcpy(texels, blocks, (size_t)width * height * 4);
+    return;
+  }
+
+  const auto blockCountX = (width + 3) / 4;
+  const auto blockCountY = (height + 3) / 4;
+  const auto blockSize = getTextureBlockSize(format);
+  uint8_t blockTexels[c_blockTexelCount][4];
+  for (uint32_t blockY = 0; blockY < blockCountY; blockY++)
+  {
+    for (uint32_t blockX = 0; blockX < blockCountX; blockX++)
+    {
+      decodeBlock(format, blocks + ((size_t)blockY * blockCountX + blockX) * blockSize, blockTexels);
+
+      // Texels of the partial blocks past the edges are dropped.
+      for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; y++)
+      {
+        for (uint32_t x = 0; x < 4 && blockX * 4 + x < width; x++)
+        {
+          std::memcpy(texels + ((size_t)(blockY * 4 + y) * width + blockX * 4 + x) * 4, blockTexels[y * 4 + x], 4);
+        }
+      }
+    }
+  }
+}
+
+double computeTexturePsnr(TextureFormat format, const uint8_t* original, const uint8_t* decoded, uint32_t width, uint32_t height)
+{
+  const auto channelCount = getStoredChannelCount(format);
+  const auto texelCount = (size_t)width * height;
+
+  double squaredError = 0.0;
+  for (size_t i = 0; i < texelCount; i++)
+  {
+    for (uint32_t c = 0; c < channelCount; c++)
+    {
+      auto difference = (double)original[i * 4 + c] - decoded[i * 4 + c];
+      squaredError += difference * difference;
+    }
+  }
+
+  if (squaredError == 0.0)
+  {
+    return std::numeric_limits<double>::infinity();
+  }
+
+  auto meanSquaredError = squaredError / ((double)texelCount * channelCount);
+  return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+} // namespace VkHal
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vulkan/vulkan.hpp>
+
+namespace VkHal
+{
+class VulkanRecordingWorkers;
+
+enum class TextureFormat : uint8_t
+{
+  eRGBA8,
+  eBC1, // RGB, 4 bits per texel. Alpha is dropped.
+  eBC3, // RGBA, a BC1 color block and an interpolated alpha block, 8 bits per texel.
+  eBC5, // Red and green, one interpolated block each, 8 bits per texel. Meant for normal maps.
+  eBC7, // RGBA, mode 6 blocks only: one subset with 4 bit indices, 8 bits per texel.
+};
+
+const char* getTextureFormatName(TextureFormat format);
+vk::Format getVkFormat(TextureFormat format);
+
+/** @brief Texels per side of a block, 4 for the block compressed formats and 1 for eRGBA8. */
+uint32_t getTextureBlockDimension(TextureFormat format);
+
+/** @brief Bytes per block. */
+uint32_t getTextureBlockSize(TextureFormat format);
+
+uint64_t getTextureMipSize(TextureFormat format, uint32_t width, uint32_t height);
+
+/**
+ * @brief Encodes RGBA8 texels to the blocks of the format. The block rows are spread over the workers when given.
+ * Blocks crossing the right or bottom edge repeat the last column and row.
+ */
+void compressTexture(TextureFormat format, const uint8_t* texels, uint32_t width, uint32_t height, uint8_t* blocks, VulkanRecordingWorkers* workers = nullptr, uint32_t workerCount = 1);
+
+/** @brief Decodes the blocks compressTexture writes back to RGBA8, to measure the encoding quality. Channels the format lacks are 0, alpha is 255. */
+void decompressTexture(TextureFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* texels);
+
+/** @brief Peak signal to noise ratio in dB over the channels the format stores, infinite when they match. */
+double computeTexturePsnr(TextureFormat format, const uint8_t* original, const uint8_t* decoded, uint32_t width, uint32_t height);
+} // namespace VkHal
@@ -0,0 +1,406 @@
+#include "VertexLayout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "glm/gtc/constants.hpp"
+#include "glm/gtc/packing.hpp"
+
+#include "VkHal/VkMesh.h"
+
+namespace VkHal
+{
+namespace
+{
+constexpr float c_snorm16HalfStep = 0.5f / 32767.0f;
+constexpr float c_unorm16HalfStep = 0.5f / 65535.0f;
+constexpr float c_float16HalfStep = 1.0f / 4096.0f; // Half a float16 ulp for values in [0.5, 1], the largest ulp of the normalized range.
+constexpr float c_octahedralSnorm16MaxAngle = 1.0e-4f; // Measured worst case is about 6.4e-5 radians.
+
+// Float rounding of the dequantization itself, scaled by the magnitude of the values.
+constexpr float c_floatRoundingTolerance = 4.0f * std::numeric_limits<float>::epsilon();
+
+template <typename T>
+void writeValue(uint8_t* output, const T& value)
+{
+  std::memcpy(output, &value, sizeof(T));
+}
+
+template <typename T>
+T readValue(const uint8_t* input)
+{
+  T value;
+  std::memcpy(&value, input, sizeof(T));
+  return value;
+}
+
+float maxComponent(const glm::vec3& value)
+{
+  return std::max(value.x, std::max(value.y, value.z));
+}
+
+glm::vec2 signNotZero(const glm::vec2& value)
+{
+  return {value.x >= 0.0f ? 1.0f : -1.0f, value.y >= 0.0f ? 1.0f : -1.0f};
+}
+
+// http://jcgt.org/published/0003/02/01/
+glm::vec2 encodeOctahedral(const glm::vec3& normal)
+{
+  auto length1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+  if (length1 == 0.0f)
+  {
+    return {0.0f, 0.0f};
+  }
+
+  auto projected = glm::vec2(normal) / length1;
+  if (normal.z < 0.0f)
+  {
+    // The lower hemisphere is folded over the diagonals.
+    projected = (1.0f - glm::abs(glm::vec2(projected.y, projected.x))) * signNotZero(projected);
+  }
+  return projected;
+}
+
+glm::vec3 decodeOctahedral(const glm::vec2& encoded)
+{
+  glm::vec3 normal{encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y)};
+  if (normal.z < 0.0f)
+  {
+    auto unfolded = (1.0f - glm::abs(glm::vec2(normal.y, normal.x))) * signNotZero(glm::vec2(normal));
+    normal.x = unfolded.x;
+    normal.y = unfolded.y;
+  }
+  return glm::normalize(normal);
+}
+
+float getAngle(const glm::vec3& lhs, const glm::vec3& rhs)
+{
+  auto lhsLength = glm::length(lhs);
+  auto rhsLength = glm::length(rhs);
+  if (lhsLength == 0.0f)
+  {
+    // Degenerate source normal, there is no direction to preserve.
+    return 0.0f;
+  }
+  if (rhsLength == 0.0f)
+  {
+    return glm::pi<float>();
+  }
+
+  // atan2 keeps its precision for the tiny angles quantization produces, acos does not.
+  return std::atan2(glm::length(glm::cross(lhs, rhs)), glm::dot(lhs, rhs));
+}
+} // namespace
+
+VertexLayout::VertexLayout(const VertexLayoutDesc& desc)
+    : m_desc{desc}
+{
+  switch (m_desc.m_streams)
+  {
+  case VertexStreams::eInterleaved:
+    m_attributeStream = c_vertexPositionStream;
+    break;
+  case VertexStreams::ePositionSplit:
+    m_attributeStream = c_vertexPositionStream + 1;
+    break;
+  default:
+    throw std::runtime_error("Unknown vertex stream layout.");
+  }
+
+  auto& positionStride = m_streamStrides[c_vertexPositionStream];
+  m_positionOffset = positionStride;
+  switch (m_desc.m_position)
+  {
+  case PositionEncoding::eFloat32:
+    positionStride += sizeof(glm::vec3);
+    break;
+  case PositionEncoding::eFloat16:
+  case PositionEncoding::eSnorm16:
+    // Three component 16 bit formats are rarely supported as vertex input, w holds 1.
+    positionStride += 4 * sizeof(uint16_t);
+    break;
+  default:
+    throw std::runtime_error("Unknown vertex position encoding.");
+  }
+
+  auto& attributeStride = m_streamStrides[m_attributeStream];
+  m_normalOffset = attributeStride;
+  switch (m_desc.m_normal)
+  {
+  case NormalEncoding::eNone:
+    break;
+  case NormalEncoding::eFloat32:
+    attributeStride += sizeof(glm::vec3);
+    break;
+  case NormalEncoding::eOctahedralSnorm16:
+    attributeStride += 2 * sizeof(uint16_t);
+    break;
+  default:
+    throw std::runtime_error("Unknown vertex normal encoding.");
+  }
+
+  m_texCoordOffset = attributeStride;
+  switch (m_desc.m_texCoord)
+  {
+  case TexCoordEncoding::eNone:
+    break;
+  case TexCoordEncoding::eFloat32:
+    attributeStride += sizeof(glm::vec2);
+    break;
+  case TexCoordEncoding::eUnorm16:
+    attributeStride += 2 * sizeof(uint16_t);
+    break;
+  default:
+    throw std::runtime_error("Unknown vertex texture coordinate encoding.");
+  }
+
+  // A split layout without other attributes has nothing in its second stream.
+  m_streamCount = m_streamStrides[1] > 0 ? 2 : 1;
+}
+
+uint32_t VertexLayout::getStreamMask(VertexAttributeMask attributes) const
+{
+  uint32_t streamMask = 0;
+  if (attributes & c_vertexPositionBit)
+  {
+    streamMask |= 1 << c_vertexPositionStream;
+  }
+  if ((attributes & c_vertexNormalBit && m_desc.m_normal != NormalEncoding::eNone) || (attributes & c_vertexTexCoordBit && m_desc.m_texCoord != TexCoordEncoding::eNone))
+  {
+    streamMask |= 1 << m_attributeStream;
+  }
+  return streamMask;
+}
+
+std::vector<vk::VertexInputBindingDescription> VertexLayout::getBindingDescriptions(VertexAttributeMask attributes) const
+{
+  std::vector<vk::VertexInputBindingDescription> bindingsDesc;
+
+  auto streamMask = getStreamMask(attributes);
+  for (uint32_t stream = 0; stream < m_streamCount; stream++)
+  {
+    if (streamMask & 1 << stream)
+    {
+      bindingsDesc.emplace_back(stream, m_streamStrides[stream], vk::VertexInputRate::eVertex);
+    }
+  }
+
+  return bindingsDesc;
+}
+
+std::vector<vk::VertexInputAttributeDescription> VertexLayout::getAttributeDescriptions(VertexAttributeMask attributes) const
+{
+  std::vector<vk::VertexInputAttributeDescription> attributesDesc;
+
+  if (attributes & c_vertexPositionBit)
+  {
+    static constexpr vk::Format positionFormats[] = {vk::Format::eR32G32B32Sfloat, vk::Format::eR16G16B16A16Sfloat, vk::Format::eR16G16B16A16Snorm};
+    attributesDesc.emplace_back(c_vertexPositionLocation, c_vertexPositionStream, positionFormats[(size_t)m_desc.m_position], m_positionOffset);
+  }
+
+  if (attributes & c_vertexNormalBit && m_desc.m_normal != NormalEncoding::eNone)
+  {
+    auto format = m_desc.m_normal == NormalEncoding::eFloat32 ? vk::Format::eR32G32B32Sfloat : vk::Format::eR16G16Snorm;
+    attributesDesc.emplace_back(c_vertexNormalLocation, m_attributeStream, format, m_normalOffset);
+  }
+
+  if (attributes & c_vertexTexCoordBit && m_desc.m_texCoord != TexCoordEncoding::eNone)
+  {
+    auto format = m_desc.m_texCoord == TexCoordEncoding::eFloat32 ? vk::Format::eR32G32Sfloat : vk::Format::eR16G16Unorm;
+    attributesDesc.emplace_back(c_vertexTexCoordLocation, m_attributeStream, format, m_texCoordOffset);
+  }
+
+  return attributesDesc;
+}
+
+VertexDequantization VertexLayout::computeDequantization(const Vertex* vertices, size_t vertexCount) const
+{
+  VertexDequantization dequantization{};
+  if (vertexCount == 0)
+  {
+    return dequantization;
+  }
+
+  if (m_desc.m_position != PositionEncoding::eFloat32)
+  {
+    auto boundsMin = vertices[0].pos;
+    auto boundsMax = vertices[0].pos;
+    for (size_t i = 1; i < vertexCount; i++)
+    {
+      boundsMin = glm::min(boundsMin, vertices[i].pos);
+      boundsMax = glm::max(boundsMax, vertices[i].pos);
+    }
+
+    // Centered so the encodings are symmetric, a flat axis keeps a unit scale.
+    auto halfExtent = (boundsMax - boundsMin) * 0.5f;
+    dequantization.m_positionOffset = (boundsMin + boundsMax) * 0.5f;
+    dequantization.m_positionScale = glm::vec3{halfExtent.x > 0.0f ? halfExtent.x : 1.0f, halfExtent.y > 0.0f ? halfExtent.y : 1.0f, halfExtent.z > 0.0f ? halfExtent.z : 1.0f};
+  }
+
+  if (m_desc.m_texCoord == TexCoordEncoding::eUnorm16)
+  {
+    auto boundsMin = vertices[0].texCoord;
+    auto boundsMax = vertices[0].texCoord;
+    for (size_t i = 1; i < vertexCount; i++)
+    {
+      boundsMin = glm::min(boundsMin, vertices[i].texCoord);
+      boundsMax = glm::max(boundsMax, vertices[i].texCoord);
+    }
+
+    auto extent = boundsMax - boundsMin;
+    dequantization.m_texCoordOffset = boundsMin;
+    dequantization.m_texCoordScale = glm::vec2{extent.x > 0.0f ? extent.x : 1.0f, extent.y > 0.0f ? extent.y : 1.0f};
+  }
+
+  return dequantization;
+}
+
+void VertexLayout::encode(const Vertex* vertices, size_t vertexCount, const VertexDequantization& dequantization, const VertexStreamPointers& streams) const
+{
+  for (size_t i = 0; i < vertexCount; i++)
+  {
+    const auto& vertex = vertices[i];
+    auto* positionOutput = streams[c_vertexPositionStream] + i * m_streamStrides[c_vertexPositionStream];
+    auto* attributeOutput = m_streamStrides[m_attributeStream] > 0 ? streams[m_attributeStream] + i * m_streamStrides[m_attributeStream] : nullptr;
+
+    auto normalizedPosition = glm::clamp((vertex.pos - dequantization.m_positionOffset) / dequantization.m_positionScale, -1.0f, 1.0f);
+    switch (m_desc.m_position)
+    {
+    case PositionEncoding::eFloat32:
+      writeValue(positionOutput + m_positionOffset, vertex.pos);
+      break;
+    case PositionEncoding::eFloat16:
+      writeValue(positionOutput + m_positionOffset, glm::packHalf4x16(glm::vec4(normalizedPosition, 1.0f)));
+      break;
+    case PositionEncoding::eSnorm16:
+      writeValue(positionOutput + m_positionOffset, glm::packSnorm4x16(glm::vec4(normalizedPosition, 1.0f)));
+      break;
+    }
+
+    switch (m_desc.m_normal)
+    {
+    case NormalEncoding::eNone:
+      break;
+    case NormalEncoding::eFloat32:
+      writeValue(attributeOutput + m_normalOffset, vertex.normal);
+      break;
+    case NormalEncoding::eOctahedralSnorm16:
+      writeValue(attributeOutput + m_normalOffset, glm::packSnorm2x16(encodeOctahedral(vertex.normal)));
+      break;
+    }
+
+    switch (m_desc.m_texCoord)
+    {
+    case TexCoordEncoding::eNone:
+      break;
+    case TexCoordEncoding::eFloat32:
+      writeValue(attributeOutput + m_texCoordOffset, vertex.texCoord);
+      break;
+    case TexCoordEncoding::eUnorm16:
+      writeValue(attributeOutput + m_texCoordOffset, glm::packUnorm2x16(glm::clamp((vertex.texCoord - dequantization.m_texCoordOffset) / dequantization.m_texCoordScale, 0.0f, 1.0f)));
+      break;
+    }
+  }
+}
+
+void VertexLayout::decode(const ConstVertexStreamPointers& streams, size_t vertexCount, const VertexDequantization& dequantization, Vertex* vertices) const
+{
+  for (size_t i = 0; i < vertexCount; i++)
+  {
+    Vertex vertex{};
+    const auto* positionInput = streams[c_vertexPositionStream] + i * m_streamStrides[c_vertexPositionStream];
+    const auto* attributeInput = m_streamStrides[m_attributeStream] > 0 ? streams[m_attributeStream] + i * m_streamStrides[m_attributeStream] : nullptr;
+
+    switch (m_desc.m_position)
+    {
+    case PositionEncoding::eFloat32:
+      vertex.pos = readValue<glm::vec3>(positionInput + m_positionOffset);
+      break;
+    case PositionEncoding::eFloat16:
+      vertex.pos = glm::vec3(glm::unpackHalf4x16(readValue<glm::uint64>(positionInput + m_positionOffset))) * dequantization.m_positionScale + dequantization.m_positionOffset;
+      break;
+    case PositionEncoding::eSnorm16:
+      vertex.pos = glm::vec3(glm::unpackSnorm4x16(readValue<glm::uint64>(positionInput + m_positionOffset))) * dequantization.m_positionScale + dequantization.m_positionOffset;
+      break;
+    }
+
+    switch (m_desc.m_normal)
+    {
+    case NormalEncoding::eNone:
+      break;
+    case NormalEncoding::eFloat32:
+      vertex.normal = readValue<glm::vec3>(attributeInput + m_normalOffset);
+      break;
+    case NormalEncoding::eOctahedralSnorm16:
+      vertex.normal = decodeOctahedral(glm::unpackSnorm2x16(readValue<glm::uint32>(attributeInput + m_normalOffset)));
+      break;
+    }
+
+    switch (m_desc.m_texCoord)
+    {
+    case TexCoordEncoding::eNone:
+      break;
+    case TexCoordEncoding::eFloat32:
+      vertex.texCoord = readValue<glm::vec2>(attributeInput + m_texCoordOffset);
+      break;
+    case TexCoordEncoding::eUnorm16:
+      vertex.texCoord = glm::unpackUnorm2x16(readValue<glm::uint32>(attributeInput + m_texCoordOffset)) * dequantization.m_texCoordScale + dequantization.m_texCoordOffset;
+      break;
+    }
+
+    vertices[i] = vertex;
+  }
+}
+
+VertexQuantizationError VertexLayout::getErrorBound(const VertexDequantization& dequantization) const
+{
+  VertexQuantizationError bound{};
+
+  auto positionMagnitude = maxComponent(glm::abs(dequantization.m_positionOffset) + dequantization.m_positionScale);
+  bound.m_position = positionMagnitude * c_floatRoundingTolerance;
+  if (m_desc.m_position == PositionEncoding::eSnorm16)
+  {
+    bound.m_position += maxComponent(dequantization.m_positionScale) * c_snorm16HalfStep;
+  }
+  else if (m_desc.m_position == PositionEncoding::eFloat16)
+  {
+    bound.m_position += maxComponent(dequantization.m_positionScale) * c_float16HalfStep;
+  }
+
+  bound.m_normal = m_desc.m_normal == NormalEncoding::eOctahedralSnorm16 ? c_octahedralSnorm16MaxAngle : c_floatRoundingTolerance;
+
+  auto texCoordMagnitude = std::max(std::abs(dequantization.m_texCoordOffset.x) + dequantization.m_texCoordScale.x, std::abs(dequantization.m_texCoordOffset.y) + dequantization.m_texCoordScale.y);
+  bound.m_texCoord = texCoordMagnitude * c_floatRoundingTolerance;
+  if (m_desc.m_texCoord == TexCoordEncoding::eUnorm16)
+  {
+    bound.m_texCoord += std::max(dequantization.m_texCoordScale.x, dequantization.m_texCoordScale.y) * c_unorm16HalfStep;
+  }
+
+  return bound;
+}
+
+VertexQuantizationError VertexLayout::measureError(const Vertex* original, const Vertex* decoded, size_t vertexCount) const
+{
+  VertexQuantizationError error{};
+  for (size_t i = 0; i < vertexCount; i++)
+  {
+    error.m_position = std::max(error.m_position, maxComponent(glm::abs(original[i].pos - decoded[i].pos)));
+
+    if (m_desc.m_normal != NormalEncoding::eNone)
+    {
+      error.m_normal = std::max(error.m_normal, getAngle(original[i].normal, decoded[i].normal));
+    }
+
+    if (m_desc.m_texCoord != TexCoordEncoding::eNone)
+    {
+      auto texCoordError = glm::abs(original[i].texCoord - decoded[i].texCoord);
+      error.m_texCoord = std::max(error.m_texCoord, std::max(texCoordError.x, texCoordError.y));
+    }
+  }
+  return error;
+}
+} // namespace VkHal
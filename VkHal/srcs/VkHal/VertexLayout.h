@@ -0,0 +1,158 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+namespace VkHal
+{
+struct Vertex;
+
+enum class PositionEncoding : uint8_t
+{
+  eFloat32,
+  eFloat16, // Relative to the mesh bounds.
+  eSnorm16, // Relative to the mesh bounds.
+};
+
+enum class NormalEncoding : uint8_t
+{
+  eNone,
+  eFloat32,
+  eOctahedralSnorm16,
+};
+
+enum class TexCoordEncoding : uint8_t
+{
+  eNone,
+  eFloat32,
+  eUnorm16, // Relative to the mesh texture coordinate bounds.
+};
+
+enum class VertexStreams : uint8_t
+{
+  eInterleaved,   // Every attribute in stream 0.
+  ePositionSplit, // Position alone in stream 0, the other attributes in stream 1, so position only passes fetch nothing else.
+};
+
+/** @brief Shader input locations of the vertex attributes. A dropped attribute leaves its location unused. */
+constexpr uint32_t c_vertexPositionLocation = 0;
+constexpr uint32_t c_vertexNormalLocation = 1;
+constexpr uint32_t c_vertexTexCoordLocation = 2;
+
+/** @brief Attributes a pass reads, one bit per shader input location. */
+using VertexAttributeMask = uint32_t;
+constexpr VertexAttributeMask c_vertexPositionBit = 1 << c_vertexPositionLocation;
+constexpr VertexAttributeMask c_vertexNormalBit = 1 << c_vertexNormalLocation;
+constexpr VertexAttributeMask c_vertexTexCoordBit = 1 << c_vertexTexCoordLocation;
+constexpr VertexAttributeMask c_vertexAllAttributes = c_vertexPositionBit | c_vertexNormalBit | c_vertexTexCoordBit;
+
+/** @brief Streams are bound at the binding of their index. */
+constexpr uint32_t c_maxVertexStreamCount = 2;
+constexpr uint32_t c_vertexPositionStream = 0;
+
+struct VertexLayoutDesc
+{
+  PositionEncoding m_position = PositionEncoding::eFloat32;
+  NormalEncoding m_normal = NormalEncoding::eNone;
+  TexCoordEncoding m_texCoord = TexCoordEncoding::eFloat32;
+  VertexStreams m_streams = VertexStreams::eInterleaved;
+
+  bool operator==(const VertexLayoutDesc& other) const
+  {
+    return m_position == other.m_position && m_normal == other.m_normal && m_texCoord == other.m_texCoord && m_streams == other.m_streams;
+  }
+
+  bool operator!=(const VertexLayoutDesc& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+/** @brief Maps the encoded attributes of one mesh back to model space: value = encoded * scale + offset. Identity for float32 attributes. */
+struct VertexDequantization
+{
+  glm::vec3 m_positionScale = glm::vec3(1.0f);
+  glm::vec3 m_positionOffset = glm::vec3(0.0f);
+  glm::vec2 m_texCoordScale = glm::vec2(1.0f);
+  glm::vec2 m_texCoordOffset = glm::vec2(0.0f);
+};
+
+/** @brief Largest difference between original and decoded attributes. The normal error is an angle in radians. */
+struct VertexQuantizationError
+{
+  float m_position = 0.0f;
+  float m_normal = 0.0f;
+  float m_texCoord = 0.0f;
+};
+
+/** @brief First vertex of a range in each stream of a layout. Unused streams are ignored. */
+using VertexStreamPointers = std::array<uint8_t*, c_maxVertexStreamCount>;
+using ConstVertexStreamPointers = std::array<const uint8_t*, c_maxVertexStreamCount>;
+
+/** @brief Vertex stream layout built from per attribute encodings. Generates the vertex input state of the attributes a pass reads. */
+class VertexLayout
+{
+public:
+  VertexLayout() = default;
+
+  /** @brief Throws if an encoding is unknown, the desc may come from a file. */
+  explicit VertexLayout(const VertexLayoutDesc& desc);
+
+  const VertexLayoutDesc& getDesc() const
+  {
+    return m_desc;
+  }
+
+  /** @brief Bytes per vertex over all the streams. */
+  uint32_t getStride() const
+  {
+    return m_streamStrides[0] + m_streamStrides[1];
+  }
+
+  uint32_t getStreamCount() const
+  {
+    return m_streamCount;
+  }
+
+  uint32_t getStreamStride(uint32_t stream) const
+  {
+    return m_streamStrides[stream];
+  }
+
+  /** @brief Bit per stream holding one of the attributes, those a pass reading them must bind. */
+  uint32_t getStreamMask(VertexAttributeMask attributes) const;
+
+  /** @brief One binding per stream the attributes need, at the binding of the stream index. */
+  std::vector<vk::VertexInputBindingDescription> getBindingDescriptions(VertexAttributeMask attributes = c_vertexAllAttributes) const;
+  std::vector<vk::VertexInputAttributeDescription> getAttributeDescriptions(VertexAttributeMask attributes = c_vertexAllAttributes) const;
+
+  /** @brief Dequantization fitting the bounds of the vertices, so the normalized encodings use their whole range. */
+  VertexDequantization computeDequantization(const Vertex* vertices, size_t vertexCount) const;
+
+  void encode(const Vertex* vertices, size_t vertexCount, const VertexDequantization& dequantization, const VertexStreamPointers& streams) const;
+  void decode(const ConstVertexStreamPointers& streams, size_t vertexCount, const VertexDequantization& dequantization, Vertex* vertices) const;
+
+  /** @brief Worst error the encodings may introduce for a mesh with this dequantization. */
+  VertexQuantizationError getErrorBound(const VertexDequantization& dequantization) const;
+
+  /** @brief Measures the error of decoded vertices against the originals. Dropped attributes are not compared. */
+  VertexQuantizationError measureError(const Vertex* original, const Vertex* decoded, size_t vertexCount) const;
+
+private:
+  VertexLayoutDesc m_desc;
+  std::array<uint32_t, c_maxVertexStreamCount> m_streamStrides = {};
+  uint32_t m_streamCount = 0;
+  uint32_t m_attributeStream = 0; // Stream of the normal and texture coordinates.
+  uint32_t m_positionOffset = 0;
+  uint32_t m_normalOffset = 0;
+  uint32_t m_texCoordOffset = 0;
+};
+} // namespace VkHal
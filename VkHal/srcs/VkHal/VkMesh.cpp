@@ -0,0 +1,464 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "VkHal/MeshOptimizer.h"
+#include "VkHal/MeshSimplifier.h"
+#include "VkHal/Vulkan/VulkanRecordingWorkers.h"
+#include "VkHal/VkMesh.h"
+
+namespace VkHal
+{
+namespace
+{
+MeshMaterial processMaterial(const aiMaterial* material)
+{
+  MeshMaterial meshMaterial{};
+
+  // The material Assimp makes up for a model without materials has a gray diffuse, it should not tint the texture.
+  aiString name;
+  auto isDefaultMaterial = material->Get(AI_MATKEY_NAME, name) == aiReturn_SUCCESS && name == aiString(AI_DEFAULT_MATERIAL_NAME);
+
+  aiColor4D diffuseColor{};
+  if (!isDefaultMaterial && material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseColor) == aiReturn_SUCCESS)
+  {
+    meshMaterial.m_baseColor = {diffuseColor.r, diffuseColor.g, diffuseColor.b, diffuseColor.a};
+  }
+
+  aiString texturePath;
+  if (material->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath) == aiReturn_SUCCESS)
+  {
+    meshMaterial.m_diffuseTexture = texturePath.C_Str();
+  }
+
+  return meshMaterial;
+}
+
+uint32_t countIndices(const aiMesh* mesh)
+{
+  uint32_t indexCount = 0;
+  for (uint32_t i = 0; i < mesh->mNumFaces; i++)
+  {
+    indexCount += mesh->mFaces[i].mNumIndices;
+  }
+  return indexCount;
+}
+
+/** @brief Writes the mesh to its preallocated range, it touches nothing outside of it so meshes can be converted concurrently. */
+void processMesh(const aiMesh* mesh, Vertex* vertices, uint32_t* indices)
+{
+  bool hasFirstSetOfUV = mesh->mTextureCoords[0] != nullptr;
+
+  for (uint32_t i = 0; i < mesh->mNumVertices; i++)
+  {
+    const auto& aiVertex = mesh->mVertices[i];
+
+    Vertex vertex{};
+    vertex.pos = {aiVertex.x, aiVertex.y, aiVertex.z};
+
+    if (mesh->HasNormals())
+    {
+      const auto& aiNormal = mesh->mNormals[i];
+      vertex.normal = {aiNormal.x, aiNormal.y, aiNormal.z};
+    }
+
+    if (hasFirstSetOfUV)
+    {
+      const auto& aiUV = mesh->mTextureCoords[0][i];
+      vertex.texCoord = {aiUV.x, aiUV.y};
+    }
+    else
+    {
+      vertex.texCoord = {0.0f, 0.0f};
+    }
+    vertices[i] = vertex;
+  }
+
+  for (uint32_t i = 0; i < mesh->mNumFaces; i++)
+  {
+    const auto& face = mesh->mFaces[i];
+    for (uint32_t j = 0; j < face.mNumIndices; j++)
+    {
+      *indices++ = face.mIndices[j];
+    }
+  }
+}
+} // namespace
+
+const aiScene* MeshLoader::importScene(Assimp::Importer& importer, const std::filesystem::path& path, uint32_t meshVertexLimit)
+{
+  // https://learnopengl.com/Model-Loading/Assimp
+  // https://learnopengl.com/Model-Loading/Model
+  // The mesh optimizations work on triangle lists.
+  unsigned int flags = aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices | aiProcess_Triangulate;
+  if (meshVertexLimit > 0)
+  {
+    importer.SetPropertyInteger(AI_CONFIG_PP_SLM_VERTEX_LIMIT, (int)meshVertexLimit);
+    flags |= aiProcess_SplitLargeMeshes;
+  }
+
+  auto scene = importer.ReadFile(path.u8string().c_str(), flags);
+
+  if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+  {
+    throw std::runtime_error(std::string("ERROR::ASSIMP::") + importer.GetErrorString());
+  }
+
+  return scene;
+}
+
+void MeshLoader::loadModel(const std::filesystem::path& path, VulkanRecordingWorkers* workers, uint32_t meshVertexLimit)
+{
+  Assimp::Importer importer;
+  auto scene = importScene(importer, path, meshVertexLimit);
+  convertScene(scene, workers, workers ? workers->getWorkerCount() : 1);
+}
+
+void MeshLoader::convertScene(const aiScene* scene, VulkanRecordingWorkers* workers, uint32_t workerCount)
+{
+  m_vertices.clear();
+  m_indices.clear();
+  m_meshes.clear();
+  m_lods.clear();
+  m_materials.clear();
+  m_instances.clear();
+  m_hasNormals = false;
+  m_hasTexCoords = false;
+
+  // The node tree is flattened first, the meshes are then independent of each other.
+  std::vector<std::pair<const aiNode*, glm::mat4>> nodeStack;
+  nodeStack.emplace_back(scene->mRootNode, glm::mat4(1.0f));
+  while (!nodeStack.empty())
+  {
+    auto [node, parentTransform] = nodeStack.back();
+    nodeStack.pop_back();
+
+    // Assimp matrices are row major.
+    auto worldTransform = parentTransform * glm::transpose(glm::make_mat4(&node->mTransformation.a1));
+
+    for (uint32_t i = 0; i < node->mNumMeshes; i++)
+    {
+      m_instances.push_back({worldTransform, node->mMeshes[i]});
+    }
+
+    // Pushed in reverse so the instances keep the depth first order of the tree.
+    for (uint32_t i = node->mNumChildren; i > 0; i--)
+    {
+      nodeStack.emplace_back(node->mChildren[i - 1], worldTransform);
+    }
+  }
+
+  m_materials.reserve(scene->mNumMaterials);
+  for (uint32_t i = 0; i < scene->mNumMaterials; i++)
+  {
+    m_materials.push_back(processMaterial(scene->mMaterials[i]));
+  }
+
+  const uint32_t meshCount = scene->mNumMeshes;
+  m_meshes.resize(meshCount);
+
+  for (uint32_t i = 0; i < meshCount; i++)
+  {
+    m_hasNormals |= scene->mMeshes[i]->HasNormals();
+    m_hasTexCoords |= scene->mMeshes[i]->mTextureCoords[0] != nullptr;
+  }
+
+  // Pass 1: count, faces are not all triangles so the index count needs a walk over them.
+  VulkanRecordingWorkers::forEach(workers, workerCount, meshCount, [&](uint32_t meshIndex) {
+    const auto* mesh = scene->mMeshes[meshIndex];
+    m_meshes[meshIndex].m_vertexCount = mesh->mNumVertices;
+    m_meshes[meshIndex].m_indexCount = countIndices(mesh);
+    m_meshes[meshIndex].m_materialIndex = mesh->mMaterialIndex;
+  });
+
+  // Exclusive prefix sum gives every mesh its own range of the arenas.
+  uint64_t vertexCount = 0;
+  uint64_t indexCount = 0;
+  for (auto& mesh : m_meshes)
+  {
+    mesh.m_firstVertex = (uint32_t)vertexCount;
+    mesh.m_firstIndex = (uint32_t)indexCount;
+    vertexCount += mesh.m_vertexCount;
+    indexCount += mesh.m_indexCount;
+  }
+
+  if (vertexCount > UINT32_MAX || indexCount > UINT32_MAX)
+  {
+    throw std::runtime_error("Scene has too many vertices or indices for 32 bit offsets");
+  }
+
+  m_vertices.resize(vertexCount);
+  m_indices.resize(indexCount);
+
+  // Pass 2: convert, each mesh writes only to its range.
+  VulkanRecordingWorkers::forEach(workers, workerCount, meshCount, [&](uint32_t meshIndex) {
+    const auto& mesh = m_meshes[meshIndex];
+    processMesh(scene->mMeshes[meshIndex], m_vertices.data() + mesh.m_firstVertex, m_indices.data() + mesh.m_firstIndex);
+  });
+}
+
+MeshOptimizationStats MeshLoader::optimizeMeshes(VulkanRecordingWorkers* workers, uint32_t workerCount)
+{
+  std::vector<MeshOptimizationStats> meshStats(m_meshes.size());
+
+  // Indices are relative to the first vertex of their mesh, every mesh is optimized on its own.
+  VulkanRecordingWorkers::forEach(workers, workerCount, (uint32_t)m_meshes.size(), [&](uint32_t meshIndex) {
+    const auto& mesh = m_meshes[meshIndex];
+    auto* vertices = m_vertices.data() + mesh.m_firstVertex;
+    auto* indices = m_indices.data() + mesh.m_firstIndex;
+
+    meshStats[meshIndex].m_before = analyzeVertexCache(indices, mesh.m_indexCount, mesh.m_vertexCount);
+    optimizeVertexCache(indices, mesh.m_indexCount, mesh.m_vertexCount);
+    optimizeOverdraw(indices, mesh.m_indexCount, vertices, mesh.m_vertexCount);
+    optimizeVertexFetch(vertices, indices, mesh.m_indexCount, mesh.m_vertexCount);
+    meshStats[meshIndex].m_after = analyzeVertexCache(indices, mesh.m_indexCount, mesh.m_vertexCount);
+  });
+
+  MeshOptimizationStats stats{};
+  for (const auto& meshStat : meshStats)
+  {
+    stats.m_before += meshStat.m_before;
+    stats.m_after += meshStat.m_after;
+  }
+  return stats;
+}
+
+uint32_t MeshLoader::splitMeshes(uint32_t maxVertexCount, VulkanRecordingWorkers* workers, uint32_t workerCount)
+{
+  if (!m_lods.empty())
+  {
+    throw std::runtime_error("Meshes must be split before their levels of detail are generated");
+  }
+
+  struct MeshParts
+  {
+    std::vector<Mesh> m_parts; // Ranges relative to the part streams below.
+    std::vector<Vertex> m_vertices;
+    std::vector<uint32_t> m_indices;
+  };
+
+  const auto meshCount = (uint32_t)m_meshes.size();
+  std::vector<MeshParts> meshParts(meshCount);
+
+  VulkanRecordingWorkers::forEach(workers, workerCount, meshCount, [&](uint32_t meshIndex) {
+    const auto& mesh = m_meshes[meshIndex];
+    if (mesh.m_vertexCount <= maxVertexCount)
+    {
+      return;
+    }
+
+    auto& parts = meshParts[meshIndex];
+    const auto* vertices = m_vertices.data() + mesh.m_firstVertex;
+    const auto* indices = m_indices.data() + mesh.m_firstIndex;
+
+    // Index of every mesh vertex in the current part, valid when its stamp is the current part.
+    std::vector<uint32_t> localIndices(mesh.m_vertexCount);
+    std::vector<uint32_t> partStamps(mesh.m_vertexCount, std::numeric_limits<uint32_t>::max());
+
+    auto startPart = [&]() {
+      Mesh part{};
+      part.m_firstVertex = (uint32_t)parts.m_vertices.size();
+      part.m_firstIndex = (uint32_t)parts.m_indices.size();
+      part.m_materialIndex = mesh.m_materialIndex;
+      parts.m_parts.push_back(part);
+    };
+
+    startPart();
+    for (uint32_t i = 0; i + 2 < mesh.m_indexCount; i += 3)
+    {
+      auto partIndex = (uint32_t)parts.m_parts.size() - 1;
+      uint32_t newVertexCount = 0;
+      for (uint32_t j = 0; j < 3; j++)
+      {
+        auto vertex = indices[i + j];
+        auto isRepeated = (j > 0 && indices[i] == vertex) || (j > 1 && indices[i + 1] == vertex);
+        newVertexCount += partStamps[vertex] != partIndex && !isRepeated ? 1 : 0;
+      }
+
+      if (parts.m_parts.back().m_vertexCount + newVertexCount > maxVertexCount)
+      {
+        startPart();
+        partIndex++;
+      }
+
+      auto& part = parts.m_parts.back();
+      for (uint32_t j = 0; j < 3; j++)
+      {
+        auto vertex = indices[i + j];
+        if (partStamps[vertex] != partIndex)
+        {
+          // First use in this part, the fetch order of the optimized mesh is kept.
+          partStamps[vertex] = partIndex;
+          localIndices[vertex] = part.m_vertexCount++;
+          parts.m_vertices.push_back(vertices[vertex]);
+        }
+        parts.m_indices.push_back(localIndices[vertex]);
+      }
+      part.m_indexCount += 3;
+    }
+  });
+
+  // Prefix sum over the parts, meshes that were not split keep their range as one part.
+  std::vector<uint32_t> firstParts(meshCount);
+  std::vector<Mesh> meshes;
+  uint64_t vertexCount = 0;
+  uint64_t indexCount = 0;
+  uint32_t splitMeshCount = 0;
+  for (uint32_t meshIndex = 0; meshIndex < meshCount; meshIndex++)
+  {
+    firstParts[meshIndex] = (uint32_t)meshes.size();
+    if (meshParts[meshIndex].m_parts.empty())
+    {
+      auto mesh = m_meshes[meshIndex];
+      mesh.m_firstVertex = (uint32_t)vertexCount;
+      mesh.m_firstIndex = (uint32_t)indexCount;
+      meshes.push_back(mesh);
+    }
+    else
+    {
+      for (auto part : meshParts[meshIndex].m_parts)
+      {
+        part.m_firstVertex += (uint32_t)vertexCount;
+        part.m_firstIndex += (uint32_t)indexCount;
+        meshes.push_back(part);
+      }
+      splitMeshCount++;
+    }
+    vertexCount = meshes.back().m_firstVertex + (uint64_t)meshes.back().m_vertexCount;
+    indexCount = meshes.back().m_firstIndex + (uint64_t)meshes.back().m_indexCount;
+  }
+
+  if (splitMeshCount == 0)
+  {
+    return 0;
+  }
+
+  if (vertexCount > UINT32_MAX || indexCount > UINT32_MAX)
+  {
+    throw std::runtime_error("Scene has too many vertices or indices for 32 bit offsets");
+  }
+
+  std::vector<Vertex> vertices(vertexCount);
+  std::vector<uint32_t> indices(indexCount);
+  VulkanRecordingWorkers::forEach(workers, workerCount, meshCount, [&](uint32_t meshIndex) {
+    const auto& parts = meshParts[meshIndex];
+    const auto& firstPart = meshes[firstParts[meshIndex]];
+    if (parts.m_parts.empty())
+    {
+      const auto& mesh = m_meshes[meshIndex];
+      std::copy_n(m_vertices.begin() + mesh.m_firstVertex, mesh.m_vertexCount, vertices.begin() + firstPart.m_firstVertex);
+      std::copy_n(m_indices.begin() + mesh.m_firstIndex, mesh.m_indexCount, indices.begin() + firstPart.m_firstIndex);
+    }
+    else
+    {
+      // The parts of a mesh are contiguous, their streams are copied at once.
+      std::copy(parts.m_vertices.begin(), parts.m_vertices.end(), vertices.begin() + firstPart.m_firstVertex);
+      std::copy(parts.m_indices.begin(), parts.m_indices.end(), indices.begin() + firstPart.m_firstIndex);
+    }
+  });
+
+  std::vector<MeshInstance> instances;
+  instances.reserve(m_instances.size());
+  for (const auto& instance : m_instances)
+  {
+    auto partCount = meshParts[instance.m_meshIndex].m_parts.empty() ? 1 : (uint32_t)meshParts[instance.m_meshIndex].m_parts.size();
+    for (uint32_t part = 0; part < partCount; part++)
+    {
+      instances.push_back({instance.m_worldTransform, firstParts[instance.m_meshIndex] + part});
+    }
+  }
+
+  m_meshes = std::move(meshes);
+  m_vertices = std::move(vertices);
+  m_indices = std::move(indices);
+  m_instances = std::move(instances);
+  return splitMeshCount;
+}
+
+uint32_t MeshLoader::generateLods(uint32_t maxLodCount, VulkanRecordingWorkers* workers, uint32_t workerCount)
+{
+  // Under that ratio of the previous level, the next one would cost a draw for too few saved triangles.
+  constexpr float c_minLodReduction = 0.9f;
+
+  struct MeshLevels
+  {
+    std::vector<std::vector<uint32_t>> m_indices;
+    std::vector<float> m_errors;
+  };
+
+  const auto meshCount = (uint32_t)m_meshes.size();
+  std::vector<MeshLevels> meshLevels(meshCount);
+
+  VulkanRecordingWorkers::forEach(workers, workerCount, meshCount, [&](uint32_t meshIndex) {
+    const auto& mesh = m_meshes[meshIndex];
+    const auto* vertices = m_vertices.data() + mesh.m_firstVertex;
+    const auto* indices = m_indices.data() + mesh.m_firstIndex;
+    auto& levels = meshLevels[meshIndex];
+
+    // Every level starts from the full mesh, the error is then against the source and not accumulated over the chain.
+    auto previousIndexCount = mesh.m_indexCount;
+    for (uint32_t lod = 1; lod < maxLodCount; lod++)
+    {
+      auto targetIndexCount = previousIndexCount / 6 * 3;
+      std::vector<uint32_t> lodIndices(mesh.m_indexCount);
+      float error = 0.0f;
+      auto indexCount = (uint32_t)simplifyMesh(lodIndices.data(), indices, mesh.m_indexCount, vertices, mesh.m_vertexCount, targetIndexCount, std::numeric_limits<float>::max(), &error);
+      if (indexCount == 0 || indexCount > previousIndexCount * c_minLodReduction)
+      {
+        break;
+      }
+
+      lodIndices.resize(indexCount);
+      optimizeVertexCache(lodIndices.data(), indexCount, mesh.m_vertexCount);
+      levels.m_indices.push_back(std::move(lodIndices));
+      levels.m_errors.push_back(error);
+      previousIndexCount = indexCount;
+    }
+  });
+
+  // Prefix sum, the levels of a mesh follow its own indices.
+  std::vector<Mesh> meshes = m_meshes;
+  std::vector<MeshLod> lods;
+  uint64_t indexCount = 0;
+  uint32_t lodCount = 0;
+  for (uint32_t meshIndex = 0; meshIndex < meshCount; meshIndex++)
+  {
+    auto& mesh = meshes[meshIndex];
+    mesh.m_firstIndex = (uint32_t)indexCount;
+    mesh.m_firstLod = (uint32_t)lods.size();
+    lods.push_back({mesh.m_firstIndex, mesh.m_indexCount, 0.0f});
+    indexCount += mesh.m_indexCount;
+
+    const auto& levels = meshLevels[meshIndex];
+    for (size_t level = 0; level < levels.m_indices.size(); level++)
+    {
+      lods.push_back({(uint32_t)indexCount, (uint32_t)levels.m_indices[level].size(), levels.m_errors[level]});
+      indexCount += levels.m_indices[level].size();
+    }
+    mesh.m_lodCount = (uint32_t)lods.size() - mesh.m_firstLod;
+    lodCount += mesh.m_lodCount - 1;
+  }
+
+  if (indexCount > UINT32_MAX)
+  {
+    throw std::runtime_error("Scene has too many vertices or indices for 32 bit offsets");
+  }
+
+  std::vector<uint32_t> indices(indexCount);
+  VulkanRecordingWorkers::forEach(workers, workerCount, meshCount, [&](uint32_t meshIndex) {
+    const auto& mesh = m_meshes[meshIndex];
+    auto output = std::copy_n(m_indices.begin() + mesh.m_firstIndex, mesh.m_indexCount, indices.begin() + meshes[meshIndex].m_firstIndex);
+    for (const auto& levelIndices : meshLevels[meshIndex].m_indices)
+    {
+      output = std::copy(levelIndices.begin(), levelIndices.end(), output);
+    }
+  });
+
+  m_meshes = std::move(meshes);
+  m_lods = std::move(lods);
+  m_indices = std::move(indices);
+  return lodCount;
+}
+} // namespace VkHal
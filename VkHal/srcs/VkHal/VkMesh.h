@@ -1,75 +1,83 @@
 #pragma once
 
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/type_ptr.hpp"
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
+#include "VkHal/Vulkan/VulkanMemoryAllocator.h"
+
 namespace VkHal
 {
+/** @brief Full precision vertex the meshes are imported and processed in. The GPU streams are encoded from it with a VertexLayout. */
 struct Vertex
 {
   glm::vec3 pos;
-  glm::vec3 color;
+  glm::vec3 normal;
   glm::vec2 texCoord;
+};
 
-  static auto getBindingDescription()
-  {
-    vk::VertexInputBindingDescription bindingDesc = {};
-    bindingDesc.binding = 0;
-    bindingDesc.stride = sizeof(Vertex);
-    bindingDesc.inputRate = vk::VertexInputRate::eVertex;
+/** @brief Range of one mesh in the loader vertex and index arenas. Indices are relative to m_firstVertex. */
+struct Mesh
+{
+  uint32_t m_firstVertex = 0;
+  uint32_t m_vertexCount = 0;
+  uint32_t m_firstIndex = 0;
+  uint32_t m_indexCount = 0;
+  uint32_t m_materialIndex = 0;
+  uint32_t m_firstLod = 0; // In the loader LOD table, empty until the levels are generated.
+  uint32_t m_lodCount = 0;
+};
 
-    return bindingDesc;
-  }
+/** @brief Index range of one level of detail of a mesh, using the vertices of the mesh. Level 0 is the mesh itself. */
+struct MeshLod
+{
+  uint32_t m_firstIndex = 0;
+  uint32_t m_indexCount = 0;
+  float m_error = 0.0f; // Simplification error, a distance in model space.
+};
 
-  static auto getAttributesDescription()
-  {
-    std::array<vk::VertexInputAttributeDescription, 3> attributesDesc = {};
-    attributesDesc[0].binding = 0;
-    attributesDesc[0].location = 0;
-    attributesDesc[0].format = vk::Format::eR32G32B32Sfloat;
-    attributesDesc[0].offset = offsetof(Vertex, pos);
-
-    attributesDesc[1].binding = 0;
-    attributesDesc[1].location = 1;
-    attributesDesc[1].format = vk::Format::eR32G32B32Sfloat;
-    attributesDesc[1].offset = offsetof(Vertex, color);
-
-    attributesDesc[2].binding = 0;
-    attributesDesc[2].location = 2;
-    attributesDesc[2].format = vk::Format::eR32G32Sfloat;
-    attributesDesc[2].offset = offsetof(Vertex, texCoord);
-
-    return attributesDesc;
-  }
+struct MeshMaterial
+{
+  glm::vec4 m_baseColor = glm::vec4(1.0f);
+  std::string m_diffuseTexture;
 };
 
-class Mesh
+/** @brief One placement of a mesh in the scene. A mesh referenced by several nodes has one instance per node. */
+struct MeshInstance
 {
-public:
-  Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
-      : m_vertices{vertices}
-      , m_indices{indices}
-  {
-  }
+  glm::mat4 m_worldTransform = glm::mat4(1.0f);
+  uint32_t m_meshIndex = 0;
+};
 
-  std::vector<Vertex> m_vertices;
-  std::vector<uint32_t> m_indices;
+/** @brief Per draw data pushed as push constants: world transform of the instance and base color of its material. */
+struct DrawConstants
+{
+  glm::mat4 m_model; // Includes the position dequantization of the mesh.
+  glm::vec4 m_baseColor;
+  glm::vec4 m_texCoordTransform; // Texture coordinate dequantization, xy scale and zw offset.
 };
 
 class VkMesh
 {
   // something like that , approximatively
   VkMesh(Mesh mesh);
-  vk::UniqueDeviceMemory m_vertexBufferMemory;
+  VulkanAllocation m_vertexBufferMemory;
   vk::UniqueBuffer m_vertexBuffer;
 
-  vk::UniqueDeviceMemory m_indexBufferMemory;
+  VulkanAllocation m_indexBufferMemory;
   vk::UniqueBuffer m_indexBuffer;
 };
 
@@ -96,97 +104,85 @@ struct UniformBufferObject
 
 //const std::vector<uint16_t> indices = {0, 1, 2, 2, 3, 0, 4, 5, 6, 6, 7, 4};
 
-Mesh processMesh(const aiMesh* mesh, const aiScene* scene)
+class VulkanRecordingWorkers;
+struct MeshOptimizationStats;
+
+/** @brief Imports a model with Assimp and packs all its meshes in one vertex and one index arena. */
+class MeshLoader
 {
-  std::vector<Vertex> vertices;
-  vertices.reserve(mesh->mNumVertices);
-  std::vector<uint32_t> indices;
+public:
+  /** @brief With workers, the meshes are converted in parallel. A non zero meshVertexLimit splits the meshes larger than that. */
+  void loadModel(const std::filesystem::path& path, VulkanRecordingWorkers* workers = nullptr, uint32_t meshVertexLimit = 0);
+
+  /** @brief Flattens the node tree then converts the meshes on up to workerCount workers, each one writing to its own range of the arenas. */
+  void convertScene(const aiScene* scene, VulkanRecordingWorkers* workers, uint32_t workerCount);
+
+  /** @brief Reorders the triangles of every mesh for the vertex cache then for overdraw, and its vertices for fetch locality. The ranges do not change. */
+  MeshOptimizationStats optimizeMeshes(VulkanRecordingWorkers* workers, uint32_t workerCount);
+
+  /**
+   * @brief Splits the meshes with more than maxVertexCount vertices in parts that each reference at most that many, in triangle order.
+   * Vertices shared by two parts are duplicated and the instances of a split mesh get one instance per part. Returns the number of meshes split.
+   */
+  uint32_t splitMeshes(uint32_t maxVertexCount, VulkanRecordingWorkers* workers, uint32_t workerCount);
 
-  bool hasFirstSetOfUV = mesh->mTextureCoords[0] != nullptr;
+  /**
+   * @brief Simplifies every mesh in up to maxLodCount - 1 coarser levels, each with about half the triangles of the previous one, stopping when the simplifier can not get there.
+   * The levels go in the index arena right after the indices of their mesh, which stay level 0. Returns the number of levels over all meshes.
+   */
+  uint32_t generateLods(uint32_t maxLodCount, VulkanRecordingWorkers* workers, uint32_t workerCount);
 
-  for (size_t i = 0; i < mesh->mNumVertices; i++)
+  static const aiScene* importScene(Assimp::Importer& importer, const std::filesystem::path& path, uint32_t meshVertexLimit);
+
+  const std::vector<Vertex>& getVertices() const
   {
-    const auto& aiVertex = mesh->mVertices[i];
-    const auto& aiNormal = mesh->mNormals[i];
-
-    Vertex vertex{};
-    vertex.pos = {aiVertex.x, aiVertex.y, aiVertex.z};
-
-    if (hasFirstSetOfUV)
-    {
-      const auto& aiUV = mesh->mTextureCoords[0][i];
-      vertex.texCoord = {aiUV.x, aiUV.y};
-    }
-    else
-    {
-      vertex.texCoord = {0.0f, 0.0f};
-    }
-    vertices.push_back(vertex);
+    return m_vertices;
   }
 
-  for (size_t i = 0; i < mesh->mNumFaces; i++)
+  const std::vector<uint32_t>& getIndices() const
   {
-    const auto& face = mesh->mFaces[i];
-    for (size_t j = 0; j < face.mNumIndices; j++)
-    {
-      indices.push_back(face.mIndices[j]);
-    }
+    return m_indices;
   }
 
-  return Mesh{vertices, indices};
-}
+  const std::vector<Mesh>& getMeshes() const
+  {
+    return m_meshes;
+  }
 
-class MeshLoader
-{
-public:
-  void loadModel(std::filesystem::path path)
+  const std::vector<MeshLod>& getLods() const
   {
-    // https://learnopengl.com/Model-Loading/Assimp
-    // https://learnopengl.com/Model-Loading/Model
-    Assimp::Importer import;
-    auto scene = import.ReadFile(path.u8string().c_str(), aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices);
-
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
-    {
-      throw std::runtime_error(std::string("ERROR::ASSIMP::") + import.GetErrorString());
-      return;
-    }
-
-    meshes.reserve(scene->mNumMeshes);
-    processNode(scene->mRootNode, scene);
-    vertices = meshes[0].m_vertices;
-    indices = meshes[0].m_indices;
+    return m_lods;
   }
 
-  auto getVertices() const
+  const std::vector<MeshMaterial>& getMaterials() const
   {
-    return vertices;
+    return m_materials;
   }
 
-  auto getIndices() const
+  const std::vector<MeshInstance>& getInstances() const
   {
-    return indices;
+    return m_instances;
   }
 
-private:
-  void processNode(aiNode* node, const aiScene* scene)
+  /** @brief Whether any mesh of the scene has the attribute, the vertices of the others have it zeroed. */
+  bool hasNormals() const
+  {
+    return m_hasNormals;
+  }
+
+  bool hasTexCoords() const
   {
-    // process all the node's meshes (if any)
-    for (size_t i = 0; i < node->mNumMeshes; i++)
-    {
-      const auto mesh = scene->mMeshes[node->mMeshes[i]];
-      meshes.push_back(processMesh(mesh, scene));
-    }
-
-    // then do the same for each of its children
-    for (size_t i = 0; i < node->mNumChildren; i++)
-    {
-      processNode(node->mChildren[i], scene);
-    }
+    return m_hasTexCoords;
   }
 
-  std::vector<Mesh> meshes;
-  std::vector<Vertex> vertices;
-  std::vector<uint32_t> indices;
+private:
+  std::vector<Vertex> m_vertices;
+  std::vector<uint32_t> m_indices;
+  std::vector<Mesh> m_meshes;
+  std::vector<MeshLod> m_lods;
+  std::vector<MeshMaterial> m_materials;
+  std::vector<MeshInstance> m_instances;
+  bool m_hasNormals = false;
+  bool m_hasTexCoords = false;
 };
-}
\ No newline at end of file
+}
@@ -0,0 +1,418 @@
+#include "VkMeshCache.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include "VkHal/MeshOptimizer.h"
+#include "VkHal/Vulkan/VulkanHash.h"
+#include "VkHal/Vulkan/VulkanRecordingWorkers.h"
+#include "VkHal/VkMesh.h"
+
+namespace VkHal
+{
+static_assert(std::is_trivially_copyable_v<MeshCacheHeader> && std::is_trivially_copyable_v<MeshCacheRange> && std::is_trivially_copyable_v<MeshCacheLod> && std::is_trivially_copyable_v<MeshCacheMaterial> && std::is_trivially_copyable_v<MeshCacheNode> && std::is_trivially_copyable_v<Meshlet>, "Mesh cache content is written and read as raw bytes.");
+
+namespace
+{
+constexpr uint64_t c_streamAlignment = 16;
+
+uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+int64_t getWriteTime(const std::filesystem::path& path)
+{
+  return (int64_t)std::filesystem::last_write_time(path).time_since_epoch().count();
+}
+
+uint64_t hashFile(const std::filesystem::path& path)
+{
+  MappedFile file(path);
+  return hashBytes(file.getData(), file.getSize());
+}
+
+void writeAt(std::ofstream& file, uint64_t offset, const void* data, uint64_t size)
+{
+  file.seekp(offset);
+  file.write(static_cast<const char*>(data), size);
+}
+} // namespace
+
+MeshCache::MeshCache(const std::filesystem::path& cachePath)
+    : m_file{cachePath}
+{
+  if (m_file.getSize() < sizeof(MeshCacheHeader))
+  {
+    throw std::runtime_error("Mesh cache is truncated.");
+  }
+
+  const auto& header = getHeader();
+  if (header.m_magic != c_meshCacheMagic || header.m_version != c_meshCacheVersion)
+  {
+    throw std::runtime_error("Mesh cache version is not supported.");
+  }
+
+  VertexLayout vertexLayout(header.m_vertexLayout);
+  if (header.m_vertexStride != vertexLayout.getStride() || header.m_indexDataSize != getIndex32DataOffset() + (uint64_t)header.m_index32Count * sizeof(uint32_t))
+  {
+    throw std::runtime_error("Mesh cache vertex layout does not match.");
+  }
+
+  auto fileSize = (uint64_t)m_file.getSize();
+  auto isInFile = [fileSize](uint64_t offset, uint64_t size) { return offset <= fileSize && size <= fileSize - offset; };
+  if (!isInFile(header.m_meshTableOffset, (uint64_t)header.m_meshCount * sizeof(MeshCacheRange)) || !isInFile(header.m_lodTableOffset, (uint64_t)header.m_lodCount * sizeof(MeshCacheLod)) || !isInFile(header.m_materialTableOffset, (uint64_t)header.m_materialCount * sizeof(MeshCacheMaterial)) || !isInFile(header.m_nodeTableOffset, (uint64_t)header.m_nodeCount * sizeof(MeshCacheNode)) || !isInFile(header.m_vertexDataOffset, header.m_vertexDataSize) || !isInFile(header.m_indexDataOffset, header.m_indexDataSize) || !isInFile(header.m_meshletTableOffset, (uint64_t)header.m_meshletCount * sizeof(Meshlet)) || !isInFile(header.m_meshletVertexDataOffset, (uint64_t)header.m_meshletVertexCount * sizeof(uint32_t)) || !isInFile(header.m_meshletTriangleDataOffset, (uint64_t)header.m_meshletTriangleCount * 3))
+  {
+    throw std::runtime_error("Mesh cache is truncated.");
+  }
+
+  for (uint32_t stream = 0; stream < vertexLayout.getStreamCount(); stream++)
+  {
+    auto streamOffset = header.m_vertexStreamOffsets[stream];
+    if (streamOffset > header.m_vertexDataSize || (uint64_t)header.m_vertexCount * vertexLayout.getStreamStride(stream) > header.m_vertexDataSize - streamOffset)
+    {
+      throw std::runtime_error("Mesh cache vertex stream is out of the vertex data.");
+    }
+  }
+
+  for (uint32_t meshIndex = 0; meshIndex < header.m_meshCount; meshIndex++)
+  {
+    const auto& mesh = getMesh(meshIndex);
+    if (header.m_materialCount != 0 && mesh.m_materialIndex >= header.m_materialCount)
+    {
+      throw std::runtime_error("Mesh cache mesh references a missing material.");
+    }
+
+    auto isIndex16 = mesh.m_indexSize == sizeof(uint16_t);
+    if ((!isIndex16 && mesh.m_indexSize != sizeof(uint32_t)) || (isIndex16 && mesh.m_vertexCount > c_maxIndex16VertexCount))
+    {
+      throw std::runtime_error("Mesh cache mesh index size is invalid.");
+    }
+
+    auto groupIndexCount = isIndex16 ? header.m_index16Count : header.m_index32Count;
+    if (mesh.m_firstIndex > groupIndexCount || mesh.m_indexCount > groupIndexCount - mesh.m_firstIndex || (uint64_t)mesh.m_firstVertex + mesh.m_vertexCount > header.m_vertexCount)
+    {
+      throw std::runtime_error("Mesh cache mesh range is out of its streams.");
+    }
+
+    if (mesh.m_firstLod > header.m_lodCount || mesh.m_lodCount > header.m_lodCount - mesh.m_firstLod)
+    {
+      throw std::runtime_error("Mesh cache mesh levels of detail are out of the LOD table.");
+    }
+
+    for (auto lodIndex = mesh.m_firstLod; lodIndex < mesh.m_firstLod + mesh.m_lodCount; lodIndex++)
+    {
+      const auto& lod = getLod(lodIndex);
+      if (lod.m_firstIndex > groupIndexCount || lod.m_indexCount > groupIndexCount - lod.m_firstIndex)
+      {
+        throw std::runtime_error("Mesh cache level of detail is out of its index stream.");
+      }
+    }
+
+    if (mesh.m_firstMeshlet > header.m_meshletCount || mesh.m_meshletCount > header.m_meshletCount - mesh.m_firstMeshlet)
+    {
+      throw std::runtime_error("Mesh cache mesh meshlets are out of the meshlet table.");
+    }
+  }
+
+  for (uint32_t meshletIndex = 0; meshletIndex < header.m_meshletCount; meshletIndex++)
+  {
+    const auto& meshlet = getMeshlet(meshletIndex);
+    if (meshlet.m_vertexCount > c_meshletMaxVertexCount || meshlet.m_triangleCount > c_meshletMaxTriangleCount || meshlet.m_firstVertex > header.m_meshletVertexCount || meshlet.m_vertexCount > header.m_meshletVertexCount - meshlet.m_firstVertex || meshlet.m_firstTriangle > header.m_meshletTriangleCount || meshlet.m_triangleCount > header.m_meshletTriangleCount - meshlet.m_firstTriangle)
+    {
+      throw std::runtime_error("Mesh cache meshlet is out of its streams.");
+    }
+  }
+
+  for (uint32_t nodeIndex = 0; nodeIndex < header.m_nodeCount; nodeIndex++)
+  {
+    if (getNode(nodeIndex).m_meshIndex >= header.m_meshCount)
+    {
+      throw std::runtime_error("Mesh cache node references a missing mesh.");
+    }
+  }
+}
+
+MeshCache MeshCache::loadOrCook(const std::filesystem::path& sourcePath, const std::filesystem::path& cachePath, const VertexLayoutDesc& vertexLayout, VulkanRecordingWorkers* workers)
+{
+  if (std::filesystem::exists(cachePath))
+  {
+    try
+    {
+      MeshCache meshCache(cachePath);
+      if (meshCache.getHeader().m_requestedVertexLayout == vertexLayout && meshCache.isSourceUpToDate(sourcePath))
+      {
+        return meshCache;
+      }
+    }
+    catch (const std::runtime_error&)
+    {
+      // Corrupted or from an older version, cooked again below.
+    }
+  }
+
+  cook(sourcePath, cachePath, vertexLayout, workers);
+  return MeshCache(cachePath);
+}
+
+void MeshCache::cook(const std::filesystem::path& sourcePath, const std::filesystem::path& cachePath, const VertexLayoutDesc& vertexLayout, VulkanRecordingWorkers* workers)
+{
+  MeshLoader meshLoader;
+  meshLoader.loadModel(sourcePath, workers);
+
+  auto workerCount = workers ? workers->getWorkerCount() : 1;
+  auto optimizationStats = meshLoader.optimizeMeshes(workers, workerCount);
+  const auto size = std::snprintf(nullptr, 0, "Mesh optimization %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", sourcePath.filename().u8string().c_str(), optimizationStats.m_before.getAcmr(), optimizationStats.m_after.getAcmr(), optimizationStats.m_before.getAtvr(), optimizationStats.m_after.getAtvr());
+  std::string output(size + 1, '\0');
+  std::snprintf(output.data(), output.size(), "Mesh optimization %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", sourcePath.filename().u8string().c_str(), optimizationStats.m_before.getAcmr(), optimizationStats.m_after.getAcmr(), optimizationStats.m_before.getAtvr(), optimizationStats.m_after.getAtvr());
+  std::cout << output.c_str();
+
+  // After the optimizations so the parts follow the cache friendly triangle order.
+  auto splitMeshCount = meshLoader.splitMeshes(c_maxIndex16VertexCount, workers, workerCount);
+  if (splitMeshCount > 0)
+  {
+    std::cout << "Split " << splitMeshCount << " meshes over " << c_maxIndex16VertexCount << " vertices for 16 bit indices" << std::endl;
+  }
+
+  // After the split, the levels of a part then only reference its vertices and keep its index size.
+  auto lodCount = meshLoader.generateLods(c_meshCacheMaxLodCount, workers, workerCount);
+
+  const auto& vertices = meshLoader.getVertices();
+  const auto& indices = meshLoader.getIndices();
+  const auto& meshes = meshLoader.getMeshes();
+  const auto& lods = meshLoader.getLods();
+  const auto& materials = meshLoader.getMaterials();
+  const auto& instances = meshLoader.getInstances();
+
+  // Attributes no mesh has are dropped instead of streaming zeros.
+  auto cookedLayoutDesc = vertexLayout;
+  if (!meshLoader.hasNormals())
+  {
+    cookedLayoutDesc.m_normal = NormalEncoding::eNone;
+  }
+  if (!meshLoader.hasTexCoords())
+  {
+    cookedLayoutDesc.m_texCoord = TexCoordEncoding::eNone;
+  }
+  VertexLayout cookedLayout(cookedLayoutDesc);
+
+  MeshCacheHeader header{};
+  header.m_sourceHash = hashFile(sourcePath);
+  header.m_sourceSize = std::filesystem::file_size(sourcePath);
+  header.m_sourceWriteTime = getWriteTime(sourcePath);
+  header.m_requestedVertexLayout = vertexLayout;
+  header.m_vertexLayout = cookedLayoutDesc;
+  header.m_vertexStride = cookedLayout.getStride();
+  header.m_meshCount = (uint32_t)meshes.size();
+  header.m_lodCount = (uint32_t)lods.size();
+  header.m_materialCount = (uint32_t)materials.size();
+  header.m_nodeCount = (uint32_t)instances.size();
+
+  // Streams back to back, a pass binds each one at its offset and reads only those it needs.
+  uint64_t vertexDataSize = 0;
+  for (uint32_t stream = 0; stream < cookedLayout.getStreamCount(); stream++)
+  {
+    vertexDataSize = alignUp(vertexDataSize, c_streamAlignment);
+    header.m_vertexStreamOffsets[stream] = vertexDataSize;
+    vertexDataSize += vertices.size() * cookedLayout.getStreamStride(stream);
+  }
+  header.m_vertexCount = (uint32_t)vertices.size();
+  std::vector<uint8_t> vertexData(vertexDataSize);
+  std::vector<Vertex> decodedVertices;
+  VertexQuantizationError maxError{};
+
+  std::vector<uint16_t> indices16;
+  std::vector<uint32_t> indices32;
+  MeshletData meshletData;
+
+  std::vector<MeshCacheRange> meshRanges;
+  meshRanges.reserve(meshes.size());
+  std::vector<MeshCacheLod> cacheLods;
+  cacheLods.reserve(lods.size());
+  uint64_t lod0TriangleCount = 0;
+  uint64_t lastLodTriangleCount = 0;
+  for (const auto& mesh : meshes)
+  {
+    // The levels follow the mesh indices in the arena, they are copied with them.
+    const auto& lastLod = lods[mesh.m_firstLod + mesh.m_lodCount - 1];
+    auto indexBegin = indices.begin() + mesh.m_firstIndex;
+    auto indexEnd = indices.begin() + lastLod.m_firstIndex + lastLod.m_indexCount;
+
+    MeshCacheRange meshRange{};
+    meshRange.m_firstVertex = mesh.m_firstVertex;
+    meshRange.m_vertexCount = mesh.m_vertexCount;
+    if (mesh.m_vertexCount <= c_maxIndex16VertexCount)
+    {
+      meshRange.m_indexSize = sizeof(uint16_t);
+      meshRange.m_firstIndex = (uint32_t)indices16.size();
+      std::transform(indexBegin, indexEnd, std::back_inserter(indices16), [](uint32_t index) { return (uint16_t)index; });
+    }
+    else
+    {
+      meshRange.m_indexSize = sizeof(uint32_t);
+      meshRange.m_firstIndex = (uint32_t)indices32.size();
+      indices32.insert(indices32.end(), indexBegin, indexEnd);
+    }
+    meshRange.m_indexCount = mesh.m_indexCount;
+
+    meshRange.m_firstLod = (uint32_t)cacheLods.size();
+    meshRange.m_lodCount = mesh.m_lodCount;
+    for (auto lodIndex = mesh.m_firstLod; lodIndex < mesh.m_firstLod + mesh.m_lodCount; lodIndex++)
+    {
+      const auto& lod = lods[lodIndex];
+      cacheLods.push_back({meshRange.m_firstIndex + (lod.m_firstIndex - mesh.m_firstIndex), lod.m_indexCount, lod.m_error});
+    }
+    lod0TriangleCount += mesh.m_indexCount / 3;
+    lastLodTriangleCount += lastLod.m_indexCount / 3;
+    meshRange.m_materialIndex = mesh.m_materialIndex;
+    meshRange.m_boundsMin = mesh.m_vertexCount == 0 ? glm::vec3{} : vertices[mesh.m_firstVertex].pos;
+    meshRange.m_boundsMax = meshRange.m_boundsMin;
+    for (uint32_t i = 0; i < mesh.m_vertexCount; i++)
+    {
+      meshRange.m_boundsMin = glm::min(meshRange.m_boundsMin, vertices[mesh.m_firstVertex + i].pos);
+      meshRange.m_boundsMax = glm::max(meshRange.m_boundsMax, vertices[mesh.m_firstVertex + i].pos);
+    }
+
+    const auto* meshVertices = vertices.data() + mesh.m_firstVertex;
+    VertexStreamPointers meshStreams{};
+    for (uint32_t stream = 0; stream < cookedLayout.getStreamCount(); stream++)
+    {
+      meshStreams[stream] = vertexData.data() + header.m_vertexStreamOffsets[stream] + (size_t)mesh.m_firstVertex * cookedLayout.getStreamStride(stream);
+    }
+    meshRange.m_dequantization = cookedLayout.computeDequantization(meshVertices, mesh.m_vertexCount);
+    cookedLayout.encode(meshVertices, mesh.m_vertexCount, meshRange.m_dequantization, meshStreams);
+
+    // Round trip check, a broken encoding would otherwise only show as a distorted mesh.
+    decodedVertices.resize(mesh.m_vertexCount);
+    cookedLayout.decode({meshStreams[0], meshStreams[1]}, mesh.m_vertexCount, meshRange.m_dequantization, decodedVertices.data());
+    auto error = cookedLayout.measureError(meshVertices, decodedVertices.data(), mesh.m_vertexCount);
+    auto errorBound = cookedLayout.getErrorBound(meshRange.m_dequantization);
+    if (error.m_position > errorBound.m_position || error.m_normal > errorBound.m_normal || error.m_texCoord > errorBound.m_texCoord)
+    {
+      throw std::runtime_error("Vertex quantization error is over its bound.");
+    }
+    maxError.m_position = std::max(maxError.m_position, error.m_position);
+    maxError.m_normal = std::max(maxError.m_normal, error.m_normal);
+    maxError.m_texCoord = std::max(maxError.m_texCoord, error.m_texCoord);
+
+    // Built from the original positions, the spheres grow by the worst quantization error so culling stays conservative for the decoded ones.
+    meshRange.m_firstMeshlet = (uint32_t)meshletData.m_meshlets.size();
+    buildMeshlets(indices.data() + mesh.m_firstIndex, mesh.m_indexCount, meshVertices, mesh.m_vertexCount, meshletData);
+    meshRange.m_meshletCount = (uint32_t)meshletData.m_meshlets.size() - meshRange.m_firstMeshlet;
+    for (auto meshletIndex = meshRange.m_firstMeshlet; meshletIndex < meshletData.m_meshlets.size(); meshletIndex++)
+    {
+      meshletData.m_meshlets[meshletIndex].m_radius += errorBound.m_position * std::sqrt(3.0f);
+    }
+
+    meshRanges.push_back(meshRange);
+  }
+
+  {
+    const auto size = std::snprintf(nullptr, 0, "Vertex layout %s: %u -> %u bytes per vertex, %u in the position stream, max error position %g, normal %g rad, uv %g\n", sourcePath.filename().u8string().c_str(), (uint32_t)sizeof(Vertex), cookedLayout.getStride(), cookedLayout.getStreamStride(c_vertexPositionStream), maxError.m_position, maxError.m_normal, maxError.m_texCoord);
+    std::string output(size + 1, '\0');
+    std::snprintf(output.data(), output.size(), "Vertex layout %s: %u -> %u bytes per vertex, %u in the position stream, max error position %g, normal %g rad, uv %g\n", sourcePath.filename().u8string().c_str(), (uint32_t)sizeof(Vertex), cookedLayout.getStride(), cookedLayout.getStreamStride(c_vertexPositionStream), maxError.m_position, maxError.m_normal, maxError.m_texCoord);
+    std::cout << output.c_str();
+  }
+
+  std::vector<MeshCacheMaterial> cacheMaterials(materials.size());
+  for (size_t i = 0; i < materials.size(); i++)
+  {
+    if (materials[i].m_diffuseTexture.size() >= c_meshCacheMaxPathLength)
+    {
+      throw std::runtime_error("Texture path too long for the mesh cache: " + materials[i].m_diffuseTexture);
+    }
+    cacheMaterials[i].m_baseColor = materials[i].m_baseColor;
+    std::copy(materials[i].m_diffuseTexture.begin(), materials[i].m_diffuseTexture.end(), cacheMaterials[i].m_diffuseTexture);
+  }
+
+  std::vector<MeshCacheNode> cacheNodes(instances.size());
+  for (size_t i = 0; i < instances.size(); i++)
+  {
+    cacheNodes[i].m_worldTransform = instances[i].m_worldTransform;
+    cacheNodes[i].m_meshIndex = instances[i].m_meshIndex;
+  }
+
+  header.m_meshTableOffset = alignUp(sizeof(MeshCacheHeader), c_streamAlignment);
+  header.m_lodTableOffset = alignUp(header.m_meshTableOffset + meshRanges.size() * sizeof(MeshCacheRange), c_streamAlignment);
+  header.m_materialTableOffset = alignUp(header.m_lodTableOffset + cacheLods.size() * sizeof(MeshCacheLod), c_streamAlignment);
+  header.m_nodeTableOffset = alignUp(header.m_materialTableOffset + cacheMaterials.size() * sizeof(MeshCacheMaterial), c_streamAlignment);
+  header.m_vertexDataOffset = alignUp(header.m_nodeTableOffset + cacheNodes.size() * sizeof(MeshCacheNode), c_streamAlignment);
+  header.m_vertexDataSize = vertexData.size();
+  header.m_indexDataOffset = alignUp(header.m_vertexDataOffset + header.m_vertexDataSize, c_streamAlignment);
+  header.m_index16Count = (uint32_t)indices16.size();
+  header.m_index32Count = (uint32_t)indices32.size();
+  auto index32DataOffset = alignUp(indices16.size() * sizeof(uint16_t), sizeof(uint32_t));
+  header.m_indexDataSize = index32DataOffset + indices32.size() * sizeof(uint32_t);
+
+  header.m_meshletCount = (uint32_t)meshletData.m_meshlets.size();
+  header.m_meshletVertexCount = (uint32_t)meshletData.m_vertices.size();
+  header.m_meshletTriangleCount = (uint32_t)(meshletData.m_triangles.size() / 3);
+  header.m_meshletTableOffset = alignUp(header.m_indexDataOffset + header.m_indexDataSize, c_streamAlignment);
+  header.m_meshletVertexDataOffset = alignUp(header.m_meshletTableOffset + meshletData.m_meshlets.size() * sizeof(Meshlet), c_streamAlignment);
+  header.m_meshletTriangleDataOffset = alignUp(header.m_meshletVertexDataOffset + meshletData.m_vertices.size() * sizeof(uint32_t), c_streamAlignment);
+  auto fileSize = header.m_meshletTriangleDataOffset + meshletData.m_triangles.size();
+
+  std::cout << "Meshlets " << sourcePath.filename().u8string() << ": " << header.m_meshletCount << ", " << (header.m_meshletCount ? (float)header.m_meshletTriangleCount / header.m_meshletCount : 0.0f) << " triangles and " << (header.m_meshletCount ? (float)header.m_meshletVertexCount / header.m_meshletCount : 0.0f) << " vertices on average" << std::endl;
+
+  std::cout << "LODs " << sourcePath.filename().u8string() << ": " << lodCount << " levels over " << meshes.size() << " meshes, " << lod0TriangleCount << " triangles at level 0, " << lastLodTriangleCount << " at the coarsest levels" << std::endl;
+
+  std::cout << "Indices " << sourcePath.filename().u8string() << ": " << indices16.size() << " 16 bit, " << indices32.size() << " 32 bit, " << header.m_indexDataSize << " bytes instead of " << indices.size() * sizeof(uint32_t) << std::endl;
+
+  std::vector<uint8_t> indexData(header.m_indexDataSize);
+  std::memcpy(indexData.data(), indices16.data(), indices16.size() * sizeof(uint16_t));
+  std::memcpy(indexData.data() + index32DataOffset, indices32.data(), indices32.size() * sizeof(uint32_t));
+
+  std::filesystem::create_directories(cachePath.parent_path());
+  auto tempPath = cachePath;
+  tempPath += ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    writeAt(file, 0, &header, sizeof(header));
+    writeAt(file, header.m_meshTableOffset, meshRanges.data(), meshRanges.size() * sizeof(MeshCacheRange));
+    writeAt(file, header.m_lodTableOffset, cacheLods.data(), cacheLods.size() * sizeof(MeshCacheLod));
+    writeAt(file, header.m_materialTableOffset, cacheMaterials.data(), cacheMaterials.size() * sizeof(MeshCacheMaterial));
+    writeAt(file, header.m_nodeTableOffset, cacheNodes.data(), cacheNodes.size() * sizeof(MeshCacheNode));
+
+    // The loader already packed the meshes back to back, the streams are written as is.
+    writeAt(file, header.m_vertexDataOffset, vertexData.data(), header.m_vertexDataSize);
+    writeAt(file, header.m_indexDataOffset, indexData.data(), indexData.size());
+
+    writeAt(file, header.m_meshletTableOffset, meshletData.m_meshlets.data(), meshletData.m_meshlets.size() * sizeof(Meshlet));
+    writeAt(file, header.m_meshletVertexDataOffset, meshletData.m_vertices.data(), meshletData.m_vertices.size() * sizeof(uint32_t));
+    writeAt(file, header.m_meshletTriangleDataOffset, meshletData.m_triangles.data(), meshletData.m_triangles.size());
+
+    if (!file)
+    {
+      throw std::runtime_error("Failed to write the mesh cache.");
+    }
+  }
+
+  // Seeking past the end does not grow the file, empty trailing streams must still start inside it.
+  std::filesystem::resize_file(tempPath, fileSize);
+
+  std::filesystem::rename(tempPath, cachePath);
+}
+
+bool MeshCache::isSourceUpToDate(const std::filesystem::path& sourcePath) const
+{
+  const auto& header = getHeader();
+  if (header.m_sourceSize == std::filesystem::file_size(sourcePath) && header.m_sourceWriteTime == getWriteTime(sourcePath))
+  {
+    return true;
+  }
+
+  // A checkout or a copy changes the write time without changing the content.
+  return header.m_sourceHash == hashFile(sourcePath);
+}
+} // namespace VkHal
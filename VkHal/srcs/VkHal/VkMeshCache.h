@@ -0,0 +1,231 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+#include "VkHal/MappedFile.h"
+#include "VkHal/Meshlet.h"
+#include "VkHal/VertexLayout.h"
+
+namespace VkHal
+{
+class VulkanRecordingWorkers;
+
+constexpr uint32_t c_meshCacheMagic = 0x434D4B56; // "VKMC"
+constexpr uint32_t c_meshCacheVersion = 8;
+constexpr uint32_t c_maxIndex16VertexCount = 1 << 16; // Larger meshes are split so all of them can use 16 bit indices.
+constexpr uint32_t c_meshCacheMaxPathLength = 128;
+constexpr uint32_t c_meshCacheMaxLodCount = 8; // Including the full mesh, each level has about half the triangles of the previous one.
+
+/** @brief Start of a mesh cache file. The mesh, LOD, material, node and meshlet tables and the vertex, index and meshlet streams follow at the given offsets, each 16 bytes aligned. */
+struct MeshCacheHeader
+{
+  uint32_t m_magic = c_meshCacheMagic;
+  uint32_t m_version = c_meshCacheVersion;
+
+  // The source is trusted when size and write time match, the content hash settles it otherwise.
+  uint64_t m_sourceHash = 0;
+  uint64_t m_sourceSize = 0;
+  int64_t m_sourceWriteTime = 0;
+
+  uint32_t m_vertexStride = 0;
+  uint32_t m_index16Count = 0; // The index stream holds the 16 bit indices, then the 32 bit ones from a 4 bytes aligned offset.
+  uint32_t m_meshCount = 0;
+  uint32_t m_materialCount = 0;
+  uint32_t m_nodeCount = 0;
+
+  // The cooked layout is the requested one without the attributes the source lacks.
+  VertexLayoutDesc m_requestedVertexLayout;
+  VertexLayoutDesc m_vertexLayout;
+  uint32_t m_index32Count = 0;
+
+  uint64_t m_meshTableOffset = 0;
+  uint64_t m_materialTableOffset = 0;
+  uint64_t m_nodeTableOffset = 0;
+  uint64_t m_vertexDataOffset = 0;
+  uint64_t m_vertexDataSize = 0;
+  uint64_t m_indexDataOffset = 0;
+  uint64_t m_indexDataSize = 0;
+
+  uint32_t m_meshletCount = 0;
+  uint32_t m_meshletVertexCount = 0;   // uint32_t mesh vertex indices.
+  uint32_t m_meshletTriangleCount = 0; // Three uint8_t meshlet vertex indices each.
+  uint32_t m_lodCount = 0;
+  uint64_t m_meshletTableOffset = 0;
+  uint64_t m_meshletVertexDataOffset = 0;
+  uint64_t m_meshletTriangleDataOffset = 0;
+  uint64_t m_lodTableOffset = 0;
+
+  // The vertex data holds one stream after the other, each 16 bytes aligned. A mesh has the same first vertex in all of them.
+  uint32_t m_vertexCount = 0;
+  uint32_t m_padding = 0;
+  uint64_t m_vertexStreamOffsets[c_maxVertexStreamCount] = {}; // From the start of the vertex data.
+};
+
+/**
+ * @brief Range of one mesh in the streams. Indices are relative to m_firstVertex, m_firstIndex counts from the start of the indices of its size.
+ * The index range is level of detail 0, the coarser levels follow it in the same index group. Meshlets are built from level 0.
+ */
+struct MeshCacheRange
+{
+  uint32_t m_firstVertex = 0;
+  uint32_t m_vertexCount = 0;
+  uint32_t m_firstIndex = 0;
+  uint32_t m_indexCount = 0;
+  uint32_t m_indexSize = 0; // 2 when the mesh has at most c_maxIndex16VertexCount vertices, 4 otherwise.
+  uint32_t m_materialIndex = 0;
+  uint32_t m_firstMeshlet = 0;
+  uint32_t m_meshletCount = 0;
+  uint32_t m_firstLod = 0;
+  uint32_t m_lodCount = 0;
+  glm::vec3 m_boundsMin = {};
+  glm::vec3 m_boundsMax = {};
+  VertexDequantization m_dequantization;
+};
+
+/** @brief One level of detail of a mesh, with the indices of its mesh. */
+struct MeshCacheLod
+{
+  uint32_t m_firstIndex = 0; // From the start of the indices of the size of the mesh.
+  uint32_t m_indexCount = 0;
+  float m_error = 0.0f; // Simplification error, a distance in the model space of the mesh.
+  uint32_t m_padding = 0;
+};
+
+struct MeshCacheMaterial
+{
+  glm::vec4 m_baseColor = {};
+  char m_diffuseTexture[c_meshCacheMaxPathLength] = {}; // Relative to the source, null terminated.
+};
+
+/** @brief Mesh instance with the world transform of the node it hangs from. */
+struct MeshCacheNode
+{
+  glm::mat4 m_worldTransform = {};
+  uint32_t m_meshIndex = 0;
+  uint32_t m_padding[3] = {};
+};
+
+/** @brief Memory mapped mesh cache. The streams are laid out as the GPU buffers so they are copied as is, without parsing. */
+class MeshCache
+{
+public:
+  /** @brief Throws if the file is not a mesh cache of the current version. */
+  explicit MeshCache(const std::filesystem::path& cachePath);
+
+  /** @brief Maps the cache of the source, cooking it first if it is missing, stale or of another vertex layout. */
+  static MeshCache loadOrCook(const std::filesystem::path& sourcePath, const std::filesystem::path& cachePath, const VertexLayoutDesc& vertexLayout, VulkanRecordingWorkers* workers = nullptr);
+
+  /**
+   * @brief Imports the source with Assimp and writes its optimized vertex and index streams to cachePath. The meshes are converted on the workers when given.
+   * Throws if encoding the vertices with the layout loses more precision than its error bound.
+   */
+  static void cook(const std::filesystem::path& sourcePath, const std::filesystem::path& cachePath, const VertexLayoutDesc& vertexLayout, VulkanRecordingWorkers* workers = nullptr);
+
+  bool isSourceUpToDate(const std::filesystem::path& sourcePath) const;
+
+  const MeshCacheHeader& getHeader() const
+  {
+    return *reinterpret_cast<const MeshCacheHeader*>(m_file.getData());
+  }
+
+  VertexLayout getVertexLayout() const
+  {
+    return VertexLayout(getHeader().m_vertexLayout);
+  }
+
+  uint32_t getMeshCount() const
+  {
+    return getHeader().m_meshCount;
+  }
+
+  const MeshCacheRange& getMesh(uint32_t meshIndex) const
+  {
+    return reinterpret_cast<const MeshCacheRange*>(m_file.getData() + getHeader().m_meshTableOffset)[meshIndex];
+  }
+
+  const MeshCacheLod& getLod(uint32_t lodIndex) const
+  {
+    return reinterpret_cast<const MeshCacheLod*>(m_file.getData() + getHeader().m_lodTableOffset)[lodIndex];
+  }
+
+  uint32_t getMaterialCount() const
+  {
+    return getHeader().m_materialCount;
+  }
+
+  const MeshCacheMaterial& getMaterial(uint32_t materialIndex) const
+  {
+    return reinterpret_cast<const MeshCacheMaterial*>(m_file.getData() + getHeader().m_materialTableOffset)[materialIndex];
+  }
+
+  uint32_t getNodeCount() const
+  {
+    return getHeader().m_nodeCount;
+  }
+
+  const MeshCacheNode& getNode(uint32_t nodeIndex) const
+  {
+    return reinterpret_cast<const MeshCacheNode*>(m_file.getData() + getHeader().m_nodeTableOffset)[nodeIndex];
+  }
+
+  const void* getVertexData() const
+  {
+    return m_file.getData() + getHeader().m_vertexDataOffset;
+  }
+
+  uint64_t getVertexDataSize() const
+  {
+    return getHeader().m_vertexDataSize;
+  }
+
+  /** @brief Offset of the stream in the vertex data, where its buffer binding starts. */
+  uint64_t getVertexStreamOffset(uint32_t stream) const
+  {
+    return getHeader().m_vertexStreamOffsets[stream];
+  }
+
+  const void* getIndexData() const
+  {
+    return m_file.getData() + getHeader().m_indexDataOffset;
+  }
+
+  uint64_t getIndexDataSize() const
+  {
+    return getHeader().m_indexDataSize;
+  }
+
+  uint32_t getMeshletCount() const
+  {
+    return getHeader().m_meshletCount;
+  }
+
+  const Meshlet& getMeshlet(uint32_t meshletIndex) const
+  {
+    return reinterpret_cast<const Meshlet*>(m_file.getData() + getHeader().m_meshletTableOffset)[meshletIndex];
+  }
+
+  const uint32_t* getMeshletVertices() const
+  {
+    return reinterpret_cast<const uint32_t*>(m_file.getData() + getHeader().m_meshletVertexDataOffset);
+  }
+
+  const uint8_t* getMeshletTriangles() const
+  {
+    return m_file.getData() + getHeader().m_meshletTriangleDataOffset;
+  }
+
+  /** @brief Byte offset of the 32 bit indices in the index stream, the 16 bit ones start at 0. */
+  uint64_t getIndex32DataOffset() const
+  {
+    return ((uint64_t)getHeader().m_index16Count * sizeof(uint16_t) + 3) / 4 * 4;
+  }
+
+private:
+  MappedFile m_file;
+};
+} // namespace VkHal
@@ -2,11 +2,17 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
+#include <cmath>
 #include <exception>
 #include <filesystem>
+#include <iostream>
+#include <limits>
 #include <map>
+#include <optional>
 #include <set>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <vector>
 
@@ -14,12 +20,14 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
 
 #include <vulkan/vulkan.hpp>
 
+#include "VkHal/TextureCache.h"
 #include "VkHal/VkMesh.h"
+#include "VkHal/VkMeshCache.h"
+#include "VkHal/Vulkan/VulkanTextureLoader.h"
+#include "VkHal/Vulkan/VulkanTextureStreamer.h"
 #include "VkHal/Vulkan/VulkanUtils.h"
 
 using namespace std::literals::string_literals;
@@ -28,9 +36,12 @@ namespace VkHal
 {
 constexpr std::array<const char*, 2> g_instanceExtensions = {VK_KHR_SURFACE_EXTENSION_NAME, VK_KHR_WIN32_SURFACE_EXTENSION_NAME};
 constexpr std::array<const char*, 1> g_validationLayers = {"VK_LAYER_LUNARG_standard_validation"};
-
-std::vector<Vertex> vertices;
-std::vector<uint32_t> indices;
+constexpr vk::DeviceSize g_uniformRingFrameSize = 1024 * 1024;
+constexpr vk::DeviceSize g_textureStagingSize = 64 * 1024 * 1024; // Streamed mips waiting for their upload, a few updates worth. Larger mips are not streamed in.
+constexpr uint32_t g_drawItemIndexCount = 3 * 2048; // The mesh is split in draws of that many indices.
+constexpr uint32_t g_minDrawsPerRecordingWorker = 64;  // Under that a worker costs more to wake up than it saves.
+constexpr float g_lodErrorThresholdPixels = 1.0f;       // Coarsest level whose simplification error projects under that many pixels.
+constexpr VertexAttributeMask g_sceneVertexAttributes = c_vertexPositionBit | c_vertexTexCoordBit; // Inputs of shader.vert, a depth only pass would read positions alone.
 
 VkRenderer::VkRenderer(bool isHeadless, bool enableValidation, const std::string& appName)
     : m_isHeadless(isHeadless)
@@ -41,6 +52,14 @@ VkRenderer::VkRenderer(bool isHeadless, bool enableValidation, const std::string
   auto exePath = std::filesystem::path(exePathStr).parent_path();
 
   m_dataPath = std::filesystem::canonical(exePath / ".." / ".." / ".." / "data");
+  m_cachePath = exePath / "cache";
+  std::filesystem::create_directories(m_cachePath);
+  m_pipelineCachePath = m_cachePath / "pipeline_cache.bin";
+  m_meshSourcePath = m_dataPath / "models" / "chalet.obj";
+  m_meshCachePath = m_cachePath / "chalet.meshcache";
+  m_textureSourcePath = m_dataPath / "textures" / "chalet.jpg";
+  //m_textureSourcePath = m_dataPath / "textures" / "texture.jpg";
+  m_textureCachePath = m_cachePath / "chalet.texcache";
 
   vk::ApplicationInfo appInfo{};
   appInfo.pApplicationName = appName.c_str();
@@ -89,6 +108,8 @@ VkRenderer::~VkRenderer()
 {
   m_device->waitIdle();
 
+  m_vulkanDevice->getPipelineCache().save();
+
   m_debugGui.reset();
 }
 
@@ -105,33 +126,57 @@ void VkRenderer::initialize(HINSTANCE appInstance, HWND windowHandle)
   m_physicalDevice = physicalDevice[0];
   createDeviceAndQueues(m_physicalDevice);
 
+  m_uploadManager = std::make_unique<VulkanUploadManager>(m_vulkanDevice.get(), m_transferQueue, m_queueFamilyIndices.transfer, m_graphicsQueue, m_queueFamilyIndices.graphics);
+
+  m_recordingWorkers = std::make_unique<VulkanRecordingWorkers>(std::max(std::thread::hardware_concurrency(), 1u));
+
+  m_textureLoader = std::make_unique<VulkanTextureLoader>(m_vulkanDevice.get(), m_uploadManager.get(), g_textureStagingSize);
+  m_textureStreamer = std::make_unique<VulkanTextureStreamer>(m_vulkanDevice.get(), m_uploadManager.get(), m_textureLoader.get(), m_recordingWorkers.get(), c_textureStreamingBudget, c_textureTailSize);
+
   m_debugGui = std::make_unique<DevGuiRenderer>(&m_instance.get(), m_vulkanDevice.get(), m_queueFamilyIndices.graphics, m_graphicsQueue);
 }
 
 VKHAL_API void VkRenderer::recreateSwapchain()
 {
-  m_device->waitIdle();
+  // The objects in flight frames still use are destroyed once the GPU is done with them instead of waiting for the device to be idle.
+  // Only the size dependent objects are rebuilt, the pipeline uses a dynamic viewport and scissor.
+  auto& timeline = m_vulkanDevice->getTimeline();
+  timeline.retire(std::move(m_swapchainFramebuffers));
+  timeline.retire(std::move(m_depthImage));
 
   RECT clientRect = {};
   ::GetClientRect(m_windowHandle, &clientRect);
   m_windowWidth = clientRect.right - clientRect.left;
   m_windowHeight = clientRect.bottom - clientRect.top;
 
+  auto isFormatChanged = false;
   if (!m_isHeadless)
   {
-    m_vulkanSwapchain = m_vulkanDevice->recreateSwapchain({m_windowWidth, m_windowHeight}, VkRenderer::m_frameResourcesCount, m_surface.get(), &m_vulkanSwapchain->getSwapchain());
+    auto swapchain = m_vulkanDevice->recreateSwapchain({m_windowWidth, m_windowHeight}, VkRenderer::m_frameResourcesCount, m_surface.get(), &m_vulkanSwapchain->getSwapchain());
+    isFormatChanged = swapchain->getFormat() != m_vulkanSwapchain->getFormat();
+    timeline.retire(std::move(m_vulkanSwapchain));
+    m_vulkanSwapchain = std::move(swapchain);
     m_frameResourcesCount = std::min(m_frameResourcesCount, m_vulkanSwapchain->getSwapchainImageCount());
   }
 
   createFrameResources();
 
   createGBuffer();
-  createRenderPass();
+  if (isFormatChanged)
+  {
+    // The pending compilation still uses the render pass, and the last pipeline is not compatible with the new one.
+    if (m_pipelineRequest.isValid())
+    {
+      m_pipelineRequest.get();
+    }
+    m_pipeline = {};
+    timeline.retire(std::move(m_renderPass));
+    createRenderPass();
+    createGraphicsPipeline();
+  }
   createFramebuffers();
 
-  createGraphicsPipeline();
-
-  createCommandBuffers();
+  m_debugGui->recreateFramebuffers(m_vulkanSwapchain.get());
 }
 
 void VkRenderer::prepare(uint32_t windowWidth, uint32_t windowHeight)
@@ -139,11 +184,60 @@ void VkRenderer::prepare(uint32_t windowWidth, uint32_t windowHeight)
   m_windowWidth = windowWidth;
   m_windowHeight = windowHeight;
 
-  MeshLoader meshLoader;
-  meshLoader.loadModel(m_dataPath / "models" / "chalet.obj");
+  // Assimp only runs when the cache is missing or stale. The cache stays mapped until the streams are copied to staging.
+  auto meshCache = MeshCache::loadOrCook(m_meshSourcePath, m_meshCachePath, c_sceneVertexLayout, m_recordingWorkers.get());
+
+  m_vertexLayout = meshCache.getVertexLayout();
+  if (m_vertexLayout.getDesc().m_texCoord == TexCoordEncoding::eNone)
+  {
+    throw std::runtime_error("The scene shader needs texture coordinates.");
+  }
+
+  // All meshes share one vertex and index buffer, each node instance draws the ranges of its mesh with its own constants.
+  for (uint32_t nodeIndex = 0; nodeIndex < meshCache.getNodeCount(); nodeIndex++)
+  {
+    const auto& node = meshCache.getNode(nodeIndex);
+    const auto& mesh = meshCache.getMesh(node.m_meshIndex);
+    auto baseColor = mesh.m_materialIndex < meshCache.getMaterialCount() ? meshCache.getMaterial(mesh.m_materialIndex).m_baseColor : glm::vec4(1.0f);
+
+    // The dequantization goes in the constants so the shader decodes the compact streams for free.
+    const auto& dequantization = mesh.m_dequantization;
+    auto model = glm::scale(glm::translate(node.m_worldTransform, dequantization.m_positionOffset), dequantization.m_positionScale);
+    glm::vec4 texCoordTransform{dequantization.m_texCoordScale, dequantization.m_texCoordOffset};
+
+    auto drawConstantsIndex = (uint32_t)m_drawConstants.size();
+    m_drawConstants.push_back({model, baseColor, texCoordTransform});
+
+    VulkanDrawInstance drawInstance{};
+    drawInstance.m_worldTransform = node.m_worldTransform;
+    drawInstance.m_boundsCenter = (mesh.m_boundsMin + mesh.m_boundsMax) * 0.5f;
+    drawInstance.m_boundsRadius = glm::length(mesh.m_boundsMax - mesh.m_boundsMin) * 0.5f;
+    drawInstance.m_firstLod = (uint32_t)m_lodDraws.size();
+    drawInstance.m_lodCount = mesh.m_lodCount;
+    m_drawInstances.push_back(drawInstance);
+
+    // Every level is split in draw items up front, selecting one per frame only copies its items.
+    auto indexType = mesh.m_indexSize == sizeof(uint16_t) ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+    for (auto lodIndex = mesh.m_firstLod; lodIndex < mesh.m_firstLod + mesh.m_lodCount; lodIndex++)
+    {
+      const auto& lod = meshCache.getLod(lodIndex);
+      VulkanLodDraws lodDraws{(uint32_t)m_lodDrawItems.size(), 0, lod.m_indexCount / 3, lod.m_error};
+      auto lodIndexEnd = lod.m_firstIndex + lod.m_indexCount;
+      for (uint32_t firstIndex = lod.m_firstIndex; firstIndex < lodIndexEnd; firstIndex += g_drawItemIndexCount)
+      {
+        m_lodDrawItems.push_back({firstIndex, std::min(g_drawItemIndexCount, lodIndexEnd - firstIndex), (int32_t)mesh.m_firstVertex, drawConstantsIndex, indexType});
+      }
+      lodDraws.m_drawItemCount = (uint32_t)m_lodDrawItems.size() - lodDraws.m_firstDrawItem;
+      m_lodDraws.push_back(lodDraws);
+    }
 
-  vertices = meshLoader.getVertices();
-  indices = meshLoader.getIndices();
+    // Full detail until the first frame selects the levels from its camera.
+    if (drawInstance.m_lodCount > 0)
+    {
+      const auto& lodDraws = m_lodDraws[drawInstance.m_firstLod];
+      m_drawItems.insert(m_drawItems.end(), m_lodDrawItems.begin() + lodDraws.m_firstDrawItem, m_lodDrawItems.begin() + lodDraws.m_firstDrawItem + lodDraws.m_drawItemCount);
+    }
+  }
 
   if (!m_isHeadless)
   {
@@ -151,8 +245,6 @@ void VkRenderer::prepare(uint32_t windowWidth, uint32_t windowHeight)
     m_frameResourcesCount = std::min(m_frameResourcesCount, m_vulkanSwapchain->getSwapchainImageCount());
   }
 
-  createCommandPools();
-  createCommandBuffers();
   createFrameResources();
 
   createGBuffer();
@@ -161,15 +253,18 @@ void VkRenderer::prepare(uint32_t windowWidth, uint32_t windowHeight)
 
   createUniformBuffer();
   createTextureImage();
-  createTextureSampler(m_vulkanTextureImage->getMipCount());
+  createTextureSampler(m_textureStreamer->getMipCount(m_sceneTexture));
   createDescriptorSetLayout();
   createDescriptorPool();
   createDescriptorSets();
 
   createGraphicsPipeline();
 
-  createVertexBuffer();
-  createIndexBuffer();
+  createVertexBuffer(meshCache);
+  createIndexBuffer(meshCache);
+
+  // The scene is drawn once the GPU is done with the copies, see render().
+  m_sceneUploadTicket = m_uploadManager->flush();
 
   m_debugGui->prepare(m_windowHandle, m_vulkanSwapchain.get());
 }
@@ -317,7 +412,7 @@ void VkRenderer::createDeviceAndQueues(const vk::PhysicalDevice& physicalDevice)
   deviceFeatures.fillModeNonSolid = true;
   deviceFeatures.samplerAnisotropy = true;
 
-  m_vulkanDevice = std::make_unique<VulkanDevice>(physicalDevice, deviceFeatures, m_isHeadless, m_queueFamilyIndices);
+  m_vulkanDevice = std::make_unique<VulkanDevice>(physicalDevice, deviceFeatures, m_isHeadless, m_queueFamilyIndices, m_pipelineCachePath);
 
   if (m_enableValidation)
   {
@@ -334,21 +429,42 @@ void VkRenderer::createDeviceAndQueues(const vk::PhysicalDevice& physicalDevice)
 
 void VkRenderer::createFrameResources()
 {
-  m_frameResources.resize(VkRenderer::m_frameResourcesCount);
+  // The frame that used a recreated resource may still be in flight, the uniform ring and descriptor sets of the index are only reused once it completed.
+  std::vector<uint64_t> submissionValues(VkRenderer::m_frameResourcesCount, m_vulkanDevice->getTimeline().getSubmittedValue());
+  for (uint32_t i = 0; i < std::min((uint32_t)m_frameResources.size(), VkRenderer::m_frameResourcesCount); i++)
+  {
+    submissionValues[i] = m_frameResources[i].m_submissionValue;
+  }
+
+  if (!m_frameResources.empty())
+  {
+    m_vulkanDevice->getTimeline().retire(std::move(m_frameResources));
+  }
+
+  m_frameResources = std::vector<VulkanFrameResources>(VkRenderer::m_frameResourcesCount);
 
   for (uint32_t i = 0; i < m_frameResources.size(); i++)
   {
     auto iStr = std::to_string(i);
     auto& frameResource = m_frameResources[i];
+    frameResource.m_submissionValue = submissionValues[i];
     frameResource.m_imageAcquiredSemaphores = m_vulkanDevice->createSemaphore();
     frameResource.m_renderCompletedSemaphores = m_vulkanDevice->createSemaphore();
-    frameResource.m_frameFence = m_vulkanDevice->createFence(true);
 
     frameResource.m_graphicsCmdPool = m_vulkanDevice->createCommandPool(m_queueFamilyIndices.graphics, vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient);
     m_vulkanDevice->setObjectName(frameResource.m_graphicsCmdPool.get(), vk::ObjectType::eCommandPool, ("Frameresources:GfxCmdPool_"s + iStr).c_str());
     frameResource.m_graphicsCmdBuffers = m_vulkanDevice->allocateCommandBuffer(*frameResource.m_graphicsCmdPool, 1, true);
     m_vulkanDevice->setObjectName(frameResource.m_graphicsCmdBuffers[0].get(), vk::ObjectType::eCommandBuffer, ("Frameresources:GfxCmdBuffer_"s + iStr).c_str());
 
+    frameResource.m_graphicsWorkerCmdPools.resize(m_recordingWorkers->getWorkerCount());
+    for (uint32_t workerIndex = 0; workerIndex < m_recordingWorkers->getWorkerCount(); workerIndex++)
+    {
+      auto& workerCmdPool = frameResource.m_graphicsWorkerCmdPools[workerIndex];
+      workerCmdPool.m_cmdPool = m_vulkanDevice->createCommandPool(m_queueFamilyIndices.graphics, vk::CommandPoolCreateFlagBits::eTransient);
+      workerCmdPool.m_secondaryCmdBuffer = std::move(m_vulkanDevice->allocateCommandBuffer(*workerCmdPool.m_cmdPool, 1, false)[0]);
+      m_vulkanDevice->setObjectName(workerCmdPool.m_secondaryCmdBuffer.get(), vk::ObjectType::eCommandBuffer, ("Frameresources:GfxSecondaryCmdBuffer_"s + iStr + "_"s + std::to_string(workerIndex)).c_str());
+    }
+
     frameResource.m_computeCmdPool = m_vulkanDevice->createCommandPool(m_queueFamilyIndices.compute, vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient);
     m_vulkanDevice->setObjectName(frameResource.m_computeCmdPool.get(), vk::ObjectType::eCommandPool, ("FrameresourcesComputeCmdPool_"s + iStr).c_str());
     frameResource.m_computeCmdBuffers = m_vulkanDevice->allocateCommandBuffer(*frameResource.m_computeCmdPool, 1, true);
@@ -366,118 +482,6 @@ void VkRenderer::createFrameResources()
   }
 }
 
-void VkRenderer::createCommandPools()
-{
-  m_graphicsCmdPoolTmp = m_vulkanDevice->createCommandPool(m_queueFamilyIndices.graphics, vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient);
-  m_vulkanDevice->setObjectName(m_graphicsCmdPoolTmp.get(), vk::ObjectType::eCommandPool, "GfxCmdPoolTmp");
-
-  m_transferCmdPool = m_vulkanDevice->createCommandPool(m_queueFamilyIndices.transfer, vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer);
-}
-
-void VkRenderer::createCommandBuffers()
-{
-  m_graphicsCmdBuffersTmp = m_vulkanDevice->allocateCommandBuffer(*m_graphicsCmdPoolTmp, 1, true);
-  m_vulkanDevice->setObjectName(m_graphicsCmdBuffersTmp[0].get(), vk::ObjectType::eCommandBuffer, "GfxCmdBufferTmp");
-
-  m_transferCmdBuffers = m_vulkanDevice->allocateCommandBuffer(*m_transferCmdPool, 1, true);
-}
-
-void VkRenderer::generateMipmaps(vk::CommandBuffer& cmdBuffer, vk::Queue queue, vk::Image image, vk::Format format, int32_t width, int32_t height, uint32_t mipLevels)
-{
-  auto formatProperties = m_physicalDevice.getFormatProperties(format);
-
-  if (!(formatProperties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear))
-  {
-    throw std::runtime_error("Texture image format does not support linear blitting.");
-  }
-
-  m_debugUtils->beginLabel(cmdBuffer, "GenerateMipMap");
-
-  vk::CommandBufferBeginInfo beginInfo{};
-  beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
-
-  cmdBuffer.begin(beginInfo);
-
-  vk::ImageMemoryBarrier barrier{};
-  barrier.image = image;
-  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-  barrier.subresourceRange.baseArrayLayer = 0;
-  barrier.subresourceRange.layerCount = 1;
-  barrier.subresourceRange.levelCount = 1;
-
-  auto mipWidth = width;
-  auto mipHeight = height;
-
-  for (uint32_t i = 1; i < mipLevels; i++)
-  {
-    barrier.subresourceRange.baseMipLevel = i - 1;
-    barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-    barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
-    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-    barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
-
-    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags{}, nullptr, nullptr, barrier);
-
-    vk::ImageBlit imgBlit{};
-    imgBlit.srcOffsets[0] = vk::Offset3D{0, 0, 0};
-    imgBlit.srcOffsets[1] = vk::Offset3D{mipWidth, mipHeight, 1};
-    imgBlit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-    imgBlit.srcSubresource.mipLevel = i - 1;
-    imgBlit.srcSubresource.baseArrayLayer = 0;
-    imgBlit.srcSubresource.layerCount = 1;
-    imgBlit.dstOffsets[0] = vk::Offset3D{0, 0, 0};
-    imgBlit.dstOffsets[1] = vk::Offset3D{mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1};
-    imgBlit.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-    imgBlit.dstSubresource.mipLevel = i;
-    imgBlit.dstSubresource.baseArrayLayer = 0;
-    imgBlit.dstSubresource.layerCount = 1;
-
-    cmdBuffer.blitImage(image, vk::ImageLayout::eTransferSrcOptimal, image, vk::ImageLayout::eTransferDstOptimal, imgBlit, vk::Filter::eLinear);
-
-    barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
-    barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-    barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
-    barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-
-    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, vk::DependencyFlags{}, nullptr, nullptr, barrier);
-
-    if (mipWidth > 1)
-    {
-      mipWidth /= 2;
-    }
-
-    if (mipHeight > 1)
-    {
-      mipHeight /= 2;
-    }
-  }
-
-  barrier.subresourceRange.baseMipLevel = mipLevels - 1;
-  barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-  barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-  barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-  barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-
-  cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, vk::DependencyFlags{}, nullptr, nullptr, barrier);
-
-  cmdBuffer.end();
-
-  m_debugUtils->endLabel(cmdBuffer);
-
-  vk::SubmitInfo submitInfo{};
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &cmdBuffer;
-
-  m_debugUtils->beginLabel(queue, "Submit GenerateMipmap.");
-  queue.submit(submitInfo, nullptr);
-  m_debugUtils->endLabel(queue);
-  queue.waitIdle();
-
-  cmdBuffer.reset(vk::CommandBufferResetFlagBits::eReleaseResources);
-}
-
 vk::Format VkRenderer::selectSupportedFormat(const std::vector<vk::Format>& formats, vk ::ImageTiling desiredTilling, vk::FormatFeatureFlags featuresDesired)
 {
   for (const auto& format : formats)
@@ -511,18 +515,18 @@ void VkRenderer::createGraphicsPipeline()
   auto fragmentShader = m_vulkanDevice->createShaderModule(fragShaderCode);
 
   auto vkPipelineBuilder = m_vulkanDevice->getPipelineBuilder();
-  vkPipelineBuilder.addShaderStage(vk::ShaderStageFlagBits::eVertex, vertexShader.get(), "main");
-  vkPipelineBuilder.addShaderStage(vk::ShaderStageFlagBits::eFragment, fragmentShader.get(), "main");
+  vkPipelineBuilder.addShaderStage(vk::ShaderStageFlagBits::eVertex, vertexShader, "main");
+  vkPipelineBuilder.addShaderStage(vk::ShaderStageFlagBits::eFragment, fragmentShader, "main");
 
-  auto bindingDesc = Vertex::getBindingDescription();
-  auto attributesDesc = Vertex::getAttributesDescription();
-  vkPipelineBuilder.setVertexInputState(bindingDesc, attributesDesc);
+  // Only the streams holding the shader inputs are bound.
+  auto bindingsDesc = m_vertexLayout.getBindingDescriptions(g_sceneVertexAttributes);
+  auto attributesDesc = m_vertexLayout.getAttributeDescriptions(g_sceneVertexAttributes);
+  vkPipelineBuilder.setVertexInputState(bindingsDesc, attributesDesc);
 
   vkPipelineBuilder.setInputAssemblyState(vk::PrimitiveTopology::eTriangleList, false);
 
-  auto extent = m_vulkanSwapchain->getSwapchainExtent();
-  vkPipelineBuilder.addViewport({0, 0}, extent, 0.0f, 1.0f);
-  vkPipelineBuilder.addScissor({0, 0}, extent);
+  vkPipelineBuilder.addDynamicState(vk::DynamicState::eViewport);
+  vkPipelineBuilder.addDynamicState(vk::DynamicState::eScissor);
 
   vkPipelineBuilder.setRasterizationState(false, false, vk::PolygonMode::eFill, 1.0f, vk::CullModeFlagBits::eBack, vk::FrontFace::eCounterClockwise, false, 0.0f, 0.0f, 0.0f);
   vkPipelineBuilder.setDepthStencilState(true, true, vk::CompareOp::eLess, false, 0.0f, 1.0f, false, {}, {});
@@ -530,9 +534,34 @@ void VkRenderer::createGraphicsPipeline()
 
   vkPipelineBuilder.addColorBlendAttachment(VulkanPipelineBuilder::colorWriteMaskAll, false, vk::BlendFactor::eOne, vk::BlendFactor::eZero, vk::BlendFactor::eOne, vk::BlendFactor::eZero, vk::BlendOp::eAdd);
   vkPipelineBuilder.setColorBlendingInfo(false, vk::LogicOp::eCopy, {0.0f, 0.0f, 0.0f, 0.0f});
-  vkPipelineBuilder.setPipelineLayoutInfo(m_descriptorSetLayout.get(), nullptr);
+  vk::PushConstantRange drawConstantsRange{vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof(DrawConstants)};
+  vkPipelineBuilder.setPipelineLayoutInfo(m_descriptorSetLayout.get(), drawConstantsRange);
+
+  // Compiled on the registry threads, the frames keep going and the draws start once it is ready.
+  m_pipelineRequestTime = std::chrono::high_resolution_clock::now();
+  m_pipelineRequest = m_vulkanDevice->getPipelineRegistry().requestGraphicsPipeline(vkPipelineBuilder, m_renderPass.get(), m_renderPassKey);
+}
+
+void VkRenderer::updateGraphicsPipeline()
+{
+  if (!m_pipelineRequest.isReady() || m_pipeline.m_key == m_pipelineRequest.getKey())
+  {
+    return;
+  }
+
+  m_pipeline = m_pipelineRequest.get();
+  auto creationTimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - m_pipelineRequestTime).count();
 
-  std::tie(m_pipeline, m_pipelineLayout) = vkPipelineBuilder.buildGraphicsPipeline(m_renderPass.get());
+  const auto& pipelineCache = m_vulkanDevice->getPipelineCache();
+  const char* cacheState = pipelineCache.isWarm() ? "warm" : "cold";
+  // Cold is a cache that started empty, warm is one seeded from the file of a previous run.
+  const auto size = std::snprintf(nullptr, 0, "Graphics pipeline ready %.3f ms after the request (%s start, %zu cache bytes loaded)\n", creationTimeMs, cacheState, pipelineCache.getLoadedSize());
+  std::string output(size + 1, '\0');
+  std::snprintf(output.data(), output.size(), "Graphics pipeline ready %.3f ms after the request (%s start, %zu cache bytes loaded)\n", creationTimeMs, cacheState, pipelineCache.getLoadedSize());
+  std::cout << output.c_str();
+
+  auto registryStats = m_vulkanDevice->getPipelineRegistry().getStats();
+  std::cout << "Pipeline registry: " << registryStats.m_pipelineCount << " pipelines (" << registryStats.m_pendingCount << " compiling), " << registryStats.m_hitCount << "/" << registryStats.m_requestCount << " requests hit (" << registryStats.getHitRate() * 100.0f << "%)" << std::endl;
 }
 
 void VkRenderer::createGBuffer()
@@ -548,7 +577,7 @@ void VkRenderer::createGBuffer()
 
   m_depthImage = m_vulkanDevice->createImage(extent, 1, depthFormat, vk::ImageTiling::eOptimal, depthUsageFlags, vk::MemoryPropertyFlagBits::eDeviceLocal, depthImgAspect);
   m_vulkanDevice->setObjectName(m_depthImage.get(), "GBuffer:DepthBuffer");
-  transitionImage(m_graphicsCmdBuffersTmp[0].get(), m_graphicsQueue, m_depthImage->getImage(), depthFormat, vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal, 1, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED);
+  // No explicit transition, the render pass moves the depth image out of eUndefined.
 
   // https://medium.com/@lordned/unreal-engine-4-rendering-part-4-the-deferred-shading-pipeline-389fc0175789
   // Albedo
@@ -616,12 +645,13 @@ void VkRenderer::createRenderPass()
   renderPassCreateInfo.pDependencies = &subpassDependency;
 
   m_renderPass = m_device->createRenderPassUnique(renderPassCreateInfo);
+  m_renderPassKey = VulkanPipelineRegistry::computeRenderPassKey(renderPassCreateInfo);
 }
 
 void VkRenderer::createDescriptorSetLayout()
 {
   auto builder = m_vulkanDevice->getDescriptorSetLayoutBuilder();
-  builder.addDescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex, nullptr);
+  builder.addDescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBufferDynamic, 1, vk::ShaderStageFlagBits::eVertex, nullptr);
   builder.addDescriptorSetLayoutBinding(1, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment, nullptr);
 
   m_descriptorSetLayout = builder.build();
@@ -639,51 +669,38 @@ void VkRenderer::createFramebuffers()
   }
 }
 
-void VkRenderer::createVertexBuffer()
+void VkRenderer::createVertexBuffer(const MeshCache& meshCache)
 {
-  vk::DeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
-  auto [stagingBuffer, stagingBufferMemory] = m_vulkanDevice->createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
-
-  auto data = m_device->mapMemory(stagingBufferMemory.get(), 0, bufferSize, vk::MemoryMapFlagBits{});
-  memcpy(data, vertices.data(), (size_t)bufferSize);
-  m_device->unmapMemory(stagingBufferMemory.get());
+  vk::DeviceSize bufferSize = meshCache.getVertexDataSize();
 
   std::tie(m_vertexBuffer, m_vertexBufferMemory) = m_vulkanDevice->createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
-  copyBuffer(stagingBuffer.get(), m_vertexBuffer.get(), bufferSize);
+  m_uploadManager->uploadBuffer(meshCache.getVertexData(), bufferSize, m_vertexBuffer.get(), 0, vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eVertexAttributeRead);
+
+  for (uint32_t stream = 0; stream < m_vertexLayout.getStreamCount(); stream++)
+  {
+    m_vertexStreamOffsets[stream] = meshCache.getVertexStreamOffset(stream);
+  }
 }
 
-void VkRenderer::createIndexBuffer()
+void VkRenderer::createIndexBuffer(const MeshCache& meshCache)
 {
-  vk::DeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-  auto [stagingBuffer, stagingBufferMemory] = m_vulkanDevice->createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
-
-  auto data = m_device->mapMemory(stagingBufferMemory.get(), 0, bufferSize, vk::MemoryMapFlagBits{});
-  memcpy(data, indices.data(), (size_t)bufferSize);
-  m_device->unmapMemory(stagingBufferMemory.get());
+  vk::DeviceSize bufferSize = meshCache.getIndexDataSize();
+  m_index32BufferOffset = meshCache.getIndex32DataOffset();
 
   std::tie(m_indexBuffer, m_indexBufferMemory) = m_vulkanDevice->createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
-  copyBuffer(stagingBuffer.get(), m_indexBuffer.get(), bufferSize);
+  m_uploadManager->uploadBuffer(meshCache.getIndexData(), bufferSize, m_indexBuffer.get(), 0, vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eIndexRead);
 }
 
 void VkRenderer::createUniformBuffer()
 {
-  vk::DeviceSize bufferSize = sizeof(UniformBufferObject);
-
-  m_uboBuffersMemory.resize(VkRenderer::m_frameResourcesCount);
-  m_uboBuffers.resize(VkRenderer::m_frameResourcesCount);
-
-  for (size_t i = 0; i < VkRenderer::m_frameResourcesCount; i++)
-  {
-    std::tie(m_uboBuffers[i], m_uboBuffersMemory[i]) = m_vulkanDevice->createBuffer(bufferSize, vk::BufferUsageFlagBits::eUniformBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
-  }
+  m_uniformRing = m_vulkanDevice->createUniformRing(g_uniformRingFrameSize, VkRenderer::m_frameResourcesCount);
+  m_vulkanDevice->setObjectName(m_uniformRing->getBuffer(), vk::ObjectType::eBuffer, "UniformRing");
 }
 
 void VkRenderer::createDescriptorPool()
 {
   auto builder = m_vulkanDevice->getDescriptorPoolBuilder();
-  builder.addDescriptorPoolSize(vk::DescriptorType::eUniformBuffer, VkRenderer::m_frameResourcesCount);
+  builder.addDescriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic, VkRenderer::m_frameResourcesCount);
   builder.addDescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, VkRenderer::m_frameResourcesCount);
   m_descriptorPool = builder.build(VkRenderer::m_frameResourcesCount);
 }
@@ -702,68 +719,52 @@ void VkRenderer::createDescriptorSets()
   for (size_t i = 0; i < VkRenderer::m_frameResourcesCount; i++)
   {
     vk::DescriptorBufferInfo descriptorBufferInfo{};
-    descriptorBufferInfo.buffer = m_uboBuffers[i].get();
+    descriptorBufferInfo.buffer = m_uniformRing->getBuffer();
     descriptorBufferInfo.offset = 0;
     descriptorBufferInfo.range = sizeof(UniformBufferObject);
 
-    vk::DescriptorImageInfo descriptorImageInfo{};
-    descriptorImageInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-    descriptorImageInfo.imageView = m_vulkanTextureImage->getImageView();
-    descriptorImageInfo.sampler = m_textureSampler.get();
-
-    std::array<vk::WriteDescriptorSet, 2> descriptorSetWrites{};
-    descriptorSetWrites[0].dstSet = m_descriptorSets[i];
-    descriptorSetWrites[0].dstBinding = 0;
-    descriptorSetWrites[0].dstArrayElement = 0;
-    descriptorSetWrites[0].descriptorType = vk::DescriptorType::eUniformBuffer;
-    descriptorSetWrites[0].descriptorCount = 1;
-    descriptorSetWrites[0].pBufferInfo = &descriptorBufferInfo;
-
-    descriptorSetWrites[1].dstSet = m_descriptorSets[i];
-    descriptorSetWrites[1].dstBinding = 1;
-    descriptorSetWrites[1].dstArrayElement = 0;
-    descriptorSetWrites[1].descriptorType = vk::DescriptorType::eCombinedImageSampler;
-    descriptorSetWrites[1].descriptorCount = 1;
-    descriptorSetWrites[1].pImageInfo = &descriptorImageInfo;
-
-    m_device->updateDescriptorSets(descriptorSetWrites, nullptr);
-  }
-}
+    vk::WriteDescriptorSet descriptorSetWrite{};
+    descriptorSetWrite.dstSet = m_descriptorSets[i];
+    descriptorSetWrite.dstBinding = 0;
+    descriptorSetWrite.dstArrayElement = 0;
+    descriptorSetWrite.descriptorType = vk::DescriptorType::eUniformBufferDynamic;
+    descriptorSetWrite.descriptorCount = 1;
+    descriptorSetWrite.pBufferInfo = &descriptorBufferInfo;
 
-void VkRenderer::createTextureImage()
-{
-  int32_t texWidth{};
-  int32_t texHeight{};
-  int32_t texChannels{};
-
-  //auto texturePath = m_dataPath / "textures" / "texture.jpg";
-  auto texturePath = m_dataPath / "textures" / "chalet.jpg";
-  auto pixels = stbi_load(texturePath.u8string().c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-  vk::DeviceSize imageSize = texWidth * texHeight * 4;
+    m_device->updateDescriptorSets(descriptorSetWrite, nullptr);
+  }
 
-  if (!pixels)
+  m_textureDescriptorVersions.assign(VkRenderer::m_frameResourcesCount, 0);
+  for (uint32_t i = 0; i < VkRenderer::m_frameResourcesCount; i++)
   {
-    throw std::runtime_error("Failed to load texture image.");
+    updateTextureDescriptor(i);
   }
+}
 
-  auto mipLevels = (uint32_t)std::floor(std::log2(std::max(texWidth, texHeight))) + 1;
-
-  auto [stagingBuffer, stagingBufferMemory] = m_vulkanDevice->createBuffer(imageSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
-
-  auto data = m_device->mapMemory(stagingBufferMemory.get(), 0, imageSize, vk::MemoryMapFlagBits{});
-  memcpy(data, pixels, (size_t)imageSize);
-  m_device->unmapMemory(stagingBufferMemory.get());
-
-  stbi_image_free(pixels);
-
-  auto format = vk::Format::eR8G8B8A8Unorm;
-
-  auto imageUsage = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
-  m_vulkanTextureImage = m_vulkanDevice->createImage({(uint32_t)texWidth, (uint32_t)texHeight}, mipLevels, format, vk::ImageTiling::eOptimal, imageUsage, vk::MemoryPropertyFlagBits::eDeviceLocal, vk::ImageAspectFlagBits::eColor);
+void VkRenderer::updateTextureDescriptor(uint32_t frameResourceIndex)
+{
+  vk::DescriptorImageInfo descriptorImageInfo{};
+  descriptorImageInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+  descriptorImageInfo.imageView = m_textureStreamer->getImage(m_sceneTexture).getImageView();
+  descriptorImageInfo.sampler = m_textureSampler.get();
+
+  vk::WriteDescriptorSet descriptorSetWrite{};
+  descriptorSetWrite.dstSet = m_descriptorSets[frameResourceIndex];
+  descriptorSetWrite.dstBinding = 1;
+  descriptorSetWrite.dstArrayElement = 0;
+  descriptorSetWrite.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+  descriptorSetWrite.descriptorCount = 1;
+  descriptorSetWrite.pImageInfo = &descriptorImageInfo;
+
+  m_device->updateDescriptorSets(descriptorSetWrite, nullptr);
+  m_textureDescriptorVersions[frameResourceIndex] = m_textureStreamer->getVersion();
+}
 
-  transitionImage(m_transferCmdBuffers[0].get(), m_transferQueue, m_vulkanTextureImage->getImage(), format, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, mipLevels, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED);
-  copyBufferToImage(stagingBuffer.get(), m_vulkanTextureImage->getImage(), (uint32_t)texWidth, (uint32_t)texHeight);
-  generateMipmaps(m_graphicsCmdBuffersTmp[0].get(), m_graphicsQueue, m_vulkanTextureImage->getImage(), format, texWidth, texHeight, mipLevels);
+void VkRenderer::createTextureImage()
+{
+  // Only the mip tail is uploaded with the scene, the streamer brings the larger mips in once the texture is on screen.
+  auto textureCache = TextureCache::loadOrCook(m_textureSourcePath, m_textureCachePath, c_sceneTextureFormat, m_recordingWorkers.get());
+  m_sceneTexture = m_textureStreamer->addTexture(std::move(textureCache));
 }
 
 void VkRenderer::createTextureSampler(uint32_t mipLevels)
@@ -784,178 +785,94 @@ void VkRenderer::createTextureSampler(uint32_t mipLevels)
 
   samplerInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
   samplerInfo.mipLodBias = 0.0f;
+  // The streamed images only hold their resident mips and the LOD counts from the top one, so no clamp follows the streaming.
   samplerInfo.minLod = 0.0f;
   samplerInfo.maxLod = (float)mipLevels;
 
   m_textureSampler = m_device->createSamplerUnique(samplerInfo);
 }
 
-void VkRenderer::copyBuffer(vk::Buffer& srcBuffer, vk::Buffer& dstBuffer, vk::DeviceSize size)
+uint32_t VkRenderer::updateUniformBuffer(const VkFramePacket& framePacket)
 {
-  vk::CommandBufferBeginInfo beginInfo{};
-  beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
-
-  auto& transferCmdBuffer = m_transferCmdBuffers[0];
-  transferCmdBuffer->begin(beginInfo);
+  auto time = (float)framePacket.m_simulationTimeInSeconds;
 
-  vk::BufferCopy copyRegion{};
-  copyRegion.srcOffset = 0;
-  copyRegion.dstOffset = 0;
-  copyRegion.size = size;
-
-  transferCmdBuffer->copyBuffer(srcBuffer, dstBuffer, copyRegion);
-  transferCmdBuffer->end();
-
-  vk::SubmitInfo submitInfo{};
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &transferCmdBuffer.get();
-
-  m_transferQueue.submit(submitInfo, nullptr);
-  m_transferQueue.waitIdle();
-
-  transferCmdBuffer->reset(vk::CommandBufferResetFlagBits::eReleaseResources);
-}
-
-void VkRenderer::copyBufferToImage(vk::Buffer& buffer, vk::Image image, uint32_t width, uint32_t height)
-{
-  vk::CommandBufferBeginInfo beginInfo{};
-  beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
-
-  auto& transferCmdBuffer = m_transferCmdBuffers[0];
-  transferCmdBuffer->begin(beginInfo);
-
-  vk::BufferImageCopy copyRegion{};
-  copyRegion.bufferOffset = 0;
-  copyRegion.bufferRowLength = 0;
-  copyRegion.bufferImageHeight = 0;
-
-  copyRegion.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-  copyRegion.imageSubresource.mipLevel = 0;
-  copyRegion.imageSubresource.baseArrayLayer = 0;
-  copyRegion.imageSubresource.layerCount = 1;
-
-  copyRegion.imageOffset = vk::Offset3D{0, 0, 0};
-  copyRegion.imageExtent = vk::Extent3D{width, height, 1};
-
-  transferCmdBuffer->copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal, copyRegion);
-  transferCmdBuffer->end();
-
-  vk::SubmitInfo submitInfo{};
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &transferCmdBuffer.get();
+  auto extent = m_vulkanSwapchain->getSwapchainExtent();
+  UniformBufferObject ubo = {};
+  ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+  ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+  ubo.proj = glm::perspective(glm::radians(45.0f), extent.width / (float)extent.height, 0.1f, 10.0f);
+  ubo.proj[1][1] *= -1; // any other way to fix this?
 
-  m_transferQueue.submit(submitInfo, nullptr);
-  m_transferQueue.waitIdle();
+  selectLods(ubo, (float)extent.height);
+  requestTextureMips(ubo, (float)extent.height);
 
-  transferCmdBuffer->reset(vk::CommandBufferResetFlagBits::eReleaseResources);
+  return m_uniformRing->push(ubo).m_dynamicOffset;
 }
 
-void VkRenderer::transitionImage(vk::CommandBuffer& cmdBuffer, vk::Queue queue, const vk::Image& image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, uint32_t mipLevels, QueueFamilyIndex srcQueueFamilyIdx, QueueFamilyIndex dstQueueFamilyIdx)
+void VkRenderer::selectLods(const UniformBufferObject& ubo, float viewportHeight)
 {
-  vk::PipelineStageFlags sourceStage{};
-  vk::PipelineStageFlags destinationStage{};
+  // proj[1][1] is the cotangent of half the vertical field of view, a view space length l at distance d covers l * pixelsPerUnit / d pixels.
+  auto pixelsPerUnit = std::abs(ubo.proj[1][1]) * viewportHeight * 0.5f;
 
-  vk::AccessFlags srcAccessFlags{};
-  vk::AccessFlags dstAccessFlags{};
-
-  vk::ImageAspectFlags aspectMask = vk::ImageAspectFlagBits::eColor;
-
-  if (newLayout == vk::ImageLayout::eDepthStencilAttachmentOptimal)
+  m_drawItems.clear();
+  m_frameStats.m_triangleCount = 0;
+  for (const auto& drawInstance : m_drawInstances)
   {
-    aspectMask = vk::ImageAspectFlagBits::eDepth;
-
-    if (hasStencilComponent(format))
+    if (drawInstance.m_lodCount == 0)
     {
-      aspectMask |= vk::ImageAspectFlagBits::eStencil;
+      continue;
     }
-  }
 
-  if (oldLayout == vk::ImageLayout::eUndefined && newLayout == vk::ImageLayout::eTransferDstOptimal)
-  {
-    srcAccessFlags = vk::AccessFlagBits{};
-    dstAccessFlags = vk::AccessFlagBits::eTransferWrite;
+    auto modelView = ubo.view * ubo.model * drawInstance.m_worldTransform;
+    auto scale = std::max({glm::length(glm::vec3(modelView[0])), glm::length(glm::vec3(modelView[1])), glm::length(glm::vec3(modelView[2]))});
+    auto viewCenter = glm::vec3(modelView * glm::vec4(drawInstance.m_boundsCenter, 1.0f));
 
-    sourceStage = vk::PipelineStageFlagBits::eTopOfPipe;
-    destinationStage = vk::PipelineStageFlagBits::eTransfer;
-  }
-  else if (oldLayout == vk::ImageLayout::eTransferDstOptimal && newLayout == vk::ImageLayout::eShaderReadOnlyOptimal)
-  {
-    srcAccessFlags = vk::AccessFlagBits::eTransferWrite;
-    dstAccessFlags = vk::AccessFlagBits::eShaderRead;
-
-    sourceStage = vk::PipelineStageFlagBits::eTransfer;
-    destinationStage = vk::PipelineStageFlagBits::eFragmentShader;
-  }
-  else if (oldLayout == vk::ImageLayout::eUndefined && newLayout == vk::ImageLayout::eDepthStencilAttachmentOptimal)
-  {
-    srcAccessFlags = vk::AccessFlagBits{};
-    dstAccessFlags = vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    // The closest point of the bounds gives the largest projected error, inside them the full mesh is kept.
+    auto distance = glm::length(viewCenter) - drawInstance.m_boundsRadius * scale;
+    auto lodIndex = drawInstance.m_firstLod;
+    if (distance > 0.0f)
+    {
+      for (auto candidate = drawInstance.m_firstLod + drawInstance.m_lodCount - 1; candidate > drawInstance.m_firstLod; candidate--)
+      {
+        if (m_lodDraws[candidate].m_error * scale * pixelsPerUnit / distance <= g_lodErrorThresholdPixels)
+        {
+          lodIndex = candidate;
+          break;
+        }
+      }
+    }
 
-    sourceStage = vk::PipelineStageFlagBits::eTopOfPipe;
-    destinationStage = vk::PipelineStageFlagBits::eEarlyFragmentTests;
-  }
-  else
-  {
-    throw std::invalid_argument("Unsuported layout transition.");
+    const auto& lodDraws = m_lodDraws[lodIndex];
+    m_drawItems.insert(m_drawItems.end(), m_lodDrawItems.begin() + lodDraws.m_firstDrawItem, m_lodDrawItems.begin() + lodDraws.m_firstDrawItem + lodDraws.m_drawItemCount);
+    m_frameStats.m_triangleCount += lodDraws.m_triangleCount;
   }
-
-  vk::CommandBufferBeginInfo beginInfo{};
-  beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
-
-  cmdBuffer.begin(beginInfo);
-
-  vk::ImageMemoryBarrier imgBarrier{};
-  imgBarrier.oldLayout = oldLayout;
-  imgBarrier.newLayout = newLayout;
-  imgBarrier.srcQueueFamilyIndex = srcQueueFamilyIdx;
-  imgBarrier.dstQueueFamilyIndex = dstQueueFamilyIdx;
-
-  imgBarrier.image = image;
-  imgBarrier.subresourceRange.aspectMask = aspectMask;
-  imgBarrier.subresourceRange.baseMipLevel = 0;
-  imgBarrier.subresourceRange.levelCount = mipLevels;
-  imgBarrier.subresourceRange.baseArrayLayer = 0;
-  imgBarrier.subresourceRange.layerCount = 1;
-
-  imgBarrier.srcAccessMask = srcAccessFlags;
-  imgBarrier.dstAccessMask = dstAccessFlags;
-
-  cmdBuffer.pipelineBarrier(sourceStage, destinationStage, vk::DependencyFlagBits{}, nullptr, nullptr, imgBarrier);
-
-  cmdBuffer.end();
-
-  vk::SubmitInfo submitInfo{};
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &cmdBuffer;
-
-  queue.submit(submitInfo, nullptr);
-  queue.waitIdle();
-
-  cmdBuffer.reset(vk::CommandBufferResetFlagBits::eReleaseResources);
 }
 
-void VkRenderer::updateUniformBuffer(uint32_t currentImage)
+void VkRenderer::requestTextureMips(const UniformBufferObject& ubo, float viewportHeight)
 {
-  static auto startTime = std::chrono::high_resolution_clock::now();
+  auto pixelsPerUnit = std::abs(ubo.proj[1][1]) * viewportHeight * 0.5f;
 
-  auto currentTime = std::chrono::high_resolution_clock::now();
-  float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
-
-  auto extent = m_vulkanSwapchain->getSwapchainExtent();
-  UniformBufferObject ubo = {};
-  ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-  ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-  ubo.proj = glm::perspective(glm::radians(45.0f), extent.width / (float)extent.height, 0.1f, 10.0f);
-  ubo.proj[1][1] *= -1; // any other way to fix this?
-
-  auto data = m_device->mapMemory(m_uboBuffersMemory[currentImage].get(), 0, sizeof(ubo), vk::MemoryMapFlagBits{});
-  memcpy(data, &ubo, (size_t)sizeof(ubo));
-  m_device->unmapMemory(m_uboBuffersMemory[currentImage].get());
-}
+  // The scene texture spans each instance once, an instance covering d pixels samples about size / d texels per pixel.
+  auto maxDiameter = 0.0f;
+  for (const auto& drawInstance : m_drawInstances)
+  {
+    auto modelView = ubo.view * ubo.model * drawInstance.m_worldTransform;
+    auto scale = std::max({glm::length(glm::vec3(modelView[0])), glm::length(glm::vec3(modelView[1])), glm::length(glm::vec3(modelView[2]))});
+    auto viewCenter = glm::vec3(modelView * glm::vec4(drawInstance.m_boundsCenter, 1.0f));
+
+    // From inside the bounds the instance covers the screen.
+    auto distance = glm::length(viewCenter) - drawInstance.m_boundsRadius * scale;
+    auto diameter = distance > 0.0f ? 2.0f * drawInstance.m_boundsRadius * scale * pixelsPerUnit / distance : viewportHeight;
+    maxDiameter = std::max(maxDiameter, std::min(diameter, viewportHeight));
+  }
 
-void VkRenderer::update()
-{
-  m_debugGui->startFrame();
+  if (maxDiameter > 0.0f)
+  {
+    const auto extent = m_textureStreamer->getExtent(m_sceneTexture);
+    const auto texelsPerPixel = std::max(extent.width, extent.height) / maxDiameter;
+    const auto mipLevel = texelsPerPixel > 1.0f ? (uint32_t)std::floor(std::log2(texelsPerPixel)) : 0u;
+    m_textureStreamer->requestMip(m_sceneTexture, mipLevel, maxDiameter);
+  }
 }
 
 void VkRenderer::recordGfxCommandBuffer(const VulkanCurrentFrameResources& currentFrameResources)
@@ -976,24 +893,112 @@ void VkRenderer::recordGfxCommandBuffer(const VulkanCurrentFrameResources& curre
   renderPassInfo.clearValueCount = (uint32_t)clearColor.size();
   renderPassInfo.pClearValues = clearColor.data();
 
-  commandBuffer->beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+  if (!m_isSceneReady || !m_pipeline.m_pipeline)
+  {
+    commandBuffer->beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+    commandBuffer->endRenderPass();
+    m_debugUtils->endLabel(commandBuffer.get());
+    return;
+  }
 
-  commandBuffer->bindPipeline(vk::PipelineBindPoint::eGraphics, *m_pipeline);
+  auto recordingStart = std::chrono::high_resolution_clock::now();
 
-  commandBuffer->bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_pipelineLayout.get(), 0, m_descriptorSets[currentFrameResources.m_frameResourceIndex], nullptr);
+  auto workerCount = (uint32_t)(m_drawItems.size() + g_minDrawsPerRecordingWorker - 1) / g_minDrawsPerRecordingWorker;
+  workerCount = recordDraws(currentFrameResources.m_frameResourceIndex, renderPassInfo.framebuffer, currentFrameResources.m_uboDynamicOffset, m_drawItems, workerCount);
 
-  std::array<vk::Buffer, 1> vertexBuffers = {m_vertexBuffer.get()};
-  std::array<vk::DeviceSize, 1> offsets = {0};
-  commandBuffer->bindVertexBuffers(0, vertexBuffers, offsets);
-  commandBuffer->bindIndexBuffer(m_indexBuffer.get(), 0, vk::IndexType::eUint32);
+  m_frameStats.m_drawCount = (uint32_t)m_drawItems.size();
+  m_frameStats.m_recordingWorkerCount = workerCount;
+  m_frameStats.m_recordingTimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - recordingStart).count();
+
+  std::vector<vk::CommandBuffer> secondaryCmdBuffers;
+  for (uint32_t workerIndex = 0; workerIndex < workerCount; workerIndex++)
+  {
+    secondaryCmdBuffers.push_back(currentFrameResources.m_frameResources->m_graphicsWorkerCmdPools[workerIndex].m_secondaryCmdBuffer.get());
+  }
 
-  m_debugUtils->insertLabel(commandBuffer.get(), "DrawIndexedCmd", DebugUtils::m_darkGray);
-  commandBuffer->drawIndexed((uint32_t)indices.size(), 1, 0, 0, 0);
+  commandBuffer->beginRenderPass(renderPassInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+  m_debugUtils->insertLabel(commandBuffer.get(), "ExecuteDrawCmdBuffers", DebugUtils::m_darkGray);
+  commandBuffer->executeCommands(secondaryCmdBuffers);
   commandBuffer->endRenderPass();
   m_debugUtils->endLabel(commandBuffer.get());
 }
 
-void VkRenderer::render()
+uint32_t VkRenderer::recordDraws(uint32_t frameResourceIndex, vk::Framebuffer framebuffer, uint32_t uboDynamicOffset, const std::vector<VulkanDrawItem>& drawItems, uint32_t workerCount)
+{
+  auto& frameResources = m_frameResources[frameResourceIndex];
+  workerCount = std::clamp(workerCount, 1u, m_recordingWorkers->getWorkerCount());
+
+  vk::CommandBufferInheritanceInfo inheritanceInfo{};
+  inheritanceInfo.renderPass = m_renderPass.get();
+  inheritanceInfo.subpass = 0;
+  inheritanceInfo.framebuffer = framebuffer;
+
+  auto extent = m_vulkanSwapchain->getSwapchainExtent();
+  vk::Viewport viewport{0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f};
+  vk::Rect2D scissor{{0, 0}, extent};
+
+  // Each worker records a contiguous slice of the draws into the secondary command buffer of its own pool.
+  m_recordingWorkers->dispatch(workerCount, [&](uint32_t workerIndex) {
+    auto& workerCmdPool = frameResources.m_graphicsWorkerCmdPools[workerIndex];
+    m_device->resetCommandPool(workerCmdPool.m_cmdPool.get(), vk::CommandPoolResetFlags{});
+
+    auto& commandBuffer = workerCmdPool.m_secondaryCmdBuffer;
+
+    vk::CommandBufferBeginInfo beginInfo{};
+    beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+    commandBuffer->begin(beginInfo);
+
+    commandBuffer->bindPipeline(vk::PipelineBindPoint::eGraphics, m_pipeline.m_pipeline);
+    // Secondary command buffers do not inherit dynamic state.
+    commandBuffer->setViewport(0, viewport);
+    commandBuffer->setScissor(0, scissor);
+    commandBuffer->bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_pipeline.m_pipelineLayout, 0, m_descriptorSets[frameResourceIndex], uboDynamicOffset);
+
+    // Every stream lives in the same buffer, the binding of a stream is its index.
+    auto streamMask = m_vertexLayout.getStreamMask(g_sceneVertexAttributes);
+    for (uint32_t stream = 0; stream < m_vertexLayout.getStreamCount(); stream++)
+    {
+      if (streamMask & 1 << stream)
+      {
+        commandBuffer->bindVertexBuffers(stream, m_vertexBuffer.get(), m_vertexStreamOffsets[stream]);
+      }
+    }
+
+    auto drawBegin = drawItems.size() * workerIndex / workerCount;
+    auto drawEnd = drawItems.size() * (workerIndex + 1) / workerCount;
+    auto drawConstantsIndex = std::numeric_limits<uint32_t>::max();
+    std::optional<vk::IndexType> indexType;
+    for (auto i = drawBegin; i < drawEnd; i++)
+    {
+      // The index buffer is rebound only when the index size changes, which split meshes make rare.
+      if (drawItems[i].m_indexType != indexType)
+      {
+        indexType = drawItems[i].m_indexType;
+        commandBuffer->bindIndexBuffer(m_indexBuffer.get(), *indexType == vk::IndexType::eUint16 ? 0 : m_index32BufferOffset, *indexType);
+      }
+
+      // Consecutive draws of the same instance share their constants.
+      if (drawItems[i].m_drawConstantsIndex != drawConstantsIndex)
+      {
+        drawConstantsIndex = drawItems[i].m_drawConstantsIndex;
+        commandBuffer->pushConstants(m_pipeline.m_pipelineLayout, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof(DrawConstants), &m_drawConstants[drawConstantsIndex]);
+      }
+      commandBuffer->drawIndexed(drawItems[i].m_indexCount, 1, drawItems[i].m_firstIndex, drawItems[i].m_vertexOffset, 0);
+    }
+
+    commandBuffer->end();
+  });
+
+  return workerCount;
+}
+
+void VkRenderer::writeDebugGuiInput(VkFramePacket& framePacket)
+{
+  DevGuiRenderer::takeInput(framePacket.m_debugGuiInput);
+}
+
+void VkRenderer::render(const VkFramePacket& framePacket)
 {
   static VulkanCurrentFrameResources currentFrameResources{};
 
@@ -1002,9 +1007,25 @@ void VkRenderer::render()
   currentFrameResources.m_swapchain = m_vulkanSwapchain.get();
   currentFrameResources.m_debugUtils = m_debugUtils.get();
 
-  m_device->waitForFences(currentFrameResources.m_frameResources->m_frameFence.get(), VK_TRUE, std::numeric_limits<uint64_t>::max());
+  auto& timeline = m_vulkanDevice->getTimeline();
+  timeline.wait(currentFrameResources.m_frameResources->m_submissionValue);
+
+  // The GPU is done with this frame resource, its uniform ring region can be rewritten.
+  m_uniformRing->beginFrame(currentFrameResources.m_frameResourceIndex);
 
-  m_device->resetFences(currentFrameResources.m_frameResources->m_frameFence.get());
+  m_uploadManager->collect();
+  m_textureStreamer->update();
+  timeline.collect();
+
+  // The frame resource is idle, its descriptor set can move to the images the streamer swapped in.
+  if (m_textureDescriptorVersions[currentFrameResources.m_frameResourceIndex] != m_textureStreamer->getVersion())
+  {
+    updateTextureDescriptor(currentFrameResources.m_frameResourceIndex);
+  }
+
+  const auto streamingStats = m_textureStreamer->getStats();
+  m_frameStats.m_textureResidentMip = m_textureStreamer->getResidentMip(m_sceneTexture);
+  m_frameStats.m_textureResidentMB = streamingStats.m_residentSize / (1024.0f * 1024.0f);
 
   try
   {
@@ -1015,8 +1036,12 @@ void VkRenderer::render()
     recreateSwapchain();
     return;
   }
+
+  // The DevGui frame is built and rendered on the same thread, ImGui is not thread safe.
+  m_debugGui->startFrame(m_frameStats, framePacket.m_debugGuiInput);
+
   m_debugUtils->beginLabel(m_graphicsQueue, "GfxQueue Begin", DebugUtils::m_yellow);
-  updateUniformBuffer(currentFrameResources.m_frameResourceIndex);
+  currentFrameResources.m_uboDynamicOffset = updateUniformBuffer(framePacket);
 
   {
     auto& commandBuffer = currentFrameResources.m_frameResources->m_graphicsCmdBuffers[0];
@@ -1029,6 +1054,12 @@ void VkRenderer::render()
     auto labelStr = std::string("Begin cmdBuffer") + std::to_string(currentFrameResources.m_frameResourceIndex);
     m_debugUtils->beginLabel(commandBuffer.get(), labelStr.c_str(), DebugUtils::m_green);
 
+    if (!m_isSceneReady && m_uploadManager->isComplete(m_sceneUploadTicket))
+    {
+      m_isSceneReady = true;
+    }
+
+    updateGraphicsPipeline();
     recordGfxCommandBuffer(currentFrameResources);
 
     m_debugGui->recordCommandBuffers(currentFrameResources);
@@ -1052,7 +1083,7 @@ void VkRenderer::render()
   submitInfo.pSignalSemaphores = signalSemaphores;
 
   m_debugUtils->insertLabel(m_graphicsQueue, "GfxQueue Submit", DebugUtils::m_lightGray);
-  m_graphicsQueue.submit(submitInfo, currentFrameResources.m_frameResources->m_frameFence.get());
+  currentFrameResources.m_frameResources->m_submissionValue = timeline.submit(m_graphicsQueue, submitInfo);
   m_debugUtils->endLabel(m_graphicsQueue);
 
   vk::SwapchainKHR swapchains[] = {m_vulkanSwapchain->getSwapchain()};
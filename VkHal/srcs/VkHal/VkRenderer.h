@@ -8,6 +8,8 @@
 #define NOMINMAX
 #include <windows.h>
 
+#include <array>
+#include <chrono>
 #include <filesystem>
 #include <memory>
 
@@ -15,13 +17,23 @@
 #include <vulkan/vulkan.hpp>
 
 #include "DebugGui/DebugGui.h"
+#include "VkHal/TextureCompressor.h"
+#include "VkHal/VertexLayout.h"
 #include "VkHal/VkHalDefines.h"
 #include "VkHal/Vulkan/VulkanDebug.h"
 #include "VkHal/Vulkan/VulkanDevice.h"
 #include "VkHal/Vulkan/VulkanImage.h"
+#include "VkHal/Vulkan/VulkanRecordingWorkers.h"
+#include "VkHal/Vulkan/VulkanUploadManager.h"
 
 namespace VkHal
 {
+class MeshCache;
+class VulkanTextureLoader;
+class VulkanTextureStreamer;
+struct DrawConstants;
+struct UniformBufferObject;
+
 struct GBuffer
 {
   std::unique_ptr<VulkanImage> m_depthImage;
@@ -30,15 +42,24 @@ struct GBuffer
   //std::unique_ptr<VulkanImage> m_materialPropImage;
 };
 
+/** @brief Command pool owned by one recording worker. Only that worker touches it so recording needs no lock. */
+struct VulkanWorkerCmdPool
+{
+  vk::UniqueCommandPool m_cmdPool;
+  vk::UniqueCommandBuffer m_secondaryCmdBuffer;
+};
+
 struct VulkanFrameResources
 {
   vk::UniqueSemaphore m_imageAcquiredSemaphores;
   vk::UniqueSemaphore m_renderCompletedSemaphores;
-  vk::UniqueFence m_frameFence;
+  uint64_t m_submissionValue = 0; // Timeline value of the last submission that used this frame resource.
 
   vk::UniqueCommandPool m_graphicsCmdPool;
   std::vector<vk::UniqueCommandBuffer> m_graphicsCmdBuffers;
 
+  std::vector<VulkanWorkerCmdPool> m_graphicsWorkerCmdPools;
+
   vk::UniqueCommandPool m_computeCmdPool;
   std::vector<vk::UniqueCommandBuffer> m_computeCmdBuffers;
 
@@ -56,6 +77,52 @@ struct VulkanCurrentFrameResources
   VulkanFrameResources* m_frameResources = {};
   const VulkanSwapchain* m_swapchain = {};
   uint32_t m_swapchainImageIndex = {};
+  uint32_t m_uboDynamicOffset = {};
+};
+
+struct VulkanDrawItem
+{
+  uint32_t m_firstIndex = 0;
+  uint32_t m_indexCount = 0;
+  int32_t m_vertexOffset = 0;
+  uint32_t m_drawConstantsIndex = 0; // Index of the transform and material constants of the instance.
+  vk::IndexType m_indexType = vk::IndexType::eUint32; // m_firstIndex counts from the start of the indices of that type.
+};
+
+/** @brief Draw items of one level of detail of an instance, in the LOD draw items of the renderer. */
+struct VulkanLodDraws
+{
+  uint32_t m_firstDrawItem = 0;
+  uint32_t m_drawItemCount = 0;
+  uint32_t m_triangleCount = 0;
+  float m_error = 0.0f; // Simplification error, a distance in the model space of the mesh.
+};
+
+/** @brief Node instance of a mesh with its levels of detail, finest first. */
+struct VulkanDrawInstance
+{
+  glm::mat4 m_worldTransform = glm::mat4(1.0f); // Without the dequantization, the bounds and LOD errors are in the space of the source positions.
+  glm::vec3 m_boundsCenter = {};
+  float m_boundsRadius = 0.0f;
+  uint32_t m_firstLod = 0;
+  uint32_t m_lodCount = 0;
+};
+
+/** @brief Simulation state the renderer reads for one frame. Filled by the simulation thread, read by the thread calling render. */
+struct VkFramePacket
+{
+  double m_simulationTimeInSeconds = 0.0;
+  DevGuiInput m_debugGuiInput; // Window input since the previous packet, replayed into the GUI before its frame.
+};
+
+struct VulkanFrameStats
+{
+  uint32_t m_drawCount = 0;
+  uint32_t m_triangleCount = 0;
+  uint32_t m_recordingWorkerCount = 0;
+  float m_recordingTimeMs = 0.0f;
+  uint32_t m_textureResidentMip = 0; // Top mip of the scene texture on the GPU.
+  float m_textureResidentMB = 0.0f;
 };
 
 class VkRenderer
@@ -67,52 +134,67 @@ public:
   VKHAL_API void initialize(HINSTANCE appInstance, HWND windowHandle);
   VKHAL_API void recreateSwapchain();
   VKHAL_API void prepare(uint32_t windowWidth = 0, uint32_t windowHeight = 0);
-  VKHAL_API void update();
-  VKHAL_API void render();
+  VKHAL_API void render(const VkFramePacket& framePacket);
+
+  /** @brief Moves the window input the debug GUI received into the packet. Called on the thread pumping the window messages. */
+  VKHAL_API static void writeDebugGuiInput(VkFramePacket& framePacket);
 
 private:
+  friend class VkRendererBenchmarks;
+
   using QueueFamilyIndex = uint32_t;
 
+  static constexpr vk::DeviceSize c_textureStreamingBudget = 256 * 1024 * 1024; // Streamed mips of all the textures, tails included.
+  static constexpr uint32_t c_textureTailSize = 128;                              // Mips up to that many texels per side are uploaded with the scene and never evicted.
+  static constexpr VertexLayoutDesc c_sceneVertexLayout = {PositionEncoding::eSnorm16, NormalEncoding::eNone, TexCoordEncoding::eUnorm16, VertexStreams::ePositionSplit}; // Nothing is lit yet, normals are not streamed.
+  static constexpr TextureFormat c_sceneTextureFormat = TextureFormat::eBC1; // The scene texture is opaque.
+
   void createSurface(HINSTANCE appInstance, HWND windowHandle);
   void createDeviceAndQueues(const vk::PhysicalDevice& physicalDevice);
   void createFrameResources();
 
-  void createCommandPools();
-  void createCommandBuffers();
-
   void createGBuffer();
   void createRenderPass();
   void createDescriptorSetLayout();
   void createGraphicsPipeline();
+  void updateGraphicsPipeline();
   void createFramebuffers();
 
-  void createVertexBuffer();
-  void createIndexBuffer();
+  void createVertexBuffer(const MeshCache& meshCache);
+  void createIndexBuffer(const MeshCache& meshCache);
   void createUniformBuffer();
   void createDescriptorPool();
   void createDescriptorSets();
   void createTextureImage();
   void createTextureSampler(uint32_t mipLevels);
+  void updateTextureDescriptor(uint32_t frameResourceIndex);
 
   std::vector<vk::PhysicalDevice> selectPhysicalDevice();
   vk::Format selectSupportedFormat(const std::vector<vk::Format>& formats, vk::ImageTiling desiredTilling, vk::FormatFeatureFlags featuresDesired);
 
-  void copyBuffer(vk::Buffer& srcBuffer, vk::Buffer& dstBuffer, vk::DeviceSize size);
-  void copyBufferToImage(vk::Buffer& buffer, vk::Image image, uint32_t width, uint32_t height);
-  void transitionImage(vk::CommandBuffer& cmdBuffer, vk::Queue queue, const vk::Image& image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, uint32_t mipLevels, QueueFamilyIndex srcQueueFamilyIdx, QueueFamilyIndex dstQueueFamilyIdx);
 
-  void generateMipmaps(vk::CommandBuffer& cmdBuffer, vk::Queue queue, vk::Image image, vk::Format format, int32_t width, int32_t height, uint32_t mipLevels);
   void recordGfxCommandBuffer(const VulkanCurrentFrameResources& currentFrameResources);
-  void updateUniformBuffer(uint32_t currentImage);
+  uint32_t recordDraws(uint32_t frameResourceIndex, vk::Framebuffer framebuffer, uint32_t uboDynamicOffset, const std::vector<VulkanDrawItem>& drawItems, uint32_t workerCount);
+  uint32_t updateUniformBuffer(const VkFramePacket& framePacket);
+  void selectLods(const UniformBufferObject& ubo, float viewportHeight);
+  void requestTextureMips(const UniformBufferObject& ubo, float viewportHeight);
 
   const bool m_isHeadless = true;
   const bool m_enableValidation = false;
   uint32_t m_frameResourcesCount = 3;
 
   std::filesystem::path m_dataPath;
+  std::filesystem::path m_cachePath;
+  std::filesystem::path m_pipelineCachePath;
+  std::filesystem::path m_meshSourcePath;
+  std::filesystem::path m_meshCachePath;
+  std::filesystem::path m_textureSourcePath;
+  std::filesystem::path m_textureCachePath;
   uint32_t m_currentFrameResourceIndex = 0;
 
   std::unique_ptr<DevGuiRenderer> m_debugGui;
+  std::unique_ptr<VulkanRecordingWorkers> m_recordingWorkers;
+  VulkanFrameStats m_frameStats;
 
   HINSTANCE m_appInstance = {};
   HWND m_windowHandle = {};
@@ -136,11 +218,11 @@ private:
   vk::Queue m_transferQueue;
   vk::Queue m_presentQueue;
 
-  vk::UniqueCommandPool m_graphicsCmdPoolTmp;
-  std::vector<vk::UniqueCommandBuffer> m_graphicsCmdBuffersTmp;
-
-  vk::UniqueCommandPool m_transferCmdPool;
-  std::vector<vk::UniqueCommandBuffer> m_transferCmdBuffers;
+  std::unique_ptr<VulkanUploadManager> m_uploadManager;
+  std::unique_ptr<VulkanTextureLoader> m_textureLoader;
+  std::unique_ptr<VulkanTextureStreamer> m_textureStreamer;
+  VulkanUploadTicket m_sceneUploadTicket = 0;
+  bool m_isSceneReady = false;
 
   std::unique_ptr<VulkanSwapchain> m_vulkanSwapchain;
 
@@ -149,25 +231,36 @@ private:
   std::unique_ptr<VulkanImage> m_depthImage;
 
   vk::UniqueRenderPass m_renderPass;
+  uint64_t m_renderPassKey = 0;
 
   vk::UniqueDescriptorSetLayout m_descriptorSetLayout;
-  vk::UniquePipelineLayout m_pipelineLayout;
-  vk::UniquePipeline m_pipeline;
+  VulkanPipelineHandle m_pipelineRequest;
+  std::chrono::high_resolution_clock::time_point m_pipelineRequestTime;
+  VulkanPipeline m_pipeline; // Last pipeline that finished compiling, draws are skipped while there is none.
 
   std::vector<vk::UniqueFramebuffer> m_swapchainFramebuffers;
 
-  vk::UniqueDeviceMemory m_vertexBufferMemory;
+  VulkanAllocation m_vertexBufferMemory;
   vk::UniqueBuffer m_vertexBuffer;
+  std::array<vk::DeviceSize, c_maxVertexStreamCount> m_vertexStreamOffsets = {}; // Binding offset of each stream of m_vertexLayout.
 
-  vk::UniqueDeviceMemory m_indexBufferMemory;
+  VulkanAllocation m_indexBufferMemory;
   vk::UniqueBuffer m_indexBuffer;
+  vk::DeviceSize m_index32BufferOffset = 0; // 16 bit indices start at 0, the 32 bit ones at this offset.
+
+  VertexLayout m_vertexLayout;
+  std::vector<VulkanDrawItem> m_drawItems; // Draws of the levels of detail selected for the frame.
+  std::vector<VulkanDrawItem> m_lodDrawItems;
+  std::vector<VulkanLodDraws> m_lodDraws;
+  std::vector<VulkanDrawInstance> m_drawInstances;
+  std::vector<DrawConstants> m_drawConstants;
 
   vk::UniqueDescriptorPool m_descriptorPool;
   std::vector<vk::DescriptorSet> m_descriptorSets;
-  std::vector<vk::UniqueDeviceMemory> m_uboBuffersMemory;
-  std::vector<vk::UniqueBuffer> m_uboBuffers;
+  std::unique_ptr<VulkanUniformRing> m_uniformRing;
 
-  std::unique_ptr<VulkanImage> m_vulkanTextureImage;
+  uint32_t m_sceneTexture = 0; // In m_textureStreamer.
+  std::vector<uint64_t> m_textureDescriptorVersions; // Streamer version the image descriptor of each frame resource was written at.
   vk::UniqueSampler m_textureSampler;
 };
 } // namespace VkHal
@@ -0,0 +1,491 @@
+#include "VkRendererBenchmarks.h"
+#include "VkRenderer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "stb_image.h"
+
+#include "VkHal/MeshOptimizer.h"
+#include "VkHal/Meshlet.h"
+#include "VkHal/MeshSimplifier.h"
+#include "VkHal/MipGenerator.h"
+#include "VkHal/TextureCache.h"
+#include "VkHal/TextureCompressor.h"
+#include "VkHal/VkMesh.h"
+#include "VkHal/VkMeshCache.h"
+#include "VkHal/Vulkan/VulkanTextureLoader.h"
+#include "VkHal/Vulkan/VulkanTextureStreamer.h"
+
+namespace VkHal
+{
+VkRendererBenchmarks::VkRendererBenchmarks(VkRenderer& renderer)
+    : m_renderer(renderer)
+{
+}
+
+bool VkRendererBenchmarks::run(const std::string& name)
+{
+  const std::pair<const char*, std::function<void()>> benchmarks[] = {
+      {"command-recording", [this] { commandRecording(50000, 20); }},
+      {"mesh-loading", [this] { meshLoading(5); }},
+      {"mesh-conversion", [this] { meshConversion(2000, 10); }},
+      {"mesh-simplification", [this] { meshSimplification(); }},
+      {"meshlet-culling", [this] { meshletCulling(16); }},
+      {"texture-loading", [this] { textureLoading(256); }},
+      {"texture-compression", [this] { textureCompression(); }},
+      {"mip-generation", [this] { mipGeneration(); }},
+      {"texture-streaming", [this] { textureStreaming(); }},
+  };
+
+  for (const auto& [benchmarkName, benchmarkFunc] : benchmarks)
+  {
+    if (name == benchmarkName)
+    {
+      benchmarkFunc();
+      return true;
+    }
+  }
+  return false;
+}
+
+void VkRendererBenchmarks::commandRecording(uint32_t drawCount, uint32_t iterationCount)
+{
+  auto& timeline = m_renderer.m_vulkanDevice->getTimeline();
+  timeline.wait(timeline.getSubmittedValue());
+  m_renderer.m_pipeline = m_renderer.m_pipelineRequest.get();
+
+  std::vector<VulkanDrawItem> drawItems(drawCount);
+  for (uint32_t i = 0; i < drawCount; i++)
+  {
+    drawItems[i] = m_renderer.m_drawItems[i % m_renderer.m_drawItems.size()];
+  }
+
+  std::cout << "Command recording benchmark, " << drawCount << " draws, " << iterationCount << " iterations" << std::endl;
+
+  float singleWorkerTimeMs = 0.0f;
+  for (uint32_t workerCount = 1; workerCount <= m_renderer.m_recordingWorkers->getWorkerCount(); workerCount++)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < iterationCount; i++)
+    {
+      m_renderer.recordDraws(0, m_renderer.m_swapchainFramebuffers[0].get(), 0, drawItems, workerCount);
+    }
+    auto timeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count() / iterationCount;
+
+    if (workerCount == 1)
+    {
+      singleWorkerTimeMs = timeMs;
+    }
+
+    const auto size = std::snprintf(nullptr, 0, "  %2u workers: %8.3f ms, speedup %5.2fx\n", workerCount, timeMs, singleWorkerTimeMs / timeMs);
+    std::string output(size + 1, '\0');
+    std::snprintf(output.data(), output.size(), "  %2u workers: %8.3f ms, speedup %5.2fx\n", workerCount, timeMs, singleWorkerTimeMs / timeMs);
+    std::cout << output.c_str();
+  }
+}
+
+void VkRendererBenchmarks::meshLoading(uint32_t iterationCount)
+{
+  MeshCache::loadOrCook(m_renderer.m_meshSourcePath, m_renderer.m_meshCachePath, VkRenderer::c_sceneVertexLayout, m_renderer.m_recordingWorkers.get());
+
+  // Both paths end with the streams in one buffer, the way they would be in the staging buffer.
+  std::vector<uint8_t> staging;
+
+  auto assimpStart = std::chrono::high_resolution_clock::now();
+  for (uint32_t i = 0; i < iterationCount; i++)
+  {
+    MeshLoader meshLoader;
+    meshLoader.loadModel(m_renderer.m_meshSourcePath, m_renderer.m_recordingWorkers.get());
+    auto vertexSize = meshLoader.getVertices().size() * sizeof(Vertex);
+    auto indexSize = meshLoader.getIndices().size() * sizeof(uint32_t);
+    staging.resize(vertexSize + indexSize);
+    std::memcpy(staging.data(), meshLoader.getVertices().data(), vertexSize);
+    std::memcpy(staging.data() + vertexSize, meshLoader.getIndices().data(), indexSize);
+  }
+  auto assimpTimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - assimpStart).count() / iterationCount;
+
+  auto cacheStart = std::chrono::high_resolution_clock::now();
+  for (uint32_t i = 0; i < iterationCount; i++)
+  {
+    MeshCache meshCache(m_renderer.m_meshCachePath);
+    if (!meshCache.isSourceUpToDate(m_renderer.m_meshSourcePath))
+    {
+      throw std::runtime_error("Mesh cache went stale during the benchmark.");
+    }
+
+    auto vertexSize = (size_t)meshCache.getVertexDataSize();
+    auto indexSize = (size_t)meshCache.getIndexDataSize();
+    staging.resize(vertexSize + indexSize);
+    std::memcpy(staging.data(), meshCache.getVertexData(), vertexSize);
+    std::memcpy(staging.data() + vertexSize, meshCache.getIndexData(), indexSize);
+  }
+  auto cacheTimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - cacheStart).count() / iterationCount;
+
+  std::cout << "Mesh loading benchmark, " << m_renderer.m_meshSourcePath.filename().u8string() << ", " << iterationCount << " iterations" << std::endl;
+  const auto size = std::snprintf(nullptr, 0, "  Assimp: %8.3f ms\n  Cache:  %8.3f ms, speedup %5.1fx\n", assimpTimeMs, cacheTimeMs, assimpTimeMs / cacheTimeMs);
+  std::string output(size + 1, '\0');
+  std::snprintf(output.data(), output.size(), "  Assimp: %8.3f ms\n  Cache:  %8.3f ms, speedup %5.1fx\n", assimpTimeMs, cacheTimeMs, assimpTimeMs / cacheTimeMs);
+  std::cout << output.c_str();
+}
+
+void VkRendererBenchmarks::meshConversion(uint32_t meshVertexLimit, uint32_t iterationCount)
+{
+  // Splitting the source gives a scene with many meshes of similar size, the import is not part of the timings.
+  Assimp::Importer importer;
+  auto scene = MeshLoader::importScene(importer, m_renderer.m_meshSourcePath, meshVertexLimit);
+
+  MeshLoader meshLoader;
+  meshLoader.convertScene(scene, nullptr, 1);
+  std::cout << "Mesh conversion benchmark, " << m_renderer.m_meshSourcePath.filename().u8string() << " split to " << scene->mNumMeshes << " meshes, " << meshLoader.getVertices().size() << " vertices, " << meshLoader.getIndices().size() << " indices, " << iterationCount << " iterations" << std::endl;
+
+  float singleWorkerTimeMs = 0.0f;
+  for (uint32_t workerCount = 1; workerCount <= m_renderer.m_recordingWorkers->getWorkerCount(); workerCount++)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < iterationCount; i++)
+    {
+      meshLoader.convertScene(scene, m_renderer.m_recordingWorkers.get(), workerCount);
+    }
+    auto timeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count() / iterationCount;
+
+    if (workerCount == 1)
+    {
+      singleWorkerTimeMs = timeMs;
+    }
+
+    const auto size = std::snprintf(nullptr, 0, "  %2u workers: %8.3f ms, speedup %5.2fx\n", workerCount, timeMs, singleWorkerTimeMs / timeMs);
+    std::string output(size + 1, '\0');
+    std::snprintf(output.data(), output.size(), "  %2u workers: %8.3f ms, speedup %5.2fx\n", workerCount, timeMs, singleWorkerTimeMs / timeMs);
+    std::cout << output.c_str();
+  }
+}
+
+void VkRendererBenchmarks::meshSimplification()
+{
+  MeshLoader meshLoader;
+  meshLoader.loadModel(m_renderer.m_meshSourcePath, m_renderer.m_recordingWorkers.get());
+  meshLoader.optimizeMeshes(m_renderer.m_recordingWorkers.get(), m_renderer.m_recordingWorkers->getWorkerCount());
+
+  const auto& vertices = meshLoader.getVertices();
+  const auto& indices = meshLoader.getIndices();
+  const auto& meshes = meshLoader.getMeshes();
+
+  // Target errors relative to the scene size, so the table reads the same for any model.
+  auto boundsMin = vertices.empty() ? glm::vec3{} : vertices[0].pos;
+  auto boundsMax = boundsMin;
+  for (const auto& vertex : vertices)
+  {
+    boundsMin = glm::min(boundsMin, vertex.pos);
+    boundsMax = glm::max(boundsMax, vertex.pos);
+  }
+  auto sceneSize = glm::length(boundsMax - boundsMin);
+
+  std::cout << "Mesh simplification benchmark, " << m_renderer.m_meshSourcePath.filename().u8string() << ", " << meshes.size() << " meshes, " << indices.size() / 3 << " triangles" << std::endl;
+
+  std::vector<uint32_t> lodIndices(indices.size());
+  for (auto relativeError : {0.0001f, 0.0005f, 0.001f, 0.005f, 0.01f, 0.05f})
+  {
+    auto targetError = relativeError * sceneSize;
+    uint64_t triangleCount = 0;
+    float maxError = 0.0f;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& mesh : meshes)
+    {
+      float error = 0.0f;
+      auto indexCount = simplifyMesh(lodIndices.data(), indices.data() + mesh.m_firstIndex, mesh.m_indexCount, vertices.data() + mesh.m_firstVertex, mesh.m_vertexCount, 0, targetError, &error);
+      triangleCount += indexCount / 3;
+      maxError = std::max(maxError, error);
+    }
+    auto timeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+
+    auto keptPercent = indices.empty() ? 0.0f : 100.0f * triangleCount / (indices.size() / 3);
+    const auto size = std::snprintf(nullptr, 0, "  target error %7.4f%% of the scene: %8llu triangles, %5.1f%% kept, max error %g, %8.3f ms\n", relativeError * 100.0f, (unsigned long long)triangleCount, keptPercent, maxError, timeMs);
+    std::string output(size + 1, '\0');
+    std::snprintf(output.data(), output.size(), "  target error %7.4f%% of the scene: %8llu triangles, %5.1f%% kept, max error %g, %8.3f ms\n", relativeError * 100.0f, (unsigned long long)triangleCount, keptPercent, maxError, timeMs);
+    std::cout << output.c_str();
+  }
+}
+
+void VkRendererBenchmarks::meshletCulling(uint32_t viewCount)
+{
+  auto meshCache = MeshCache::loadOrCook(m_renderer.m_meshSourcePath, m_renderer.m_meshCachePath, VkRenderer::c_sceneVertexLayout, m_renderer.m_recordingWorkers.get());
+
+  // Same camera as updateUniformBuffer, the swapchain may not exist yet so the aspect ratio is fixed.
+  auto view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+  auto proj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 10.0f);
+  proj[1][1] *= -1;
+  auto frustum = Frustum::fromViewProjection(proj * view);
+  auto cameraPosition = glm::vec3(glm::inverse(view)[3]);
+
+  std::cout << "Meshlet culling benchmark, " << m_renderer.m_meshSourcePath.filename().u8string() << ", " << meshCache.getMeshletCount() << " meshlets, " << viewCount << " views" << std::endl;
+
+  uint64_t totalTriangleCount = 0;
+  uint64_t totalFrustumRejectedCount = 0;
+  uint64_t totalBackfacingRejectedCount = 0;
+  float totalTimeMs = 0.0f;
+  for (uint32_t viewIndex = 0; viewIndex < viewCount; viewIndex++)
+  {
+    auto angle = glm::radians(360.0f) * viewIndex / viewCount;
+    auto sceneModel = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 0.0f, 1.0f));
+
+    uint64_t triangleCount = 0;
+    uint64_t frustumRejectedCount = 0;
+    uint64_t backfacingRejectedCount = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32_t nodeIndex = 0; nodeIndex < meshCache.getNodeCount(); nodeIndex++)
+    {
+      const auto& node = meshCache.getNode(nodeIndex);
+      const auto& mesh = meshCache.getMesh(node.m_meshIndex);
+
+      // Meshlet bounds are in the model space of the source positions, before dequantization.
+      auto worldTransform = sceneModel * node.m_worldTransform;
+      auto worldScale = std::max({glm::length(glm::vec3(worldTransform[0])), glm::length(glm::vec3(worldTransform[1])), glm::length(glm::vec3(worldTransform[2]))});
+      auto modelCameraPosition = glm::vec3(glm::inverse(worldTransform) * glm::vec4(cameraPosition, 1.0f));
+
+      for (uint32_t meshletIndex = mesh.m_firstMeshlet; meshletIndex < mesh.m_firstMeshlet + mesh.m_meshletCount; meshletIndex++)
+      {
+        const auto& meshlet = meshCache.getMeshlet(meshletIndex);
+        triangleCount += meshlet.m_triangleCount;
+        switch (cullMeshlet(meshlet, worldTransform, worldScale, frustum, modelCameraPosition))
+        {
+        case MeshletVisibility::eOutsideFrustum:
+          frustumRejectedCount += meshlet.m_triangleCount;
+          break;
+        case MeshletVisibility::eBackfacing:
+          backfacingRejectedCount += meshlet.m_triangleCount;
+          break;
+        default:
+          break;
+        }
+      }
+    }
+    auto timeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+
+    totalTriangleCount += triangleCount;
+    totalFrustumRejectedCount += frustumRejectedCount;
+    totalBackfacingRejectedCount += backfacingRejectedCount;
+    totalTimeMs += timeMs;
+
+    auto rejectedPercent = triangleCount ? 100.0f * (frustumRejectedCount + backfacingRejectedCount) / triangleCount : 0.0f;
+    const auto size = std::snprintf(nullptr, 0, "  %6.1f deg: %8llu triangles, %8llu outside frustum, %8llu backfacing, %5.1f%% rejected, %7.3f ms\n", glm::degrees(angle), (unsigned long long)triangleCount, (unsigned long long)frustumRejectedCount, (unsigned long long)backfacingRejectedCount, rejectedPercent, timeMs);
+    std::string output(size + 1, '\0');
+    std::snprintf(output.data(), output.size(), "  %6.1f deg: %8llu triangles, %8llu outside frustum, %8llu backfacing, %5.1f%% rejected, %7.3f ms\n", glm::degrees(angle), (unsigned long long)triangleCount, (unsigned long long)frustumRejectedCount, (unsigned long long)backfacingRejectedCount, rejectedPercent, timeMs);
+    std::cout << output.c_str();
+  }
+
+  if (viewCount > 0 && totalTriangleCount > 0)
+  {
+    const auto size = std::snprintf(nullptr, 0, "  Average: %5.1f%% outside frustum, %5.1f%% backfacing, %7.3f ms per view\n", 100.0f * totalFrustumRejectedCount / totalTriangleCount, 100.0f * totalBackfacingRejectedCount / totalTriangleCount, totalTimeMs / viewCount);
+    std::string output(size + 1, '\0');
+    std::snprintf(output.data(), output.size(), "  Average: %5.1f%% outside frustum, %5.1f%% backfacing, %7.3f ms per view\n", 100.0f * totalFrustumRejectedCount / totalTriangleCount, 100.0f * totalBackfacingRejectedCount / totalTriangleCount, totalTimeMs / viewCount);
+    std::cout << output.c_str();
+  }
+}
+
+void VkRendererBenchmarks::textureLoading(uint32_t textureCount)
+{
+  // Small textures keep the images of all the copies in memory at once.
+  std::vector<std::filesystem::path> texturePaths(textureCount, m_renderer.m_dataPath / "textures" / "texture.jpg");
+  std::cout << "Texture loading benchmark, " << texturePaths[0].filename().u8string() << " x " << textureCount << ", " << m_renderer.m_textureLoader->getStagingSize() / (1024 * 1024) << " MB staging" << std::endl;
+
+  float singleWorkerTimeMs = 0.0f;
+  for (uint32_t workerCount = 1; workerCount <= m_renderer.m_recordingWorkers->getWorkerCount(); workerCount++)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    auto textures = m_renderer.m_textureLoader->load(texturePaths, m_renderer.m_recordingWorkers.get(), workerCount);
+    m_renderer.m_uploadManager->wait(m_renderer.m_uploadManager->flush());
+    auto timeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+
+    uint64_t decodedSize = 0;
+    for (const auto& texture : textures)
+    {
+      const auto extent = texture.m_image->getExtent();
+      decodedSize += (uint64_t)extent.width * extent.height * 4;
+    }
+
+    if (workerCount == 1)
+    {
+      singleWorkerTimeMs = timeMs;
+    }
+
+    const auto decodedMBPerSecond = (float)decodedSize / (1024.0f * 1024.0f) / (timeMs / 1000.0f);
+    const auto size = std::snprintf(nullptr, 0, "  %2u workers: %8.3f ms, %8.1f MB/s, speedup %5.2fx\n", workerCount, timeMs, decodedMBPerSecond, singleWorkerTimeMs / timeMs);
+    std::string output(size + 1, '\0');
+    std::snprintf(output.data(), output.size(), "  %2u workers: %8.3f ms, %8.1f MB/s, speedup %5.2fx\n", workerCount, timeMs, decodedMBPerSecond, singleWorkerTimeMs / timeMs);
+    std::cout << output.c_str();
+  }
+
+  // The same texture cooked with its whole mip chain, copied out of the mapped cache instead of decoded.
+  auto textureCache = TextureCache::loadOrCook(texturePaths[0], m_renderer.m_textureCachePath.parent_path() / "texture.texcache", VkRenderer::c_sceneTextureFormat, m_renderer.m_recordingWorkers.get());
+  std::vector<const TextureCache*> textureCaches(textureCount, &textureCache);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  auto textures = m_renderer.m_textureLoader->loadCooked(textureCaches, m_renderer.m_recordingWorkers.get(), m_renderer.m_recordingWorkers->getWorkerCount());
+  m_renderer.m_uploadManager->wait(m_renderer.m_uploadManager->flush());
+  auto timeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+
+  const auto cookedMBPerSecond = (float)textureCache.getDataSize() * textureCount / (1024.0f * 1024.0f) / (timeMs / 1000.0f);
+  const auto size = std::snprintf(nullptr, 0, "  Cooked %s, %u mips, %2u workers: %8.3f ms, %8.1f MB/s, %5.2fx the decoding on 1 worker\n", getTextureFormatName(VkRenderer::c_sceneTextureFormat), textureCache.getMipCount(), m_renderer.m_recordingWorkers->getWorkerCount(), timeMs, cookedMBPerSecond, singleWorkerTimeMs / timeMs);
+  std::string output(size + 1, '\0');
+  std::snprintf(output.data(), output.size(), "  Cooked %s, %u mips, %2u workers: %8.3f ms, %8.1f MB/s, %5.2fx the decoding on 1 worker\n", getTextureFormatName(VkRenderer::c_sceneTextureFormat), textureCache.getMipCount(), m_renderer.m_recordingWorkers->getWorkerCount(), timeMs, cookedMBPerSecond, singleWorkerTimeMs / timeMs);
+  std::cout << output.c_str();
+}
+
+void VkRendererBenchmarks::textureCompression()
+{
+  int32_t width{};
+  int32_t height{};
+  int32_t channels{};
+  auto pixels = stbi_load(m_renderer.m_textureSourcePath.u8string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+  if (!pixels)
+  {
+    throw std::runtime_error("Failed to load texture image.");
+  }
+  std::vector<uint8_t> texels(pixels, pixels + (size_t)width * height * 4);
+  stbi_image_free(pixels);
+
+  const auto workerCount = m_renderer.m_recordingWorkers->getWorkerCount();
+  const auto megaTexelCount = (float)width * height / 1e6f;
+  std::cout << "Texture compression benchmark, " << m_renderer.m_textureSourcePath.filename().u8string() << " " << width << "x" << height << std::endl;
+
+  std::vector<uint8_t> decodedTexels(texels.size());
+  for (auto format : {TextureFormat::eBC1, TextureFormat::eBC3, TextureFormat::eBC5, TextureFormat::eBC7})
+  {
+    std::vector<uint8_t> blocks(getTextureMipSize(format, width, height));
+
+    auto singleWorkerStart = std::chrono::high_resolution_clock::now();
+    compressTexture(format, texels.data(), width, height, blocks.data());
+    auto singleWorkerTimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - singleWorkerStart).count();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    compressTexture(format, texels.data(), width, height, blocks.data(), m_renderer.m_recordingWorkers.get(), workerCount);
+    auto timeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+
+    decompressTexture(format, blocks.data(), width, height, decodedTexels.data());
+    auto psnr = computeTexturePsnr(format, texels.data(), decodedTexels.data(), width, height);
+
+    const auto size = std::snprintf(nullptr, 0, "  %s: %6.2f dB, %4.1fx smaller, 1 worker %7.1f MTexel/s, %2u workers %7.1f MTexel/s\n", getTextureFormatName(format), psnr, (float)texels.size() / blocks.size(), megaTexelCount * 1000.0f / singleWorkerTimeMs, workerCount, megaTexelCount * 1000.0f / timeMs);
+    std::string output(size + 1, '\0');
+    std::snprintf(output.data(), output.size(), "  %s: %6.2f dB, %4.1fx smaller, 1 worker %7.1f MTexel/s, %2u workers %7.1f MTexel/s\n", getTextureFormatName(format), psnr, (float)texels.size() / blocks.size(), megaTexelCount * 1000.0f / singleWorkerTimeMs, workerCount, megaTexelCount * 1000.0f / timeMs);
+    std::cout << output.c_str();
+  }
+}
+
+void VkRendererBenchmarks::mipGeneration()
+{
+  int32_t width{};
+  int32_t height{};
+  int32_t channels{};
+  auto pixels = stbi_load(m_renderer.m_textureSourcePath.u8string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+  if (!pixels)
+  {
+    throw std::runtime_error("Failed to load texture image.");
+  }
+  std::vector<uint8_t> texels(pixels, pixels + (size_t)width * height * 4);
+  stbi_image_free(pixels);
+
+  const auto workerCount = m_renderer.m_recordingWorkers->getWorkerCount();
+  std::cout << "Mip generation benchmark, " << m_renderer.m_textureSourcePath.filename().u8string() << " " << width << "x" << height << std::endl;
+
+  // Each mip is filtered from the previous one, the throughput counts the texels read over the whole chain.
+  auto generateChain = [&](MipFilter filter, VulkanRecordingWorkers* workers, uint32_t chainWorkerCount) {
+    std::vector<uint8_t> sourceTexels = texels;
+    std::vector<uint8_t> mipTexels;
+    auto mipWidth = (uint32_t)width;
+    auto mipHeight = (uint32_t)height;
+    uint64_t sourceTexelCount = 0;
+    while (mipWidth > 1 || mipHeight > 1)
+    {
+      mipTexels.resize((size_t)std::max(mipWidth / 2, 1u) * std::max(mipHeight / 2, 1u) * 4);
+      generateMip(filter, true, sourceTexels.data(), mipWidth, mipHeight, mipTexels.data(), workers, chainWorkerCount);
+      sourceTexelCount += (uint64_t)mipWidth * mipHeight;
+      sourceTexels.swap(mipTexels);
+      mipWidth = std::max(mipWidth / 2, 1u);
+      mipHeight = std::max(mipHeight / 2, 1u);
+    }
+    return sourceTexelCount;
+  };
+
+  for (auto filter : {MipFilter::eBox, MipFilter::eLanczos, MipFilter::eKaiser})
+  {
+    auto singleWorkerStart = std::chrono::high_resolution_clock::now();
+    const auto megaPixelCount = generateChain(filter, nullptr, 1) / 1e6f;
+    auto singleWorkerTimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - singleWorkerStart).count();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    generateChain(filter, m_renderer.m_recordingWorkers.get(), workerCount);
+    auto timeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+
+    const auto size = std::snprintf(nullptr, 0, "  %-7s: 1 worker %7.1f MPix/s, %2u workers %7.1f MPix/s\n", getMipFilterName(filter), megaPixelCount * 1000.0f / singleWorkerTimeMs, workerCount, megaPixelCount * 1000.0f / timeMs);
+    std::string output(size + 1, '\0');
+    std::snprintf(output.data(), output.size(), "  %-7s: 1 worker %7.1f MPix/s, %2u workers %7.1f MPix/s\n", getMipFilterName(filter), megaPixelCount * 1000.0f / singleWorkerTimeMs, workerCount, megaPixelCount * 1000.0f / timeMs);
+    std::cout << output.c_str();
+  }
+}
+
+void VkRendererBenchmarks::textureStreaming()
+{
+  auto textureCache = TextureCache::loadOrCook(m_renderer.m_textureSourcePath, m_renderer.m_textureCachePath, VkRenderer::c_sceneTextureFormat, m_renderer.m_recordingWorkers.get());
+  std::cout << "Texture streaming benchmark, " << m_renderer.m_textureSourcePath.filename().u8string() << " " << getTextureFormatName(VkRenderer::c_sceneTextureFormat) << std::endl;
+
+  auto printStep = [](const char* name, uint32_t residentMip, vk::DeviceSize residentSize, float timeMs) {
+    const auto size = std::snprintf(nullptr, 0, "  %-12s: mip %2u resident, %7.2f MB, %8.3f ms\n", name, residentMip, residentSize / (1024.0f * 1024.0f), timeMs);
+    std::string output(size + 1, '\0');
+    std::snprintf(output.data(), output.size(), "  %-12s: mip %2u resident, %7.2f MB, %8.3f ms\n", name, residentMip, residentSize / (1024.0f * 1024.0f), timeMs);
+    std::cout << output.c_str();
+  };
+
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    auto textures = m_renderer.m_textureLoader->loadCooked({&textureCache}, m_renderer.m_recordingWorkers.get(), m_renderer.m_recordingWorkers->getWorkerCount());
+    m_renderer.m_uploadManager->wait(m_renderer.m_uploadManager->flush());
+    printStep("Whole chain", 0, textureCache.getDataSize(), std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count());
+  }
+
+  for (auto budget : {VkRenderer::c_textureStreamingBudget, (vk::DeviceSize)textureCache.getDataSize() / 2})
+  {
+    std::cout << "  Budget " << budget / (1024 * 1024) << " MB" << std::endl;
+
+    VulkanTextureStreamer textureStreamer(m_renderer.m_vulkanDevice.get(), m_renderer.m_uploadManager.get(), m_renderer.m_textureLoader.get(), m_renderer.m_recordingWorkers.get(), budget, VkRenderer::c_textureTailSize);
+    auto start = std::chrono::high_resolution_clock::now();
+    auto texture = textureStreamer.addTexture(TextureCache(m_renderer.m_textureCachePath));
+    m_renderer.m_uploadManager->wait(m_renderer.m_uploadManager->flush());
+    printStep("Tail", textureStreamer.getResidentMip(texture), textureStreamer.getStats().m_residentSize, std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count());
+
+    // Asked for mip 0 on every update, the way a close-up would, until the budget stops the upgrades.
+    auto residentMip = textureStreamer.getResidentMip(texture);
+    while (true)
+    {
+      textureStreamer.requestMip(texture, 0, 1.0f);
+      textureStreamer.update();
+      if (textureStreamer.getResidentMip(texture) != residentMip)
+      {
+        residentMip = textureStreamer.getResidentMip(texture);
+        printStep("Upgrade", residentMip, textureStreamer.getStats().m_residentSize, std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count());
+      }
+
+      if (textureStreamer.getStats().m_pendingTextureCount == 0)
+      {
+        break;
+      }
+      m_renderer.m_uploadManager->wait(m_renderer.m_uploadManager->flush());
+    }
+  }
+
+  m_renderer.m_vulkanDevice->getTimeline().collect();
+}
+} // namespace VkHal
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "VkHal/VkHalDefines.h"
+
+namespace VkHal
+{
+class VkRenderer;
+
+/** @brief Times the subsystems of a prepared renderer on its scene and prints the results. Not part of rendering a frame, the app runs them from its command line. */
+class VkRendererBenchmarks
+{
+public:
+  VKHAL_API explicit VkRendererBenchmarks(VkRenderer& renderer);
+
+  /**
+   * @brief Runs the benchmark of that name: command-recording, mesh-loading, mesh-conversion, mesh-simplification, meshlet-culling,
+   * texture-loading, texture-compression, mip-generation or texture-streaming. Returns false if there is no such benchmark.
+   */
+  VKHAL_API bool run(const std::string& name);
+
+private:
+  /** @brief Records drawCount draws with 1 to N workers and prints the recording times. Nothing is submitted. */
+  void commandRecording(uint32_t drawCount, uint32_t iterationCount);
+
+  /** @brief Times loading the scene mesh with Assimp against mapping its mesh cache, both ending with the bytes in a staging-like buffer. */
+  void meshLoading(uint32_t iterationCount);
+
+  /** @brief Converts the scene mesh split in meshes of at most meshVertexLimit vertices with 1 to N workers and prints the conversion times. */
+  void meshConversion(uint32_t meshVertexLimit, uint32_t iterationCount);
+
+  /** @brief Simplifies the scene meshes for a range of target errors and prints the triangles left and the time for each. VkHalTests checks the results. */
+  void meshSimplification();
+
+  /** @brief Culls the scene meshlets on the CPU for viewCount turns of the model under the scene camera and prints the triangles each test rejects. */
+  void meshletCulling(uint32_t viewCount);
+
+  /** @brief Loads textureCount copies of a small texture with 1 to N workers, the way a directory of textures would, and prints the decoded MB/s up to the completed uploads. */
+  void textureLoading(uint32_t textureCount);
+
+  /** @brief Encodes the scene texture to every block compressed format with 1 and N workers and prints the throughputs and PSNR. VkHalTests checks the quality. */
+  void textureCompression();
+
+  /** @brief Filters the sRGB mip chain of the scene texture with every mip filter, with 1 and N workers, and prints the source MPix/s. */
+  void mipGeneration();
+
+  /**
+   * @brief Times uploading the whole scene texture against streaming its mip tail, then streams it in mip by mip, with the scene budget and with half of it.
+   * Prints the time and size until each step is on the GPU.
+   */
+  void textureStreaming();
+
+  VkRenderer& m_renderer;
+};
+} // namespace VkHal
@@ -1,32 +1,41 @@
 #include "VulkanPipelineBuilder.h"
 
+#include "VkHal/Vulkan/VulkanHash.h"
+
 namespace VkHal
 {
 
-VulkanPipelineBuilder::VulkanPipelineBuilder(const vk::Device& device)
+VulkanPipelineBuilder::VulkanPipelineBuilder(const vk::Device& device, vk::PipelineCache pipelineCache)
     : m_device{device}
+    , m_pipelineCache{pipelineCache}
 {
 }
 
-VulkanPipelineBuilder VulkanPipelineBuilder::addShaderStage(vk::ShaderStageFlagBits shaderStage, const vk::ShaderModule& shaderModule, const char* entryName, vk::SpecializationInfo* specialization)
+VulkanPipelineBuilder VulkanPipelineBuilder::addShaderStage(vk::ShaderStageFlagBits shaderStage, std::shared_ptr<const VulkanShaderModule> shaderModule, const char* entryName, const vk::SpecializationInfo* specialization)
 {
-  vk::PipelineShaderStageCreateInfo shaderStageInfo{};
-  shaderStageInfo.stage = shaderStage;
-  shaderStageInfo.module = shaderModule;
-  shaderStageInfo.pName = entryName;
-  shaderStageInfo.pSpecializationInfo = specialization; // to specialize the shader at pipeline creation time.
-
-  m_shaderStages.push_back(shaderStageInfo);
+  ShaderStage stage{};
+  stage.m_stage = shaderStage;
+  stage.m_shaderModule = std::move(shaderModule);
+  stage.m_entryName = entryName;
+
+  // to specialize the shader at pipeline creation time.
+  if (specialization)
+  {
+    auto data = static_cast<const uint8_t*>(specialization->pData);
+    stage.m_isSpecialized = true;
+    stage.m_specializationEntries.assign(specialization->pMapEntries, specialization->pMapEntries + specialization->mapEntryCount);
+    stage.m_specializationData.assign(data, data + specialization->dataSize);
+  }
+
+  m_shaderStages.push_back(std::move(stage));
 
   return *this;
 }
 
 VulkanPipelineBuilder VulkanPipelineBuilder::setVertexInputState(vk::ArrayProxy<vk::VertexInputBindingDescription> inputBindingDescArray, vk::ArrayProxy<vk::VertexInputAttributeDescription> attributeDescArray)
 {
-  m_vertexInputInfo.vertexBindingDescriptionCount = inputBindingDescArray.size();
-  m_vertexInputInfo.pVertexBindingDescriptions = inputBindingDescArray.data();
-  m_vertexInputInfo.vertexAttributeDescriptionCount = attributeDescArray.size();
-  m_vertexInputInfo.pVertexAttributeDescriptions = attributeDescArray.data();
+  m_vertexBindings.assign(inputBindingDescArray.begin(), inputBindingDescArray.end());
+  m_vertexAttributes.assign(attributeDescArray.begin(), attributeDescArray.end());
 
   return *this;
 }
@@ -65,6 +74,13 @@ VulkanPipelineBuilder VulkanPipelineBuilder::addScissor(vk::Offset2D offset, vk:
   return *this;
 }
 
+VulkanPipelineBuilder VulkanPipelineBuilder::addDynamicState(vk::DynamicState dynamicState)
+{
+  m_dynamicStates.push_back(dynamicState);
+
+  return *this;
+}
+
 VulkanPipelineBuilder VulkanPipelineBuilder::setRasterizationState(bool depthClampEnable, bool rasterizerDiscardEnable, vk::PolygonMode polygonMode, float lineWidth, vk::CullModeFlagBits cullMode, vk::FrontFace frontFace, bool depthBiasEnable, float depthBiasConstantFactor, float depthBiasClamp, float depthBiasSlopeFactor)
 {
   m_rasterizerStateInfo.depthClampEnable = depthClampEnable;
@@ -101,7 +117,13 @@ VulkanPipelineBuilder VulkanPipelineBuilder::setMultisampleState(bool sampleShad
   m_multisamplingInfo.sampleShadingEnable = sampleShadingEnable;
   m_multisamplingInfo.rasterizationSamples = sampleCount;
   m_multisamplingInfo.minSampleShading = minSampleShading;
-  m_multisamplingInfo.pSampleMask = sampleMask;
+  m_multisamplingInfo.pSampleMask = nullptr;
+  m_sampleMask.clear();
+  if (sampleMask)
+  {
+    auto sampleMaskWordCount = ((uint32_t)sampleCount + 31) / 32;
+    m_sampleMask.assign(sampleMask, sampleMask + sampleMaskWordCount);
+  }
   m_multisamplingInfo.alphaToCoverageEnable = alphaToCoverageEnable;
   m_multisamplingInfo.alphaToOneEnable = alphaToOneEnable;
 
@@ -137,45 +159,226 @@ VulkanPipelineBuilder VulkanPipelineBuilder::setColorBlendingInfo(bool logicOpEn
 
 VulkanPipelineBuilder VulkanPipelineBuilder::setPipelineLayoutInfo(vk::ArrayProxy<vk::DescriptorSetLayout> descriptorSetLayoutArray, vk::ArrayProxy<vk::PushConstantRange> pushConstantArray)
 {
-  m_pipelineLayoutInfo.setLayoutCount = descriptorSetLayoutArray.size();
-  m_pipelineLayoutInfo.pSetLayouts = descriptorSetLayoutArray.data();
-  m_pipelineLayoutInfo.pushConstantRangeCount = pushConstantArray.size();
-  m_pipelineLayoutInfo.pPushConstantRanges = pushConstantArray.data();
+  m_descriptorSetLayouts.assign(descriptorSetLayoutArray.begin(), descriptorSetLayoutArray.end());
+  m_pushConstantRanges.assign(pushConstantArray.begin(), pushConstantArray.end());
 
   return *this;
 }
 
-std::tuple<vk::UniquePipeline, vk::UniquePipelineLayout> VulkanPipelineBuilder::buildGraphicsPipeline(vk::RenderPass& renderPass)
+uint64_t VulkanPipelineBuilder::computeHash() const
 {
-  auto pipelineLayout = m_device.createPipelineLayoutUnique(m_pipelineLayoutInfo);
+  VulkanHasher hasher;
+
+  hasher.add(m_shaderStages.size());
+  for (const auto& stage : m_shaderStages)
+  {
+    hasher.add(stage.m_stage);
+    hasher.add(stage.m_shaderModule->m_codeHash);
+    hasher.addBytes(stage.m_entryName.data(), stage.m_entryName.size());
+
+    hasher.add(stage.m_isSpecialized);
+    for (const auto& entry : stage.m_specializationEntries)
+    {
+      hasher.add(entry.constantID);
+      hasher.add(entry.offset);
+      hasher.add(entry.size);
+    }
+    hasher.addBytes(stage.m_specializationData.data(), stage.m_specializationData.size());
+  }
+
+  hasher.add(m_vertexBindings.size());
+  for (const auto& binding : m_vertexBindings)
+  {
+    hasher.add(binding.binding);
+    hasher.add(binding.stride);
+    hasher.add(binding.inputRate);
+  }
+  hasher.add(m_vertexAttributes.size());
+  for (const auto& attribute : m_vertexAttributes)
+  {
+    hasher.add(attribute.location);
+    hasher.add(attribute.binding);
+    hasher.add(attribute.format);
+    hasher.add(attribute.offset);
+  }
+
+  hasher.add(m_inputAssemblyInfo.topology);
+  hasher.add(m_inputAssemblyInfo.primitiveRestartEnable);
+
+  hasher.add(m_dynamicStates.size());
+  for (auto dynamicState : m_dynamicStates)
+  {
+    hasher.add(dynamicState);
+  }
+
+  // Static viewports and scissors are baked in the pipeline, dynamic ones only count.
+  hasher.add(m_viewports.size());
+  if (!isDynamicState(vk::DynamicState::eViewport))
+  {
+    for (const auto& viewport : m_viewports)
+    {
+      hasher.add(viewport.x);
+      hasher.add(viewport.y);
+      hasher.add(viewport.width);
+      hasher.add(viewport.height);
+      hasher.add(viewport.minDepth);
+      hasher.add(viewport.maxDepth);
+    }
+  }
+  hasher.add(m_scissors.size());
+  if (!isDynamicState(vk::DynamicState::eScissor))
+  {
+    for (const auto& scissor : m_scissors)
+    {
+      hasher.add(scissor.offset.x);
+      hasher.add(scissor.offset.y);
+      hasher.add(scissor.extent.width);
+      hasher.add(scissor.extent.height);
+    }
+  }
+
+  hasher.add(m_rasterizerStateInfo.depthClampEnable);
+  hasher.add(m_rasterizerStateInfo.rasterizerDiscardEnable);
+  hasher.add(m_rasterizerStateInfo.polygonMode);
+  hasher.add(m_rasterizerStateInfo.lineWidth);
+  hasher.add(m_rasterizerStateInfo.cullMode);
+  hasher.add(m_rasterizerStateInfo.frontFace);
+  hasher.add(m_rasterizerStateInfo.depthBiasEnable);
+  hasher.add(m_rasterizerStateInfo.depthBiasConstantFactor);
+  hasher.add(m_rasterizerStateInfo.depthBiasClamp);
+  hasher.add(m_rasterizerStateInfo.depthBiasSlopeFactor);
+
+  hasher.add(m_depthStencilStateInfo.depthTestEnable);
+  hasher.add(m_depthStencilStateInfo.depthWriteEnable);
+  hasher.add(m_depthStencilStateInfo.depthCompareOp);
+  hasher.add(m_depthStencilStateInfo.depthBoundsTestEnable);
+  hasher.add(m_depthStencilStateInfo.minDepthBounds);
+  hasher.add(m_depthStencilStateInfo.maxDepthBounds);
+  hasher.add(m_depthStencilStateInfo.stencilTestEnable);
+  for (const auto& stencilOp : {m_depthStencilStateInfo.front, m_depthStencilStateInfo.back})
+  {
+    hasher.add(stencilOp.failOp);
+    hasher.add(stencilOp.passOp);
+    hasher.add(stencilOp.depthFailOp);
+    hasher.add(stencilOp.compareOp);
+    hasher.add(stencilOp.compareMask);
+    hasher.add(stencilOp.writeMask);
+    hasher.add(stencilOp.reference);
+  }
+
+  hasher.add(m_multisamplingInfo.sampleShadingEnable);
+  hasher.add(m_multisamplingInfo.rasterizationSamples);
+  hasher.add(m_multisamplingInfo.minSampleShading);
+  hasher.add(m_sampleMask.size());
+  hasher.addBytes(m_sampleMask.data(), m_sampleMask.size() * sizeof(vk::SampleMask));
+  hasher.add(m_multisamplingInfo.alphaToCoverageEnable);
+  hasher.add(m_multisamplingInfo.alphaToOneEnable);
+
+  hasher.add(m_colorBlendAttachments.size());
+  for (const auto& attachment : m_colorBlendAttachments)
+  {
+    hasher.add(attachment.colorWriteMask);
+    hasher.add(attachment.blendEnable);
+    hasher.add(attachment.srcColorBlendFactor);
+    hasher.add(attachment.dstColorBlendFactor);
+    hasher.add(attachment.colorBlendOp);
+    hasher.add(attachment.srcAlphaBlendFactor);
+    hasher.add(attachment.dstAlphaBlendFactor);
+    hasher.add(attachment.alphaBlendOp);
+  }
+  hasher.add(m_colorBlendingInfo.logicOpEnable);
+  hasher.add(m_colorBlendingInfo.logicOp);
+  for (auto blendConstant : m_colorBlendingInfo.blendConstants)
+  {
+    hasher.add(blendConstant);
+  }
+
+  hasher.add(m_descriptorSetLayouts.size());
+  for (const auto& descriptorSetLayout : m_descriptorSetLayouts)
+  {
+    hasher.addHandle(descriptorSetLayout);
+  }
+  for (const auto& pushConstantRange : m_pushConstantRanges)
+  {
+    hasher.add(pushConstantRange.stageFlags);
+    hasher.add(pushConstantRange.offset);
+    hasher.add(pushConstantRange.size);
+  }
+
+  return hasher.get();
+}
 
-  m_colorBlendingInfo.attachmentCount = (uint32_t)m_colorBlendAttachments.size();
-  m_colorBlendingInfo.pAttachments = m_colorBlendAttachments.data();
+std::tuple<vk::UniquePipeline, vk::UniquePipelineLayout> VulkanPipelineBuilder::buildGraphicsPipeline(vk::RenderPass renderPass) const
+{
+  // The create infos point into the builder so they are only filled here, a copied builder would otherwise point into the original.
+  vk::PipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.setLayoutCount = (uint32_t)m_descriptorSetLayouts.size();
+  pipelineLayoutInfo.pSetLayouts = m_descriptorSetLayouts.data();
+  pipelineLayoutInfo.pushConstantRangeCount = (uint32_t)m_pushConstantRanges.size();
+  pipelineLayoutInfo.pPushConstantRanges = m_pushConstantRanges.data();
+  auto pipelineLayout = m_device.createPipelineLayoutUnique(pipelineLayoutInfo);
+
+  std::vector<vk::SpecializationInfo> specializationInfos(m_shaderStages.size());
+  std::vector<vk::PipelineShaderStageCreateInfo> shaderStageInfos(m_shaderStages.size());
+  for (size_t i = 0; i < m_shaderStages.size(); i++)
+  {
+    const auto& stage = m_shaderStages[i];
+    specializationInfos[i].mapEntryCount = (uint32_t)stage.m_specializationEntries.size();
+    specializationInfos[i].pMapEntries = stage.m_specializationEntries.data();
+    specializationInfos[i].dataSize = stage.m_specializationData.size();
+    specializationInfos[i].pData = stage.m_specializationData.data();
+
+    shaderStageInfos[i].stage = stage.m_stage;
+    shaderStageInfos[i].module = stage.m_shaderModule->m_module.get();
+    shaderStageInfos[i].pName = stage.m_entryName.c_str();
+    shaderStageInfos[i].pSpecializationInfo = stage.m_isSpecialized ? &specializationInfos[i] : nullptr;
+  }
+
+  vk::PipelineVertexInputStateCreateInfo vertexInputInfo{};
+  vertexInputInfo.vertexBindingDescriptionCount = (uint32_t)m_vertexBindings.size();
+  vertexInputInfo.pVertexBindingDescriptions = m_vertexBindings.data();
+  vertexInputInfo.vertexAttributeDescriptionCount = (uint32_t)m_vertexAttributes.size();
+  vertexInputInfo.pVertexAttributeDescriptions = m_vertexAttributes.data();
+
+  auto multisamplingInfo = m_multisamplingInfo;
+  multisamplingInfo.pSampleMask = m_sampleMask.empty() ? nullptr : m_sampleMask.data();
+
+  auto colorBlendingInfo = m_colorBlendingInfo;
+  colorBlendingInfo.attachmentCount = (uint32_t)m_colorBlendAttachments.size();
+  colorBlendingInfo.pAttachments = m_colorBlendAttachments.data();
+
+  // Dynamic viewports and scissors still need a count, their values are ignored.
+  auto isViewportDynamic = isDynamicState(vk::DynamicState::eViewport);
+  auto isScissorDynamic = isDynamicState(vk::DynamicState::eScissor);
 
   vk::PipelineViewportStateCreateInfo viewportStateInfo{};
-  viewportStateInfo.viewportCount = (uint32_t)m_viewports.size();
-  viewportStateInfo.pViewports = m_viewports.data();
-  viewportStateInfo.scissorCount = (uint32_t)m_scissors.size();
-  viewportStateInfo.pScissors = m_scissors.data();
+  viewportStateInfo.viewportCount = isViewportDynamic ? std::max((uint32_t)m_viewports.size(), 1u) : (uint32_t)m_viewports.size();
+  viewportStateInfo.pViewports = isViewportDynamic ? nullptr : m_viewports.data();
+  viewportStateInfo.scissorCount = isScissorDynamic ? std::max((uint32_t)m_scissors.size(), 1u) : (uint32_t)m_scissors.size();
+  viewportStateInfo.pScissors = isScissorDynamic ? nullptr : m_scissors.data();
+
+  vk::PipelineDynamicStateCreateInfo dynamicStateInfo{};
+  dynamicStateInfo.dynamicStateCount = (uint32_t)m_dynamicStates.size();
+  dynamicStateInfo.pDynamicStates = m_dynamicStates.data();
 
   vk::GraphicsPipelineCreateInfo gfxPipelineInfo{};
-  gfxPipelineInfo.stageCount = (uint32_t)m_shaderStages.size();
-  gfxPipelineInfo.pStages = m_shaderStages.data();
-  gfxPipelineInfo.pVertexInputState = &m_vertexInputInfo;
+  gfxPipelineInfo.stageCount = (uint32_t)shaderStageInfos.size();
+  gfxPipelineInfo.pStages = shaderStageInfos.data();
+  gfxPipelineInfo.pVertexInputState = &vertexInputInfo;
   gfxPipelineInfo.pInputAssemblyState = &m_inputAssemblyInfo;
   gfxPipelineInfo.pViewportState = &viewportStateInfo;
   gfxPipelineInfo.pRasterizationState = &m_rasterizerStateInfo;
-  gfxPipelineInfo.pMultisampleState = &m_multisamplingInfo;
-  gfxPipelineInfo.pColorBlendState = &m_colorBlendingInfo;
+  gfxPipelineInfo.pMultisampleState = &multisamplingInfo;
+  gfxPipelineInfo.pColorBlendState = &colorBlendingInfo;
   gfxPipelineInfo.pDepthStencilState = &m_depthStencilStateInfo;
-  gfxPipelineInfo.pDynamicState = nullptr;
+  gfxPipelineInfo.pDynamicState = m_dynamicStates.empty() ? nullptr : &dynamicStateInfo;
   gfxPipelineInfo.layout = pipelineLayout.get();
   gfxPipelineInfo.renderPass = renderPass;
   gfxPipelineInfo.subpass = 0;
   gfxPipelineInfo.basePipelineHandle = nullptr;
   gfxPipelineInfo.basePipelineIndex = -1;
 
-  auto pipeline = m_device.createGraphicsPipelineUnique(nullptr, gfxPipelineInfo);
+  auto pipeline = m_device.createGraphicsPipelineUnique(m_pipelineCache, gfxPipelineInfo);
 
   return std::make_tuple(std::move(pipeline), std::move(pipelineLayout));
 }
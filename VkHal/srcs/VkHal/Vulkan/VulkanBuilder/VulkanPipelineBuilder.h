@@ -1,20 +1,32 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include <vulkan/vulkan.hpp>
 
 namespace VkHal
 {
+/** @brief Shader module with the hash of its SPIR-V. Pipelines are identified by the code they run rather than by module handle. */
+struct VulkanShaderModule
+{
+  vk::UniqueShaderModule m_module;
+  uint64_t m_codeHash = 0;
+};
+
+/** @brief Owns a copy of everything it is given, shader modules included, so a builder can be handed to another thread and built there. */
 class VulkanPipelineBuilder
 {
 public:
   static constexpr vk::ColorComponentFlags colorWriteMaskAll = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
 
-  VulkanPipelineBuilder(const vk::Device& device);
+  VulkanPipelineBuilder(const vk::Device& device, vk::PipelineCache pipelineCache);
   ~VulkanPipelineBuilder() = default;
 
-  VulkanPipelineBuilder addShaderStage(vk::ShaderStageFlagBits shaderStage, const vk::ShaderModule& shaderModule, const char* entryName, vk::SpecializationInfo* specialization = nullptr);
+  VulkanPipelineBuilder addShaderStage(vk::ShaderStageFlagBits shaderStage, std::shared_ptr<const VulkanShaderModule> shaderModule, const char* entryName, const vk::SpecializationInfo* specialization = nullptr);
 
   VulkanPipelineBuilder setVertexInputState(vk::ArrayProxy<vk::VertexInputBindingDescription> inputBindingDescArray, vk::ArrayProxy<vk::VertexInputAttributeDescription> attributeDescArray);
   VulkanPipelineBuilder setInputAssemblyState(vk::PrimitiveTopology topology, bool primitiveRestartEnable);
@@ -22,6 +34,9 @@ public:
   VulkanPipelineBuilder addViewport(vk::Offset2D offset, vk::Extent2D extent, float minDepth, float maxDepth); // should the offset and extent actually be floats?
   VulkanPipelineBuilder addScissor(vk::Offset2D offset, vk::Extent2D extent);
 
+  /** @brief With eViewport or eScissor dynamic, addViewport/addScissor are optional and the command buffer sets them before drawing. */
+  VulkanPipelineBuilder addDynamicState(vk::DynamicState dynamicState);
+
   VulkanPipelineBuilder setRasterizationState(bool depthClampEnable, bool rasterizerDiscardEnable, vk::PolygonMode polygonMode, float lineWidth, vk::CullModeFlagBits cullMode, vk::FrontFace frontFace, bool depthBiasEnable, float depthBiasConstantFactor, float depthBiasClamp, float depthBiasSlopeFactor);
   VulkanPipelineBuilder setDepthStencilState(bool depthTestEnable, bool depthWriteEnable, vk::CompareOp compareOp, bool depthBoundsTestEnable, float minDepthBounds, float maxDepthBounds, bool stencilTestEnable, vk::StencilOpState front, vk::StencilOpState back);
   VulkanPipelineBuilder setMultisampleState(bool sampleShadingEnable, vk::SampleCountFlagBits sampleCount, float minSampleShading, const vk::SampleMask* sampleMask, bool alphaToCoverageEnable, bool alphaToOneEnable);
@@ -31,22 +46,43 @@ public:
 
   VulkanPipelineBuilder setPipelineLayoutInfo(vk::ArrayProxy<vk::DescriptorSetLayout> descriptorSetLayoutArray, vk::ArrayProxy<vk::PushConstantRange> pushConstantArray);
 
-  std::tuple<vk::UniquePipeline, vk::UniquePipelineLayout> buildGraphicsPipeline(vk::RenderPass& renderPass);
+  /** @brief Hash of the whole description: shaders, specialization constants, fixed function state and pipeline layout. The render pass is not part of it. */
+  uint64_t computeHash() const;
+
+  std::tuple<vk::UniquePipeline, vk::UniquePipelineLayout> buildGraphicsPipeline(vk::RenderPass renderPass) const;
 
 private:
+  struct ShaderStage
+  {
+    vk::ShaderStageFlagBits m_stage = {};
+    std::shared_ptr<const VulkanShaderModule> m_shaderModule;
+    std::string m_entryName;
+    bool m_isSpecialized = false;
+    std::vector<vk::SpecializationMapEntry> m_specializationEntries;
+    std::vector<uint8_t> m_specializationData;
+  };
+
+  bool isDynamicState(vk::DynamicState dynamicState) const
+  {
+    return std::find(m_dynamicStates.begin(), m_dynamicStates.end(), dynamicState) != m_dynamicStates.end();
+  }
+
   const vk::Device& m_device;
+  vk::PipelineCache m_pipelineCache;
 
   // Programmable part of the pipeline
-  std::vector<vk::PipelineShaderStageCreateInfo> m_shaderStages;
+  std::vector<ShaderStage> m_shaderStages;
 
   // Fixed-function part of the pipeline
-  vk::PipelineVertexInputStateCreateInfo m_vertexInputInfo = {};
+  std::vector<vk::VertexInputBindingDescription> m_vertexBindings;
+  std::vector<vk::VertexInputAttributeDescription> m_vertexAttributes;
   vk::PipelineInputAssemblyStateCreateInfo m_inputAssemblyInfo = {};
 
   vk::PipelineRasterizationStateCreateInfo m_rasterizerStateInfo = {};
   vk::PipelineDepthStencilStateCreateInfo m_depthStencilStateInfo = {};
 
   vk::PipelineMultisampleStateCreateInfo m_multisamplingInfo = {};
+  std::vector<vk::SampleMask> m_sampleMask;
 
   std::vector<vk::PipelineColorBlendAttachmentState> m_colorBlendAttachments;
   vk::PipelineColorBlendStateCreateInfo m_colorBlendingInfo = {};
@@ -54,7 +90,10 @@ private:
   std::vector<vk::Viewport> m_viewports;
   std::vector<vk::Rect2D> m_scissors;
 
-  vk::PipelineLayoutCreateInfo m_pipelineLayoutInfo = {};
+  std::vector<vk::DynamicState> m_dynamicStates;
+
+  std::vector<vk::DescriptorSetLayout> m_descriptorSetLayouts;
+  std::vector<vk::PushConstantRange> m_pushConstantRanges;
 };
 
 } // namespace VkHal
@@ -2,10 +2,14 @@
 
 #include <string>
 
+#include "VkHal/Vulkan/VulkanHash.h"
+
 using namespace std::literals::string_literals;
 
 namespace VkHal
 {
+constexpr uint32_t c_pipelineCompileThreadCount = 2; // Pipelines compile in the background, more threads would compete with the recording workers.
+
 vk::SurfaceFormatKHR selectSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& surfaceFormats)
 {
   if (surfaceFormats.size() == 1 && surfaceFormats[0].format == vk::Format::eUndefined)
@@ -54,7 +58,7 @@ vk::Extent2D selectSurfaceExtend(const vk::SurfaceCapabilitiesKHR& surfaceCapabi
   return surfaceExtend;
 }
 
-VulkanDevice::VulkanDevice(vk::PhysicalDevice physicalDevice, vk::PhysicalDeviceFeatures enabledFeatures, bool isHeadless, QueueFamilyIndices queueFamilyIndices)
+VulkanDevice::VulkanDevice(vk::PhysicalDevice physicalDevice, vk::PhysicalDeviceFeatures enabledFeatures, bool isHeadless, QueueFamilyIndices queueFamilyIndices, const std::filesystem::path& pipelineCachePath)
     : m_physicalDevice(physicalDevice)
     , m_queueFamilyIndices(queueFamilyIndices)
     , m_physicalDeviceMemoryProperties(m_physicalDevice.getMemoryProperties())
@@ -90,6 +94,10 @@ VulkanDevice::VulkanDevice(vk::PhysicalDevice physicalDevice, vk::PhysicalDevice
   deviceCreateInfo.ppEnabledExtensionNames = VulkanDevice::m_extensionName.data();
 
   m_device = m_physicalDevice.createDeviceUnique(deviceCreateInfo);
+  m_memoryAllocator = std::make_unique<VulkanMemoryAllocator>(m_device.get(), m_physicalDevice);
+  m_pipelineCache = std::make_unique<VulkanPipelineCache>(m_device.get(), m_physicalDevice.getProperties(), pipelineCachePath);
+  m_pipelineRegistry = std::make_unique<VulkanPipelineRegistry>(c_pipelineCompileThreadCount);
+  m_timeline = std::make_unique<VulkanTimeline>(m_device.get());
 }
 
 void VulkanDevice::initDebugExtention()
@@ -173,10 +181,10 @@ std::unique_ptr<VulkanImage> VulkanDevice::createImage(vk::Extent2D extent, uint
   auto [image, imageMemory] = createImage(extent, mipLevels, format, tiling, usage, properties);
   auto imageView = createImageView(*image, format, imgAspectflags, mipLevels);
 
-  return std::make_unique<VulkanImage>(std::move(imageMemory), std::move(image), std::move(imageView), format, mipLevels);
+  return std::make_unique<VulkanImage>(std::move(imageMemory), std::move(image), std::move(imageView), format, extent, mipLevels);
 }
 
-std::tuple<vk::UniqueImage, vk::UniqueDeviceMemory> VulkanDevice::createImage(vk::Extent2D extent, uint32_t mipLevels, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties) const
+std::tuple<vk::UniqueImage, VulkanAllocation> VulkanDevice::createImage(vk::Extent2D extent, uint32_t mipLevels, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties) const
 {
   vk::ImageCreateInfo imgCreateInfo{};
   imgCreateInfo.imageType = vk::ImageType::e2D;
@@ -196,12 +204,9 @@ std::tuple<vk::UniqueImage, vk::UniqueDeviceMemory> VulkanDevice::createImage(vk
 
   vk::MemoryRequirements memRequirements = m_device->getImageMemoryRequirements(image.get());
 
-  vk::MemoryAllocateInfo allocInfo = {};
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = selectMemoryType(memRequirements.memoryTypeBits, properties);
-
-  auto memory = m_device->allocateMemoryUnique(allocInfo);
-  m_device->bindImageMemory(image.get(), memory.get(), 0);
+  auto resourceKind = tiling == vk::ImageTiling::eOptimal ? VulkanResourceKind::Optimal : VulkanResourceKind::Linear;
+  auto memory = m_memoryAllocator->allocate(memRequirements, selectMemoryType(memRequirements.memoryTypeBits, properties), resourceKind);
+  m_device->bindImageMemory(image.get(), memory.getMemory(), memory.getOffset());
 
   return std::make_tuple(std::move(image), std::move(memory));
 }
@@ -234,31 +239,35 @@ vk::UniqueFramebuffer VulkanDevice::createFramebuffer(vk::Extent2D extent, const
   return m_device->createFramebufferUnique(frameBufferCreateInfo);
 }
 
-std::tuple<vk::UniqueBuffer, vk::UniqueDeviceMemory> VulkanDevice::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags memoryProperties) const
+std::tuple<vk::UniqueBuffer, VulkanAllocation> VulkanDevice::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags memoryProperties) const
 {
-  std::array<QueueFamilyIndex, 2> queueFamilyIndices = {m_queueFamilyIndices.transfer, m_queueFamilyIndices.graphics};
   vk::BufferCreateInfo bufferInfo = {};
   bufferInfo.size = size;
   bufferInfo.usage = usage;
-  bufferInfo.sharingMode = vk::SharingMode::eConcurrent; // for staging buffer this could be exclusive and transfer the ownership of the buffer with a memory barrier since with a staging buffer, the buffer wouldn't be used by 2 queue at the same time
-  bufferInfo.pQueueFamilyIndices = queueFamilyIndices.data();
-  bufferInfo.queueFamilyIndexCount = (uint32_t)queueFamilyIndices.size();
+  bufferInfo.sharingMode = vk::SharingMode::eExclusive; // buffers written on the transfer queue are handed to the graphics queue with an ownership transfer, see VulkanUploadManager
 
   auto buffer = m_device->createBufferUnique(bufferInfo);
 
   auto memoryRequirements = m_device->getBufferMemoryRequirements(buffer.get());
 
-  vk::MemoryAllocateInfo memoryAllocateInfo = {};
-  memoryAllocateInfo.allocationSize = memoryRequirements.size;
-  memoryAllocateInfo.memoryTypeIndex = selectMemoryType(memoryRequirements.memoryTypeBits, memoryProperties);
+  auto memory = m_memoryAllocator->allocate(memoryRequirements, selectMemoryType(memoryRequirements.memoryTypeBits, memoryProperties), VulkanResourceKind::Linear);
 
-  auto memory = m_device->allocateMemoryUnique(memoryAllocateInfo);
-
-  m_device->bindBufferMemory(buffer.get(), memory.get(), 0);
+  m_device->bindBufferMemory(buffer.get(), memory.getMemory(), memory.getOffset());
 
   return std::make_tuple(std::move(buffer), std::move(memory));
 }
 
+std::unique_ptr<VulkanUniformRing> VulkanDevice::createUniformRing(vk::DeviceSize frameSize, uint32_t frameCount) const
+{
+  // Every frame region has to start on a valid dynamic offset.
+  auto alignment = m_physicalDevice.getProperties().limits.minUniformBufferOffsetAlignment;
+  frameSize = (frameSize + alignment - 1) & ~(alignment - 1);
+
+  auto [buffer, memory] = createBuffer(frameSize * frameCount, vk::BufferUsageFlagBits::eUniformBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+
+  return std::make_unique<VulkanUniformRing>(std::move(buffer), std::move(memory), frameSize, frameCount, alignment);
+}
+
 vk::UniqueSemaphore VulkanDevice::createSemaphore() const
 {
   vk::SemaphoreCreateInfo semaphoreCreateInfo{};
@@ -291,13 +300,16 @@ std::vector<vk::UniqueCommandBuffer> VulkanDevice::allocateCommandBuffer(vk::Com
   return m_device->allocateCommandBuffersUnique(cmdBufferAllocateInfo);
 }
 
-vk::UniqueShaderModule VulkanDevice::createShaderModule(const std::vector<char>& code) const
+std::shared_ptr<VulkanShaderModule> VulkanDevice::createShaderModule(const std::vector<char>& code) const
 {
   vk::ShaderModuleCreateInfo shaderModuleCreateInfo{};
   shaderModuleCreateInfo.codeSize = code.size();
   shaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
 
-  return m_device->createShaderModuleUnique(shaderModuleCreateInfo);
+  auto shaderModule = std::make_shared<VulkanShaderModule>();
+  shaderModule->m_module = m_device->createShaderModuleUnique(shaderModuleCreateInfo);
+  shaderModule->m_codeHash = hashBytes(code.data(), code.size());
+  return shaderModule;
 }
 
 void VulkanDevice::resetCommandPool(vk::CommandPool cmdPool) const
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <filesystem>
+#include <memory>
 #include <set>
 #include <string>
 #include <tuple>
@@ -11,7 +13,12 @@
 #include "VkHal/Vulkan/VulkanBuilder/VulkanDescriptorSetLayoutBuilder.h"
 #include "VkHal/Vulkan/VulkanBuilder/VulkanPipelineBuilder.h"
 #include "VkHal/Vulkan/VulkanImage.h"
+#include "VkHal/Vulkan/VulkanMemoryAllocator.h"
+#include "VkHal/Vulkan/VulkanPipelineCache.h"
+#include "VkHal/Vulkan/VulkanPipelineRegistry.h"
 #include "VkHal/Vulkan/VulkanSwapchain.h"
+#include "VkHal/Vulkan/VulkanTimeline.h"
+#include "VkHal/Vulkan/VulkanUniformRing.h"
 #include "VkHal/Vulkan/VulkanUtils.h"
 
 namespace VkHal
@@ -41,7 +48,7 @@ class VulkanDevice
 public:
   static constexpr std::array<const char*, 1> m_extensionName = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
-  VulkanDevice(vk::PhysicalDevice physicalDevice, vk::PhysicalDeviceFeatures enabledFeatures, bool isHeadless, QueueFamilyIndices queueFamilyIndices);
+  VulkanDevice(vk::PhysicalDevice physicalDevice, vk::PhysicalDeviceFeatures enabledFeatures, bool isHeadless, QueueFamilyIndices queueFamilyIndices, const std::filesystem::path& pipelineCachePath);
   ~VulkanDevice() = default;
 
   void initDebugExtention();
@@ -72,7 +79,7 @@ public:
 
   auto getPipelineBuilder() const
   {
-    return VulkanPipelineBuilder{m_device.get()};
+    return VulkanPipelineBuilder{m_device.get(), m_pipelineCache->getCache()};
   }
 
   auto getDescriptorSetLayoutBuilder() const
@@ -91,19 +98,41 @@ public:
   }
 
   std::unique_ptr<VulkanImage> createImage(vk::Extent2D extent, uint32_t mipLevels, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, vk::ImageAspectFlags imgAspectflags) const;
-  std::tuple<vk::UniqueImage, vk::UniqueDeviceMemory> createImage(vk::Extent2D extent, uint32_t mipLevels, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties) const;
+  std::tuple<vk::UniqueImage, VulkanAllocation> createImage(vk::Extent2D extent, uint32_t mipLevels, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties) const;
   vk::UniqueImageView createImageView(vk::Image image, vk::Format format, vk::ImageAspectFlags aspectFlags, uint32_t mipLevels) const;
 
   vk::UniqueFramebuffer createFramebuffer(vk::Extent2D extent, const vk::RenderPass& renderPass, vk::ArrayProxy<const vk::ImageView> attachments) const;
 
-  std::tuple<vk::UniqueBuffer, vk::UniqueDeviceMemory> createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags memoryProperties) const;
+  std::tuple<vk::UniqueBuffer, VulkanAllocation> createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags memoryProperties) const;
+
+  std::unique_ptr<VulkanUniformRing> createUniformRing(vk::DeviceSize frameSize, uint32_t frameCount) const;
+
+  VulkanMemoryStats getMemoryStats() const
+  {
+    return m_memoryAllocator->getStats();
+  }
+
+  VulkanPipelineCache& getPipelineCache() const
+  {
+    return *m_pipelineCache;
+  }
+
+  VulkanPipelineRegistry& getPipelineRegistry() const
+  {
+    return *m_pipelineRegistry;
+  }
+
+  VulkanTimeline& getTimeline() const
+  {
+    return *m_timeline;
+  }
 
   vk::UniqueSemaphore createSemaphore() const;
   vk::UniqueFence createFence(bool createSignaled) const;
   vk::UniqueCommandPool createCommandPool(QueueFamilyIndex queueFamilyIndx, vk::CommandPoolCreateFlags cmdPoolFlags) const;
   std::vector<vk::UniqueCommandBuffer> allocateCommandBuffer(vk::CommandPool& cmdPool, uint32_t count, bool isPrimary) const;
 
-  vk::UniqueShaderModule createShaderModule(const std::vector<char>& code) const;
+  std::shared_ptr<VulkanShaderModule> createShaderModule(const std::vector<char>& code) const;
 
   void resetCommandPool(vk::CommandPool cmdPool) const;
 
@@ -129,6 +158,18 @@ private:
 
   /** @brief The index of the QueueFamily.*/
   QueueFamilyIndices m_queueFamilyIndices;
+
+  /** @brief Sub-allocates buffers and images from large memory blocks. Declared after the device so it is destroyed first. */
+  std::unique_ptr<VulkanMemoryAllocator> m_memoryAllocator;
+
+  /** @brief Shared by every pipeline created on the device. */
+  std::unique_ptr<VulkanPipelineCache> m_pipelineCache;
+
+  /** @brief Owns every pipeline created through it, identical descriptions share one pipeline. */
+  std::unique_ptr<VulkanPipelineRegistry> m_pipelineRegistry;
+
+  /** @brief Tracks every queue submission. Declared after the allocator so retired objects give their memory back before it is destroyed. */
+  std::unique_ptr<VulkanTimeline> m_timeline;
 };
 
 template <typename VkHandle_t>
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include <vulkan/vulkan.hpp>
+
+namespace VkHal
+{
+/** @brief 64-bit FNV-1a. Values are hashed field by field so padding and pNext pointers never reach the hash. */
+class VulkanHasher
+{
+public:
+  void addBytes(const void* data, size_t size)
+  {
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+      m_hash ^= bytes[i];
+      m_hash *= c_prime;
+    }
+  }
+
+  template <typename Value_t>
+  void add(const Value_t& value)
+  {
+    static_assert(std::is_arithmetic_v<Value_t> || std::is_enum_v<Value_t>, "Hash aggregates field by field.");
+    addBytes(&value, sizeof(value));
+  }
+
+  template <typename FlagBits_t>
+  void add(const vk::Flags<FlagBits_t>& flags)
+  {
+    add(static_cast<VkFlags>(flags));
+  }
+
+  /** @brief Hashes the handle value. Only meaningful while the object is alive. */
+  template <typename Handle_t>
+  void addHandle(const Handle_t& handle)
+  {
+    addBytes(&handle, sizeof(handle));
+  }
+
+  uint64_t get() const
+  {
+    return m_hash;
+  }
+
+private:
+  static constexpr uint64_t c_offsetBasis = 14695981039346656037ull;
+  static constexpr uint64_t c_prime = 1099511628211ull;
+
+  uint64_t m_hash = c_offsetBasis;
+};
+
+inline uint64_t hashBytes(const void* data, size_t size)
+{
+  VulkanHasher hasher;
+  hasher.addBytes(data, size);
+  return hasher.get();
+}
+} // namespace VkHal
@@ -2,12 +2,14 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include "VkHal/Vulkan/VulkanMemoryAllocator.h"
+
 namespace VkHal
 {
 class VulkanImage
 {
 public:
-  VulkanImage(vk::UniqueDeviceMemory&& imgMemory, vk::UniqueImage&& img, vk::UniqueImageView&& imgView, vk::Format format, uint32_t mipCount);
+  VulkanImage(VulkanAllocation&& imgMemory, vk::UniqueImage&& img, vk::UniqueImageView&& imgView, vk::Format format, vk::Extent2D extent, uint32_t mipCount);
   ~VulkanImage() = default;
 
   const vk::ImageView& getImageView() const
@@ -25,17 +27,23 @@ public:
     return m_format;
   }
 
-  uint32_t getMipCount()
+  vk::Extent2D getExtent() const
+  {
+    return m_extent;
+  }
+
+  uint32_t getMipCount() const
   {
     return m_mipCount;
   }
 
 private:
-  vk::UniqueDeviceMemory m_imageMemory;
+  VulkanAllocation m_imageMemory;
   vk::UniqueImage m_image;
   vk::UniqueImageView m_imageView;
 
   vk::Format m_format;
+  vk::Extent2D m_extent;
   uint32_t m_mipCount;
 };
 } // namespace VkHal
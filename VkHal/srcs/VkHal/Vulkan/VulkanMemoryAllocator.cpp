@@ -0,0 +1,545 @@
+#include "VulkanMemoryAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace VkHal
+{
+namespace
+{
+constexpr vk::DeviceSize c_largeHeapSize = 1024ull * 1024 * 1024;
+constexpr vk::DeviceSize c_largeHeapBlockSize = 256ull * 1024 * 1024;
+
+uint32_t findLowestBit(uint64_t mask)
+{
+#ifdef _MSC_VER
+  unsigned long index{};
+  _BitScanForward64(&index, mask);
+  return (uint32_t)index;
+#else
+  return (uint32_t)__builtin_ctzll(mask);
+#endif
+}
+
+uint32_t findHighestBit(uint64_t mask)
+{
+#ifdef _MSC_VER
+  unsigned long index{};
+  _BitScanReverse64(&index, mask);
+  return (uint32_t)index;
+#else
+  return 63 - (uint32_t)__builtin_clzll(mask);
+#endif
+}
+
+vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+{
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+} // namespace
+
+TlsfRangeAllocator::TlsfRangeAllocator(vk::DeviceSize size)
+    : m_size{size}
+{
+  for (auto& secondLevelLists : m_freeLists)
+  {
+    secondLevelLists.fill(c_nullIndex);
+  }
+
+  // Range 0 always stays the physical head of the block, merges only ever release the right hand side range.
+  auto rangeIndex = createRange(0, size);
+  insertFreeRange(rangeIndex);
+}
+
+std::tuple<uint32_t, uint32_t> TlsfRangeAllocator::mappingInsert(vk::DeviceSize size)
+{
+  if (size < c_smallRangeSize)
+  {
+    return {0, (uint32_t)(size / (c_smallRangeSize / c_secondLevelCount))};
+  }
+
+  auto highestBit = findHighestBit(size);
+  auto firstLevel = highestBit - (findHighestBit(c_smallRangeSize) - 1);
+  auto secondLevel = (uint32_t)(size >> (highestBit - c_secondLevelCountLog2)) ^ c_secondLevelCount;
+
+  return {firstLevel, secondLevel};
+}
+
+std::tuple<uint32_t, uint32_t> TlsfRangeAllocator::mappingSearch(vk::DeviceSize size)
+{
+  // Round up to the next bucket so any range found in it is guaranteed to be big enough.
+  if (size < c_smallRangeSize)
+  {
+    size += (c_smallRangeSize / c_secondLevelCount) - 1;
+  }
+  else
+  {
+    size += (1ull << (findHighestBit(size) - c_secondLevelCountLog2)) - 1;
+  }
+
+  return mappingInsert(size);
+}
+
+uint32_t TlsfRangeAllocator::createRange(vk::DeviceSize offset, vk::DeviceSize size)
+{
+  uint32_t rangeIndex{};
+  if (!m_unusedRangeIndices.empty())
+  {
+    rangeIndex = m_unusedRangeIndices.back();
+    m_unusedRangeIndices.pop_back();
+    m_ranges[rangeIndex] = Range{};
+  }
+  else
+  {
+    rangeIndex = (uint32_t)m_ranges.size();
+    m_ranges.emplace_back();
+  }
+
+  m_ranges[rangeIndex].offset = offset;
+  m_ranges[rangeIndex].size = size;
+
+  return rangeIndex;
+}
+
+void TlsfRangeAllocator::releaseRange(uint32_t rangeIndex)
+{
+  m_unusedRangeIndices.push_back(rangeIndex);
+}
+
+uint32_t TlsfRangeAllocator::findFreeRange(vk::DeviceSize size) const
+{
+  auto [firstLevel, secondLevel] = mappingSearch(size);
+  if (firstLevel >= c_firstLevelCount)
+  {
+    return c_nullIndex;
+  }
+
+  uint32_t secondLevelMap = m_secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+  if (!secondLevelMap)
+  {
+    uint64_t firstLevelMap = firstLevel + 1 < 64 ? m_firstLevelBitmap & (~0ull << (firstLevel + 1)) : 0;
+    if (!firstLevelMap)
+    {
+      return c_nullIndex;
+    }
+
+    firstLevel = findLowestBit(firstLevelMap);
+    secondLevelMap = m_secondLevelBitmaps[firstLevel];
+  }
+
+  secondLevel = findLowestBit(secondLevelMap);
+  return m_freeLists[firstLevel][secondLevel];
+}
+
+void TlsfRangeAllocator::insertFreeRange(uint32_t rangeIndex)
+{
+  auto [firstLevel, secondLevel] = mappingInsert(m_ranges[rangeIndex].size);
+  auto& head = m_freeLists[firstLevel][secondLevel];
+
+  auto& range = m_ranges[rangeIndex];
+  range.isFree = true;
+  range.prevFree = c_nullIndex;
+  range.nextFree = head;
+  if (head != c_nullIndex)
+  {
+    m_ranges[head].prevFree = rangeIndex;
+  }
+  head = rangeIndex;
+
+  m_firstLevelBitmap |= 1ull << firstLevel;
+  m_secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+}
+
+void TlsfRangeAllocator::removeFreeRange(uint32_t rangeIndex)
+{
+  auto [firstLevel, secondLevel] = mappingInsert(m_ranges[rangeIndex].size);
+  auto& range = m_ranges[rangeIndex];
+
+  if (range.prevFree != c_nullIndex)
+  {
+    m_ranges[range.prevFree].nextFree = range.nextFree;
+  }
+  else
+  {
+    m_freeLists[firstLevel][secondLevel] = range.nextFree;
+  }
+
+  if (range.nextFree != c_nullIndex)
+  {
+    m_ranges[range.nextFree].prevFree = range.prevFree;
+  }
+
+  if (m_freeLists[firstLevel][secondLevel] == c_nullIndex)
+  {
+    m_secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+    if (!m_secondLevelBitmaps[firstLevel])
+    {
+      m_firstLevelBitmap &= ~(1ull << firstLevel);
+    }
+  }
+
+  range.isFree = false;
+  range.prevFree = c_nullIndex;
+  range.nextFree = c_nullIndex;
+}
+
+uint32_t TlsfRangeAllocator::splitRange(uint32_t rangeIndex, vk::DeviceSize splitOffset)
+{
+  auto rangeEnd = m_ranges[rangeIndex].offset + m_ranges[rangeIndex].size;
+  auto newRangeIndex = createRange(splitOffset, rangeEnd - splitOffset);
+
+  auto& range = m_ranges[rangeIndex];
+  auto& newRange = m_ranges[newRangeIndex];
+  range.size = splitOffset - range.offset;
+
+  newRange.prevPhysical = rangeIndex;
+  newRange.nextPhysical = range.nextPhysical;
+  if (range.nextPhysical != c_nullIndex)
+  {
+    m_ranges[range.nextPhysical].prevPhysical = newRangeIndex;
+  }
+  range.nextPhysical = newRangeIndex;
+
+  return newRangeIndex;
+}
+
+void TlsfRangeAllocator::mergeWithNext(uint32_t rangeIndex)
+{
+  auto& range = m_ranges[rangeIndex];
+  auto nextIndex = range.nextPhysical;
+  const auto& next = m_ranges[nextIndex];
+
+  range.size += next.size;
+  range.nextPhysical = next.nextPhysical;
+  if (next.nextPhysical != c_nullIndex)
+  {
+    m_ranges[next.nextPhysical].prevPhysical = rangeIndex;
+  }
+
+  releaseRange(nextIndex);
+}
+
+std::optional<std::tuple<uint32_t, vk::DeviceSize>> TlsfRangeAllocator::allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+  alignment = std::max<vk::DeviceSize>(alignment, 1);
+
+  // Searching for size + alignment - 1 guarantees the aligned allocation fits in whatever range is returned.
+  auto rangeIndex = findFreeRange(size + alignment - 1);
+
+  // The bucket rounding can miss a range that fits exactly, like a dedicated block. Give the head range a chance.
+  if (rangeIndex == c_nullIndex && m_ranges[0].isFree && m_ranges[0].size >= size)
+  {
+    rangeIndex = 0;
+  }
+
+  if (rangeIndex == c_nullIndex)
+  {
+    return std::nullopt;
+  }
+
+  removeFreeRange(rangeIndex);
+
+  auto alignedOffset = alignUp(m_ranges[rangeIndex].offset, alignment);
+  if (alignedOffset > m_ranges[rangeIndex].offset)
+  {
+    auto alignedRangeIndex = splitRange(rangeIndex, alignedOffset);
+    insertFreeRange(rangeIndex);
+    rangeIndex = alignedRangeIndex;
+  }
+
+  if (m_ranges[rangeIndex].size > size)
+  {
+    auto remainderRangeIndex = splitRange(rangeIndex, alignedOffset + size);
+    insertFreeRange(remainderRangeIndex);
+  }
+
+  m_bytesAllocated += size;
+  m_allocationCount++;
+
+  return std::make_tuple(rangeIndex, alignedOffset);
+}
+
+void TlsfRangeAllocator::free(uint32_t rangeIndex)
+{
+  m_bytesAllocated -= m_ranges[rangeIndex].size;
+  m_allocationCount--;
+
+  auto nextIndex = m_ranges[rangeIndex].nextPhysical;
+  if (nextIndex != c_nullIndex && m_ranges[nextIndex].isFree)
+  {
+    removeFreeRange(nextIndex);
+    mergeWithNext(rangeIndex);
+  }
+
+  auto prevIndex = m_ranges[rangeIndex].prevPhysical;
+  if (prevIndex != c_nullIndex && m_ranges[prevIndex].isFree)
+  {
+    removeFreeRange(prevIndex);
+    mergeWithNext(prevIndex);
+    rangeIndex = prevIndex;
+  }
+
+  insertFreeRange(rangeIndex);
+}
+
+vk::DeviceSize TlsfRangeAllocator::getLargestFreeRange() const
+{
+  if (!m_firstLevelBitmap)
+  {
+    return 0;
+  }
+
+  auto firstLevel = findHighestBit(m_firstLevelBitmap);
+  auto secondLevel = findHighestBit(m_secondLevelBitmaps[firstLevel]);
+
+  vk::DeviceSize largest = 0;
+  for (auto rangeIndex = m_freeLists[firstLevel][secondLevel]; rangeIndex != c_nullIndex; rangeIndex = m_ranges[rangeIndex].nextFree)
+  {
+    largest = std::max(largest, m_ranges[rangeIndex].size);
+  }
+
+  return largest;
+}
+
+VulkanMemoryBlock::VulkanMemoryBlock(vk::UniqueDeviceMemory&& memory, vk::DeviceSize size, void* mappedData, uint32_t poolIndex, bool isDedicated)
+    : m_memory{std::move(memory)}
+    , m_mappedData{mappedData}
+    , m_poolIndex{poolIndex}
+    , m_isDedicated{isDedicated}
+    , m_ranges{size}
+{
+}
+
+VulkanAllocation::VulkanAllocation(VulkanMemoryAllocator* allocator, VulkanMemoryBlock* block, uint32_t rangeIndex, vk::DeviceMemory memory, vk::DeviceSize offset, vk::DeviceSize size, void* mappedData)
+    : m_allocator{allocator}
+    , m_block{block}
+    , m_rangeIndex{rangeIndex}
+    , m_memory{memory}
+    , m_offset{offset}
+    , m_size{size}
+    , m_mappedData{mappedData}
+{
+}
+
+VulkanAllocation::~VulkanAllocation()
+{
+  reset();
+}
+
+VulkanAllocation::VulkanAllocation(VulkanAllocation&& other) noexcept
+{
+  *this = std::move(other);
+}
+
+VulkanAllocation& VulkanAllocation::operator=(VulkanAllocation&& other) noexcept
+{
+  if (this != &other)
+  {
+    reset();
+
+    m_allocator = std::exchange(other.m_allocator, nullptr);
+    m_block = std::exchange(other.m_block, nullptr);
+    m_rangeIndex = std::exchange(other.m_rangeIndex, TlsfRangeAllocator::c_nullIndex);
+    m_memory = std::exchange(other.m_memory, nullptr);
+    m_offset = std::exchange(other.m_offset, 0);
+    m_size = std::exchange(other.m_size, 0);
+    m_mappedData = std::exchange(other.m_mappedData, nullptr);
+  }
+
+  return *this;
+}
+
+void VulkanAllocation::reset()
+{
+  if (m_block)
+  {
+    m_allocator->free(m_block, m_rangeIndex);
+  }
+
+  m_allocator = nullptr;
+  m_block = nullptr;
+  m_rangeIndex = TlsfRangeAllocator::c_nullIndex;
+  m_memory = nullptr;
+  m_offset = 0;
+  m_size = 0;
+  m_mappedData = nullptr;
+}
+
+VulkanMemoryAllocator::VulkanMemoryAllocator(const vk::Device& device, const vk::PhysicalDevice& physicalDevice)
+    : m_device{device}
+    , m_memoryProperties{physicalDevice.getMemoryProperties()}
+{
+  auto limits = physicalDevice.getProperties().limits;
+  m_bufferImageGranularity = limits.bufferImageGranularity;
+  m_maxMemoryAllocationCount = limits.maxMemoryAllocationCount;
+
+  m_pools.resize(m_memoryProperties.memoryTypeCount * (size_t)VulkanResourceKind::Count);
+  for (uint32_t i = 0; i < m_pools.size(); i++)
+  {
+    auto memoryTypeIndex = i / (uint32_t)VulkanResourceKind::Count;
+    auto heapSize = m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+
+    m_pools[i].m_memoryTypeIndex = memoryTypeIndex;
+    m_pools[i].m_preferredBlockSize = heapSize <= c_largeHeapSize ? heapSize / 8 : c_largeHeapBlockSize;
+  }
+}
+
+VulkanMemoryAllocator::~VulkanMemoryAllocator() = default;
+
+VulkanMemoryAllocator::MemoryPool& VulkanMemoryAllocator::getPool(uint32_t memoryTypeIndex, VulkanResourceKind resourceKind)
+{
+  // With a granularity of 1 linear and optimal resources can be neighbours, so they share the same blocks.
+  if (m_bufferImageGranularity <= 1)
+  {
+    resourceKind = VulkanResourceKind::Linear;
+  }
+
+  return m_pools[memoryTypeIndex * (size_t)VulkanResourceKind::Count + (size_t)resourceKind];
+}
+
+VulkanMemoryBlock* VulkanMemoryAllocator::createBlock(MemoryPool& pool, vk::DeviceSize size, bool isDedicated)
+{
+  if (m_memoryAllocationCount >= m_maxMemoryAllocationCount)
+  {
+    throw std::runtime_error("Reached maxMemoryAllocationCount.");
+  }
+
+  vk::MemoryAllocateInfo allocInfo{};
+  allocInfo.allocationSize = size;
+  allocInfo.memoryTypeIndex = pool.m_memoryTypeIndex;
+
+  auto memory = m_device.allocateMemoryUnique(allocInfo);
+
+  void* mappedData = nullptr;
+  if (m_memoryProperties.memoryTypes[pool.m_memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+  {
+    mappedData = m_device.mapMemory(memory.get(), 0, VK_WHOLE_SIZE, vk::MemoryMapFlags{});
+  }
+
+  m_memoryAllocationCount++;
+
+  auto poolIndex = (uint32_t)(&pool - m_pools.data());
+  pool.m_blocks.push_back(std::make_unique<VulkanMemoryBlock>(std::move(memory), size, mappedData, poolIndex, isDedicated));
+
+  return pool.m_blocks.back().get();
+}
+
+VulkanAllocation VulkanMemoryAllocator::allocate(const vk::MemoryRequirements& memRequirements, uint32_t memoryTypeIndex, VulkanResourceKind resourceKind)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto& pool = getPool(memoryTypeIndex, resourceKind);
+
+  auto makeAllocation = [this, &memRequirements](VulkanMemoryBlock* block, uint32_t rangeIndex, vk::DeviceSize offset) {
+    auto mappedData = block->m_mappedData ? static_cast<char*>(block->m_mappedData) + offset : nullptr;
+    return VulkanAllocation{this, block, rangeIndex, block->m_memory.get(), offset, memRequirements.size, mappedData};
+  };
+
+  // Big resources get their own VkDeviceMemory, they would waste most of a block otherwise.
+  if (memRequirements.size > pool.m_preferredBlockSize / 2)
+  {
+    auto block = createBlock(pool, memRequirements.size, true);
+    auto [rangeIndex, offset] = *block->m_ranges.allocate(memRequirements.size, memRequirements.alignment);
+    return makeAllocation(block, rangeIndex, offset);
+  }
+
+  for (auto& block : pool.m_blocks)
+  {
+    if (block->m_isDedicated)
+    {
+      continue;
+    }
+
+    if (auto range = block->m_ranges.allocate(memRequirements.size, memRequirements.alignment))
+    {
+      auto [rangeIndex, offset] = *range;
+      return makeAllocation(block.get(), rangeIndex, offset);
+    }
+  }
+
+  // No room left in the existing blocks, try smaller blocks if the heap is running low.
+  auto blockSize = pool.m_preferredBlockSize;
+  while (true)
+  {
+    try
+    {
+      auto block = createBlock(pool, blockSize, false);
+      auto [rangeIndex, offset] = *block->m_ranges.allocate(memRequirements.size, memRequirements.alignment);
+      return makeAllocation(block, rangeIndex, offset);
+    }
+    catch (const vk::OutOfDeviceMemoryError&)
+    {
+      blockSize /= 2;
+      if (blockSize < memRequirements.size * 2)
+      {
+        throw;
+      }
+    }
+  }
+}
+
+void VulkanMemoryAllocator::free(VulkanMemoryBlock* block, uint32_t rangeIndex)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  block->m_ranges.free(rangeIndex);
+  if (!block->m_ranges.isEmpty())
+  {
+    return;
+  }
+
+  // Keep one empty block around per pool to avoid allocation churn, dedicated blocks are always released.
+  auto& blocks = m_pools[block->m_poolIndex].m_blocks;
+  auto emptyBlockCount = std::count_if(cbegin(blocks), cend(blocks), [](const auto& poolBlock) { return !poolBlock->m_isDedicated && poolBlock->m_ranges.isEmpty(); });
+  if (block->m_isDedicated || emptyBlockCount > 1)
+  {
+    auto it = std::find_if(begin(blocks), end(blocks), [block](const auto& poolBlock) { return poolBlock.get() == block; });
+    blocks.erase(it);
+    m_memoryAllocationCount--;
+  }
+}
+
+void VulkanMemoryAllocator::accumulateStats(const MemoryPool& pool, VulkanMemoryStats& stats) const
+{
+  for (const auto& block : pool.m_blocks)
+  {
+    stats.blockCount++;
+    stats.dedicatedBlockCount += block->m_isDedicated ? 1 : 0;
+    stats.allocationCount += block->m_ranges.getAllocationCount();
+    stats.bytesReserved += block->m_ranges.getSize();
+    stats.bytesAllocated += block->m_ranges.getBytesAllocated();
+    stats.largestFreeRange = std::max(stats.largestFreeRange, block->m_ranges.getLargestFreeRange());
+  }
+}
+
+VulkanMemoryStats VulkanMemoryAllocator::getStats() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  VulkanMemoryStats stats{};
+  for (const auto& pool : m_pools)
+  {
+    accumulateStats(pool, stats);
+  }
+
+  return stats;
+}
+
+VulkanMemoryStats VulkanMemoryAllocator::getStats(uint32_t memoryTypeIndex) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  VulkanMemoryStats stats{};
+  for (size_t kind = 0; kind < (size_t)VulkanResourceKind::Count; kind++)
+  {
+    accumulateStats(m_pools[memoryTypeIndex * (size_t)VulkanResourceKind::Count + kind], stats);
+  }
+
+  return stats;
+}
+} // namespace VkHal
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace VkHal
+{
+class VulkanMemoryAllocator;
+
+/** @brief Kind of resource bound to an allocation. Linear and optimal resources never share a block when bufferImageGranularity > 1. */
+enum class VulkanResourceKind
+{
+  Linear = 0, // Buffers and linear tiling images.
+  Optimal = 1,
+  Count
+};
+
+struct VulkanMemoryStats
+{
+  uint32_t blockCount = 0;
+  uint32_t dedicatedBlockCount = 0;
+  uint32_t allocationCount = 0;
+  vk::DeviceSize bytesReserved = 0;  // Sum of the VkDeviceMemory sizes.
+  vk::DeviceSize bytesAllocated = 0; // Sum of the sub-allocation sizes, alignment padding excluded.
+  vk::DeviceSize largestFreeRange = 0;
+};
+
+/** @brief Two-level segregated fit allocator managing the ranges of a single memory block. O(1) allocate and free. */
+class TlsfRangeAllocator
+{
+public:
+  static constexpr uint32_t c_nullIndex = ~0u;
+
+  explicit TlsfRangeAllocator(vk::DeviceSize size);
+
+  /** @brief Returns the range index and the aligned offset of the allocation. */
+  std::optional<std::tuple<uint32_t, vk::DeviceSize>> allocate(vk::DeviceSize size, vk::DeviceSize alignment);
+  void free(uint32_t rangeIndex);
+
+  vk::DeviceSize getSize() const
+  {
+    return m_size;
+  }
+
+  vk::DeviceSize getBytesAllocated() const
+  {
+    return m_bytesAllocated;
+  }
+
+  uint32_t getAllocationCount() const
+  {
+    return m_allocationCount;
+  }
+
+  bool isEmpty() const
+  {
+    return m_allocationCount == 0;
+  }
+
+  vk::DeviceSize getLargestFreeRange() const;
+
+private:
+  static constexpr uint32_t c_secondLevelCountLog2 = 3;
+  static constexpr uint32_t c_secondLevelCount = 1 << c_secondLevelCountLog2;
+  static constexpr vk::DeviceSize c_smallRangeSize = 256;
+  static constexpr uint32_t c_firstLevelCount = 64 - 7;
+
+  struct Range
+  {
+    vk::DeviceSize offset = 0;
+    vk::DeviceSize size = 0;
+    uint32_t prevPhysical = c_nullIndex;
+    uint32_t nextPhysical = c_nullIndex;
+    uint32_t prevFree = c_nullIndex;
+    uint32_t nextFree = c_nullIndex;
+    bool isFree = false;
+  };
+
+  static std::tuple<uint32_t, uint32_t> mappingInsert(vk::DeviceSize size);
+  static std::tuple<uint32_t, uint32_t> mappingSearch(vk::DeviceSize size);
+
+  uint32_t createRange(vk::DeviceSize offset, vk::DeviceSize size);
+  void releaseRange(uint32_t rangeIndex);
+  uint32_t findFreeRange(vk::DeviceSize size) const;
+  void insertFreeRange(uint32_t rangeIndex);
+  void removeFreeRange(uint32_t rangeIndex);
+  uint32_t splitRange(uint32_t rangeIndex, vk::DeviceSize splitOffset);
+  void mergeWithNext(uint32_t rangeIndex);
+
+  vk::DeviceSize m_size = 0;
+  vk::DeviceSize m_bytesAllocated = 0;
+  uint32_t m_allocationCount = 0;
+
+  std::vector<Range> m_ranges;
+  std::vector<uint32_t> m_unusedRangeIndices;
+
+  uint64_t m_firstLevelBitmap = 0;
+  std::array<uint32_t, c_firstLevelCount> m_secondLevelBitmaps = {};
+  std::array<std::array<uint32_t, c_secondLevelCount>, c_firstLevelCount> m_freeLists;
+};
+
+struct VulkanMemoryBlock
+{
+  VulkanMemoryBlock(vk::UniqueDeviceMemory&& memory, vk::DeviceSize size, void* mappedData, uint32_t poolIndex, bool isDedicated);
+
+  vk::UniqueDeviceMemory m_memory;
+  void* m_mappedData = nullptr;
+  uint32_t m_poolIndex = 0;
+  bool m_isDedicated = false;
+  TlsfRangeAllocator m_ranges;
+};
+
+/** @brief Sub-allocation of a VkDeviceMemory block. Returns the range to its block when destroyed. */
+class VulkanAllocation
+{
+public:
+  VulkanAllocation() = default;
+  VulkanAllocation(VulkanMemoryAllocator* allocator, VulkanMemoryBlock* block, uint32_t rangeIndex, vk::DeviceMemory memory, vk::DeviceSize offset, vk::DeviceSize size, void* mappedData);
+  ~VulkanAllocation();
+
+  VulkanAllocation(const VulkanAllocation&) = delete;
+  VulkanAllocation& operator=(const VulkanAllocation&) = delete;
+  VulkanAllocation(VulkanAllocation&& other) noexcept;
+  VulkanAllocation& operator=(VulkanAllocation&& other) noexcept;
+
+  void reset();
+
+  const vk::DeviceMemory& getMemory() const
+  {
+    return m_memory;
+  }
+
+  vk::DeviceSize getOffset() const
+  {
+    return m_offset;
+  }
+
+  vk::DeviceSize getSize() const
+  {
+    return m_size;
+  }
+
+  /** @brief Pointer to the start of the allocation, nullptr if the memory is not host visible. Blocks are persistently mapped. */
+  void* getMappedData() const
+  {
+    return m_mappedData;
+  }
+
+  explicit operator bool() const
+  {
+    return m_block != nullptr;
+  }
+
+private:
+  VulkanMemoryAllocator* m_allocator = nullptr;
+  VulkanMemoryBlock* m_block = nullptr;
+  uint32_t m_rangeIndex = TlsfRangeAllocator::c_nullIndex;
+
+  vk::DeviceMemory m_memory;
+  vk::DeviceSize m_offset = 0;
+  vk::DeviceSize m_size = 0;
+  void* m_mappedData = nullptr;
+};
+
+/** @brief Carves resources out of large per memory type VkDeviceMemory blocks instead of one VkDeviceMemory per resource. */
+class VulkanMemoryAllocator
+{
+public:
+  VulkanMemoryAllocator(const vk::Device& device, const vk::PhysicalDevice& physicalDevice);
+  ~VulkanMemoryAllocator();
+
+  VulkanAllocation allocate(const vk::MemoryRequirements& memRequirements, uint32_t memoryTypeIndex, VulkanResourceKind resourceKind);
+
+  VulkanMemoryStats getStats() const;
+  VulkanMemoryStats getStats(uint32_t memoryTypeIndex) const;
+
+private:
+  friend class VulkanAllocation;
+
+  struct MemoryPool
+  {
+    uint32_t m_memoryTypeIndex = 0;
+    vk::DeviceSize m_preferredBlockSize = 0;
+    std::vector<std::unique_ptr<VulkanMemoryBlock>> m_blocks;
+  };
+
+  void free(VulkanMemoryBlock* block, uint32_t rangeIndex);
+
+  VulkanMemoryBlock* createBlock(MemoryPool& pool, vk::DeviceSize size, bool isDedicated);
+  void accumulateStats(const MemoryPool& pool, VulkanMemoryStats& stats) const;
+
+  MemoryPool& getPool(uint32_t memoryTypeIndex, VulkanResourceKind resourceKind);
+
+  const vk::Device& m_device;
+  vk::PhysicalDeviceMemoryProperties m_memoryProperties;
+  vk::DeviceSize m_bufferImageGranularity = 1;
+  uint32_t m_maxMemoryAllocationCount = 0;
+  uint32_t m_memoryAllocationCount = 0;
+
+  mutable std::mutex m_mutex;
+  std::vector<MemoryPool> m_pools;
+};
+} // namespace VkHal
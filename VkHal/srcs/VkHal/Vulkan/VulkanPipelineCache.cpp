@@ -0,0 +1,118 @@
+#include "VulkanPipelineCache.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+#include <vector>
+
+namespace VkHal
+{
+namespace
+{
+// Layout of the version one header, see VkPipelineCacheHeaderVersion in the spec.
+constexpr size_t c_headerLengthOffset = 0;
+constexpr size_t c_headerVersionOffset = 4;
+constexpr size_t c_vendorIdOffset = 8;
+constexpr size_t c_deviceIdOffset = 12;
+constexpr size_t c_uuidOffset = 16;
+constexpr size_t c_headerSize = c_uuidOffset + VK_UUID_SIZE;
+
+uint32_t readUint32(const std::vector<char>& data, size_t offset)
+{
+  uint32_t value = 0;
+  std::memcpy(&value, data.data() + offset, sizeof(value));
+  return value;
+}
+
+std::vector<char> readCacheFile(const std::filesystem::path& path)
+{
+  std::ifstream file(path, std::ios::ate | std::ios::binary);
+  if (!file)
+  {
+    return {};
+  }
+
+  auto fileSize = (size_t)file.tellg();
+  std::vector<char> fileBuffer(fileSize);
+  file.seekg(0);
+  file.read(fileBuffer.data(), fileSize);
+  if (!file)
+  {
+    return {};
+  }
+
+  return fileBuffer;
+}
+} // namespace
+
+VulkanPipelineCache::VulkanPipelineCache(const vk::Device& device, const vk::PhysicalDeviceProperties& physicalDeviceProperties, std::filesystem::path filePath)
+    : m_device{device}
+    , m_physicalDeviceProperties{physicalDeviceProperties}
+    , m_filePath{std::move(filePath)}
+{
+  auto data = readCacheFile(m_filePath);
+  if (!data.empty() && !isHeaderValid(data))
+  {
+    std::cout << "Pipeline cache file was written by another device or driver, starting with an empty cache.\n";
+    data.clear();
+  }
+
+  vk::PipelineCacheCreateInfo cacheInfo{};
+  cacheInfo.initialDataSize = data.size();
+  cacheInfo.pInitialData = data.data();
+  m_pipelineCache = m_device.createPipelineCacheUnique(cacheInfo);
+  m_loadedSize = data.size();
+}
+
+bool VulkanPipelineCache::save() const
+{
+  auto data = m_device.getPipelineCacheData(m_pipelineCache.get());
+
+  auto tempPath = m_filePath;
+  tempPath += ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    if (!file)
+    {
+      std::cout << "Failed to write the pipeline cache file.\n";
+      return false;
+    }
+  }
+
+  // Written aside first so a crash while saving never leaves a truncated cache behind.
+  std::error_code error;
+  std::filesystem::rename(tempPath, m_filePath, error);
+  if (error)
+  {
+    std::cout << "Failed to replace the pipeline cache file.\n";
+    return false;
+  }
+
+  return true;
+}
+
+bool VulkanPipelineCache::isHeaderValid(const std::vector<char>& data) const
+{
+  if (data.size() < c_headerSize)
+  {
+    return false;
+  }
+
+  auto headerLength = readUint32(data, c_headerLengthOffset);
+  auto headerVersion = readUint32(data, c_headerVersionOffset);
+  if (headerLength < c_headerSize || headerLength > data.size() || headerVersion != (uint32_t)vk::PipelineCacheHeaderVersion::eOne)
+  {
+    return false;
+  }
+
+  if (readUint32(data, c_vendorIdOffset) != m_physicalDeviceProperties.vendorID || readUint32(data, c_deviceIdOffset) != m_physicalDeviceProperties.deviceID)
+  {
+    return false;
+  }
+
+  return std::memcmp(data.data() + c_uuidOffset, m_physicalDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+} // namespace VkHal
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+#include <vulkan/vulkan.hpp>
+
+namespace VkHal
+{
+/** @brief Device wide VkPipelineCache seeded from a file. The file is only used when its header matches the physical device, otherwise the cache starts empty. */
+class VulkanPipelineCache
+{
+public:
+  VulkanPipelineCache(const vk::Device& device, const vk::PhysicalDeviceProperties& physicalDeviceProperties, std::filesystem::path filePath);
+  ~VulkanPipelineCache() = default;
+
+  VulkanPipelineCache(const VulkanPipelineCache&) = delete;
+  VulkanPipelineCache& operator=(const VulkanPipelineCache&) = delete;
+
+  vk::PipelineCache getCache() const
+  {
+    return m_pipelineCache.get();
+  }
+
+  /** @brief True when the cache was seeded with data from a previous run. */
+  bool isWarm() const
+  {
+    return m_loadedSize != 0;
+  }
+
+  size_t getLoadedSize() const
+  {
+    return m_loadedSize;
+  }
+
+  /** @brief Writes the cache content to a temporary file then replaces the cache file. Returns false on failure, a missing cache is not fatal. */
+  bool save() const;
+
+private:
+  bool isHeaderValid(const std::vector<char>& data) const;
+
+  const vk::Device& m_device;
+  vk::PhysicalDeviceProperties m_physicalDeviceProperties;
+  std::filesystem::path m_filePath;
+  size_t m_loadedSize = 0;
+
+  vk::UniquePipelineCache m_pipelineCache;
+};
+} // namespace VkHal
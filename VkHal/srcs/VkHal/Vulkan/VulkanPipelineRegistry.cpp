@@ -0,0 +1,187 @@
+#include "VulkanPipelineRegistry.h"
+
+#include <exception>
+#include <optional>
+#include <tuple>
+
+#include "VkHal/Vulkan/VulkanHash.h"
+
+namespace VkHal
+{
+namespace
+{
+void addAttachmentReferences(VulkanHasher& hasher, uint32_t count, const vk::AttachmentReference* references)
+{
+  hasher.add(count);
+  for (uint32_t i = 0; references && i < count; i++)
+  {
+    hasher.add(references[i].attachment);
+  }
+}
+} // namespace
+
+VulkanPipelineRegistry::VulkanPipelineRegistry(uint32_t compileThreadCount)
+{
+  for (uint32_t i = 0; i < compileThreadCount; i++)
+  {
+    m_compileThreads.emplace_back(&VulkanPipelineRegistry::compileThreadMain, this);
+  }
+}
+
+VulkanPipelineRegistry::~VulkanPipelineRegistry()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isExiting = true;
+  }
+  m_compileRequested.notify_all();
+
+  for (auto& thread : m_compileThreads)
+  {
+    thread.join();
+  }
+}
+
+VulkanPipeline VulkanPipelineRegistry::getGraphicsPipeline(const VulkanPipelineBuilder& builder, vk::RenderPass renderPass, uint64_t renderPassKey)
+{
+  auto key = computeKey(builder, renderPassKey);
+
+  RegisteredPipeline* registeredPipeline = nullptr;
+  if (registerPipeline(key, registeredPipeline))
+  {
+    compile(key, *registeredPipeline, builder, renderPass);
+  }
+
+  return registeredPipeline->m_future.get();
+}
+
+VulkanPipelineHandle VulkanPipelineRegistry::requestGraphicsPipeline(const VulkanPipelineBuilder& builder, vk::RenderPass renderPass, uint64_t renderPassKey)
+{
+  auto key = computeKey(builder, renderPassKey);
+
+  RegisteredPipeline* registeredPipeline = nullptr;
+  if (registerPipeline(key, registeredPipeline))
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_compileQueue.push_back(CompileRequest{key, builder, renderPass});
+    }
+    m_compileRequested.notify_one();
+  }
+
+  return VulkanPipelineHandle{key, registeredPipeline->m_future};
+}
+
+VulkanPipelineRegistryStats VulkanPipelineRegistry::getStats() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  VulkanPipelineRegistryStats stats;
+  stats.m_pipelineCount = (uint32_t)m_pipelines.size();
+  stats.m_pendingCount = m_pendingCount;
+  stats.m_requestCount = m_requestCount;
+  stats.m_hitCount = m_hitCount;
+  return stats;
+}
+
+bool VulkanPipelineRegistry::registerPipeline(uint64_t key, RegisteredPipeline*& registeredPipeline)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_requestCount++;
+
+  // Entries are never erased and unordered_map does not move its elements, so the pointer stays valid without the lock.
+  auto [it, isInserted] = m_pipelines.try_emplace(key);
+  registeredPipeline = &it->second;
+
+  if (!isInserted)
+  {
+    m_hitCount++;
+    return false;
+  }
+
+  registeredPipeline->m_future = registeredPipeline->m_promise.get_future().share();
+  m_pendingCount++;
+  return true;
+}
+
+void VulkanPipelineRegistry::compile(uint64_t key, RegisteredPipeline& registeredPipeline, const VulkanPipelineBuilder& builder, vk::RenderPass renderPass)
+{
+  // Compiled without the lock, vkCreateGraphicsPipelines may be called from several threads with the same pipeline cache.
+  try
+  {
+    auto [pipeline, pipelineLayout] = builder.buildGraphicsPipeline(renderPass);
+    VulkanPipeline result{key, pipeline.get(), pipelineLayout.get()};
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      registeredPipeline.m_pipeline = std::move(pipeline);
+      registeredPipeline.m_pipelineLayout = std::move(pipelineLayout);
+      m_pendingCount--;
+    }
+    registeredPipeline.m_promise.set_value(result);
+  }
+  catch (...)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_pendingCount--;
+    }
+    registeredPipeline.m_promise.set_exception(std::current_exception());
+  }
+}
+
+void VulkanPipelineRegistry::compileThreadMain()
+{
+  while (true)
+  {
+    std::optional<CompileRequest> request;
+    RegisteredPipeline* registeredPipeline = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_compileRequested.wait(lock, [this] { return m_isExiting || !m_compileQueue.empty(); });
+      if (m_isExiting)
+      {
+        return;
+      }
+
+      request.emplace(std::move(m_compileQueue.front()));
+      m_compileQueue.pop_front();
+      registeredPipeline = &m_pipelines.at(request->m_key);
+    }
+
+    compile(request->m_key, *registeredPipeline, request->m_builder, request->m_renderPass);
+  }
+}
+
+uint64_t VulkanPipelineRegistry::computeKey(const VulkanPipelineBuilder& builder, uint64_t renderPassKey)
+{
+  VulkanHasher hasher;
+  hasher.add(builder.computeHash());
+  hasher.add(renderPassKey);
+  return hasher.get();
+}
+
+uint64_t VulkanPipelineRegistry::computeRenderPassKey(const vk::RenderPassCreateInfo& renderPassInfo)
+{
+  VulkanHasher hasher;
+
+  hasher.add(renderPassInfo.attachmentCount);
+  for (uint32_t i = 0; i < renderPassInfo.attachmentCount; i++)
+  {
+    hasher.add(renderPassInfo.pAttachments[i].format);
+    hasher.add(renderPassInfo.pAttachments[i].samples);
+  }
+
+  hasher.add(renderPassInfo.subpassCount);
+  for (uint32_t i = 0; i < renderPassInfo.subpassCount; i++)
+  {
+    const auto& subpass = renderPassInfo.pSubpasses[i];
+    addAttachmentReferences(hasher, subpass.inputAttachmentCount, subpass.pInputAttachments);
+    addAttachmentReferences(hasher, subpass.colorAttachmentCount, subpass.pColorAttachments);
+    addAttachmentReferences(hasher, subpass.pResolveAttachments ? subpass.colorAttachmentCount : 0, subpass.pResolveAttachments);
+    addAttachmentReferences(hasher, subpass.pDepthStencilAttachment ? 1 : 0, subpass.pDepthStencilAttachment);
+  }
+
+  return hasher.get();
+}
+} // namespace VkHal
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "VkHal/Vulkan/VulkanBuilder/VulkanPipelineBuilder.h"
+
+namespace VkHal
+{
+/** @brief Pipeline owned by the registry. The key is stable for a given description so it can be used to sort draws. */
+struct VulkanPipeline
+{
+  uint64_t m_key = 0;
+  vk::Pipeline m_pipeline;
+  vk::PipelineLayout m_pipelineLayout;
+};
+
+/** @brief Pipeline that may still be compiling. The key is known right away, the pipeline once isReady returns true. */
+class VulkanPipelineHandle
+{
+public:
+  VulkanPipelineHandle() = default;
+  VulkanPipelineHandle(uint64_t key, std::shared_future<VulkanPipeline> future)
+      : m_key{key}
+      , m_future{std::move(future)}
+  {
+  }
+
+  uint64_t getKey() const
+  {
+    return m_key;
+  }
+
+  bool isValid() const
+  {
+    return m_future.valid();
+  }
+
+  bool isReady() const
+  {
+    return m_future.valid() && m_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
+
+  /** @brief Blocks until the pipeline is compiled. Rethrows if the compilation failed. */
+  VulkanPipeline get() const
+  {
+    return m_future.get();
+  }
+
+private:
+  uint64_t m_key = 0;
+  std::shared_future<VulkanPipeline> m_future;
+};
+
+struct VulkanPipelineRegistryStats
+{
+  uint32_t m_pipelineCount = 0;
+  uint32_t m_pendingCount = 0;
+  uint64_t m_requestCount = 0;
+  uint64_t m_hitCount = 0;
+
+  float getHitRate() const
+  {
+    return m_requestCount ? (float)m_hitCount / m_requestCount : 0.0f;
+  }
+};
+
+/** @brief Deduplicates pipelines by the hash of their description. Identical requests get the same pipeline, only the first one compiles.
+           Pipelines can be compiled on the calling thread or on the registry compile threads. They live as long as the registry. */
+class VulkanPipelineRegistry
+{
+public:
+  explicit VulkanPipelineRegistry(uint32_t compileThreadCount);
+  ~VulkanPipelineRegistry();
+
+  VulkanPipelineRegistry(const VulkanPipelineRegistry&) = delete;
+  VulkanPipelineRegistry& operator=(const VulkanPipelineRegistry&) = delete;
+
+  /** @brief Compiles on the calling thread if nobody requested that pipeline yet, otherwise waits for it. renderPassKey identifies the render pass compatibility class, see computeRenderPassKey. */
+  VulkanPipeline getGraphicsPipeline(const VulkanPipelineBuilder& builder, vk::RenderPass renderPass, uint64_t renderPassKey);
+
+  /** @brief Returns right away. A new pipeline is compiled by a compile thread; the render pass must stay alive until the handle is ready. */
+  VulkanPipelineHandle requestGraphicsPipeline(const VulkanPipelineBuilder& builder, vk::RenderPass renderPass, uint64_t renderPassKey);
+
+  VulkanPipelineRegistryStats getStats() const;
+
+  /** @brief Hash of what makes two render passes compatible: attachment formats and sample counts, and the attachment references of each subpass. */
+  static uint64_t computeRenderPassKey(const vk::RenderPassCreateInfo& renderPassInfo);
+
+private:
+  struct RegisteredPipeline
+  {
+    vk::UniquePipeline m_pipeline;
+    vk::UniquePipelineLayout m_pipelineLayout;
+    std::promise<VulkanPipeline> m_promise;
+    std::shared_future<VulkanPipeline> m_future;
+  };
+
+  struct CompileRequest
+  {
+    uint64_t m_key;
+    VulkanPipelineBuilder m_builder;
+    vk::RenderPass m_renderPass;
+  };
+
+  /** @brief Finds or inserts the entry of the key. Returns true if the caller inserted it and has to compile it. */
+  bool registerPipeline(uint64_t key, RegisteredPipeline*& registeredPipeline);
+  void compile(uint64_t key, RegisteredPipeline& registeredPipeline, const VulkanPipelineBuilder& builder, vk::RenderPass renderPass);
+  void compileThreadMain();
+
+  static uint64_t computeKey(const VulkanPipelineBuilder& builder, uint64_t renderPassKey);
+
+  mutable std::mutex m_mutex;
+  std::unordered_map<uint64_t, RegisteredPipeline> m_pipelines;
+  uint32_t m_pendingCount = 0;
+  uint64_t m_requestCount = 0;
+  uint64_t m_hitCount = 0;
+
+  std::condition_variable m_compileRequested;
+  std::deque<CompileRequest> m_compileQueue;
+  std::vector<std::thread> m_compileThreads;
+  bool m_isExiting = false;
+};
+} // namespace VkHal
@@ -0,0 +1,122 @@
+#include "VulkanRecordingWorkers.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace VkHal
+{
+VulkanRecordingWorkers::VulkanRecordingWorkers(uint32_t workerCount)
+{
+  workerCount = std::max(workerCount, 1u);
+
+  m_threads.reserve(workerCount - 1);
+  for (uint32_t i = 1; i < workerCount; i++)
+  {
+    m_threads.emplace_back(&VulkanRecordingWorkers::workerMain, this, i);
+  }
+}
+
+VulkanRecordingWorkers::~VulkanRecordingWorkers()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isExiting = true;
+  }
+  m_taskAvailable.notify_all();
+
+  for (auto& thread : m_threads)
+  {
+    thread.join();
+  }
+}
+
+void VulkanRecordingWorkers::dispatch(uint32_t workerCount, const std::function<void(uint32_t workerIndex)>& task)
+{
+  workerCount = std::clamp(workerCount, 1u, getWorkerCount());
+
+  if (workerCount == 1)
+  {
+    task(0);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_task = &task;
+    m_taskWorkerCount = workerCount;
+    m_pendingWorkerCount = workerCount - 1;
+    m_generation++;
+  }
+  m_taskAvailable.notify_all();
+
+  try
+  {
+    task(0);
+  }
+  catch (...)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_taskException)
+    {
+      m_taskException = std::current_exception();
+    }
+  }
+
+  // Even after a throw, the other workers still run the task and may use the caller's stack until they are done.
+  std::exception_ptr taskException;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_taskCompleted.wait(lock, [this]() { return m_pendingWorkerCount == 0; });
+    m_task = nullptr;
+    taskException = std::exchange(m_taskException, nullptr);
+  }
+
+  if (taskException)
+  {
+    std::rethrow_exception(taskException);
+  }
+}
+
+void VulkanRecordingWorkers::workerMain(uint32_t workerIndex)
+{
+  uint64_t lastGeneration = 0;
+
+  while (true)
+  {
+    const std::function<void(uint32_t)>* task = nullptr;
+
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_taskAvailable.wait(lock, [&]() { return m_isExiting || (m_generation != lastGeneration && workerIndex < m_taskWorkerCount); });
+
+      if (m_isExiting)
+      {
+        return;
+      }
+
+      lastGeneration = m_generation;
+      task = m_task;
+    }
+
+    std::exception_ptr taskException;
+    try
+    {
+      (*task)(workerIndex);
+    }
+    catch (...)
+    {
+      taskException = std::current_exception();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (taskException && !m_taskException)
+      {
+        m_taskException = taskException;
+      }
+      m_pendingWorkerCount--;
+    }
+    m_taskCompleted.notify_one();
+  }
+}
+} // namespace VkHal
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace VkHal
+{
+/** @brief Fixed set of threads used to record secondary command buffers. The thread calling dispatch is worker 0. */
+class VulkanRecordingWorkers
+{
+public:
+  explicit VulkanRecordingWorkers(uint32_t workerCount);
+  ~VulkanRecordingWorkers();
+
+  VulkanRecordingWorkers(const VulkanRecordingWorkers&) = delete;
+  VulkanRecordingWorkers& operator=(const VulkanRecordingWorkers&) = delete;
+
+  uint32_t getWorkerCount() const
+  {
+    return (uint32_t)m_threads.size() + 1;
+  }
+
+  /** @brief Runs the task on the first workerCount workers and returns once all of them are done. The first exception a worker threw is rethrown here. */
+  void dispatch(uint32_t workerCount, const std::function<void(uint32_t workerIndex)>& task);
+
+  /**
+   * @brief Calls itemFunc(itemIndex) for every item on up to workerCount workers. The items are handed out one at a time, so uneven ones still balance.
+   * Once an item threw the remaining ones are skipped, the first exception is rethrown here.
+   */
+  template <typename ItemFunc>
+  void forEach(uint32_t workerCount, uint32_t itemCount, ItemFunc&& itemFunc)
+  {
+    std::atomic<uint32_t> nextItem{0};
+    dispatch(std::min(workerCount, itemCount), [&](uint32_t) {
+      for (auto itemIndex = nextItem.fetch_add(1); itemIndex < itemCount; itemIndex = nextItem.fetch_add(1))
+      {
+        try
+        {
+          itemFunc(itemIndex);
+        }
+        catch (...)
+        {
+          nextItem = itemCount;
+          throw;
+        }
+      }
+    });
+  }
+
+  /** @brief forEach on the workers when given, on the calling thread otherwise. */
+  template <typename ItemFunc>
+  static void forEach(VulkanRecordingWorkers* workers, uint32_t workerCount, uint32_t itemCount, ItemFunc&& itemFunc)
+  {
+    if (workers)
+    {
+      workers->forEach(workerCount, itemCount, itemFunc);
+      return;
+    }
+
+    for (uint32_t itemIndex = 0; itemIndex < itemCount; itemIndex++)
+    {
+      itemFunc(itemIndex);
+    }
+  }
+
+private:
+  void workerMain(uint32_t workerIndex);
+
+  std::vector<std::thread> m_threads;
+
+  std::mutex m_mutex;
+  std::condition_variable m_taskAvailable;
+  std::condition_variable m_taskCompleted;
+
+  const std::function<void(uint32_t)>* m_task = nullptr;
+  uint32_t m_taskWorkerCount = 0;
+  uint32_t m_pendingWorkerCount = 0;
+  std::exception_ptr m_taskException; // First exception of the current task.
+  uint64_t m_generation = 0;
+  bool m_isExiting = false;
+};
+} // namespace VkHal
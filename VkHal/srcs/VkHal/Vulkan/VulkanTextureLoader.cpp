@@ -0,0 +1,341 @@
+#include "VulkanTextureLoader.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "VkHal/TextureCache.h"
+#include "VkHal/Vulkan/VulkanDevice.h"
+#include "VkHal/Vulkan/VulkanImage.h"
+#include "VkHal/Vulkan/VulkanRecordingWorkers.h"
+
+using namespace std::literals::string_literals;
+
+namespace VkHal
+{
+namespace
+{
+/**
+ * @brief Staging bytes the decoder of this thread writes its output to. stb_image allocates its result itself, the first allocation of the
+ * size of the pixels is served from the staging memory so the decoder writes there directly. Any other result is copied over.
+ */
+struct DecodeTarget
+{
+  uint8_t* m_data = nullptr;
+  size_t m_pixelSize = 0;
+  size_t m_capacity = 0;
+  bool m_isTaken = false;
+};
+
+thread_local DecodeTarget t_decodeTarget;
+
+void* decodeMalloc(size_t size)
+{
+  auto& target = t_decodeTarget;
+  // The JPEG decoder asks for one byte more than the pixels.
+  if (target.m_data && !target.m_isTaken && size >= target.m_pixelSize && size <= target.m_capacity)
+  {
+    target.m_isTaken = true;
+    return target.m_data;
+  }
+  return std::malloc(size);
+}
+
+void decodeFree(void* data)
+{
+  if (data != t_decodeTarget.m_data)
+  {
+    std::free(data);
+  }
+}
+
+void* decodeRealloc(void* data, size_t size)
+{
+  const auto& target = t_decodeTarget;
+  if (data && data == target.m_data)
+  {
+    // The staging range cannot grow, the decoder continues in heap memory.
+    auto* newData = std::malloc(size);
+    if (newData)
+    {
+      std::memcpy(newData, data, std::min(size, target.m_capacity));
+    }
+    return newData;
+  }
+  return std::realloc(data, size);
+}
+} // namespace
+} // namespace VkHal
+
+#define STBI_MALLOC(size) VkHal::decodeMalloc(size)
+#define STBI_REALLOC(data, size) VkHal::decodeRealloc(data, size)
+#define STBI_FREE(data) VkHal::decodeFree(data)
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+namespace VkHal
+{
+namespace
+{
+constexpr vk::DeviceSize c_stagingAlignment = 16; // A multiple of the texel and block sizes copyBufferToImage needs, the rows of the decoder stay aligned.
+constexpr vk::DeviceSize c_noStagingSpace = std::numeric_limits<vk::DeviceSize>::max();
+
+vk::DeviceSize alignStaging(vk::DeviceSize size)
+{
+  return (size + c_stagingAlignment - 1) & ~(c_stagingAlignment - 1);
+}
+
+} // namespace
+
+VulkanTextureLoader::VulkanTextureLoader(const VulkanDevice* device, VulkanUploadManager* uploadManager, vk::DeviceSize stagingSize)
+    : m_device{device}
+    , m_uploadManager{uploadManager}
+    , m_stagingSize{alignStaging(stagingSize)}
+{
+  std::tie(m_stagingBuffer, m_stagingMemory) = m_device->createBuffer(m_stagingSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+  m_stagingData = static_cast<uint8_t*>(m_stagingMemory.getMappedData());
+}
+
+VulkanTextureLoader::~VulkanTextureLoader()
+{
+  // The copies still read from the ring.
+  VulkanUploadTicket lastTicket = 0;
+  for (const auto& range : m_stagingRanges)
+  {
+    lastTicket = std::max(lastTicket, range.m_ticket);
+  }
+  m_uploadManager->wait(lastTicket);
+}
+
+std::vector<VulkanLoadedTexture> VulkanTextureLoader::load(const std::vector<std::filesystem::path>& paths, VulkanRecordingWorkers* workers, uint32_t workerCount)
+{
+  const auto textureCount = (uint32_t)paths.size();
+
+  // Only the headers are read to size the images.
+  std::vector<vk::Extent2D> extents(textureCount);
+  VulkanRecordingWorkers::forEach(workers, workerCount, textureCount, [&](uint32_t textureIndex) {
+    int32_t width{};
+    int32_t height{};
+    int32_t channels{};
+    if (!stbi_info(paths[textureIndex].u8string().c_str(), &width, &height, &channels))
+    {
+      throw std::runtime_error("Failed to read texture image "s + paths[textureIndex].u8string() + ".");
+    }
+    extents[textureIndex] = vk::Extent2D{(uint32_t)width, (uint32_t)height};
+  });
+
+  // The memory allocator is not thread safe, the images are created on the calling thread.
+  std::vector<VulkanLoadedTexture> textures(textureCount);
+  for (uint32_t i = 0; i < textureCount; i++)
+  {
+    auto imageUsage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+    textures[i].m_image = m_device->createImage(extents[i], 1, vk::Format::eR8G8B8A8Unorm, vk::ImageTiling::eOptimal, imageUsage, vk::MemoryPropertyFlagBits::eDeviceLocal, vk::ImageAspectFlagBits::eColor);
+  }
+
+  VulkanRecordingWorkers::forEach(workers, workerCount, textureCount, [&](uint32_t textureIndex) { textures[textureIndex].m_ticket = loadTexture(paths[textureIndex], *textures[textureIndex].m_image); });
+
+  m_uploadManager->flush();
+
+  return textures;
+}
+
+VulkanUploadTicket VulkanTextureLoader::loadTexture(const std::filesystem::path& path, const VulkanImage& image)
+{
+  const auto extent = image.getExtent();
+  const auto pixelSize = (size_t)extent.width * extent.height * 4;
+
+  uint64_t rangeId = 0;
+  auto stagingOffset = reserveStaging(pixelSize + 1, rangeId);
+
+  auto& target = t_decodeTarget;
+  target = {m_stagingData + stagingOffset, pixelSize, (size_t)alignStaging(pixelSize + 1), false};
+
+  int32_t width{};
+  int32_t height{};
+  int32_t channels{};
+  auto pixels = stbi_load(path.u8string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+  if (!pixels || (uint32_t)width != extent.width || (uint32_t)height != extent.height)
+  {
+    stbi_image_free(pixels);
+    target = {};
+    submitStaging(rangeId, 0);
+    throw std::runtime_error("Failed to load texture image "s + path.u8string() + ".");
+  }
+
+  if (pixels != target.m_data)
+  {
+    std::memcpy(target.m_data, pixels, pixelSize);
+    stbi_image_free(pixels);
+  }
+  target = {};
+
+  vk::BufferImageCopy copyRegion{};
+  copyRegion.bufferOffset = stagingOffset;
+  copyRegion.bufferRowLength = 0;
+  copyRegion.bufferImageHeight = 0;
+
+  copyRegion.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+  copyRegion.imageSubresource.mipLevel = 0;
+  copyRegion.imageSubresource.baseArrayLayer = 0;
+  copyRegion.imageSubresource.layerCount = 1;
+
+  copyRegion.imageOffset = vk::Offset3D{0, 0, 0};
+  copyRegion.imageExtent = vk::Extent3D{extent.width, extent.height, 1};
+
+  auto ticket = m_uploadManager->uploadImage(m_stagingBuffer.get(), image.getImage(), image.getMipCount(), copyRegion, vk::ImageLayout::eShaderReadOnlyOptimal, vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead);
+  submitStaging(rangeId, ticket);
+
+  return ticket;
+}
+
+std::vector<VulkanLoadedTexture> VulkanTextureLoader::loadCooked(const std::vector<const TextureCache*>& textureCaches, VulkanRecordingWorkers* workers, uint32_t workerCount)
+{
+  const auto textureCount = (uint32_t)textureCaches.size();
+
+  std::vector<VulkanLoadedTexture> textures(textureCount);
+  std::vector<VulkanCookedMips> uploads(textureCount);
+  for (uint32_t i = 0; i < textureCount; i++)
+  {
+    const auto& header = textureCaches[i]->getHeader();
+    auto imageUsage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+    textures[i].m_image = m_device->createImage({header.m_width, header.m_height}, header.m_mipCount, getVkFormat(header.m_format), vk::ImageTiling::eOptimal, imageUsage, vk::MemoryPropertyFlagBits::eDeviceLocal, vk::ImageAspectFlagBits::eColor);
+    uploads[i] = {textureCaches[i], 0, header.m_mipCount, textures[i].m_image.get()};
+  }
+  uploadCookedMips(uploads, workers, workerCount);
+
+  m_uploadManager->flush();
+
+  for (uint32_t i = 0; i < textureCount; i++)
+  {
+    textures[i].m_ticket = uploads[i].m_ticket;
+  }
+
+  return textures;
+}
+
+void VulkanTextureLoader::uploadCookedMips(std::vector<VulkanCookedMips>& uploads, VulkanRecordingWorkers* workers, uint32_t workerCount)
+{
+  // The workers also take the page faults of the mapped caches.
+  VulkanRecordingWorkers::forEach(workers, workerCount, (uint32_t)uploads.size(), [&](uint32_t uploadIndex) { uploads[uploadIndex].m_ticket = uploadMipRange(uploads[uploadIndex]); });
+}
+
+VulkanUploadTicket VulkanTextureLoader::uploadMipRange(const VulkanCookedMips& upload)
+{
+  // The cache stores the mips from the largest, the ones uploaded are a single range.
+  const auto& textureCache = *upload.m_cache;
+  const auto& firstMip = textureCache.getMip(upload.m_firstMip);
+  const auto& lastMip = textureCache.getMip(upload.m_firstMip + upload.m_mipCount - 1);
+  const auto size = lastMip.m_offset + lastMip.m_size - firstMip.m_offset;
+
+  uint64_t rangeId = 0;
+  auto stagingOffset = reserveStaging(size, rangeId);
+
+  // The cache holds the mips in their image layout, the copy out of the mapping is the only one.
+  std::memcpy(m_stagingData + stagingOffset, static_cast<const uint8_t*>(textureCache.getData()) + firstMip.m_offset, (size_t)size);
+
+  std::vector<vk::BufferImageCopy> copyRegions(upload.m_mipCount);
+  for (uint32_t imageMip = 0; imageMip < upload.m_mipCount; imageMip++)
+  {
+    const auto& mip = textureCache.getMip(upload.m_firstMip + imageMip);
+    auto& copyRegion = copyRegions[imageMip];
+    copyRegion.bufferOffset = stagingOffset + mip.m_offset - firstMip.m_offset;
+    copyRegion.bufferRowLength = 0;
+    copyRegion.bufferImageHeight = 0;
+
+    copyRegion.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+    copyRegion.imageSubresource.mipLevel = imageMip;
+    copyRegion.imageSubresource.baseArrayLayer = 0;
+    copyRegion.imageSubresource.layerCount = 1;
+
+    copyRegion.imageOffset = vk::Offset3D{0, 0, 0};
+    copyRegion.imageExtent = vk::Extent3D{mip.m_width, mip.m_height, 1};
+  }
+
+  const auto& image = *upload.m_image;
+  auto ticket = m_uploadManager->uploadImage(m_stagingBuffer.get(), image.getImage(), image.getMipCount(), copyRegions, vk::ImageLayout::eShaderReadOnlyOptimal, vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead);
+  submitStaging(rangeId, ticket);
+
+  return ticket;
+}
+
+vk::DeviceSize VulkanTextureLoader::reserveStaging(vk::DeviceSize size, uint64_t& rangeId)
+{
+  size = alignStaging(size);
+  if (size > m_stagingSize)
+  {
+    throw std::runtime_error("Texture image is larger than the texture staging ring.");
+  }
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true)
+  {
+    releaseCompletedRanges();
+
+    auto offset = findStagingSpace(size);
+    if (offset != c_noStagingSpace)
+    {
+      rangeId = m_nextRangeId++;
+      m_stagingRanges.push_back({rangeId, offset, size, 0, false});
+      return offset;
+    }
+
+    // Full, wait for the oldest upload. Its texture may still be decoding, then wait for it to be submitted first.
+    const auto& oldestRange = m_stagingRanges.front();
+    if (oldestRange.m_isSubmitted)
+    {
+      auto ticket = oldestRange.m_ticket;
+      lock.unlock();
+      m_uploadManager->wait(ticket);
+      lock.lock();
+    }
+    else
+    {
+      m_rangeSubmitted.wait(lock);
+    }
+  }
+}
+
+void VulkanTextureLoader::submitStaging(uint64_t rangeId, VulkanUploadTicket ticket)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = std::find_if(begin(m_stagingRanges), end(m_stagingRanges), [rangeId](const auto& range) { return range.m_id == rangeId; });
+    it->m_ticket = ticket;
+    it->m_isSubmitted = true;
+  }
+  m_rangeSubmitted.notify_all();
+}
+
+vk::DeviceSize VulkanTextureLoader::findStagingSpace(vk::DeviceSize size) const
+{
+  if (m_stagingRanges.empty())
+  {
+    return 0;
+  }
+
+  // The live ranges go from the head to the tail, wrapping at the end of the ring.
+  const auto head = m_stagingRanges.front().m_offset;
+  const auto tail = m_stagingRanges.back().m_offset + m_stagingRanges.back().m_size;
+  if (head < tail)
+  {
+    if (m_stagingSize - tail >= size)
+    {
+      return tail;
+    }
+    return head >= size ? 0 : c_noStagingSpace;
+  }
+
+  return head - tail >= size ? tail : c_noStagingSpace;
+}
+
+void VulkanTextureLoader::releaseCompletedRanges()
+{
+  while (!m_stagingRanges.empty() && m_stagingRanges.front().m_isSubmitted && m_uploadManager->isComplete(m_stagingRanges.front().m_ticket))
+  {
+    m_stagingRanges.pop_front();
+  }
+}
+} // namespace VkHal
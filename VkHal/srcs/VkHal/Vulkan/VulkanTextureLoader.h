@@ -0,0 +1,112 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "VkHal/Vulkan/VulkanMemoryAllocator.h"
+#include "VkHal/Vulkan/VulkanUploadManager.h"
+
+namespace VkHal
+{
+class TextureCache;
+class VulkanDevice;
+class VulkanImage;
+class VulkanRecordingWorkers;
+
+/** @brief Texture queued for upload. The image can be used once the ticket completed. */
+struct VulkanLoadedTexture
+{
+  std::unique_ptr<VulkanImage> m_image;
+  VulkanUploadTicket m_ticket = 0;
+};
+
+/** @brief Mips of a texture cache to upload to an existing image, m_firstMip of the cache lands in mip 0 of the image. */
+struct VulkanCookedMips
+{
+  const TextureCache* m_cache = nullptr;
+  uint32_t m_firstMip = 0;
+  uint32_t m_mipCount = 0;
+  const VulkanImage* m_image = nullptr;
+  VulkanUploadTicket m_ticket = 0; // Set by the upload.
+};
+
+/**
+ * @brief Fills a persistently mapped staging ring on the recording workers and uploads the textures from there, decoded from image files or copied from texture caches.
+ * The ring bounds the bytes waiting for the GPU. A worker that does not fit waits for the oldest upload, so memory stays flat whatever the file count.
+ */
+class VulkanTextureLoader
+{
+public:
+  VulkanTextureLoader(const VulkanDevice* device, VulkanUploadManager* uploadManager, vk::DeviceSize stagingSize);
+  ~VulkanTextureLoader();
+
+  VulkanTextureLoader(const VulkanTextureLoader&) = delete;
+  VulkanTextureLoader& operator=(const VulkanTextureLoader&) = delete;
+
+  /**
+   * @brief Decodes the files to RGBA8 images of a single mip, cook them to a texture cache for a mip chain. The images end in eShaderReadOnlyOptimal.
+   * The uploads are flushed before returning. Throws if a file cannot be decoded or does not fit in the staging ring.
+   */
+  std::vector<VulkanLoadedTexture> load(const std::vector<std::filesystem::path>& paths, VulkanRecordingWorkers* workers, uint32_t workerCount);
+
+  /**
+   * @brief Uploads the cached textures with their whole mip chain, a single copy with one region per mip. The images end in eShaderReadOnlyOptimal.
+   * The caches can be unmapped once this returns. Throws if a texture does not fit in the staging ring.
+   */
+  std::vector<VulkanLoadedTexture> loadCooked(const std::vector<const TextureCache*>& textureCaches, VulkanRecordingWorkers* workers, uint32_t workerCount);
+
+  /**
+   * @brief Copies the mips to the staging ring on the workers and records their uploads, without flushing. Every mip of the images ends in eShaderReadOnlyOptimal,
+   * the ones not uploaded are left for the caller to fill in the same batch. Throws if the mips of a texture do not fit in the staging ring.
+   */
+  void uploadCookedMips(std::vector<VulkanCookedMips>& uploads, VulkanRecordingWorkers* workers, uint32_t workerCount);
+
+  vk::DeviceSize getStagingSize() const
+  {
+    return m_stagingSize;
+  }
+
+private:
+  /** @brief Staging bytes of one texture, from its reservation until its upload completed. Ranges are released in reservation order. */
+  struct StagingRange
+  {
+    uint64_t m_id = 0;
+    vk::DeviceSize m_offset = 0;
+    vk::DeviceSize m_size = 0;
+    VulkanUploadTicket m_ticket = 0;
+    bool m_isSubmitted = false;
+  };
+
+  VulkanUploadTicket loadTexture(const std::filesystem::path& path, const VulkanImage& image);
+  VulkanUploadTicket uploadMipRange(const VulkanCookedMips& upload);
+
+  /** @brief Blocks until the ring has room for size bytes. */
+  vk::DeviceSize reserveStaging(vk::DeviceSize size, uint64_t& rangeId);
+
+  /** @brief The range is released once the ticket completed, right away for ticket 0. */
+  void submitStaging(uint64_t rangeId, VulkanUploadTicket ticket);
+
+  vk::DeviceSize findStagingSpace(vk::DeviceSize size) const;
+  void releaseCompletedRanges();
+
+  const VulkanDevice* m_device;
+  VulkanUploadManager* m_uploadManager;
+
+  vk::DeviceSize m_stagingSize;
+  vk::UniqueBuffer m_stagingBuffer;
+  VulkanAllocation m_stagingMemory;
+  uint8_t* m_stagingData = nullptr;
+
+  std::mutex m_mutex;
+  std::condition_variable m_rangeSubmitted;
+  std::deque<StagingRange> m_stagingRanges;
+  uint64_t m_nextRangeId = 1;
+};
+} // namespace VkHal
@@ -0,0 +1,301 @@
+#include "VulkanTextureStreamer.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "VkHal/Vulkan/VulkanDevice.h"
+#include "VkHal/Vulkan/VulkanImage.h"
+#include "VkHal/Vulkan/VulkanRecordingWorkers.h"
+#include "VkHal/Vulkan/VulkanTextureLoader.h"
+
+namespace VkHal
+{
+namespace
+{
+constexpr vk::DeviceSize c_maxUpdateUploadSize = 16 * 1024 * 1024; // Mips staged by one update, bounds the copies to the staging ring done in a frame.
+} // namespace
+
+VulkanTextureStreamer::VulkanTextureStreamer(const VulkanDevice* device, VulkanUploadManager* uploadManager, VulkanTextureLoader* textureLoader, VulkanRecordingWorkers* workers, vk::DeviceSize budget, uint32_t tailSize)
+    : m_device{device}
+    , m_uploadManager{uploadManager}
+    , m_textureLoader{textureLoader}
+    , m_workers{workers}
+    , m_budget{budget}
+    , m_tailSize{tailSize}
+{
+}
+
+VulkanTextureStreamer::~VulkanTextureStreamer() = default;
+
+VulkanStreamedTexture VulkanTextureStreamer::addTexture(TextureCache&& textureCache)
+{
+  auto texture = std::make_unique<StreamedTexture>(std::move(textureCache));
+
+  const auto mipCount = texture->m_cache.getMipCount();
+  texture->m_tailMip = mipCount - 1;
+  for (uint32_t mipLevel = 0; mipLevel < mipCount; mipLevel++)
+  {
+    const auto& mip = texture->m_cache.getMip(mipLevel);
+    if (std::max(mip.m_width, mip.m_height) <= m_tailSize)
+    {
+      texture->m_tailMip = mipLevel;
+      break;
+    }
+  }
+
+  texture->m_image = createImage(*texture, texture->m_tailMip);
+  std::vector<VulkanCookedMips> uploads = {{&texture->m_cache, texture->m_tailMip, mipCount - texture->m_tailMip, texture->m_image.get()}};
+  m_textureLoader->uploadCookedMips(uploads, nullptr, 1);
+  texture->m_residentMip = texture->m_tailMip;
+  texture->m_requestedMip = texture->m_tailMip;
+
+  m_textures.push_back(std::move(texture));
+  m_version++;
+
+  return (VulkanStreamedTexture)(m_textures.size() - 1);
+}
+
+void VulkanTextureStreamer::requestMip(VulkanStreamedTexture texture, uint32_t mipLevel, float priority)
+{
+  auto& streamedTexture = *m_textures[texture];
+  streamedTexture.m_requestedMip = std::min(mipLevel, streamedTexture.m_tailMip);
+  streamedTexture.m_priority = priority;
+}
+
+void VulkanTextureStreamer::update()
+{
+  swapCompletedUploads();
+
+  const auto targetMips = computeTargetMips();
+
+  // An image being replaced and its replacement are both alive until the swap.
+  vk::DeviceSize usedSize = 0;
+  for (const auto& texture : m_textures)
+  {
+    usedSize += getMipChainSize(*texture, texture->m_residentMip);
+    if (texture->m_pendingImage)
+    {
+      usedSize += getMipChainSize(*texture, texture->m_pendingMip);
+    }
+  }
+
+  std::vector<uint32_t> order(m_textures.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return m_textures[a]->m_priority > m_textures[b]->m_priority; });
+
+  // Mips finer than the target are kept while the targets of every texture fit next to them, then evicted from the lowest priority.
+  // Evictions go first, the memory they free is only available once they are swapped in.
+  vk::DeviceSize keptSize = 0;
+  for (size_t i = 0; i < m_textures.size(); i++)
+  {
+    keptSize += getMipChainSize(*m_textures[i], std::min(m_textures[i]->m_residentMip, targetMips[i]));
+  }
+
+  // An eviction only copies the mips it keeps from the current image.
+  bool isUploading = false;
+  for (auto it = order.rbegin(); it != order.rend() && keptSize > m_budget; it++)
+  {
+    auto& texture = *m_textures[*it];
+    if (!texture.m_pendingImage && targetMips[*it] > texture.m_residentMip)
+    {
+      keptSize -= getMipChainSize(texture, texture.m_residentMip) - getMipChainSize(texture, targetMips[*it]);
+      texture.m_pendingMip = targetMips[*it];
+      texture.m_pendingImage = createImage(texture, texture.m_pendingMip);
+      texture.m_pendingTicket = copyResidentMips(texture, vk::ImageLayout::eUndefined);
+      usedSize += getMipChainSize(texture, texture.m_pendingMip);
+      isUploading = true;
+    }
+  }
+
+  // One mip at a time, the coarser mips of every texture land before the finest ones of any. Only the new mip is staged, the others are copied from the current image.
+  std::vector<StreamedTexture*> upgradedTextures;
+  std::vector<VulkanCookedMips> uploads;
+  vk::DeviceSize uploadSize = 0;
+  for (auto textureIndex : order)
+  {
+    auto& texture = *m_textures[textureIndex];
+    if (texture.m_pendingImage || targetMips[textureIndex] >= texture.m_residentMip)
+    {
+      continue;
+    }
+
+    // Counted next to the current image, a texture that only fits without it stays a mip short of its target.
+    const auto mipLevel = texture.m_residentMip - 1;
+    const auto size = getMipChainSize(texture, mipLevel);
+    const auto mipSize = texture.m_cache.getMip(mipLevel).m_size;
+    if (usedSize + size > m_budget || (uploadSize > 0 && uploadSize + mipSize > c_maxUpdateUploadSize))
+    {
+      continue;
+    }
+
+    texture.m_pendingMip = mipLevel;
+    texture.m_pendingImage = createImage(texture, mipLevel);
+    upgradedTextures.push_back(&texture);
+    uploads.push_back({&texture.m_cache, mipLevel, 1, texture.m_pendingImage.get()});
+    usedSize += size;
+    uploadSize += mipSize;
+  }
+
+  if (!uploads.empty())
+  {
+    // The copies are recorded after the uploads, in their batch or a later one if the staging ring had to flush.
+    m_textureLoader->uploadCookedMips(uploads, m_workers, m_workers ? m_workers->getWorkerCount() : 1);
+    for (auto* texture : upgradedTextures)
+    {
+      texture->m_pendingTicket = copyResidentMips(*texture, vk::ImageLayout::eShaderReadOnlyOptimal);
+    }
+    isUploading = true;
+  }
+
+  if (isUploading)
+  {
+    m_uploadManager->flush();
+  }
+
+  for (auto& texture : m_textures)
+  {
+    texture->m_requestedMip = texture->m_tailMip;
+    texture->m_priority = 0.0f;
+  }
+}
+
+const VulkanImage& VulkanTextureStreamer::getImage(VulkanStreamedTexture texture) const
+{
+  return *m_textures[texture]->m_image;
+}
+
+uint32_t VulkanTextureStreamer::getResidentMip(VulkanStreamedTexture texture) const
+{
+  return m_textures[texture]->m_residentMip;
+}
+
+uint32_t VulkanTextureStreamer::getMipCount(VulkanStreamedTexture texture) const
+{
+  return m_textures[texture]->m_cache.getMipCount();
+}
+
+vk::Extent2D VulkanTextureStreamer::getExtent(VulkanStreamedTexture texture) const
+{
+  const auto& header = m_textures[texture]->m_cache.getHeader();
+  return {header.m_width, header.m_height};
+}
+
+VulkanTextureStreamingStats VulkanTextureStreamer::getStats() const
+{
+  VulkanTextureStreamingStats stats{};
+  stats.m_budget = m_budget;
+  for (const auto& texture : m_textures)
+  {
+    stats.m_residentSize += getMipChainSize(*texture, texture->m_residentMip);
+    if (texture->m_pendingImage)
+    {
+      stats.m_pendingSize += getMipChainSize(*texture, texture->m_pendingMip);
+      stats.m_pendingTextureCount++;
+    }
+  }
+  return stats;
+}
+
+vk::DeviceSize VulkanTextureStreamer::getMipChainSize(const StreamedTexture& texture, uint32_t mipLevel) const
+{
+  const auto& lastMip = texture.m_cache.getMip(texture.m_cache.getMipCount() - 1);
+  return lastMip.m_offset + lastMip.m_size - texture.m_cache.getMip(mipLevel).m_offset;
+}
+
+std::unique_ptr<VulkanImage> VulkanTextureStreamer::createImage(const StreamedTexture& texture, uint32_t mipLevel) const
+{
+  const auto& topMip = texture.m_cache.getMip(mipLevel);
+  const auto mipCount = texture.m_cache.getMipCount() - mipLevel;
+
+  // The image is the source of the copies when it is replaced.
+  auto imageUsage = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+  return m_device->createImage({topMip.m_width, topMip.m_height}, mipCount, getVkFormat(texture.m_cache.getHeader().m_format), vk::ImageTiling::eOptimal, imageUsage, vk::MemoryPropertyFlagBits::eDeviceLocal, vk::ImageAspectFlagBits::eColor);
+}
+
+VulkanUploadTicket VulkanTextureStreamer::copyResidentMips(const StreamedTexture& texture, vk::ImageLayout pendingLayout)
+{
+  // The mips both images hold, from the finer top of the two.
+  const auto firstMip = std::max(texture.m_residentMip, texture.m_pendingMip);
+  const auto mipCount = texture.m_cache.getMipCount() - firstMip;
+
+  std::vector<vk::ImageCopy> copyRegions(mipCount);
+  for (uint32_t i = 0; i < mipCount; i++)
+  {
+    const auto& mip = texture.m_cache.getMip(firstMip + i);
+    auto& copyRegion = copyRegions[i];
+    copyRegion.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+    copyRegion.srcSubresource.mipLevel = firstMip + i - texture.m_residentMip;
+    copyRegion.srcSubresource.baseArrayLayer = 0;
+    copyRegion.srcSubresource.layerCount = 1;
+    copyRegion.srcOffset = vk::Offset3D{0, 0, 0};
+
+    copyRegion.dstSubresource = copyRegion.srcSubresource;
+    copyRegion.dstSubresource.mipLevel = firstMip + i - texture.m_pendingMip;
+    copyRegion.dstOffset = vk::Offset3D{0, 0, 0};
+
+    copyRegion.extent = vk::Extent3D{mip.m_width, mip.m_height, 1};
+  }
+
+  return m_uploadManager->copyImage(texture.m_image->getImage(), texture.m_pendingImage->getImage(), pendingLayout, copyRegions, vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead);
+}
+
+void VulkanTextureStreamer::swapCompletedUploads()
+{
+  for (auto& texture : m_textures)
+  {
+    if (!texture->m_pendingImage || !m_uploadManager->isComplete(texture->m_pendingTicket))
+    {
+      continue;
+    }
+
+    // Frames in flight may still sample the previous image.
+    m_device->getTimeline().retire(std::move(texture->m_image));
+    texture->m_image = std::move(texture->m_pendingImage);
+    texture->m_residentMip = texture->m_pendingMip;
+    texture->m_pendingTicket = 0;
+    m_version++;
+  }
+}
+
+std::vector<uint32_t> VulkanTextureStreamer::computeTargetMips() const
+{
+  std::vector<uint32_t> targetMips(m_textures.size());
+  vk::DeviceSize size = 0;
+  for (size_t i = 0; i < m_textures.size(); i++)
+  {
+    targetMips[i] = m_textures[i]->m_tailMip;
+    size += getMipChainSize(*m_textures[i], targetMips[i]);
+  }
+
+  std::vector<uint32_t> order(m_textures.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return m_textures[a]->m_priority > m_textures[b]->m_priority; });
+
+  // The budget is handed out a mip at a time by priority, so a large texture in front cannot starve the others of their coarse mips.
+  bool isGrowing = true;
+  while (isGrowing)
+  {
+    isGrowing = false;
+    for (auto textureIndex : order)
+    {
+      const auto& texture = *m_textures[textureIndex];
+      auto& targetMip = targetMips[textureIndex];
+      if (targetMip <= texture.m_requestedMip)
+      {
+        continue;
+      }
+
+      // A mip is staged whole, the ones larger than the staging ring are never streamed in.
+      auto growth = getMipChainSize(texture, targetMip - 1) - getMipChainSize(texture, targetMip);
+      if (size + growth <= m_budget && texture.m_cache.getMip(targetMip - 1).m_size <= m_textureLoader->getStagingSize())
+      {
+        size += growth;
+        targetMip--;
+        isGrowing = true;
+      }
+    }
+  }
+
+  return targetMips;
+}
+} // namespace VkHal
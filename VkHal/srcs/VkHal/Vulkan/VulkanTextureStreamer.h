@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "VkHal/TextureCache.h"
+#include "VkHal/Vulkan/VulkanUploadManager.h"
+
+namespace VkHal
+{
+class VulkanDevice;
+class VulkanImage;
+class VulkanRecordingWorkers;
+class VulkanTextureLoader;
+
+/** @brief Index of a texture in its streamer. */
+using VulkanStreamedTexture = uint32_t;
+
+struct VulkanTextureStreamingStats
+{
+  vk::DeviceSize m_residentSize = 0;
+  vk::DeviceSize m_pendingSize = 0;
+  vk::DeviceSize m_budget = 0;
+  uint32_t m_pendingTextureCount = 0;
+};
+
+/**
+ * @brief Keeps texture caches mapped and their images resident from a requested mip down, under a memory budget.
+ * A texture starts with its mip tail. The images only hold their resident mips: a residency change allocates the image of the new top mip,
+ * stages the mip it gains through the loader's ring, copies the mips it keeps from the current image and swaps it in once the upload completed.
+ * The previous image is retired to the device timeline.
+ */
+class VulkanTextureStreamer
+{
+public:
+  /** @brief Mips of at most tailSize texels per side are the tail, always resident even over the budget. The mips are copied to the loader's staging ring on the workers. */
+  VulkanTextureStreamer(const VulkanDevice* device, VulkanUploadManager* uploadManager, VulkanTextureLoader* textureLoader, VulkanRecordingWorkers* workers, vk::DeviceSize budget, uint32_t tailSize);
+  ~VulkanTextureStreamer();
+
+  VulkanTextureStreamer(const VulkanTextureStreamer&) = delete;
+  VulkanTextureStreamer& operator=(const VulkanTextureStreamer&) = delete;
+
+  /** @brief Takes the cache and uploads its mip tail. The image is usable once the upload manager completed the ticket of its next flush. */
+  VulkanStreamedTexture addTexture(TextureCache&& textureCache);
+
+  /**
+   * @brief Asks for the texture to be resident from mipLevel down. The textures of higher priority get the budget first.
+   * Requests are consumed by the next update, a texture nobody asked for falls back to its tail.
+   */
+  void requestMip(VulkanStreamedTexture texture, uint32_t mipLevel, float priority);
+
+  /**
+   * @brief Swaps in the completed uploads, fits the resident mips to the budget by priority and starts the uploads toward them. Called once per frame.
+   * The version changes whenever an image is swapped, the descriptors referencing the images must then be rewritten.
+   */
+  void update();
+
+  const VulkanImage& getImage(VulkanStreamedTexture texture) const;
+
+  /** @brief Mip of the cache the image starts at. */
+  uint32_t getResidentMip(VulkanStreamedTexture texture) const;
+
+  /** @brief Mip count of the whole chain in the cache. */
+  uint32_t getMipCount(VulkanStreamedTexture texture) const;
+
+  /** @brief Size of mip 0 in the cache. */
+  vk::Extent2D getExtent(VulkanStreamedTexture texture) const;
+
+  uint64_t getVersion() const
+  {
+    return m_version;
+  }
+
+  VulkanTextureStreamingStats getStats() const;
+
+private:
+  struct StreamedTexture
+  {
+    explicit StreamedTexture(TextureCache&& textureCache)
+        : m_cache{std::move(textureCache)}
+    {
+    }
+
+    TextureCache m_cache;
+    uint32_t m_tailMip = 0;
+
+    std::unique_ptr<VulkanImage> m_image;
+    uint32_t m_residentMip = 0;
+
+    std::unique_ptr<VulkanImage> m_pendingImage;
+    uint32_t m_pendingMip = 0;
+    VulkanUploadTicket m_pendingTicket = 0;
+
+    uint32_t m_requestedMip = 0;
+    float m_priority = 0.0f;
+  };
+
+  /** @brief Cooked size of the mips from mipLevel to the end of the chain, what the image holding them takes. */
+  vk::DeviceSize getMipChainSize(const StreamedTexture& texture, uint32_t mipLevel) const;
+
+  /** @brief Image of the mips from mipLevel down. */
+  std::unique_ptr<VulkanImage> createImage(const StreamedTexture& texture, uint32_t mipLevel) const;
+
+  /** @brief Records the copy of the mips the current and the pending image share. The pending image is in pendingLayout, eUndefined if nothing was uploaded to it. */
+  VulkanUploadTicket copyResidentMips(const StreamedTexture& texture, vk::ImageLayout pendingLayout);
+
+  void swapCompletedUploads();
+
+  /** @brief Top mip each texture gets: the requested ones by decreasing priority while they fit the budget, the others stay at their tail. */
+  std::vector<uint32_t> computeTargetMips() const;
+
+  const VulkanDevice* m_device;
+  VulkanUploadManager* m_uploadManager;
+  VulkanTextureLoader* m_textureLoader;
+  VulkanRecordingWorkers* m_workers;
+  vk::DeviceSize m_budget;
+  uint32_t m_tailSize;
+
+  std::vector<std::unique_ptr<StreamedTexture>> m_textures;
+  uint64_t m_version = 0;
+};
+} // namespace VkHal
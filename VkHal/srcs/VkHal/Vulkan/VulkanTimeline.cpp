@@ -0,0 +1,118 @@
+#include "VulkanTimeline.h"
+
+#include <limits>
+
+namespace VkHal
+{
+VulkanTimeline::VulkanTimeline(const vk::Device& device)
+    : m_device{device}
+{
+}
+
+VulkanTimeline::~VulkanTimeline()
+{
+  wait(m_submittedValue);
+  m_retiredObjects.clear();
+}
+
+uint64_t VulkanTimeline::submit(vk::Queue queue, vk::ArrayProxy<const vk::SubmitInfo> submitInfos)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  vk::UniqueFence fence;
+  if (!m_freeFences.empty())
+  {
+    fence = std::move(m_freeFences.back());
+    m_freeFences.pop_back();
+  }
+  else
+  {
+    fence = m_device.createFenceUnique(vk::FenceCreateInfo{});
+  }
+
+  queue.submit(submitInfos, fence.get());
+
+  m_pendingSubmissions.emplace_back(++m_submittedValue, std::move(fence));
+
+  return m_submittedValue;
+}
+
+uint64_t VulkanTimeline::getSubmittedValue() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  return m_submittedValue;
+}
+
+void VulkanTimeline::pollPendingSubmissions()
+{
+  // Submissions on different queues can complete out of order, the completed value only moves past a value once everything before it completed.
+  while (!m_pendingSubmissions.empty())
+  {
+    auto& [value, fence] = m_pendingSubmissions.front();
+    if (m_device.getFenceStatus(fence.get()) != vk::Result::eSuccess)
+    {
+      break;
+    }
+
+    m_completedValue = value;
+    m_device.resetFences(fence.get());
+    m_freeFences.push_back(std::move(fence));
+    m_pendingSubmissions.pop_front();
+  }
+}
+
+uint64_t VulkanTimeline::getCompletedValue()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  pollPendingSubmissions();
+
+  return m_completedValue;
+}
+
+void VulkanTimeline::wait(uint64_t value)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  for (const auto& [pendingValue, fence] : m_pendingSubmissions)
+  {
+    if (pendingValue > value)
+    {
+      break;
+    }
+
+    m_device.waitForFences(fence.get(), VK_TRUE, std::numeric_limits<uint64_t>::max());
+  }
+
+  pollPendingSubmissions();
+}
+
+void VulkanTimeline::retireObject(std::unique_ptr<RetiredObject> object)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_retiredObjects.emplace_back(m_submittedValue, std::move(object));
+}
+
+void VulkanTimeline::collect()
+{
+  std::deque<std::tuple<uint64_t, std::unique_ptr<RetiredObject>>> completedObjects;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    pollPendingSubmissions();
+
+    // Objects are retired with a non decreasing value.
+    while (!m_retiredObjects.empty() && std::get<0>(m_retiredObjects.front()) <= m_completedValue)
+    {
+      completedObjects.push_back(std::move(m_retiredObjects.front()));
+      m_retiredObjects.pop_front();
+    }
+  }
+
+  // Destroyed outside of the lock, a retired object can hold allocations that go back to the memory allocator.
+  completedObjects.clear();
+}
+} // namespace VkHal
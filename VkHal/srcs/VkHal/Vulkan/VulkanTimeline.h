@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace VkHal
+{
+/** @brief Device wide monotonic submission counter. Every submission made through it gets the next value, and objects retired
+           with it are destroyed once the GPU passed the value that was current when they were retired.
+           Timeline semaphores are not available with the 1.1.82 headers so each value is backed by a pooled fence. */
+class VulkanTimeline
+{
+public:
+  explicit VulkanTimeline(const vk::Device& device);
+  ~VulkanTimeline();
+
+  VulkanTimeline(const VulkanTimeline&) = delete;
+  VulkanTimeline& operator=(const VulkanTimeline&) = delete;
+
+  /** @brief Submits on the queue and returns the value that is reached when the submission completed. */
+  uint64_t submit(vk::Queue queue, vk::ArrayProxy<const vk::SubmitInfo> submitInfos);
+
+  uint64_t getSubmittedValue() const;
+
+  /** @brief Largest value such that every submission up to it completed. */
+  uint64_t getCompletedValue();
+
+  void wait(uint64_t value);
+
+  /** @brief Keeps the object alive until every submission made so far completed. */
+  template <typename Object_t>
+  void retire(Object_t&& object);
+
+  /** @brief Destroys the retired objects the GPU is done with. Called once per frame. */
+  void collect();
+
+private:
+  struct RetiredObject
+  {
+    virtual ~RetiredObject() = default;
+  };
+
+  template <typename Object_t>
+  struct RetiredObjectT : RetiredObject
+  {
+    explicit RetiredObjectT(Object_t&& object)
+        : m_object{std::move(object)}
+    {
+    }
+
+    Object_t m_object;
+  };
+
+  void retireObject(std::unique_ptr<RetiredObject> object);
+  void pollPendingSubmissions();
+
+  const vk::Device& m_device;
+
+  mutable std::mutex m_mutex;
+  uint64_t m_submittedValue = 0;
+  uint64_t m_completedValue = 0;
+
+  std::deque<std::tuple<uint64_t, vk::UniqueFence>> m_pendingSubmissions;
+  std::vector<vk::UniqueFence> m_freeFences;
+  std::deque<std::tuple<uint64_t, std::unique_ptr<RetiredObject>>> m_retiredObjects;
+};
+
+template <typename Object_t>
+void VulkanTimeline::retire(Object_t&& object)
+{
+  static_assert(!std::is_lvalue_reference_v<Object_t>, "Retired objects must be moved in.");
+
+  retireObject(std::make_unique<RetiredObjectT<Object_t>>(std::move(object)));
+}
+} // namespace VkHal
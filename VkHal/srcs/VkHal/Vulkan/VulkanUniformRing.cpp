@@ -0,0 +1,43 @@
+#include "VulkanUniformRing.h"
+
+#include <stdexcept>
+
+namespace VkHal
+{
+VulkanUniformRing::VulkanUniformRing(vk::UniqueBuffer&& buffer, VulkanAllocation&& memory, vk::DeviceSize frameSize, uint32_t frameCount, vk::DeviceSize alignment)
+    : m_memory{std::move(memory)}
+    , m_buffer{std::move(buffer)}
+    , m_frameSize{frameSize}
+    , m_frameCount{frameCount}
+    , m_alignment{alignment}
+{
+  if (!m_memory.getMappedData())
+  {
+    throw std::runtime_error("Uniform ring memory must be host visible.");
+  }
+}
+
+void VulkanUniformRing::beginFrame(uint32_t frameIndex)
+{
+  m_frameBegin = (frameIndex % m_frameCount) * m_frameSize;
+  m_head = m_frameBegin;
+}
+
+VulkanUniformRange VulkanUniformRing::allocate(vk::DeviceSize size)
+{
+  auto offset = (m_head + m_alignment - 1) & ~(m_alignment - 1);
+  if (offset + size > m_frameBegin + m_frameSize)
+  {
+    throw std::runtime_error("Uniform ring frame region exhausted.");
+  }
+
+  m_head = offset + size;
+
+  VulkanUniformRange range{};
+  range.m_data = static_cast<char*>(m_memory.getMappedData()) + offset;
+  range.m_dynamicOffset = (uint32_t)offset;
+  range.m_size = size;
+
+  return range;
+}
+} // namespace VkHal
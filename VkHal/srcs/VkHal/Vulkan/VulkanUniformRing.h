@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstring>
+
+#include <vulkan/vulkan.hpp>
+
+#include "VkHal/Vulkan/VulkanMemoryAllocator.h"
+
+namespace VkHal
+{
+struct VulkanUniformRange
+{
+  void* m_data = nullptr;
+  uint32_t m_dynamicOffset = 0;
+  vk::DeviceSize m_size = 0;
+};
+
+/** @brief Persistently mapped uniform buffer split in one linear region per frame resource. Ranges are bound with dynamic offsets. */
+class VulkanUniformRing
+{
+public:
+  VulkanUniformRing(vk::UniqueBuffer&& buffer, VulkanAllocation&& memory, vk::DeviceSize frameSize, uint32_t frameCount, vk::DeviceSize alignment);
+  ~VulkanUniformRing() = default;
+
+  /** @brief Rewinds the region of the frame. The caller must have waited on the frame fence first. */
+  void beginFrame(uint32_t frameIndex);
+
+  VulkanUniformRange allocate(vk::DeviceSize size);
+
+  template <typename Data_t>
+  VulkanUniformRange push(const Data_t& data);
+
+  const vk::Buffer& getBuffer() const
+  {
+    return m_buffer.get();
+  }
+
+  vk::DeviceSize getFrameSize() const
+  {
+    return m_frameSize;
+  }
+
+  vk::DeviceSize getFrameBytesUsed() const
+  {
+    return m_head - m_frameBegin;
+  }
+
+private:
+  VulkanAllocation m_memory;
+  vk::UniqueBuffer m_buffer;
+
+  vk::DeviceSize m_frameSize = 0;
+  uint32_t m_frameCount = 0;
+  vk::DeviceSize m_alignment = 1;
+
+  vk::DeviceSize m_frameBegin = 0;
+  vk::DeviceSize m_head = 0;
+};
+
+template <typename Data_t>
+VulkanUniformRange VulkanUniformRing::push(const Data_t& data)
+{
+  auto range = allocate(sizeof(Data_t));
+  memcpy(range.m_data, &data, sizeof(Data_t));
+
+  return range;
+}
+} // namespace VkHal
@@ -0,0 +1,384 @@
+#include "VulkanUploadManager.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "VkHal/Vulkan/VulkanDevice.h"
+
+namespace VkHal
+{
+VulkanUploadManager::VulkanUploadManager(const VulkanDevice* device, vk::Queue transferQueue, uint32_t transferQueueFamily, vk::Queue graphicsQueue, uint32_t graphicsQueueFamily)
+    : m_device{device}
+    , m_transferQueue{transferQueue}
+    , m_transferQueueFamily{transferQueueFamily}
+    , m_graphicsQueue{graphicsQueue}
+    , m_graphicsQueueFamily{graphicsQueueFamily}
+{
+  m_transferCmdPool = m_device->createCommandPool(m_transferQueueFamily, vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient);
+  m_graphicsCmdPool = m_device->createCommandPool(m_graphicsQueueFamily, vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient);
+}
+
+VulkanUploadManager::~VulkanUploadManager()
+{
+  if (!m_inFlightBatches.empty())
+  {
+    m_device->getTimeline().wait(m_inFlightBatches.back()->m_timelineValue);
+  }
+}
+
+std::unique_ptr<VulkanUploadManager::UploadBatch> VulkanUploadManager::createBatch()
+{
+  auto batch = std::make_unique<UploadBatch>();
+  batch->m_transferCmdBuffer = std::move(m_device->allocateCommandBuffer(m_transferCmdPool.get(), 1, true)[0]);
+  batch->m_graphicsCmdBuffer = std::move(m_device->allocateCommandBuffer(m_graphicsCmdPool.get(), 1, true)[0]);
+  batch->m_ownershipSemaphore = m_device->createSemaphore();
+
+  return batch;
+}
+
+VulkanUploadManager::UploadBatch& VulkanUploadManager::getRecordingBatch()
+{
+  if (m_recordingBatch)
+  {
+    return *m_recordingBatch;
+  }
+
+  if (!m_freeBatches.empty())
+  {
+    m_recordingBatch = std::move(m_freeBatches.back());
+    m_freeBatches.pop_back();
+  }
+  else
+  {
+    m_recordingBatch = createBatch();
+  }
+
+  m_recordingBatch->m_ticket = m_nextTicket++;
+
+  vk::CommandBufferBeginInfo beginInfo{};
+  beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+  m_recordingBatch->m_transferCmdBuffer->begin(beginInfo);
+
+  return *m_recordingBatch;
+}
+
+VulkanUploadTicket VulkanUploadManager::uploadBuffer(const void* data, vk::DeviceSize size, vk::Buffer dstBuffer, vk::DeviceSize dstOffset, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess)
+{
+  auto [stagingBuffer, stagingMemory] = m_device->createBuffer(size, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+  memcpy(stagingMemory.getMappedData(), data, (size_t)size);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto& batch = getRecordingBatch();
+
+  vk::BufferCopy copyRegion{};
+  copyRegion.srcOffset = 0;
+  copyRegion.dstOffset = dstOffset;
+  copyRegion.size = size;
+  batch.m_transferCmdBuffer->copyBuffer(stagingBuffer.get(), dstBuffer, copyRegion);
+
+  vk::BufferMemoryBarrier barrier{};
+  barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+  barrier.dstAccessMask = dstAccess;
+  barrier.srcQueueFamilyIndex = needsOwnershipTransfer() ? m_transferQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = needsOwnershipTransfer() ? m_graphicsQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = dstBuffer;
+  barrier.offset = dstOffset;
+  barrier.size = size;
+  batch.m_bufferBarriers.push_back(barrier);
+  batch.m_dstStages |= dstStage;
+
+  batch.m_stagingBuffers.emplace_back(std::move(stagingBuffer), std::move(stagingMemory));
+
+  return batch.m_ticket;
+}
+
+VulkanUploadTicket VulkanUploadManager::uploadImage(const void* data, vk::DeviceSize size, vk::Image dstImage, uint32_t mipLevels, vk::ArrayProxy<const vk::BufferImageCopy> regions, vk::ImageLayout finalLayout, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess)
+{
+  auto [stagingBuffer, stagingMemory] = m_device->createBuffer(size, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+  memcpy(stagingMemory.getMappedData(), data, (size_t)size);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto& batch = getRecordingBatch();
+
+  recordImageUpload(batch, stagingBuffer.get(), dstImage, mipLevels, regions, finalLayout, dstStage, dstAccess);
+
+  batch.m_stagingBuffers.emplace_back(std::move(stagingBuffer), std::move(stagingMemory));
+
+  return batch.m_ticket;
+}
+
+VulkanUploadTicket VulkanUploadManager::uploadImage(vk::Buffer stagingBuffer, vk::Image dstImage, uint32_t mipLevels, vk::ArrayProxy<const vk::BufferImageCopy> regions, vk::ImageLayout finalLayout, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto& batch = getRecordingBatch();
+
+  recordImageUpload(batch, stagingBuffer, dstImage, mipLevels, regions, finalLayout, dstStage, dstAccess);
+
+  return batch.m_ticket;
+}
+
+void VulkanUploadManager::recordImageUpload(UploadBatch& batch, vk::Buffer stagingBuffer, vk::Image dstImage, uint32_t mipLevels, vk::ArrayProxy<const vk::BufferImageCopy> regions, vk::ImageLayout finalLayout, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess)
+{
+  vk::ImageMemoryBarrier barrier{};
+  barrier.oldLayout = vk::ImageLayout::eUndefined;
+  barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = dstImage;
+  barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = mipLevels;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+  barrier.srcAccessMask = vk::AccessFlags{};
+  barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+  batch.m_transferCmdBuffer->pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags{}, nullptr, nullptr, barrier);
+
+  batch.m_transferCmdBuffer->copyBufferToImage(stagingBuffer, dstImage, vk::ImageLayout::eTransferDstOptimal, regions);
+
+  barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+  barrier.newLayout = finalLayout;
+  barrier.srcQueueFamilyIndex = needsOwnershipTransfer() ? m_transferQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = needsOwnershipTransfer() ? m_graphicsQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+  barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+  barrier.dstAccessMask = dstAccess;
+  batch.m_imageBarriers.push_back(barrier);
+  batch.m_dstStages |= dstStage;
+}
+
+VulkanUploadTicket VulkanUploadManager::copyImage(vk::Image srcImage, vk::Image dstImage, vk::ImageLayout dstLayout, vk::ArrayProxy<const vk::ImageCopy> regions, vk::PipelineStageFlags stage, vk::AccessFlags access)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto& batch = getRecordingBatch();
+
+  batch.m_imageCopies.push_back({srcImage, dstImage, dstLayout, {regions.begin(), regions.end()}});
+  batch.m_copyStages |= stage;
+  batch.m_copyAccess |= access;
+
+  return batch.m_ticket;
+}
+
+void VulkanUploadManager::recordImageCopies(UploadBatch& batch, vk::CommandBuffer graphicsCmdBuffer)
+{
+  vk::ImageMemoryBarrier barrier{};
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+
+  // The sources are sampled by the frames submitted before, the transitions wait for their readers.
+  std::vector<vk::ImageMemoryBarrier> copyBarriers;
+  std::vector<vk::ImageMemoryBarrier> readBarriers;
+  for (const auto& imageCopy : batch.m_imageCopies)
+  {
+    barrier.image = imageCopy.m_srcImage;
+    barrier.oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
+    barrier.srcAccessMask = vk::AccessFlags{};
+    barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+    copyBarriers.push_back(barrier);
+
+    barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+    barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    barrier.srcAccessMask = vk::AccessFlags{};
+    barrier.dstAccessMask = batch.m_copyAccess;
+    readBarriers.push_back(barrier);
+
+    barrier.image = imageCopy.m_dstImage;
+    barrier.oldLayout = imageCopy.m_dstLayout;
+    barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.srcAccessMask = vk::AccessFlags{};
+    barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+    copyBarriers.push_back(barrier);
+
+    barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = batch.m_copyAccess;
+    readBarriers.push_back(barrier);
+  }
+
+  graphicsCmdBuffer.pipelineBarrier(batch.m_copyStages | batch.m_dstStages, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags{}, nullptr, nullptr, copyBarriers);
+
+  for (const auto& imageCopy : batch.m_imageCopies)
+  {
+    graphicsCmdBuffer.copyImage(imageCopy.m_srcImage, vk::ImageLayout::eTransferSrcOptimal, imageCopy.m_dstImage, vk::ImageLayout::eTransferDstOptimal, imageCopy.m_regions);
+  }
+
+  graphicsCmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, batch.m_copyStages, vk::DependencyFlags{}, nullptr, nullptr, readBarriers);
+}
+
+void VulkanUploadManager::flushRecordingBatch()
+{
+  if (!m_recordingBatch)
+  {
+    return;
+  }
+
+  auto& batch = *m_recordingBatch;
+  auto& timeline = m_device->getTimeline();
+  auto& transferCmdBuffer = batch.m_transferCmdBuffer.get();
+
+  if (!needsOwnershipTransfer() && batch.m_imageCopies.empty())
+  {
+    // Same queue family, a plain barrier makes the copies visible to their consumers.
+    transferCmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, batch.m_dstStages, vk::DependencyFlags{}, nullptr, batch.m_bufferBarriers, batch.m_imageBarriers);
+    transferCmdBuffer.end();
+
+    vk::SubmitInfo submitInfo{};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &transferCmdBuffer;
+
+    batch.m_timelineValue = timeline.submit(m_transferQueue, submitInfo);
+  }
+  else
+  {
+    // A batch of image copies only has no upload to release or acquire.
+    const auto hasUploads = batch.m_dstStages != vk::PipelineStageFlags{};
+
+    // Release on the transfer queue, the destination access is ignored for a release.
+    auto bufferReleases = batch.m_bufferBarriers;
+    auto imageReleases = batch.m_imageBarriers;
+    if (needsOwnershipTransfer())
+    {
+      std::for_each(begin(bufferReleases), end(bufferReleases), [](auto& barrier) { barrier.dstAccessMask = vk::AccessFlags{}; });
+      std::for_each(begin(imageReleases), end(imageReleases), [](auto& barrier) { barrier.dstAccessMask = vk::AccessFlags{}; });
+    }
+
+    if (hasUploads)
+    {
+      auto dstStages = needsOwnershipTransfer() ? vk::PipelineStageFlags{vk::PipelineStageFlagBits::eBottomOfPipe} : batch.m_dstStages;
+      transferCmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, dstStages, vk::DependencyFlags{}, nullptr, bufferReleases, imageReleases);
+    }
+    transferCmdBuffer.end();
+
+    auto& graphicsCmdBuffer = batch.m_graphicsCmdBuffer.get();
+
+    vk::CommandBufferBeginInfo beginInfo{};
+    beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    graphicsCmdBuffer.begin(beginInfo);
+
+    if (needsOwnershipTransfer() && hasUploads)
+    {
+      // Acquire on the graphics queue, the source access is ignored for an acquire.
+      auto bufferAcquires = batch.m_bufferBarriers;
+      auto imageAcquires = batch.m_imageBarriers;
+      std::for_each(begin(bufferAcquires), end(bufferAcquires), [](auto& barrier) { barrier.srcAccessMask = vk::AccessFlags{}; });
+      std::for_each(begin(imageAcquires), end(imageAcquires), [](auto& barrier) { barrier.srcAccessMask = vk::AccessFlags{}; });
+
+      graphicsCmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, batch.m_dstStages, vk::DependencyFlags{}, nullptr, bufferAcquires, imageAcquires);
+    }
+
+    if (!batch.m_imageCopies.empty())
+    {
+      recordImageCopies(batch, graphicsCmdBuffer);
+    }
+    graphicsCmdBuffer.end();
+
+    vk::SubmitInfo transferSubmitInfo{};
+    transferSubmitInfo.commandBufferCount = 1;
+    transferSubmitInfo.pCommandBuffers = &transferCmdBuffer;
+    transferSubmitInfo.signalSemaphoreCount = 1;
+    transferSubmitInfo.pSignalSemaphores = &batch.m_ownershipSemaphore.get();
+
+    timeline.submit(m_transferQueue, transferSubmitInfo);
+
+    vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eAllCommands;
+
+    vk::SubmitInfo graphicsSubmitInfo{};
+    graphicsSubmitInfo.waitSemaphoreCount = 1;
+    graphicsSubmitInfo.pWaitSemaphores = &batch.m_ownershipSemaphore.get();
+    graphicsSubmitInfo.pWaitDstStageMask = &waitStage;
+    graphicsSubmitInfo.commandBufferCount = 1;
+    graphicsSubmitInfo.pCommandBuffers = &graphicsCmdBuffer;
+
+    batch.m_timelineValue = timeline.submit(m_graphicsQueue, graphicsSubmitInfo);
+  }
+
+  timeline.retire(std::move(batch.m_stagingBuffers));
+  batch.m_stagingBuffers.clear();
+
+  m_lastSubmittedTicket = batch.m_ticket;
+  m_inFlightBatches.push_back(std::move(m_recordingBatch));
+}
+
+VulkanUploadTicket VulkanUploadManager::flush()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  flushRecordingBatch();
+
+  return m_lastSubmittedTicket;
+}
+
+void VulkanUploadManager::collectCompletedBatches()
+{
+  auto completedValue = m_device->getTimeline().getCompletedValue();
+
+  while (!m_inFlightBatches.empty() && m_inFlightBatches.front()->m_timelineValue <= completedValue)
+  {
+    auto batch = std::move(m_inFlightBatches.front());
+    m_inFlightBatches.pop_front();
+
+    m_lastCompletedTicket = batch->m_ticket;
+
+    batch->m_bufferBarriers.clear();
+    batch->m_imageBarriers.clear();
+    batch->m_dstStages = vk::PipelineStageFlags{};
+    batch->m_imageCopies.clear();
+    batch->m_copyStages = vk::PipelineStageFlags{};
+    batch->m_copyAccess = vk::AccessFlags{};
+    batch->m_transferCmdBuffer->reset(vk::CommandBufferResetFlags{});
+    batch->m_graphicsCmdBuffer->reset(vk::CommandBufferResetFlags{});
+
+    m_freeBatches.push_back(std::move(batch));
+  }
+}
+
+bool VulkanUploadManager::isComplete(VulkanUploadTicket ticket)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (ticket <= m_lastCompletedTicket)
+  {
+    return true;
+  }
+
+  collectCompletedBatches();
+
+  return ticket <= m_lastCompletedTicket;
+}
+
+void VulkanUploadManager::wait(VulkanUploadTicket ticket)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (ticket <= m_lastCompletedTicket)
+  {
+    return;
+  }
+
+  if (ticket > m_lastSubmittedTicket)
+  {
+    flushRecordingBatch();
+  }
+
+  auto it = std::find_if(cbegin(m_inFlightBatches), cend(m_inFlightBatches), [ticket](const auto& batch) { return batch->m_ticket >= ticket; });
+  if (it != cend(m_inFlightBatches))
+  {
+    m_device->getTimeline().wait((*it)->m_timelineValue);
+  }
+
+  collectCompletedBatches();
+}
+
+void VulkanUploadManager::collect()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  collectCompletedBatches();
+}
+} // namespace VkHal
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "VkHal/Vulkan/VulkanMemoryAllocator.h"
+
+namespace VkHal
+{
+class VulkanDevice;
+
+/** @brief Identifies a submitted upload batch. Tickets increase monotonically, 0 is always complete. */
+using VulkanUploadTicket = uint64_t;
+
+/**
+ * @brief Records buffer and image uploads into batches submitted on the transfer queue, with the queue family ownership transfer to the graphics queue.
+ * Copies between images, which the graphics queue samples, run on the graphics queue after the uploads of their batch.
+ */
+class VulkanUploadManager
+{
+public:
+  VulkanUploadManager(const VulkanDevice* device, vk::Queue transferQueue, uint32_t transferQueueFamily, vk::Queue graphicsQueue, uint32_t graphicsQueueFamily);
+  ~VulkanUploadManager();
+
+  /** @brief Copies data to a staging buffer right away and records the copy in the current batch. Returns the ticket of that batch. */
+  VulkanUploadTicket uploadBuffer(const void* data, vk::DeviceSize size, vk::Buffer dstBuffer, vk::DeviceSize dstOffset, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess);
+
+  /** @brief Region buffer offsets are relative to data. All mips are moved to eTransferDstOptimal before the copies and to finalLayout after. */
+  VulkanUploadTicket uploadImage(const void* data, vk::DeviceSize size, vk::Image dstImage, uint32_t mipLevels, vk::ArrayProxy<const vk::BufferImageCopy> regions, vk::ImageLayout finalLayout, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess);
+
+  /** @brief Same without the copy, the pixels already are in a staging buffer the caller keeps alive until the ticket completed. Region buffer offsets are relative to stagingBuffer. */
+  VulkanUploadTicket uploadImage(vk::Buffer stagingBuffer, vk::Image dstImage, uint32_t mipLevels, vk::ArrayProxy<const vk::BufferImageCopy> regions, vk::ImageLayout finalLayout, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess);
+
+  /**
+   * @brief Records a copy between two images on the graphics queue, run once the uploads of the current batch are acquired, so a copy can read or complete an upload of the batch.
+   * srcImage is sampled by stage in eShaderReadOnlyOptimal and is back in it after the copy. dstImage goes from dstLayout, eUndefined for an image nothing wrote yet, to eShaderReadOnlyOptimal.
+   */
+  VulkanUploadTicket copyImage(vk::Image srcImage, vk::Image dstImage, vk::ImageLayout dstLayout, vk::ArrayProxy<const vk::ImageCopy> regions, vk::PipelineStageFlags stage, vk::AccessFlags access);
+
+  /** @brief Submits the current batch. Returns the ticket of the last submitted batch if nothing was recorded. */
+  VulkanUploadTicket flush();
+
+  bool isComplete(VulkanUploadTicket ticket);
+  void wait(VulkanUploadTicket ticket);
+
+  /** @brief Recycles the batches the GPU is done with. Staging memory is retired to the device timeline. */
+  void collect();
+
+private:
+  struct ImageCopy
+  {
+    vk::Image m_srcImage;
+    vk::Image m_dstImage;
+    vk::ImageLayout m_dstLayout = vk::ImageLayout::eUndefined;
+    std::vector<vk::ImageCopy> m_regions;
+  };
+
+  struct UploadBatch
+  {
+    VulkanUploadTicket m_ticket = 0;
+    vk::UniqueCommandBuffer m_transferCmdBuffer;
+    vk::UniqueCommandBuffer m_graphicsCmdBuffer;
+    vk::UniqueSemaphore m_ownershipSemaphore;
+    uint64_t m_timelineValue = 0;
+
+    std::vector<std::tuple<vk::UniqueBuffer, VulkanAllocation>> m_stagingBuffers;
+    std::vector<vk::BufferMemoryBarrier> m_bufferBarriers;
+    std::vector<vk::ImageMemoryBarrier> m_imageBarriers;
+    vk::PipelineStageFlags m_dstStages;
+
+    std::vector<ImageCopy> m_imageCopies;
+    vk::PipelineStageFlags m_copyStages;
+    vk::AccessFlags m_copyAccess;
+  };
+
+  bool needsOwnershipTransfer() const
+  {
+    return m_transferQueueFamily != m_graphicsQueueFamily;
+  }
+
+  UploadBatch& getRecordingBatch();
+  void recordImageUpload(UploadBatch& batch, vk::Buffer stagingBuffer, vk::Image dstImage, uint32_t mipLevels, vk::ArrayProxy<const vk::BufferImageCopy> regions, vk::ImageLayout finalLayout, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess);
+  void recordImageCopies(UploadBatch& batch, vk::CommandBuffer graphicsCmdBuffer);
+  std::unique_ptr<UploadBatch> createBatch();
+  void flushRecordingBatch();
+  void collectCompletedBatches();
+
+  const VulkanDevice* m_device;
+
+  vk::Queue m_transferQueue;
+  uint32_t m_transferQueueFamily;
+  vk::Queue m_graphicsQueue;
+  uint32_t m_graphicsQueueFamily;
+
+  vk::UniqueCommandPool m_transferCmdPool;
+  vk::UniqueCommandPool m_graphicsCmdPool;
+
+  std::mutex m_mutex;
+  VulkanUploadTicket m_nextTicket = 1;
+  VulkanUploadTicket m_lastSubmittedTicket = 0;
+  VulkanUploadTicket m_lastCompletedTicket = 0;
+
+  std::unique_ptr<UploadBatch> m_recordingBatch;
+  std::deque<std::unique_ptr<UploadBatch>> m_inFlightBatches;
+  std::vector<std::unique_ptr<UploadBatch>> m_freeBatches;
+};
+} // namespace VkHal
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "VkHal/MeshSimplifier.h"
+#include "VkHal/VkMesh.h"
+
+#include "VkHalTests.h"
+
+namespace VkHalTests
+{
+namespace
+{
+struct TestMesh
+{
+  std::vector<VkHal::Vertex> m_vertices;
+  std::vector<uint32_t> m_indices;
+};
+
+/** @brief Open heightfield of size x size vertices, rolling hills with some noise so every collapse has a different error. Its border is locked. */
+TestMesh createTerrain(uint32_t size)
+{
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<float> noise(-0.002f, 0.002f);
+
+  TestMesh mesh;
+  for (uint32_t y = 0; y < size; y++)
+  {
+    for (uint32_t x = 0; x < size; x++)
+    {
+      auto u = (float)x / (size - 1);
+      auto v = (float)y / (size - 1);
+      auto height = 0.05f * std::sin(u * 6.0f) * std::cos(v * 4.0f) + noise(random);
+      mesh.m_vertices.push_back({glm::vec3(u, v, height), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(u, v)});
+    }
+  }
+
+  for (uint32_t y = 0; y + 1 < size; y++)
+  {
+    for (uint32_t x = 0; x + 1 < size; x++)
+    {
+      auto corner = y * size + x;
+      mesh.m_indices.insert(mesh.m_indices.end(), {corner, corner + 1, corner + size, corner + 1, corner + size + 1, corner + size});
+    }
+  }
+  return mesh;
+}
+
+/** @brief Closed UV sphere of unit radius. The texture coordinate seam duplicates the vertices of one meridian, which stay locked. */
+TestMesh createSphere(uint32_t ringCount, uint32_t segmentCount)
+{
+  constexpr float pi = 3.14159265358979f;
+
+  TestMesh mesh;
+  for (uint32_t ring = 0; ring <= ringCount; ring++)
+  {
+    auto v = (float)ring / ringCount;
+    for (uint32_t segment = 0; segment <= segmentCount; segment++)
+    {
+      auto u = (float)segment / segmentCount;
+      auto position = glm::vec3(std::sin(v * pi) * std::cos(u * 2.0f * pi), std::sin(v * pi) * std::sin(u * 2.0f * pi), std::cos(v * pi));
+      mesh.m_vertices.push_back({position, position, glm::vec2(u, v)});
+    }
+  }
+
+  const auto rowSize = segmentCount + 1;
+  for (uint32_t ring = 0; ring < ringCount; ring++)
+  {
+    for (uint32_t segment = 0; segment < segmentCount; segment++)
+    {
+      auto corner = ring * rowSize + segment;
+      if (ring != 0)
+      {
+        mesh.m_indices.insert(mesh.m_indices.end(), {corner, corner + rowSize, corner + 1});
+      }
+      if (ring + 1 != ringCount)
+      {
+        mesh.m_indices.insert(mesh.m_indices.end(), {corner + 1, corner + rowSize, corner + rowSize + 1});
+      }
+    }
+  }
+  return mesh;
+}
+
+void checkSimplification(const TestMesh& mesh)
+{
+  std::vector<uint32_t> lodIndices(mesh.m_indices.size());
+  std::vector<uint32_t> repeatIndices(mesh.m_indices.size());
+
+  size_t coarsestIndexCount = mesh.m_indices.size();
+  for (auto targetError : {0.0001f, 0.0005f, 0.001f, 0.005f, 0.01f, 0.05f})
+  {
+    float error = 0.0f;
+    auto indexCount = VkHal::simplifyMesh(lodIndices.data(), mesh.m_indices.data(), mesh.m_indices.size(), mesh.m_vertices.data(), mesh.m_vertices.size(), 0, targetError, &error);
+
+    // The LOD chain is part of the cooked data, cooking twice must give the same bytes.
+    auto repeatIndexCount = VkHal::simplifyMesh(repeatIndices.data(), mesh.m_indices.data(), mesh.m_indices.size(), mesh.m_vertices.data(), mesh.m_vertices.size(), 0, targetError);
+    check(repeatIndexCount == indexCount && std::equal(lodIndices.begin(), lodIndices.begin() + indexCount, repeatIndices.begin()), "Mesh simplification is not deterministic.");
+    check(error <= targetError, "Mesh simplification went over its target error.");
+    check(indexCount % 3 == 0 && std::all_of(lodIndices.begin(), lodIndices.begin() + indexCount, [&](uint32_t index) { return index < mesh.m_vertices.size(); }), "Mesh simplification wrote an invalid triangle list.");
+    coarsestIndexCount = indexCount;
+  }
+
+  // Both meshes have far more triangles than their shape needs at the coarsest target.
+  check(coarsestIndexCount < mesh.m_indices.size() / 2, "Mesh simplification left most triangles at the coarsest target error.");
+}
+} // namespace
+
+void testMeshSimplification()
+{
+  checkSimplification(createTerrain(64));
+  checkSimplification(createSphere(32, 64));
+}
+} // namespace VkHalTests
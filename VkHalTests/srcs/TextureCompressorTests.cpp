@@ -0,0 +1,52 @@
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "VkHal/TextureCompressor.h"
+#include "VkHal/Vulkan/VulkanRecordingWorkers.h"
+
+#include "VkHalTests.h"
+
+using namespace std::literals::string_literals;
+
+namespace VkHalTests
+{
+namespace
+{
+constexpr double c_minTexturePsnr = 30.0; // Under that the block artifacts are plainly visible.
+} // namespace
+
+void testTextureCompression()
+{
+  VkHal::VulkanRecordingWorkers workers(std::max(std::thread::hardware_concurrency(), 1u));
+
+  for (const auto* textureName : {"chalet.jpg", "texture.jpg"})
+  {
+    const auto texturePath = getDataPath() / "textures" / textureName;
+    int32_t width{};
+    int32_t height{};
+    int32_t channels{};
+    auto pixels = stbi_load(texturePath.u8string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    check(pixels != nullptr, "Failed to load texture image.");
+    std::vector<uint8_t> texels(pixels, pixels + (size_t)width * height * 4);
+    stbi_image_free(pixels);
+
+    std::vector<uint8_t> decodedTexels(texels.size());
+    for (auto format : {VkHal::TextureFormat::eBC1, VkHal::TextureFormat::eBC3, VkHal::TextureFormat::eBC5, VkHal::TextureFormat::eBC7})
+    {
+      std::vector<uint8_t> blocks(VkHal::getTextureMipSize(format, width, height));
+      VkHal::compressTexture(format, texels.data(), width, height, blocks.data(), &workers, workers.getWorkerCount());
+      VkHal::decompressTexture(format, blocks.data(), width, height, decodedTexels.data());
+
+      auto psnr = VkHal::computeTexturePsnr(format, texels.data(), decodedTexels.data(), width, height);
+      check(psnr >= c_minTexturePsnr, "Texture compression quality is under the PSNR threshold for "s + textureName + " in " + VkHal::getTextureFormatName(format) + ".");
+    }
+  }
+}
+} // namespace VkHalTests
@@ -0,0 +1,89 @@
+#include <array>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "VkHal/VertexLayout.h"
+#include "VkHal/VkMesh.h"
+
+#include "VkHalTests.h"
+
+using namespace std::literals::string_literals;
+
+namespace VkHalTests
+{
+namespace
+{
+/** @brief Random vertices in the box [center - extent, center + extent]. Normals point every way and texture coordinates repeat outside [0, 1]. */
+std::vector<VkHal::Vertex> createVertices(const glm::vec3& center, const glm::vec3& extent, uint32_t vertexCount)
+{
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+  std::vector<VkHal::Vertex> vertices;
+  for (uint32_t i = 0; i < vertexCount; i++)
+  {
+    auto position = center + extent * glm::vec3(unit(random), unit(random), unit(random));
+    auto normal = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(1.0e-3f));
+    vertices.push_back({position, normal, glm::vec2(unit(random), unit(random)) * 2.5f + 0.5f});
+  }
+
+  // The octahedral folds are at the axes and on the diagonals of the lower hemisphere.
+  for (const auto& normal : {glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1), glm::normalize(glm::vec3(1, 1, -1)), glm::normalize(glm::vec3(-1, 1, -1))})
+  {
+    vertices.push_back({center, normal, glm::vec2(0.5f)});
+  }
+  return vertices;
+}
+
+void checkRoundTrip(const VkHal::VertexLayout& layout, const std::vector<VkHal::Vertex>& vertices)
+{
+  std::array<std::vector<uint8_t>, VkHal::c_maxVertexStreamCount> streamData;
+  VkHal::VertexStreamPointers streams{};
+  for (uint32_t stream = 0; stream < layout.getStreamCount(); stream++)
+  {
+    streamData[stream].resize((size_t)layout.getStreamStride(stream) * vertices.size());
+    streams[stream] = streamData[stream].data();
+  }
+
+  auto dequantization = layout.computeDequantization(vertices.data(), vertices.size());
+  layout.encode(vertices.data(), vertices.size(), dequantization, streams);
+
+  std::vector<VkHal::Vertex> decodedVertices(vertices.size());
+  layout.decode({streams[0], streams[1]}, vertices.size(), dequantization, decodedVertices.data());
+
+  const auto& desc = layout.getDesc();
+  auto layoutName = "position "s + std::to_string((uint32_t)desc.m_position) + ", normal " + std::to_string((uint32_t)desc.m_normal) + ", texture coordinate " + std::to_string((uint32_t)desc.m_texCoord) + ", streams " + std::to_string((uint32_t)desc.m_streams);
+  auto error = layout.measureError(vertices.data(), decodedVertices.data(), vertices.size());
+  auto errorBound = layout.getErrorBound(dequantization);
+  check(error.m_position <= errorBound.m_position, "Vertex position error is over its bound for " + layoutName + ".");
+  check(error.m_normal <= errorBound.m_normal, "Vertex normal error is over its bound for " + layoutName + ".");
+  check(error.m_texCoord <= errorBound.m_texCoord, "Vertex texture coordinate error is over its bound for " + layoutName + ".");
+}
+} // namespace
+
+void testVertexLayout()
+{
+  // Away from the origin, so the float rounding of the dequantization counts, and flat on z, which keeps a unit scale.
+  const std::vector<VkHal::Vertex> meshes[] = {createVertices(glm::vec3(120.0f, -35.0f, 8.0f), glm::vec3(4.0f, 0.5f, 2.0f), 4096), createVertices(glm::vec3(0.0f), glm::vec3(1.0f, 1.0f, 0.0f), 1024)};
+
+  for (auto position : {VkHal::PositionEncoding::eFloat32, VkHal::PositionEncoding::eFloat16, VkHal::PositionEncoding::eSnorm16})
+  {
+    for (auto normal : {VkHal::NormalEncoding::eNone, VkHal::NormalEncoding::eFloat32, VkHal::NormalEncoding::eOctahedralSnorm16})
+    {
+      for (auto texCoord : {VkHal::TexCoordEncoding::eNone, VkHal::TexCoordEncoding::eFloat32, VkHal::TexCoordEncoding::eUnorm16})
+      {
+        for (auto streams : {VkHal::VertexStreams::eInterleaved, VkHal::VertexStreams::ePositionSplit})
+        {
+          VkHal::VertexLayout layout({position, normal, texCoord, streams});
+          for (const auto& vertices : meshes)
+          {
+            checkRoundTrip(layout, vertices);
+          }
+        }
+      }
+    }
+  }
+}
+} // namespace VkHalTests
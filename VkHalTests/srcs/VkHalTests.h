@@ -0,0 +1,29 @@
+#pragma once
+
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+namespace VkHalTests
+{
+/** @brief Fails the running test with message. */
+inline void check(bool condition, const std::string& message)
+{
+  if (!condition)
+  {
+    throw std::runtime_error(message);
+  }
+}
+
+/** @brief Data directory of the repository, the first argument of the test executable or found from its path. */
+const std::filesystem::path& getDataPath();
+
+/** @brief Simplifies generated meshes for a range of target errors. Every simplification must be deterministic and stay under its target error. */
+void testMeshSimplification();
+
+/** @brief Encodes the repository textures to every block compressed format. The decoded texels must stay over the PSNR threshold. */
+void testTextureCompression();
+
+/** @brief Encodes generated vertices with every vertex layout. The decoded vertices must stay within the error bound of the layout. */
+void testVertexLayout();
+} // namespace VkHalTests
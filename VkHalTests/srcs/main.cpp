@@ -0,0 +1,52 @@
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <utility>
+
+#include "VkHalTests.h"
+
+namespace VkHalTests
+{
+namespace
+{
+std::filesystem::path dataPath;
+} // namespace
+
+const std::filesystem::path& getDataPath()
+{
+  return dataPath;
+}
+} // namespace VkHalTests
+
+int main(int argc, char* argv[])
+{
+  // Built to _Bin/<platform>/<configuration> under the repository, like the apps.
+  VkHalTests::dataPath = argc > 1 ? std::filesystem::path(argv[1]) : std::filesystem::absolute(argv[0]).parent_path() / ".." / ".." / ".." / "data";
+
+  const std::pair<const char*, void (*)()> tests[] = {
+      {"MeshSimplification", VkHalTests::testMeshSimplification},
+      {"TextureCompression", VkHalTests::testTextureCompression},
+      {"VertexLayout", VkHalTests::testVertexLayout},
+  };
+
+  uint32_t failedCount = 0;
+  for (const auto& [testName, testFunc] : tests)
+  {
+    try
+    {
+      testFunc();
+      std::cout << "[  OK  ] " << testName << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+      failedCount++;
+      std::cout << "[FAILED] " << testName << ": " << e.what() << std::endl;
+    }
+  }
+
+  std::cout << failedCount << " of " << std::size(tests) << " tests failed" << std::endl;
+  return failedCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
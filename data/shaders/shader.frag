@@ -1,8 +1,8 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) in vec4 fragBaseColor;
 
 layout(binding = 1) uniform sampler2D texSampler;
 
@@ -10,7 +10,6 @@ layout(location = 0) out vec4 outColor;
 
 void main()
 {
-  //outColor = vec4(fragColor, 1.0);
   //outColor = vec4(fragTexCoord, 0.0, 1.0);
-  outColor = texture(texSampler, fragTexCoord);
+  outColor = texture(texSampler, fragTexCoord) * fragBaseColor;
 }
\ No newline at end of file
@@ -9,12 +9,20 @@ layout(set = 0, binding = 0) uniform UniformBufferObject
 }
 ubo;
 
+layout(push_constant) uniform DrawConstants
+{
+  mat4 model; // Includes the position dequantization of the mesh.
+  vec4 baseColor;
+  vec4 texCoordTransform; // xy scale, zw offset.
+}
+draw;
+
+// Locations match VertexLayout, normals at location 1 are not streamed yet.
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
 
-layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec4 fragBaseColor;
 
 out gl_PerVertex
 {
@@ -41,7 +49,7 @@ void main()
   // gl_Position = vec4(inPosition, 0.0, 1.0);
   // fragColor = inColor;
 
-  gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
-  fragColor = inColor;
-  fragTexCoord = inTexCoord;
+  gl_Position = ubo.proj * ubo.view * ubo.model * draw.model * vec4(inPosition, 1.0);
+  fragTexCoord = inTexCoord * draw.texCoordTransform.xy + draw.texCoordTransform.zw;
+  fragBaseColor = draw.baseColor;
 }
\ No newline at end of file